@@ -1,6 +1,17 @@
 # src/breathing_monitor/__init__.py
 
-from .video_streaming import VideoStreaming
-from .respiratory_monitoring import RespiratoryMonitoring
+# The modules are imported when they are used, so that importing one module of
+# the package, as the worker processes of combined_server do, does not need the
+# camera, radar and plotting dependencies of the others
 
-__all__ = ["VideoStreaming", "RespiratoryMonitoring"]
+__all__ = ["TCPVideoServer", "RespiratoryMonitoring"]
+
+
+def __getattr__(name):
+    if name == "TCPVideoServer":
+        from .video_streaming import TCPVideoServer
+        return TCPVideoServer
+    if name == "RespiratoryMonitoring":
+        from .respiratory_monitoring import RespiratoryMonitoring
+        return RespiratoryMonitoring
+    raise AttributeError(f"module {__name__!r} has no attribute {name!r}")
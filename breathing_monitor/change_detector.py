@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+# Skipping of unchanged video frames
+#
+# The nursery is static most of the night, so most frames need neither an
+# encode nor a send. The camera source returns a thumbnail of the luma plane of
+# its lores stream, every LUMA_STEP-th pixel of every LUMA_STEP-th row, and the
+# detector compares it block by block with the thumbnail of the last frame that
+# was sent. A frame is sent when the mean absolute difference of any block is
+# above the threshold, and then every frame for hold_s, and otherwise once every
+# keepalive_s so that the clients see that the stream is alive. Motion reported
+# by the radar also sends every frame for hold_s.
+#
+# Skipped frames are not sent at all, the wire format of the video stream stays
+# a length and a JPEG, and a client shows the last frame until the next one.
+#
+# Run with --self-test to check the motion onset latency with synthetic frames,
+# and with --measure CLIP to measure the savings on an alarm clip recorded by
+# event_clips.py (needs simplejpeg).
+
+import argparse
+import logging
+import math
+import threading
+import time
+from operator import sub
+
+logger = logging.getLogger("ChangeDetector")
+
+# Thumbnail of every 8th pixel of every 8th row, 80x45 for a 640x360 lores stream
+LUMA_STEP = 8
+# Blocks of 4x4 thumbnail pixels, 32x32 pixels of the lores stream
+BLOCK_SAMPLES = 4
+
+# Mean absolute luma difference of a block, 0-255, above the sensor noise of a dark scene
+CHANGE_THRESHOLD = 8.0
+KEEPALIVE_S = 1.0
+MOTION_HOLD_S = 2.0
+
+
+class ChangeDetector:
+    """Decides which frames are sent, from their luma thumbnails.
+
+    update() is called from the capture thread, report_motion() may be called
+    from any thread.
+    """
+
+    def __init__(self, threshold=CHANGE_THRESHOLD, keepalive_s=KEEPALIVE_S, hold_s=MOTION_HOLD_S,
+                 step=LUMA_STEP, block=BLOCK_SAMPLES):
+        self.threshold = threshold
+        self.keepalive_s = keepalive_s
+        self.hold_s = hold_s
+        self.step = step
+        self.block = block
+
+        # Thumbnail of the last frame sent, and its size
+        self.reference = None
+        self.reference_size = None
+        self.last_sent = -math.inf
+        self.active_until = -math.inf
+        self.lock = threading.Lock()
+
+        self.frames = 0
+        self.frames_sent = 0
+        self.last_score = 0.0
+
+    def report_motion(self, timestamp):
+        """Send every frame until hold_s after timestamp, a time.time() value."""
+        with self.lock:
+            self.active_until = max(self.active_until, timestamp + self.hold_s)
+
+    def update(self, thumbnail, now):
+        """Return whether the frame of a (luma bytes, width, height) thumbnail is sent."""
+        luma, width, height = thumbnail
+        self.frames += 1
+
+        if self.reference is None or self.reference_size != (width, height):
+            send = True
+        else:
+            self.last_score = self.score(luma, width, height)
+            with self.lock:
+                if self.last_score > self.threshold:
+                    self.active_until = max(self.active_until, now + self.hold_s)
+                send = now < self.active_until or now - self.last_sent >= self.keepalive_s
+
+        if send:
+            self.reference = luma
+            self.reference_size = (width, height)
+            self.last_sent = now
+            self.frames_sent += 1
+        return send
+
+    def score(self, luma, width, height):
+        """The largest mean absolute difference of a block from the reference thumbnail."""
+        block = self.block
+        diffs = list(map(abs, map(sub, luma, self.reference)))
+        worst = 0.0
+        for top in range(0, height, block):
+            rows = range(top * width, min(top + block, height) * width, width)
+            for left in range(0, width, block):
+                right = min(left + block, width)
+                total = sum(sum(diffs[row + left:row + right]) for row in rows)
+                worst = max(worst, total / (len(rows) * (right - left)))
+        return worst
+
+
+def measure(frames, detector):
+    """Replay (time, thumbnail, JPEG size) frames, return (frames, sent, bytes, sent bytes, seconds per update)."""
+    count = sent = total_bytes = sent_bytes = 0
+    elapsed = 0.0
+    for frame_time, thumbnail, size in frames:
+        began = time.perf_counter()
+        send = detector.update(thumbnail, frame_time)
+        elapsed += time.perf_counter() - began
+
+        count += 1
+        total_bytes += size
+        if send:
+            sent += 1
+            sent_bytes += size
+    return count, sent, total_bytes, sent_bytes, elapsed / max(count, 1)
+
+
+def _print_savings(name, result, encode_s=None):
+    count, sent, total_bytes, sent_bytes, update_s = result
+    print(f"{name}: sent {sent} of {count} frames ({100.0 * sent / max(count, 1):.1f} %), "
+          f"{sent_bytes / 1e6:.1f} of {total_bytes / 1e6:.1f} MB, detector {update_s * 1e3:.2f} ms/frame")
+    if encode_s is not None:
+        saved = (count - sent) * encode_s - count * update_s
+        print(f"{name}: encode {encode_s * 1e3:.2f} ms/frame, saved {saved:.1f} s of CPU "
+              f"({100.0 * saved / max(count * encode_s, 1e-9):.0f} % of the encoding)")
+
+
+def measure_clip(path, threshold, quality=60):
+    """Replay an alarm clip recorded by event_clips.py through the detector.
+
+    The encode time of a skipped frame is estimated with a grey scale encode of
+    the decoded frame at the clip quality.
+    """
+    import simplejpeg
+    from breathing_monitor.event_clips import read_clip
+
+    info, jpegs = read_clip(path)
+    frames = []
+    encode_s = 0.0
+    for frame, data in zip(info["frames"], jpegs):
+        gray = simplejpeg.decode_jpeg(data, colorspace="GRAY")
+        began = time.perf_counter()
+        simplejpeg.encode_jpeg(gray, quality=quality, colorspace="GRAY")
+        encode_s += time.perf_counter() - began
+        # The clip is the lores stream already, the thumbnail is taken the same way
+        thumbnail = gray[::LUMA_STEP, ::LUMA_STEP, 0]
+        frames.append((frame["time"], (thumbnail.tobytes(), thumbnail.shape[1], thumbnail.shape[0]), len(data)))
+
+    _print_savings(path, measure(frames, ChangeDetector(threshold)), encode_s / max(len(frames), 1))
+
+
+def run_self_test(framerate):
+    # Imported here so that the detector does not depend on the video service
+    from breathing_monitor.video_ladder import FakeCameraSource, LadderStreamer, Rung, _ThrottledReader
+    import socket
+
+    ok = True
+
+    def check(condition, message):
+        nonlocal ok
+        print(f"{'OK    ' if condition else 'FAILED'} {message}")
+        ok = ok and condition
+
+    # Savings on a synthetic night: still, with noise, and a few seconds of motion a minute
+    source = FakeCameraSource((1280, 720), framerate)
+    frames = []
+    for sequence in range(5 * 60 * framerate):
+        moving = sequence % (60 * framerate) < 3 * framerate
+        frame = {"sequence": sequence, "time": sequence / framerate, "motion": moving}
+        frames.append((frame["time"], source.luma(frame, LUMA_STEP), len(source.encode(frame, "main", 90))))
+    result = measure(frames, ChangeDetector())
+    _print_savings("Synthetic night, 5 min", result)
+    count, sent, _, _, update_s = result
+    expected = 5 * ((3 + MOTION_HOLD_S) * framerate + (57 - MOTION_HOLD_S) / KEEPALIVE_S)
+    check(sent <= 1.2 * expected, "a still scene is sent at the keep-alive rate only")
+    check(update_s < 0.2 / framerate, "the detector takes a small part of the frame interval")
+
+    # Motion onset latency through the streamer
+    source = FakeCameraSource((1280, 720), framerate)
+    source.start()
+    detector = ChangeDetector()
+    streamer = LadderStreamer(source, framerate, change_detector=detector)
+    streamer.start()
+    # Like the alarm clip recorder, a sink must get its full rate in a still scene
+    sink_times = []
+    streamer.add_sink(lambda capture_time, data: sink_times.append(time.monotonic()), Rung("lores", 60, 2))
+
+    server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server_socket.bind(("127.0.0.1", 0))
+    server_socket.listen(1)
+    port = server_socket.getsockname()[1]
+    threading.Thread(target=lambda: streamer.add_client(server_socket.accept()[0]), daemon=True).start()
+    client = _ThrottledReader(port)
+
+    def rate(start, end):
+        return len(client.between(start, end)) / (end - start)
+
+    def first_after(start):
+        # (receive time, stream, quality, sequence, capture time)
+        return next((frame for frame in client.frames if frame[4] >= start), None)
+
+    time.sleep(3.0)
+    motion_start = time.monotonic()
+    source.motion = True
+    time.sleep(2.0)
+    source.motion = False
+    motion_end = time.monotonic()
+    time.sleep(MOTION_HOLD_S + 3.0)
+    radar_motion = time.monotonic()
+    detector.report_motion(time.time())
+    time.sleep(1.0)
+    end = time.monotonic()
+
+    client.close()
+    server_socket.close()
+    streamer.stop()
+
+    still_rate = rate(motion_start - 2.0, motion_start)
+    sink_still_rate = sum(1 for t in sink_times if motion_start - 2.0 <= t < motion_start) / 2.0
+    onset = first_after(motion_start)
+    onset_latency = onset[0] - motion_start if onset else math.inf
+    print(f"Still {still_rate:.1f} fps, motion {rate(motion_start + 0.2, motion_end):.1f} fps, "
+          f"after the hold {rate(motion_end + MOTION_HOLD_S + 0.5, radar_motion):.1f} fps, "
+          f"radar motion {rate(radar_motion + 0.1, end):.1f} fps, motion onset latency {onset_latency * 1000:.0f} ms, "
+          f"sink in the still scene {sink_still_rate:.1f} fps")
+    check(still_rate <= 1.5 / KEEPALIVE_S, "a still scene is streamed at the keep-alive rate")
+    check(sink_still_rate >= 0.8 * framerate / 2, "a sink gets its full rate in a still scene")
+    check(onset_latency <= 2.0 / framerate + 0.02, "the first moving frame arrives within two frame intervals")
+    check(rate(motion_start + 0.2, motion_end) >= 0.9 * framerate, "motion is streamed at the full rate")
+    check(rate(motion_end + MOTION_HOLD_S + 0.5, radar_motion) <= 1.5 / KEEPALIVE_S,
+          "the stream returns to the keep-alive rate after the hold")
+    check(rate(radar_motion + 0.1, end) >= 0.9 * framerate, "radar motion resumes the full rate")
+    return ok
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Skipping of unchanged video frames")
+    parser.add_argument("--self-test", action="store_true",
+                        help="Check the motion onset latency and the savings with synthetic frames")
+    parser.add_argument("--measure", metavar="CLIP", nargs="+", default=[],
+                        help="Alarm clips to measure the savings on, without the .json/.mjpeg extension")
+    parser.add_argument("--framerate", type=int, default=30)
+    parser.add_argument("--threshold", type=float, default=CHANGE_THRESHOLD)
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+
+    for clip in args.measure:
+        measure_clip(clip, args.threshold)
+    if args.self_test or not args.measure:
+        raise SystemExit(0 if run_self_test(args.framerate) else 1)
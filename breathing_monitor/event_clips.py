@@ -0,0 +1,330 @@
+#!/usr/bin/env python3
+# Pre/post-event video clips around breathing alarms
+#
+# The last few seconds of encoded video frames and radar results are kept in
+# memory. When an alarm is raised, the frames and results from pre_seconds
+# before it to post_seconds after it are written to a clip on a background
+# thread, so nothing is written to the SD card until something happens.
+#
+# A clip is two files with the same name:
+#   <name>.mjpeg  the JPEG frames back to back, playable with ffplay -f mjpeg
+#   <name>.json   the alarm, the time, offset and size of every frame and the
+#                 radar results for the same interval
+# The .json file is written last, so a clip without one is incomplete.
+#
+# Run with --self-test to raise a synthetic alarm on a fake camera and check
+# the clip contents and timing.
+
+import argparse
+import json
+import logging
+import os
+import shutil
+import socket
+import struct
+import tempfile
+import threading
+import time
+from collections import deque
+
+logger = logging.getLogger("EventClips")
+
+# Radar alerts that start a clip
+ALARM_ALERTS = ("Child not moving",)
+
+# A clip that is extended by new alarms is cut at this length
+MAX_CLIP_SECONDS = 60.0
+
+# Write the clip without the last frames if the camera stops delivering them
+FLUSH_TIMEOUT_S = 2.0
+
+
+class ClipRecorder:
+    """Ring of encoded frames and radar results, flushed to a clip file on an alarm.
+
+    The frame ring holds at most max_bytes of JPEG data. While a clip is pending
+    the frames back to its start are kept, within the same bound, and the
+    frames that had to be dropped are counted in the clip.
+    """
+
+    def __init__(self, directory, pre_seconds=10.0, post_seconds=5.0, max_bytes=32 * 1024 * 1024):
+        self.directory = directory
+        self.pre_seconds = pre_seconds
+        self.post_seconds = post_seconds
+        self.max_bytes = max_bytes
+
+        self.frames = deque()  # (time, JPEG)
+        self.frame_bytes = 0
+        self.peak_frame_bytes = 0
+        self.radar = deque()  # (time, result)
+        self.last_alert = None
+
+        self.pending = None
+        self.clips = []
+        self.condition = threading.Condition()
+        self.is_running = False
+        self.writer = None
+
+    def start(self):
+        self.is_running = True
+        self.writer = threading.Thread(target=self._writer_loop, daemon=True)
+        self.writer.start()
+
+    def stop(self):
+        """Stop, writing a pending clip with the frames recorded so far."""
+        with self.condition:
+            self.is_running = False
+            self.condition.notify_all()
+        if self.writer:
+            self.writer.join()
+
+    def add_frame(self, timestamp, data):
+        with self.condition:
+            self.frames.append((timestamp, data))
+            self.frame_bytes += len(data)
+
+            keep_from = self._keep_from(timestamp)
+            while self.frames and (self.frames[0][0] < keep_from or self.frame_bytes > self.max_bytes):
+                frame_time, frame = self.frames.popleft()
+                self.frame_bytes -= len(frame)
+                if self.pending and frame_time >= self.pending["start_time"]:
+                    self.pending["frames_dropped"] += 1
+
+            self.peak_frame_bytes = max(self.peak_frame_bytes, self.frame_bytes)
+
+            if self.pending and timestamp >= self.pending["end_time"]:
+                self.condition.notify_all()
+
+    def add_radar(self, result):
+        """Add a radar result, with timestamp and alert, and start a clip if it raises an alarm."""
+        timestamp = result["timestamp"]
+        alert = result.get("alert")
+
+        with self.condition:
+            self.radar.append((timestamp, result))
+            keep_from = self._keep_from(timestamp)
+            while self.radar and self.radar[0][0] < keep_from:
+                self.radar.popleft()
+
+            raised = alert in ALARM_ALERTS and alert != self.last_alert
+            self.last_alert = alert
+
+        if raised:
+            self.trigger(alert, timestamp)
+
+    def trigger(self, reason, timestamp=None):
+        """Start a clip around timestamp, or extend the pending one."""
+        if timestamp is None:
+            timestamp = time.time()
+
+        with self.condition:
+            if self.pending is None:
+                self.pending = {
+                    "reason": reason,
+                    "trigger_time": timestamp,
+                    "start_time": timestamp - self.pre_seconds,
+                    "end_time": timestamp + self.post_seconds,
+                    "alarms": [],
+                    "frames_dropped": 0,
+                }
+                logger.info(f"Alarm '{reason}', recording a clip until {self.post_seconds} s from now.")
+            else:
+                self.pending["end_time"] = min(max(self.pending["end_time"], timestamp + self.post_seconds),
+                                               self.pending["start_time"] + MAX_CLIP_SECONDS)
+            self.pending["alarms"].append({"reason": reason, "time": timestamp})
+
+    def _keep_from(self, now):
+        keep_from = now - self.pre_seconds
+        if self.pending:
+            keep_from = min(keep_from, self.pending["start_time"])
+        return keep_from
+
+    def _clip_ready(self):
+        if self.pending is None:
+            return False
+        newest = self.frames[-1][0] if self.frames else 0.0
+        return (not self.is_running or newest >= self.pending["end_time"] or
+                time.time() >= self.pending["end_time"] + FLUSH_TIMEOUT_S)
+
+    def _writer_loop(self):
+        while True:
+            with self.condition:
+                self.condition.wait_for(lambda: self._clip_ready() or not self.is_running, timeout=0.5)
+                if not self._clip_ready():
+                    if not self.is_running:
+                        return
+                    continue
+
+                # Take references to the clip's frames and results, the writing is done unlocked
+                clip = self.pending
+                self.pending = None
+                frames = [frame for frame in self.frames if clip["start_time"] <= frame[0] <= clip["end_time"]]
+                radar = [result for t, result in self.radar if clip["start_time"] <= t <= clip["end_time"]]
+
+            try:
+                self._write_clip(clip, frames, radar)
+            except OSError as e:
+                logger.error(f"Failed to write clip: {e}")
+
+    def _write_clip(self, clip, frames, radar):
+        os.makedirs(self.directory, exist_ok=True)
+        trigger_time = clip["trigger_time"]
+        name = time.strftime("clip_%Y%m%d_%H%M%S", time.localtime(trigger_time)) + f"_{int(trigger_time * 1000) % 1000:03d}"
+        path = os.path.join(self.directory, name)
+
+        index = []
+        offset = 0
+        with open(path + ".mjpeg.tmp", "wb") as video_file:
+            for frame_time, data in frames:
+                video_file.write(data)
+                index.append({"time": frame_time, "offset": offset, "size": len(data)})
+                offset += len(data)
+        os.replace(path + ".mjpeg.tmp", path + ".mjpeg")
+
+        clip = dict(clip, frames=index, radar=radar, written_time=time.time())
+        with open(path + ".json.tmp", "w") as info_file:
+            json.dump(clip, info_file)
+        os.replace(path + ".json.tmp", path + ".json")
+
+        self.clips.append(path)
+        logger.info(f"Wrote clip {path} with {len(frames)} frames and {len(radar)} radar results "
+                    f"({clip['frames_dropped']} frames dropped by the memory bound).")
+
+
+def read_clip(path):
+    """Return the clip info and its frames."""
+    with open(path + ".json") as info_file:
+        info = json.load(info_file)
+    with open(path + ".mjpeg", "rb") as video_file:
+        video = video_file.read()
+    return info, [video[frame["offset"]:frame["offset"] + frame["size"]] for frame in info["frames"]]
+
+
+def run_self_test(framerate, pre_seconds, post_seconds):
+    """Raise a synthetic alarm while a fast client is streaming from a fake camera."""
+    # Imported here so that the recorder does not depend on the video service
+    from breathing_monitor.video_ladder import FakeCameraSource, LadderStreamer, Rung, parse_fake_frame
+
+    ok = True
+
+    def check(condition, message):
+        nonlocal ok
+        print(f"{'OK    ' if condition else 'FAILED'} {message}")
+        ok = ok and condition
+
+    directory = tempfile.mkdtemp(prefix="event_clips_")
+    clip_rung = Rung("lores", 60, 2)
+    clip_interval = clip_rung.skip / framerate
+    radar_rate = 30
+
+    source = FakeCameraSource((1280, 720), framerate)
+    source.start()
+    streamer = LadderStreamer(source, framerate)
+    streamer.start()
+
+    # A small memory bound for the second alarm, so that frames have to be dropped
+    frame_size = len(source.encode({"sequence": 0, "time": 0.0}, clip_rung.stream, clip_rung.quality))
+    recorder = ClipRecorder(directory, pre_seconds, post_seconds)
+    small_recorder = ClipRecorder(directory + "/small", pre_seconds, post_seconds, max_bytes=20 * frame_size)
+    recorder.start()
+    small_recorder.start()
+    streamer.add_sink(recorder.add_frame, clip_rung)
+    streamer.add_sink(small_recorder.add_frame, clip_rung)
+
+    # A client reading the live stream while the clip is recorded and written
+    server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server_socket.bind(("127.0.0.1", 0))
+    server_socket.listen(1)
+    client = socket.create_connection(server_socket.getsockname())
+    streamer.add_client(server_socket.accept()[0])
+    live_frames = []
+
+    def read_live():
+        try:
+            while True:
+                header = client.recv(4, socket.MSG_WAITALL)
+                (size,) = struct.unpack(">L", header)
+                client.recv(size, socket.MSG_WAITALL)
+                live_frames.append(time.monotonic())
+        except (OSError, struct.error):
+            pass
+
+    threading.Thread(target=read_live, daemon=True).start()
+
+    # Synthetic radar results, the alert is raised once
+    start = time.time()
+    live_start = time.monotonic()
+    alarm_time = start + pre_seconds + 1.0
+    end = alarm_time + post_seconds + FLUSH_TIMEOUT_S
+    while time.time() < end:
+        now = time.time()
+        result = {"timestamp": now, "waveform": [0.0], "motion_state": "Stable breathing waveform",
+                  "alert": "Child not moving" if alarm_time <= now < alarm_time + 1.0 else "Normal"}
+        recorder.add_radar(result)
+        small_recorder.add_radar(result)
+        time.sleep(1.0 / radar_rate)
+
+    client.close()
+    server_socket.close()
+    streamer.stop()
+    recorder.stop()
+    small_recorder.stop()
+
+    check(len(recorder.clips) == 1, "one clip is written for one alarm")
+    if recorder.clips:
+        info, frames = read_clip(recorder.clips[0])
+        times = [frame["time"] for frame in info["frames"]]
+        trigger_time = info["trigger_time"]
+        sequences = [parse_fake_frame(frame)[2] for frame in frames]
+        expected = (pre_seconds + post_seconds) / clip_interval
+
+        print(f"Clip: {len(frames)} frames from {times[0] - trigger_time:+.3f} s to {times[-1] - trigger_time:+.3f} s, "
+              f"{len(info['radar'])} radar results, written {info['written_time'] - info['end_time']:.3f} s after its end")
+        check(abs(trigger_time - alarm_time) < 2.0 / radar_rate, "the clip starts at the radar alarm")
+        check(-pre_seconds <= times[0] - trigger_time <= -pre_seconds + 2 * clip_interval,
+              f"the clip starts {pre_seconds} s before the alarm")
+        check(post_seconds - 2 * clip_interval <= times[-1] - trigger_time <= post_seconds,
+              f"the clip ends {post_seconds} s after the alarm")
+        check(abs(len(frames) - expected) <= 2, f"the clip has {expected:.0f} frames, give or take 2")
+        check(all(frame[:2] == b"\xff\xd8" and frame[-2:] == b"\xff\xd9" for frame in frames) and
+              all(b - a == clip_rung.skip for a, b in zip(sequences, sequences[1:])),
+              "the clip frames are whole and consecutive")
+        check(info["radar"][0]["timestamp"] - info["start_time"] <= 2.0 / radar_rate and
+              info["end_time"] - info["radar"][-1]["timestamp"] <= 2.0 / radar_rate,
+              "the radar results cover the same interval")
+        check(0.0 <= info["written_time"] - info["end_time"] < 1.0, "the clip is written within 1 s of its end")
+
+    check(small_recorder.peak_frame_bytes <= small_recorder.max_bytes, "the frame ring stays within its memory bound")
+    if small_recorder.clips:
+        info, frames = read_clip(small_recorder.clips[0])
+        check(info["frames_dropped"] > 0 and len(frames) <= 20,
+              f"a clip longer than the bound keeps the newest frames, {info['frames_dropped']} dropped")
+
+    live = [t for t in live_frames if live_start + 1.0 <= t]
+    live_duration = live_frames[-1] - (live_start + 1.0) if live else 0.0
+    live_fps = (len(live) - 1) / live_duration if live_duration > 0 else 0.0
+    print(f"Live stream: {live_fps:.1f} fps while recording")
+    check(live_fps >= 0.9 * framerate, "the live stream keeps its frame rate")
+
+    shutil.rmtree(directory)
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pre/post-event video clips")
+    parser.add_argument("--self-test", action="store_true", help="Check a clip around a synthetic alarm")
+    parser.add_argument("--framerate", type=int, default=30)
+    parser.add_argument("--pre-seconds", type=float, default=3.0)
+    parser.add_argument("--post-seconds", type=float, default=2.0)
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+
+    if args.self_test:
+        raise SystemExit(0 if run_self_test(args.framerate, args.pre_seconds, args.post_seconds) else 1)
+
+    parser.print_help()
+
+
+if __name__ == "__main__":
+    main()
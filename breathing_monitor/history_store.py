@@ -0,0 +1,674 @@
+#!/usr/bin/env python3
+# Append-only store of the breathing history on the device
+#
+# Every radar result is reduced to a sample of the breathing rate, the signal
+# quality, the motion state and the alarm, and appended by a background thread
+# to memory mapped segment files in one directory. Rollups with the min, max and
+# mean of every second, minute and hour are appended next to the samples, each
+# level built from the one below, so a query over days reads a few hundred
+# rollups instead of millions of samples. Alarm onsets and ends are appended to
+# an event level of their own.
+#
+# A segment is a 64 byte header followed by fixed size records, each with a
+# CRC32. The unwritten part of a segment is zero. The pages of a mapping reach
+# the disk in any order, so after a power loss a zero record can be followed by
+# written ones. The end of a segment is therefore found after the last record
+# that passes its CRC when it is opened, and the torn records after it are
+# overwritten. A damaged or lost record elsewhere is skipped when it is read,
+# and a segment with a damaged header is renamed to *.corrupt. The open rollup
+# of every level is rebuilt from the level below when the store is opened.
+#
+# Run with --self-test to check the rollups and the recovery from damaged
+# segments, and with --benchmark to measure the append and query throughput.
+
+import argparse
+import logging
+import math
+import mmap
+import os
+import queue
+import random
+import shutil
+import statistics
+import struct
+import tempfile
+import threading
+import time
+import zlib
+from collections import deque, namedtuple
+
+logger = logging.getLogger("HistoryStore")
+
+# Radar alerts that count as an alarm, and motion states that count as motion
+ALARM_ALERTS = ("Child not moving",)
+MOTION_STATES = ("Child in motion",)
+
+# Sample states
+STATE_STABLE = 0
+STATE_MOTION = 1
+
+# Sample flags
+FLAG_ALARM = 0x01
+
+Sample = namedtuple("Sample", "time rate quality state flags")
+Rollup = namedtuple("Rollup", "start count rate_count rate_min rate_max rate_mean "
+                              "quality_min quality_max quality_mean motion alarm")
+
+# Records, followed by a CRC32 of the record
+SAMPLE_RECORD = struct.Struct("<dffBB2x")
+ROLLUP_RECORD = struct.Struct("<dIIffffffII")
+CRC = struct.Struct("<I")
+TIME = struct.Struct("<d")
+
+# Segment header: magic, version, record size (with the CRC), capacity in records
+SEGMENT_HEADER = struct.Struct("<4sHHI")
+SEGMENT_HEADER_SIZE = 64
+SEGMENT_MAGIC = b"BRHS"
+SEGMENT_VERSION = 1
+SEGMENT_RECORDS = 65536
+
+# Levels, the rollups with the length of their buckets, finest first
+SAMPLES = "samples"
+EVENTS = "events"
+ROLLUPS = (("1s", 1), ("1m", 60), ("1h", 3600))
+
+# Segments kept per level, about a day of samples at 30 Hz, a week of seconds,
+# a year of minutes and all hours and events
+MAX_SEGMENTS = {SAMPLES: 40, EVENTS: None, "1s": 10, "1m": 8, "1h": None}
+
+# Samples waiting for the writer thread before new ones are dropped
+QUEUE_SIZE = 10000
+# Written segments are flushed to the file at least this often
+FLUSH_INTERVAL_S = 5.0
+# A query returns at most this many rollups unless asked for more
+MAX_QUERY_POINTS = 1000
+
+# The rate is estimated from the breathing cycles of the last RATE_WINDOW_S
+RATE_WINDOW_S = 30.0
+RATE_ESTIMATE_INTERVAL_S = 1.0
+
+
+class _Segment:
+    """One memory mapped segment file of fixed size records."""
+
+    def __init__(self, path, record, capacity=None):
+        self.path = path
+        self.record = record
+        self.record_size = record.size + CRC.size
+
+        if capacity is not None:
+            with open(path, "w+b") as f:
+                f.write(SEGMENT_HEADER.pack(SEGMENT_MAGIC, SEGMENT_VERSION, self.record_size, capacity)
+                        .ljust(SEGMENT_HEADER_SIZE, b"\0"))
+                f.truncate(SEGMENT_HEADER_SIZE + capacity * self.record_size)
+                self.map = mmap.mmap(f.fileno(), 0)
+        else:
+            with open(path, "r+b") as f:
+                self.map = mmap.mmap(f.fileno(), 0)
+
+        magic, version, record_size, capacity = SEGMENT_HEADER.unpack_from(self.map, 0)
+        if (magic != SEGMENT_MAGIC or version != SEGMENT_VERSION or record_size != self.record_size or
+                len(self.map) < SEGMENT_HEADER_SIZE + capacity * record_size):
+            self.map.close()
+            raise ValueError(f"{path} is not a history segment of this version")
+
+        self.capacity = capacity
+        self.length = self._find_end()
+
+    def _offset(self, index):
+        return SEGMENT_HEADER_SIZE + index * self.record_size
+
+    def _find_end(self):
+        # A record is never all zero, the records up to the last non-zero byte may have been written
+        written = len(self.map[SEGMENT_HEADER_SIZE:self._offset(self.capacity)].rstrip(b"\0"))
+        used = (written + self.record_size - 1) // self.record_size
+
+        # Records that fail their CRC after the last good one were torn while they were written.
+        # A zero or damaged record before it is kept, and skipped when it is read.
+        end = used
+        while end > 0 and self.get(end - 1) is None:
+            end -= 1
+        if end < used:
+            self.map[self._offset(end):self._offset(used)] = bytes(self._offset(used) - self._offset(end))
+        return end
+
+    @property
+    def full(self):
+        return self.length >= self.capacity
+
+    def time(self, index):
+        return TIME.unpack_from(self.map, self._offset(index))[0]
+
+    def get(self, index):
+        """Return the values of a record, None if it fails its CRC."""
+        offset = self._offset(index)
+        data = self.map[offset:offset + self.record_size]
+        if zlib.crc32(data[:-CRC.size]) != CRC.unpack_from(data, self.record.size)[0]:
+            return None
+        return self.record.unpack_from(data)
+
+    def append(self, values):
+        data = self.record.pack(*values)
+        offset = self._offset(self.length)
+        self.map[offset:offset + self.record_size] = data + CRC.pack(zlib.crc32(data))
+        self.length += 1
+
+    def find(self, start):
+        """Return the index of the first record at or after start."""
+        low, high = 0, self.length
+        while low < high:
+            middle = (low + high) // 2
+            if self.time(middle) < start:
+                low = middle + 1
+            else:
+                high = middle
+        return low
+
+    def flush(self):
+        self.map.flush()
+
+
+class _Level:
+    """The segments of one level, oldest first, named <level>-<number>.seg."""
+
+    def __init__(self, directory, name, record, segment_records, max_segments):
+        self.directory = directory
+        self.name = name
+        self.record = record
+        self.segment_records = segment_records
+        self.max_segments = max_segments
+        self.lock = threading.Lock()
+        self.segments = []
+        self.next_number = 0
+
+        prefix = f"{name}-"
+        for file_name in sorted(os.listdir(directory)):
+            if not (file_name.startswith(prefix) and file_name.endswith(".seg")):
+                continue
+            path = os.path.join(directory, file_name)
+            self.next_number = int(file_name[len(prefix):-len(".seg")]) + 1
+            try:
+                segment = _Segment(path, record)
+            except (ValueError, OSError, struct.error) as e:
+                logger.error(f"Skipping a damaged segment: {e}")
+                os.replace(path, path + ".corrupt")
+                continue
+            if segment.length:
+                self.segments.append(segment)
+            else:
+                os.remove(path)
+
+    def last(self):
+        """Return the values of the last readable record, None if there is none."""
+        for segment in reversed(self.segments):
+            for index in range(segment.length - 1, -1, -1):
+                values = segment.get(index)
+                if values is not None:
+                    return values
+        return None
+
+    def append(self, values):
+        if not self.segments or self.segments[-1].full:
+            path = os.path.join(self.directory, f"{self.name}-{self.next_number:06d}.seg")
+            segment = _Segment(path, self.record, self.segment_records)
+            self.next_number += 1
+            with self.lock:
+                self.segments.append(segment)
+                while self.max_segments and len(self.segments) > self.max_segments:
+                    # Readers may still hold the mapping, it is released with the last reference
+                    os.remove(self.segments.pop(0).path)
+        self.segments[-1].append(values)
+
+    def read(self, start, end):
+        """Yield the values of the readable records with a time in [start, end)."""
+        with self.lock:
+            segments = list(self.segments)
+
+        # The last segment starting at or before start, segments start with a written record
+        first = 0
+        for i, segment in enumerate(segments):
+            if segment.time(0) <= start:
+                first = i
+
+        for segment in segments[first:]:
+            if segment.time(0) >= end:
+                return
+            for index in range(segment.find(start), segment.length):
+                values = segment.get(index)
+                if values is None:
+                    continue
+                if values[0] >= end:
+                    return
+                yield values
+
+    def flush(self):
+        if self.segments:
+            self.segments[-1].flush()
+
+
+class _Bucket:
+    """The open rollup of one level, fed with samples or the rollups of the level below."""
+
+    def __init__(self, start):
+        self.start = start
+        self.count = 0
+        self.rate_count = 0
+        self.rate_min = math.inf
+        self.rate_max = -math.inf
+        self.rate_sum = 0.0
+        self.quality_min = math.inf
+        self.quality_max = -math.inf
+        self.quality_sum = 0.0
+        self.motion = 0
+        self.alarm = 0
+
+    def add(self, item):
+        if isinstance(item, Sample):
+            self.count += 1
+            if not math.isnan(item.rate):
+                self.rate_count += 1
+                self.rate_min = min(self.rate_min, item.rate)
+                self.rate_max = max(self.rate_max, item.rate)
+                self.rate_sum += item.rate
+            self.quality_min = min(self.quality_min, item.quality)
+            self.quality_max = max(self.quality_max, item.quality)
+            self.quality_sum += item.quality
+            self.motion += item.state == STATE_MOTION
+            self.alarm += bool(item.flags & FLAG_ALARM)
+        else:
+            self.count += item.count
+            if item.rate_count:
+                self.rate_count += item.rate_count
+                self.rate_min = min(self.rate_min, item.rate_min)
+                self.rate_max = max(self.rate_max, item.rate_max)
+                self.rate_sum += item.rate_mean * item.rate_count
+            self.quality_min = min(self.quality_min, item.quality_min)
+            self.quality_max = max(self.quality_max, item.quality_max)
+            self.quality_sum += item.quality_mean * item.count
+            self.motion += item.motion
+            self.alarm += item.alarm
+
+    def rollup(self):
+        nan = math.nan
+        rate = (self.rate_min, self.rate_max, self.rate_sum / self.rate_count) if self.rate_count else (nan, nan, nan)
+        return Rollup(self.start, self.count, self.rate_count, *rate,
+                      self.quality_min, self.quality_max, self.quality_sum / self.count,
+                      self.motion, self.alarm)
+
+
+class BreathingRateEstimator:
+    """Breathing rate and signal quality from the cycles of a breathing signal.
+
+    A cycle starts where the signal rises through a band of a quarter of its
+    standard deviation around its mean. The rate is the mean cycle length, the
+    quality 1 minus the relative spread of the cycle lengths, so irregular or
+    noisy cycles give a low quality. The rate is NaN before two cycles are seen.
+    """
+
+    def __init__(self, window_s=RATE_WINDOW_S):
+        self.window_s = window_s
+        self.values = deque()  # (time, value)
+        self.rate = math.nan
+        self.quality = 0.0
+        self.estimate_time = -math.inf
+
+    def update(self, timestamp, value):
+        self.values.append((timestamp, value))
+        while self.values[0][0] < timestamp - self.window_s:
+            self.values.popleft()
+
+        if timestamp - self.estimate_time >= RATE_ESTIMATE_INTERVAL_S:
+            self.estimate_time = timestamp
+            self.rate, self.quality = self._estimate()
+        return self.rate, self.quality
+
+    def _estimate(self):
+        if len(self.values) < 3:
+            return math.nan, 0.0
+        signal = [value for _, value in self.values]
+        mean = statistics.fmean(signal)
+        band = 0.25 * statistics.pstdev(signal, mean)
+        if band == 0.0:
+            return math.nan, 0.0
+
+        starts = []
+        below = False
+        for t, value in self.values:
+            if value < mean - band:
+                below = True
+            elif below and value > mean + band:
+                starts.append(t)
+                below = False
+
+        periods = [b - a for a, b in zip(starts, starts[1:])]
+        if len(periods) < 2:
+            return math.nan, 0.0
+        period = statistics.fmean(periods)
+        return 60.0 / period, max(0.0, 1.0 - statistics.pstdev(periods, period) / period)
+
+
+class HistoryStore:
+    """Breathing history in segment files in a directory, written on a background thread.
+
+    Samples older than the last one written, after the clock was set back, and
+    samples that find the queue full are dropped and counted in dropped. A query
+    returns the complete rollups only, not the one that is still open.
+    """
+
+    def __init__(self, directory, segment_records=SEGMENT_RECORDS, max_segments=None):
+        self.directory = directory
+        os.makedirs(directory, exist_ok=True)
+        max_segments = dict(MAX_SEGMENTS, **(max_segments or {}))
+
+        self.levels = {SAMPLES: _Level(directory, SAMPLES, SAMPLE_RECORD, segment_records, max_segments[SAMPLES]),
+                       EVENTS: _Level(directory, EVENTS, SAMPLE_RECORD, segment_records, max_segments[EVENTS])}
+        for name, _ in ROLLUPS:
+            self.levels[name] = _Level(directory, name, ROLLUP_RECORD, segment_records, max_segments[name])
+
+        self.buckets = [None] * len(ROLLUPS)
+        self.last_time = -math.inf
+        self.last_flags = 0
+        self._recover()
+
+        self.estimator = BreathingRateEstimator()
+        self.queue = queue.Queue(QUEUE_SIZE)
+        self.dropped = 0
+        self.thread = None
+
+    def _recover(self):
+        last = self.levels[SAMPLES].last()
+        if last is not None:
+            self.last_time = last[0]
+            self.last_flags = last[4]
+
+        # Rebuild the open rollups, finest first, each from the level below. The
+        # level below may hold several buckets that were not written, after a crash.
+        source = SAMPLES
+        for index, (name, seconds) in enumerate(ROLLUPS):
+            last = self.levels[name].last()
+            start = last[0] + seconds if last is not None else -math.inf
+            for values in self.levels[source].read(start, math.inf):
+                item = Sample(*values) if source == SAMPLES else Rollup(*values)
+                self._feed(index, item, cascade=False)
+            source = name
+
+    def start(self):
+        self.thread = threading.Thread(target=self._write_loop, name="history-writer", daemon=True)
+        self.thread.start()
+
+    def close(self):
+        """Write the queued samples and flush the segments."""
+        if self.thread:
+            self.queue.put(None)
+            self.thread.join()
+            self.thread = None
+        self.flush()
+
+    def add_radar(self, result):
+        """Add a sample for a radar result, the breathing signal is the middle point of its waveform."""
+        waveform = result["waveform"]
+        rate, quality = self.estimator.update(result["timestamp"], waveform[len(waveform) // 2])
+        state = STATE_MOTION if result["motion_state"] in MOTION_STATES else STATE_STABLE
+        flags = FLAG_ALARM if result["alert"] in ALARM_ALERTS else 0
+        self.append(Sample(result["timestamp"], rate, quality, state, flags))
+
+    def append(self, sample, block=False):
+        try:
+            self.queue.put(sample, block)
+        except queue.Full:
+            self.dropped += 1
+
+    def _write_loop(self):
+        flush_time = time.monotonic()
+        while True:
+            try:
+                sample = self.queue.get(timeout=FLUSH_INTERVAL_S)
+            except queue.Empty:
+                sample = ()
+            if sample is None:
+                return
+            if sample:
+                try:
+                    self._write(sample)
+                except Exception as e:
+                    logger.error(f"Error writing the breathing history: {e}")
+            if time.monotonic() - flush_time >= FLUSH_INTERVAL_S:
+                self.flush()
+                flush_time = time.monotonic()
+
+    def _write(self, sample):
+        if sample.time < self.last_time:
+            self.dropped += 1
+            return
+
+        self.levels[SAMPLES].append(sample)
+        if (sample.flags ^ self.last_flags) & FLAG_ALARM:
+            self.levels[EVENTS].append(sample)
+        self.last_time = sample.time
+        self.last_flags = sample.flags
+        self._feed(0, sample)
+
+    def _feed(self, index, item, cascade=True):
+        """Add an item to the open bucket of rollup level index, closing the bucket before it."""
+        name, seconds = ROLLUPS[index]
+        item_time = item.time if isinstance(item, Sample) else item.start
+        start = math.floor(item_time / seconds) * seconds
+
+        bucket = self.buckets[index]
+        if bucket is not None and bucket.start != start:
+            rollup = bucket.rollup()
+            self.levels[name].append(rollup)
+            if cascade and index + 1 < len(ROLLUPS):
+                self._feed(index + 1, rollup)
+            bucket = None
+        if bucket is None:
+            bucket = self.buckets[index] = _Bucket(start)
+        bucket.add(item)
+
+    def flush(self):
+        for level in self.levels.values():
+            level.flush()
+
+    def samples(self, start, end):
+        return [Sample(*values) for values in self.levels[SAMPLES].read(start, end)]
+
+    def events(self, start, end):
+        """Return the samples where an alarm started or ended."""
+        return [Sample(*values) for values in self.levels[EVENTS].read(start, end)]
+
+    def rollups(self, level, start, end):
+        return [Rollup(*values) for values in self.levels[level].read(start, end)]
+
+    def query(self, start, end, max_points=MAX_QUERY_POINTS):
+        """Return (level, rollups) of the finest level with at most max_points buckets in [start, end)."""
+        for name, seconds in ROLLUPS:
+            if (end - start) / seconds <= max_points:
+                break
+        return name, self.rollups(name, start, end)
+
+
+def _synthetic_samples(start, count, rate_hz, seed=1):
+    # Breathing at 20-40 breaths/min, motion every few minutes and an alarm once an hour
+    rng = random.Random(seed)
+    for i in range(count):
+        t = start + i / rate_hz
+        rate = 30.0 + 10.0 * math.sin(t / 600.0) if i % 97 else math.nan
+        state = STATE_MOTION if (t % 300.0) < 20.0 else STATE_STABLE
+        flags = FLAG_ALARM if (t % 3600.0) < 30.0 else 0
+        yield Sample(t, rate, rng.random(), state, flags)
+
+
+def _expected_rollups(samples, seconds):
+    buckets = {}
+    for sample in samples:
+        start = math.floor(sample.time / seconds) * seconds
+        buckets.setdefault(start, _Bucket(start)).add(sample)
+    return [buckets[start].rollup() for start in sorted(buckets)]
+
+
+def _rollups_match(actual, expected):
+    # The stored values are 32 bit floats
+    if len(actual) != len(expected):
+        return False
+    for a, e in zip(actual, expected):
+        for x, y in zip(a, e):
+            if not (math.isnan(x) and math.isnan(y)) and abs(x - y) > 1e-4 * max(1.0, abs(y)):
+                return False
+    return True
+
+
+def _record_count(path, record_size):
+    with open(path, "rb") as f:
+        written = f.read()[SEGMENT_HEADER_SIZE:].rstrip(b"\0")
+    return (len(written) + record_size - 1) // record_size
+
+
+def _damage(path, index, record_size, offset, data):
+    with open(path, "r+b") as f:
+        f.seek(SEGMENT_HEADER_SIZE + index * record_size + offset)
+        f.write(data)
+
+
+def _write_samples(directory, samples, **options):
+    store = HistoryStore(directory, **options)
+    store.start()
+    for sample in samples:
+        store.append(sample, block=True)
+    store.close()
+
+
+def run_self_test():
+    ok = True
+
+    def check(condition, message):
+        nonlocal ok
+        print(f"{'OK    ' if condition else 'FAILED'} {message}")
+        ok = ok and condition
+
+    directory = tempfile.mkdtemp(prefix="history-test-")
+    try:
+        # Three hours at 10 Hz in small segments, written in two sessions
+        options = {"segment_records": 4096}
+        start = 1700000000.0
+        samples = list(_synthetic_samples(start, 3 * 3600 * 10, 10.0))
+        stored = [Sample(*SAMPLE_RECORD.unpack(SAMPLE_RECORD.pack(*s))) for s in samples]
+        _write_samples(directory, samples[:50000], **options)
+        _write_samples(directory, samples[50000:], **options)
+
+        store = HistoryStore(directory, **options)
+        end = start + 3 * 3600
+        # The last bucket of every level is still open
+        for name, seconds in ROLLUPS:
+            expected = _expected_rollups(stored, seconds)[:-1]
+            check(_rollups_match(store.rollups(name, 0, math.inf), expected),
+                  f"the {name} rollups match the samples across a reopen")
+        check(store.samples(start + 100, start + 101) == [s for s in stored if start + 100 <= s.time < start + 101],
+              "a sample range query returns the samples in the range")
+        previous_flags = [0] + [s.flags for s in stored]
+        changes = [s for flags, s in zip(previous_flags, stored) if (flags ^ s.flags) & FLAG_ALARM]
+        check(store.events(0, math.inf) == changes, "the events are the alarm onsets and ends")
+        level, rollups = store.query(start, end)
+        check(level == "1m" and len(rollups) == 179, "a three hour query returns minute rollups")
+        store.close()
+
+        # Tear the last sample and damage a record in the middle of a segment and a segment header.
+        # Lose a record in the middle of a full segment, as if its page never reached the disk.
+        segments = [os.path.join(directory, f) for f in sorted(os.listdir(directory)) if f.startswith(SAMPLES)]
+        sample_size = SAMPLE_RECORD.size + CRC.size
+        _damage(segments[-1], _record_count(segments[-1], sample_size) - 1, sample_size, SAMPLE_RECORD.size, b"\xff" * 4)
+        _damage(segments[1], 10, sample_size, 8, b"\x12\x34\x56\x78")
+        _damage(segments[-2], options["segment_records"] // 2, sample_size, 0, bytes(sample_size))
+        with open(segments[0], "r+b") as f:
+            f.write(b"JUNK")
+        # Lose the last minute and hour rollups, as if the store stopped before they were written
+        rollup_size = ROLLUP_RECORD.size + CRC.size
+        for name in ("1m", "1h"):
+            path = [os.path.join(directory, f) for f in sorted(os.listdir(directory)) if f.startswith(name + "-")][-1]
+            _damage(path, _record_count(path, rollup_size) - 1, rollup_size, 0, bytes(rollup_size))
+
+        store = HistoryStore(directory, **options)
+        check(os.path.exists(segments[0] + ".corrupt"),
+              "a segment with a damaged header is set aside")
+        readable = store.samples(0, math.inf)
+        check(len(readable) == len(stored) - 4096 - 3 and readable[-1] == stored[-2],
+              "the damaged, lost and torn samples are skipped")
+
+        # Continue writing, the recovered rollups continue where they were
+        more = list(_synthetic_samples(end, 3600 * 10, 10.0, seed=2))
+        store.start()
+        for sample in more:
+            store.append(sample, block=True)
+        store.close()
+        surviving = stored[:-1] + [Sample(*SAMPLE_RECORD.unpack(SAMPLE_RECORD.pack(*s))) for s in more]
+        for name, seconds in ROLLUPS:
+            expected = _expected_rollups(surviving, seconds)[:-1]
+            check(_rollups_match(store.rollups(name, 0, math.inf), expected),
+                  f"the {name} rollups continue after a crash")
+
+        # Retention
+        retained = HistoryStore(directory, segment_records=4096, max_segments={SAMPLES: 2})
+        retained.start()
+        for sample in _synthetic_samples(end + 3600, 9000, 10.0):
+            retained.append(sample, block=True)
+        retained.close()
+        check(len([f for f in os.listdir(directory) if f.startswith(SAMPLES) and f.endswith(".seg")]) == 2,
+              "old sample segments are removed")
+
+        # The rate estimate of a clean breathing signal
+        estimator = BreathingRateEstimator()
+        for i in range(30 * 30):
+            rate, quality = estimator.update(i / 30.0, math.sin(2 * math.pi * 0.3 * i / 30.0))
+        check(abs(rate - 18.0) < 0.5 and quality > 0.9, f"the rate of an 18 /min signal is {rate:.1f} /min")
+    finally:
+        shutil.rmtree(directory)
+    return ok
+
+
+def run_benchmark(days, rate_hz):
+    directory = tempfile.mkdtemp(prefix="history-benchmark-")
+    try:
+        count = int(days * 86400 * rate_hz)
+        start = time.time() - days * 86400
+
+        # Including generating the samples, which is not free either
+        began = time.perf_counter()
+        _write_samples(directory, _synthetic_samples(start, count, rate_hz))
+        elapsed = time.perf_counter() - began
+        size = sum(os.path.getsize(os.path.join(directory, f)) for f in os.listdir(directory))
+        print(f"append: {count} samples in {elapsed:.1f} s, {count / elapsed:.0f} samples/s, "
+              f"{size / 1e6:.0f} MB on disk ({size / count:.0f} bytes/sample)")
+
+        began = time.perf_counter()
+        store = HistoryStore(directory)
+        print(f"open:   {(time.perf_counter() - began) * 1000:.1f} ms")
+
+        end = start + days * 86400
+        queries = (("last minute of samples", lambda: store.samples(end - 60, end)),
+                   ("last hour", lambda: store.query(end - 3600, end)[1]),
+                   ("last day", lambda: store.query(end - 86400, end)[1]),
+                   (f"all {days:g} days", lambda: store.query(start, end)[1]),
+                   ("all events", lambda: store.events(start, end)))
+        for name, run in queries:
+            rounds = 20
+            began = time.perf_counter()
+            for _ in range(rounds):
+                result = run()
+            print(f"query:  {name:22} {(time.perf_counter() - began) * 1000 / rounds:7.2f} ms, {len(result)} records")
+        store.close()
+    finally:
+        shutil.rmtree(directory)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Breathing history store")
+    parser.add_argument("--self-test", action="store_true", help="Check the rollups and the crash recovery")
+    parser.add_argument("--benchmark", action="store_true", help="Measure the append and query throughput")
+    parser.add_argument("--days", type=float, default=1.0, help="Days of samples for the benchmark")
+    parser.add_argument("--rate", type=float, default=30.0, help="Samples per second for the benchmark")
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+
+    if args.benchmark:
+        run_benchmark(args.days, args.rate)
+    else:
+        raise SystemExit(0 if run_self_test() else 1)
@@ -0,0 +1,427 @@
+#!/usr/bin/env python3
+# Latency probes for the breathing data
+#
+# Every result on the data connection carries a "probe" member with a sequence
+# number and the server clock at the stages it has passed:
+#   acquired   the radar source returned the frame
+#   processed  the filter chain is done
+#   enqueued   the result is handed to the network side, through the radar ring
+#              with worker processes
+# The time a result is written to each client socket is kept on the server.
+#
+# The data connection is length prefixed JSON both ways. A client that wants
+# its latency measured sends {"type": "hello"}, and is then sent a
+#   {"type": "ping", "t0": <server clock>}
+# every PING_INTERVAL_S, ahead of a result. It answers with
+#   {"type": "pong", "t0": t0, "t1": <client clock on receive>, "t2": <client clock on send>}
+# and the server, receiving it at t3, has an offset of the client clock
+# ((t1 - t0) + (t2 - t3)) / 2 with an error of at most half the round trip
+# (t3 - t0) - (t2 - t1). Like the clock filter of NTP, the sample with the
+# shortest round trip of the last OFFSET_WINDOW is used. The client echoes
+# every result with
+#   {"type": "echo", "seq": <probe seq>, "received": <client clock>}
+# so that the server has the time to the client, and end to end, in its own
+# clock. {"type": "stats"} is answered with the latency distributions.
+#
+# Clients that never send anything, like the app, get the results only.
+#
+# Run with --self-test to check the accounting with a local client that has a
+# skewed clock.
+
+import argparse
+import json
+import logging
+import socket
+import struct
+import threading
+import time
+from collections import deque
+
+logger = logging.getLogger("LatencyProbe")
+
+MESSAGE_SIZE = struct.Struct("!I")
+MAX_MESSAGE_SIZE = 1_000_000
+
+PING_INTERVAL_S = 1.0
+OFFSET_WINDOW = 8
+# Samples kept per stage for the distributions
+STATS_WINDOW = 1000
+# Results kept for the echoes, about 30 s at 30 Hz
+RECENT_RESULTS = 1024
+REPORT_INTERVAL_S = 60.0
+
+# (name, from stamp, to stamp), "sent" is per client and "received" is echoed in the client clock
+STAGES = (
+    ("processing", "acquired", "processed"),
+    ("enqueue", "processed", "enqueued"),
+    ("send", "enqueued", "sent"),
+    ("transport", "sent", "received"),
+    ("end_to_end", "acquired", "received"),
+)
+
+
+def pack_message(data):
+    """A JSON message, bytes or a dict, with its length in front."""
+    if not isinstance(data, (bytes, bytearray)):
+        data = json.dumps(data).encode("utf-8")
+    return MESSAGE_SIZE.pack(len(data)) + data
+
+
+def read_message(sock):
+    """The next message as a dict, None when the connection is closed."""
+    header = sock.recv(MESSAGE_SIZE.size, socket.MSG_WAITALL)
+    if len(header) < MESSAGE_SIZE.size:
+        return None
+    (size,) = MESSAGE_SIZE.unpack(header)
+    if size > MAX_MESSAGE_SIZE:
+        raise ValueError(f"Message of {size} bytes")
+    data = sock.recv(size, socket.MSG_WAITALL)
+    if len(data) < size:
+        return None
+    return json.loads(data)
+
+
+def _percentile(values, fraction):
+    values = sorted(values)
+    return values[min(int(fraction * len(values)), len(values) - 1)]
+
+
+class LatencyTracker:
+    """Latency distributions per stage, and the clock offset of each probing client."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.samples = {name: deque(maxlen=STATS_WINDOW) for name, _, _ in STAGES}
+        self.counts = {name: 0 for name, _, _ in STAGES}
+        # seq -> probe of the recent results
+        self.recent = {}
+        self.recent_order = deque()
+        # client -> deque of (round trip, offset)
+        self.offsets = {}
+        self.last_report = time.monotonic()
+
+    def _add(self, stage, value):
+        self.samples[stage].append(value)
+        self.counts[stage] += 1
+
+    def add_result(self, probe):
+        """A result reached the network side."""
+        with self.lock:
+            self._add("processing", probe["processed"] - probe["acquired"])
+            self._add("enqueue", probe["enqueued"] - probe["processed"])
+            # A restarted radar worker starts over, the newer result replaces the older
+            if probe["seq"] not in self.recent:
+                self.recent_order.append(probe["seq"])
+            self.recent[probe["seq"]] = dict(probe)
+            while len(self.recent_order) > RECENT_RESULTS:
+                self.recent.pop(self.recent_order.popleft(), None)
+
+    def sent(self, probe, sent_time):
+        with self.lock:
+            self._add("send", sent_time - probe["enqueued"])
+
+    def pong(self, client, message, received_time):
+        t0, t1, t2 = message["t0"], message["t1"], message["t2"]
+        round_trip = (received_time - t0) - (t2 - t1)
+        offset = ((t1 - t0) + (t2 - received_time)) / 2
+        with self.lock:
+            self.offsets.setdefault(client, deque(maxlen=OFFSET_WINDOW)).append((round_trip, offset))
+
+    def clock_offset(self, client):
+        """(offset of the client clock, round trip), None before the first pong."""
+        with self.lock:
+            samples = self.offsets.get(client)
+            if not samples:
+                return None
+            round_trip, offset = min(samples)
+            return offset, round_trip
+
+    def echo(self, client, message, sent_time):
+        """A client echoed a result that was sent to it at sent_time."""
+        clock = self.clock_offset(client)
+        with self.lock:
+            probe = self.recent.get(message["seq"])
+            if clock is None or probe is None or sent_time is None:
+                return False
+            received = message["received"] - clock[0]
+            self._add("transport", received - sent_time)
+            self._add("end_to_end", received - probe["acquired"])
+            return True
+
+    def forget(self, client):
+        with self.lock:
+            self.offsets.pop(client, None)
+
+    def summary(self):
+        """{stage: {count, p50, p95, p99, max}} in seconds, over the last STATS_WINDOW samples."""
+        with self.lock:
+            return {name: {"count": self.counts[name],
+                           "p50": _percentile(values, 0.50),
+                           "p95": _percentile(values, 0.95),
+                           "p99": _percentile(values, 0.99),
+                           "max": max(values)}
+                    for name, values in self.samples.items() if values}
+
+    def maybe_log(self):
+        now = time.monotonic()
+        if now - self.last_report < REPORT_INTERVAL_S:
+            return
+        self.last_report = now
+        for name, stats in self.summary().items():
+            logger.info(f"{name:10}: p50 {stats['p50'] * 1000:7.1f} ms, p95 {stats['p95'] * 1000:7.1f} ms, "
+                        f"p99 {stats['p99'] * 1000:7.1f} ms, max {stats['max'] * 1000:7.1f} ms, {stats['count']} samples")
+
+
+class DataClient:
+    """A client of the data connection, with the probe protocol.
+
+    Results are sent from the network side, replies from the thread that runs
+    serve, so every send takes the lock.
+    """
+
+    def __init__(self, sock, tracker):
+        self.sock = sock
+        self.tracker = tracker
+        self.lock = threading.Lock()
+        self.probing = False
+        self.last_ping = 0.0
+        # seq -> time the result was sent, for the echoes
+        self.sent_times = {}
+        self.sent_order = deque()
+
+    def send(self, json_data, probe=None):
+        """Send a result, raises OSError when the client is gone."""
+        with self.lock:
+            now = time.time()
+            if self.probing and now - self.last_ping >= PING_INTERVAL_S:
+                self.last_ping = now
+                self.sock.sendall(pack_message({"type": "ping", "t0": time.time()}))
+
+            sent_time = time.time()
+            self.sock.sendall(pack_message(json_data))
+
+            if probe is not None:
+                self.tracker.sent(probe, sent_time)
+                if self.probing:
+                    self.sent_times[probe["seq"]] = sent_time
+                    self.sent_order.append(probe["seq"])
+                    while len(self.sent_order) > RECENT_RESULTS:
+                        self.sent_times.pop(self.sent_order.popleft(), None)
+
+    def _reply(self, message):
+        with self.lock:
+            self.sock.sendall(pack_message(message))
+
+    def serve(self):
+        """Handle the messages from the client until it disconnects."""
+        try:
+            while True:
+                message = read_message(self.sock)
+                received_time = time.time()
+                if message is None:
+                    break
+                kind = message.get("type")
+                if kind == "hello":
+                    self.probing = True
+                elif kind == "pong":
+                    self.tracker.pong(self, message, received_time)
+                elif kind == "echo":
+                    with self.lock:
+                        sent_time = self.sent_times.get(message.get("seq"))
+                    self.tracker.echo(self, message, sent_time)
+                elif kind == "stats":
+                    clock = self.tracker.clock_offset(self)
+                    self._reply({"type": "latency",
+                                 "clock_offset": clock[0] if clock else None,
+                                 "round_trip": clock[1] if clock else None,
+                                 "stages": self.tracker.summary()})
+        except (OSError, ValueError, KeyError, TypeError) as e:
+            logger.debug(f"Data client stopped: {e}")
+        finally:
+            self.tracker.forget(self)
+
+    def close(self):
+        try:
+            self.sock.close()
+        except OSError:
+            pass
+
+
+class ProbeClient:
+    """A client that takes part in the probe protocol, for tests.
+
+    clock_offset skews its clock, like the clock of a phone that is not in sync
+    with the server.
+    """
+
+    def __init__(self, host, port, clock_offset=0.0):
+        self.clock_offset = clock_offset
+        self.sock = socket.create_connection((host, port))
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.lock = threading.Lock()
+        self.results = []
+        # End to end latency of each result, in the server clock
+        self.true_end_to_end = []
+        self.stats = deque()
+        self.stats_ready = threading.Event()
+        self._send({"type": "hello"})
+        self.thread = threading.Thread(target=self._read, daemon=True)
+        self.thread.start()
+
+    def clock(self):
+        return time.time() + self.clock_offset
+
+    def _send(self, message):
+        with self.lock:
+            self.sock.sendall(pack_message(message))
+
+    def _read(self):
+        try:
+            while True:
+                message = read_message(self.sock)
+                received = self.clock()
+                if message is None:
+                    break
+                kind = message.get("type")
+                if kind == "ping":
+                    self._send({"type": "pong", "t0": message["t0"], "t1": received, "t2": self.clock()})
+                elif kind == "latency":
+                    self.stats.append(message)
+                    self.stats_ready.set()
+                elif "probe" in message:
+                    probe = message["probe"]
+                    self.results.append(message)
+                    self.true_end_to_end.append(received - self.clock_offset - probe["acquired"])
+                    self._send({"type": "echo", "seq": probe["seq"], "received": received})
+        except (OSError, ValueError):
+            pass
+
+    def request_stats(self, timeout=2.0):
+        self.stats_ready.clear()
+        self._send({"type": "stats"})
+        self.stats_ready.wait(timeout)
+        return self.stats.popleft() if self.stats else None
+
+    def close(self):
+        self.sock.close()
+
+
+def run_self_test(count, update_rate):
+    ok = True
+
+    def check(condition, message):
+        nonlocal ok
+        print(f"{'OK    ' if condition else 'FAILED'} {message}")
+        ok = ok and condition
+
+    # Stage durations of the fake pipeline, and a phone clock far from the server clock
+    process_s, enqueue_s = 0.006, 0.002
+    client_clock_offset = 12.345
+
+    tracker = LatencyTracker()
+    clients = []
+    plain_results = []
+
+    server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server_socket.bind(("127.0.0.1", 0))
+    server_socket.listen(2)
+    port = server_socket.getsockname()[1]
+
+    def accept():
+        while True:
+            try:
+                sock, _ = server_socket.accept()
+            except OSError:
+                break
+            client = DataClient(sock, tracker)
+            clients.append(client)
+            threading.Thread(target=client.serve, daemon=True).start()
+
+    def read_plain(sock):
+        try:
+            while True:
+                message = read_message(sock)
+                if message is None:
+                    break
+                plain_results.append(message)
+        except (OSError, ValueError):
+            pass
+
+    threading.Thread(target=accept, daemon=True).start()
+    probe_client = ProbeClient("127.0.0.1", port, client_clock_offset)
+    # A client like the app, that never sends anything
+    plain_socket = socket.create_connection(("127.0.0.1", port))
+    threading.Thread(target=read_plain, args=(plain_socket,), daemon=True).start()
+
+    deadline = time.time() + 2.0
+    while (len(clients) < 2 or not any(client.probing for client in clients)) and time.time() < deadline:
+        time.sleep(0.01)
+
+    next_time = time.time()
+    for seq in range(count):
+        next_time += 1.0 / update_rate
+        time.sleep(max(0.0, next_time - time.time()))
+        probe = {"seq": seq, "acquired": time.time()}
+        time.sleep(process_s)
+        probe["processed"] = time.time()
+        time.sleep(enqueue_s)
+        probe["enqueued"] = time.time()
+        tracker.add_result(probe)
+        json_data = json.dumps({"waveform": [0.0], "motion_state": "", "alert": "Normal", "probe": probe}).encode("utf-8")
+        for client in list(clients):
+            client.send(json_data, probe)
+
+    # Let the last echoes arrive
+    time.sleep(0.2)
+    stats = probe_client.request_stats()
+
+    probe_client.close()
+    plain_socket.close()
+    server_socket.close()
+    for client in clients:
+        client.close()
+
+    check(stats is not None, "the server answers a stats request")
+    if stats is None:
+        return False
+
+    stages = stats["stages"]
+    for name, _, _ in STAGES:
+        if name in stages:
+            s = stages[name]
+            print(f"{name:10}: p50 {s['p50'] * 1000:6.2f} ms, p99 {s['p99'] * 1000:6.2f} ms, "
+                  f"max {s['max'] * 1000:6.2f} ms, {s['count']} samples")
+    offset_error = abs(stats["clock_offset"] - client_clock_offset) if stats["clock_offset"] is not None else float("inf")
+    print(f"Clock offset error {offset_error * 1000:.3f} ms, round trip {(stats['round_trip'] or 0.0) * 1000:.3f} ms")
+
+    check(offset_error < 0.002, "the clock offset of the client is estimated within 2 ms")
+    check(len(probe_client.results) == count, "the probing client gets every result")
+    check(len(plain_results) == count and all("probe" in message for message in plain_results),
+          "a client that never sends gets the results only, without pings")
+    check(all(stages.get(name, {}).get("count") == count for name in ("processing", "enqueue")),
+          "every result is counted once in the server stages")
+    check(stages.get("send", {}).get("count") == 2 * count, "every send to every client is counted")
+    check(stages.get("end_to_end", {}).get("count", 0) >= count - 1 and
+          stages.get("transport", {}).get("count") == stages.get("end_to_end", {}).get("count"),
+          "every echo after the first pong is counted")
+    check(process_s <= stages["processing"]["p50"] < process_s + 0.003, "the processing stage matches the fake pipeline")
+    check(enqueue_s <= stages["enqueue"]["p50"] < enqueue_s + 0.003, "the enqueue stage matches the fake pipeline")
+    true_p50 = _percentile(probe_client.true_end_to_end, 0.50)
+    check(abs(stages["end_to_end"]["p50"] - true_p50) < 0.002,
+          f"the end to end latency matches what the client saw ({true_p50 * 1000:.2f} ms) within 2 ms")
+    check(stages["transport"]["p50"] >= -0.002, "the transport stage is not negative")
+    return ok
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Latency probes for the breathing data")
+    parser.add_argument("--self-test", action="store_true",
+                        help="Check the latency accounting with a local client that has a skewed clock")
+    parser.add_argument("--results", type=int, default=150)
+    parser.add_argument("--update-rate", type=float, default=30.0)
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+
+    if args.self_test:
+        raise SystemExit(0 if run_self_test(args.results, args.update_rate) else 1)
+    parser.print_help()
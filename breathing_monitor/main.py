@@ -35,6 +35,21 @@ def parse_arguments():
                         help='Video resolution in format WIDTHxHEIGHT (default: 1280x720)')
     parser.add_argument('--framerate', type=int, default=60,
                         help='Video framerate (default: 60)')
+    parser.add_argument('--frame-change-threshold', type=float, default=8.0,
+                        help='Mean luma difference of a 32x32 block that sends a frame, '
+                             '0 to send every frame (default: 8)')
+    
+    # Alarm clip configuration
+    parser.add_argument('--clip-dir', type=str, default='clips',
+                        help='Directory for video clips around alarms, empty for no clips (default: clips)')
+    parser.add_argument('--clip-pre-seconds', type=float, default=10.0,
+                        help='Seconds of video before an alarm in a clip (default: 10)')
+    parser.add_argument('--clip-post-seconds', type=float, default=5.0,
+                        help='Seconds of video after an alarm in a clip (default: 5)')
+    
+    # Breathing history configuration
+    parser.add_argument('--history-dir', type=str, default='history',
+                        help='Directory for the breathing history, empty for no history (default: history)')
     
     # Breathing monitoring configuration
     parser.add_argument('--range-start', type=float, default=0.2,
@@ -70,9 +85,14 @@ def main():
         data_port=args.data_port,
         resolution=resolution,
         framerate=args.framerate,
+        frame_change_threshold=args.frame_change_threshold,
         range_start=args.range_start,
         range_end=args.range_end,
-        update_rate=args.update_rate
+        update_rate=args.update_rate,
+        clip_dir=args.clip_dir,
+        clip_pre_seconds=args.clip_pre_seconds,
+        clip_post_seconds=args.clip_post_seconds,
+        history_dir=args.history_dir
     )
     
     try:
@@ -0,0 +1,123 @@
+# Single writer, multiple reader rings in shared memory
+#
+# The writer and the readers are in different processes and never take a lock.
+# Every record has a sequence number. The writer marks a slot as being written
+# with an odd slot sequence, copies the record, marks it complete with an even
+# one and then publishes it by advancing the ring's write sequence. A reader
+# checks the slot sequence before and after copying the record, and a CRC32 of
+# the record, so that a record that was overwritten while it was read, or that
+# is seen half written on a weakly ordered CPU, is skipped instead of returned.
+
+import struct
+import zlib
+from multiprocessing import shared_memory
+
+# Number of records written
+RING_HEADER = struct.Struct("<Q")
+# Slot sequence (2 * record sequence + 2 when complete, odd while written), length, CRC32, timestamp
+SLOT_HEADER = struct.Struct("<QIId")
+
+
+class ShmRing:
+    """A ring of slots records in shared memory, at most slot_size bytes each.
+
+    Create the ring in the supervisor, before the worker processes are started,
+    so that it outlives the workers and a restarted writer continues its sequence.
+    """
+
+    def __init__(self, slots, slot_size, name=None, create=True):
+        self.slots = slots
+        self.slot_size = slot_size
+        # Slots start 8 byte aligned
+        self.slot_stride = (SLOT_HEADER.size + slot_size + 7) // 8 * 8
+        size = RING_HEADER.size + slots * self.slot_stride
+        self.shm = shared_memory.SharedMemory(name=name, create=create, size=size)
+        self.buf = self.shm.buf
+        if create:
+            self.buf[:size] = bytes(size)
+
+    @property
+    def name(self):
+        return self.shm.name
+
+    def _slot_offset(self, sequence):
+        return RING_HEADER.size + (sequence % self.slots) * self.slot_stride
+
+    def write_sequence(self):
+        return RING_HEADER.unpack_from(self.buf, 0)[0]
+
+    def write(self, record, timestamp):
+        """Write a record, only one process may write to a ring. Returns its sequence."""
+        length = len(record)
+        if length > self.slot_size:
+            raise ValueError(f"Record of {length} bytes does not fit in a {self.slot_size} byte slot")
+
+        sequence = self.write_sequence()
+        offset = self._slot_offset(sequence)
+        SLOT_HEADER.pack_into(self.buf, offset, 2 * sequence + 1, 0, 0, 0.0)
+        self.buf[offset + SLOT_HEADER.size:offset + SLOT_HEADER.size + length] = record
+        SLOT_HEADER.pack_into(self.buf, offset, 2 * sequence + 2, length, zlib.crc32(record), timestamp)
+        RING_HEADER.pack_into(self.buf, 0, sequence + 1)
+        return sequence
+
+    def read(self, sequence):
+        """Return (record, timestamp), None if the record is not complete or was overwritten."""
+        offset = self._slot_offset(sequence)
+        slot_sequence, length, crc, timestamp = SLOT_HEADER.unpack_from(self.buf, offset)
+        if slot_sequence != 2 * sequence + 2 or length > self.slot_size:
+            return None
+
+        record = bytes(self.buf[offset + SLOT_HEADER.size:offset + SLOT_HEADER.size + length])
+        if SLOT_HEADER.unpack_from(self.buf, offset)[0] != slot_sequence or zlib.crc32(record) != crc:
+            return None
+        return record, timestamp
+
+    def close(self):
+        self.buf = None
+        self.shm.close()
+
+    def unlink(self):
+        self.shm.unlink()
+
+
+class ShmRingReader:
+    """Reads new records from a ring, starting with the records written after it was created."""
+
+    def __init__(self, ring):
+        self.ring = ring
+        self.next_sequence = ring.write_sequence()
+        self.dropped = 0
+
+    def read_new(self):
+        """Return the records written since the last call, in order, skipping overwritten ones."""
+        write_sequence = self.ring.write_sequence()
+        if write_sequence - self.next_sequence > self.ring.slots:
+            # The writer has lapped this reader
+            self.dropped += write_sequence - self.ring.slots - self.next_sequence
+            self.next_sequence = write_sequence - self.ring.slots
+
+        records = []
+        while self.next_sequence < write_sequence:
+            record = self.ring.read(self.next_sequence)
+            if record is None:
+                self.dropped += 1
+            else:
+                records.append(record)
+            self.next_sequence += 1
+        return records
+
+    def read_latest(self):
+        """Return the newest record written since the last call, None if there is none."""
+        write_sequence = self.ring.write_sequence()
+        while write_sequence > self.next_sequence:
+            record = self.ring.read(write_sequence - 1)
+            if record is not None:
+                self.dropped += write_sequence - 1 - self.next_sequence
+                self.next_sequence = write_sequence
+                return record
+            # Overwritten while it was read, try the newer one
+            newer = self.ring.write_sequence()
+            if newer == write_sequence:
+                break
+            write_sequence = newer
+        return None
@@ -0,0 +1,61 @@
+# Synthetic radar source and processing for tests without a radar
+#
+# The source delivers breathing-like sweeps at a fixed rate. The first point of
+# every sweep is the wall clock time the frame was due, and the processing
+# passes it through as the first point of the waveform, so a client of the
+# breathing data can tell how long the processing of each frame took.
+
+import math
+import random
+import time
+
+# Passes of the filter over the sweep, about 2 ms of pure Python on a desktop CPU
+FILTER_PASSES = 200
+
+
+class SyntheticRadarSource:
+    def __init__(self, update_rate=30, num_points=100, connected=True):
+        self.update_rate = update_rate
+        self.num_points = num_points
+        # A source that is not connected fails to start, like a radar that is not attached
+        self.connected = connected
+        self.next_time = None
+
+    def start(self):
+        if not self.connected:
+            raise OSError("No radar connected")
+        self.next_time = time.time()
+
+    def get_next(self):
+        self.next_time += 1.0 / self.update_rate
+        delay = self.next_time - time.time()
+        if delay > 0:
+            time.sleep(delay)
+        elif delay < -1.0 / self.update_rate:
+            # Frames that were missed are not delivered in a burst
+            self.next_time = time.time()
+
+        phase = 2 * math.pi * 0.3 * self.next_time
+        sweep = [math.sin(phase + i * 0.01) + 0.1 * random.gauss(0.0, 1.0) for i in range(self.num_points)]
+        sweep[0] = self.next_time
+        return sweep
+
+    def stop(self):
+        pass
+
+
+def process_synthetic_waveform(raw_waveform):
+    """A fixed amount of filtering in pure Python, returns (waveform, motion state, alert)."""
+    frame_time = raw_waveform[0]
+    waveform = list(raw_waveform[1:])
+
+    for _ in range(FILTER_PASSES):
+        state = waveform[0]
+        for i, value in enumerate(waveform):
+            state += 0.2 * (value - state)
+            waveform[i] = state
+
+    spread = max(waveform) - min(waveform)
+    motion_state = "Child in motion" if spread > 0.5 else "Stable breathing waveform"
+    alert = "Child not moving" if spread < 0.02 else "Normal"
+    return [frame_time] + waveform, motion_state, alert
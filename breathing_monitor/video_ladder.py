@@ -0,0 +1,723 @@
+#!/usr/bin/env python3
+# Adaptive JPEG streaming with a quality/resolution ladder per client
+#
+# The camera is configured with a full size main stream and a half size lores
+# stream. Every captured frame is shared by all clients, and each (stream,
+# quality) pair is encoded at most once per frame, and only if a client needs
+# it. Each client steps up and down a ladder of (stream, quality, frame skip)
+# rungs driven by its measured send backlog, so a client on a poor link gets
+# smaller frames at a lower rate instead of lagging behind or disconnecting.
+#
+# The wire format is unchanged: a big endian 32 bit length followed by a JPEG.
+#
+# Run with --self-test to stream from a fake camera to one fast and one
+# throttled local client and check that the throttled client adapts.
+
+import argparse
+import fcntl
+import logging
+import random
+import socket
+import struct
+import termios
+import threading
+import time
+from collections import namedtuple
+
+logger = logging.getLogger("VideoLadder")
+
+Rung = namedtuple("Rung", ["stream", "quality", "skip"])
+
+# Best first. Rungs with the same stream and quality share the encoded frame.
+LADDER = (
+    Rung("main", 90, 1),
+    Rung("main", 75, 1),
+    Rung("lores", 75, 1),
+    Rung("lores", 60, 2),
+    Rung("lores", 45, 4),
+)
+
+# Backlog in frames of the current rung: the bytes still queued in the kernel
+# plus the time the last send blocked, relative to the frame interval
+DOWNGRADE_BACKLOG = 1.0
+UPGRADE_BACKLOG = 0.25
+BACKLOG_SMOOTHING = 0.3
+
+# Minimum time between two step downs, and how long a client must stay below
+# UPGRADE_BACKLOG before it steps up. A step up that fails doubles the hold.
+DOWNGRADE_HOLD_S = 0.5
+UPGRADE_HOLD_S = 3.0
+MAX_UPGRADE_HOLD_S = 30.0
+
+# After a step down, the frames of the previous rung still in the socket are
+# not held against the new rung, unless they take longer than this to drain
+MAX_DRAIN_WAIT_S = 2.0
+
+# A small send buffer keeps the backlog, and so the latency, short
+CLIENT_SNDBUF = 256 * 1024
+
+# The (stream, quality) pairs that are encoded, numbered for the encoded frame records
+KEYS = tuple(sorted({(rung.stream, rung.quality) for rung in LADDER}))
+
+# A frame encoded by another process is not older than this
+RING_POLL_S = 0.002
+DEMAND_TIMEOUT_S = 1.0
+
+# Number of JPEGs, and whether the change detector of the video process found the frame changed
+ENCODED_FRAME_HEADER = struct.Struct("<B?")
+ENCODED_FRAME_ENTRY = struct.Struct("<BI")
+
+
+def keys_to_mask(keys):
+    mask = 0
+    for key in keys:
+        mask |= 1 << KEYS.index(key)
+    return mask
+
+
+def mask_to_keys(mask):
+    return [key for i, key in enumerate(KEYS) if mask & (1 << i)]
+
+
+def pack_encoded_frame(jpegs, changed=True):
+    """One record with the JPEGs of a frame, keyed by (stream, quality)."""
+    entries = [ENCODED_FRAME_ENTRY.pack(KEYS.index(key), len(data)) for key, data in jpegs.items()]
+    return ENCODED_FRAME_HEADER.pack(len(jpegs), changed) + b"".join(entries) + b"".join(jpegs.values())
+
+
+def unpack_encoded_frame(record):
+    """The JPEGs of a frame keyed by (stream, quality), and whether it changed."""
+    count, changed = ENCODED_FRAME_HEADER.unpack_from(record, 0)
+    offset = ENCODED_FRAME_HEADER.size + count * ENCODED_FRAME_ENTRY.size
+    jpegs = {}
+    for i in range(count):
+        key_index, length = ENCODED_FRAME_ENTRY.unpack_from(record, ENCODED_FRAME_HEADER.size + i * ENCODED_FRAME_ENTRY.size)
+        jpegs[KEYS[key_index]] = record[offset:offset + length]
+        offset += length
+    return jpegs, changed
+
+
+def lores_size(resolution):
+    """Half of the main size, rounded down to even dimensions."""
+    width, height = resolution
+    return (width // 4 * 2, height // 4 * 2)
+
+
+class PicameraSource:
+    """Picamera2 with an RGB888 main stream and a YUV420 lores stream."""
+
+    def __init__(self, resolution=(1280, 720), framerate=60):
+        self.resolution = tuple(resolution)
+        self.lores_resolution = lores_size(resolution)
+        self.framerate = framerate
+        self.camera = None
+        self.simplejpeg = None
+
+    def start(self):
+        # Imported here so that the ladder can be used without a camera
+        from picamera2 import Picamera2
+        import simplejpeg
+
+        self.simplejpeg = simplejpeg
+        self.camera = Picamera2()
+        video_config = self.camera.create_video_configuration(
+            main={"size": self.resolution, "format": "RGB888"},
+            lores={"size": self.lores_resolution, "format": "YUV420"},
+            controls={"FrameRate": self.framerate}
+        )
+        self.camera.configure(video_config)
+        self.camera.start()
+        logger.info(f"Camera started with main {self.resolution} and lores {self.lores_resolution} at {self.framerate} FPS.")
+
+    def capture(self):
+        arrays, _ = self.camera.capture_arrays(["main", "lores"])
+        return {"main": arrays[0], "lores": arrays[1]}
+
+    def encode(self, frame, stream, quality):
+        array = frame[stream]
+
+        if stream == "lores":
+            # Same plane split as the Picamera2 JPEG encoder, the rows are stride wide
+            width, height = self.lores_resolution
+            y_plane = array[:height, :width]
+            reshaped = array.reshape((array.shape[0] * 2, array.shape[1] // 2))
+            u_plane = reshaped[2 * height:2 * height + height // 2, :width // 2]
+            v_plane = reshaped[2 * height + height // 2:, :width // 2]
+            return self.simplejpeg.encode_jpeg_yuv_planes(y_plane, u_plane, v_plane, quality=quality)
+
+        # RGB888 is stored as B, G, R
+        return self.simplejpeg.encode_jpeg(array, quality=quality, colorspace="BGR")
+
+    def luma(self, frame, step):
+        """Every step-th pixel of every step-th row of the lores luma, as (bytes, width, height)."""
+        width, height = self.lores_resolution
+        thumbnail = frame["lores"][:height:step, :width:step]
+        return thumbnail.tobytes(), thumbnail.shape[1], thumbnail.shape[0]
+
+    def stop(self):
+        if self.camera:
+            self.camera.stop()
+
+
+class FakeCameraSource:
+    """Paced synthetic frames for tests.
+
+    The payloads are not images. They start and end with the JPEG markers, carry
+    the stream, quality, sequence number and capture time in a text header, and
+    have the size a JPEG of a typical scene would have at that size and quality.
+    encode_cost_s of CPU time, holding the GIL, is spent on every main stream
+    encode, and a share of it by pixel count on every lores one, to load the
+    process as a JPEG encoder would.
+
+    The luma of the scene is a still gradient with sensor noise, and a bright
+    square that moves while motion is set.
+    """
+
+    def __init__(self, resolution=(1280, 720), framerate=30, encode_cost_s=0.0):
+        self.resolution = tuple(resolution)
+        self.lores_resolution = lores_size(resolution)
+        self.framerate = framerate
+        self.encode_cost_s = encode_cost_s
+        self.sequence = 0
+        self.next_time = None
+        self.motion = False
+        self.noise = random.Random(0).randbytes(1 << 16)
+
+    def start(self):
+        self.next_time = time.monotonic()
+
+    def capture(self):
+        self.next_time += 1.0 / self.framerate
+        delay = self.next_time - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        else:
+            # Late, do not try to catch up with a burst of frames
+            self.next_time = time.monotonic()
+        self.sequence += 1
+        return {"sequence": self.sequence, "time": time.monotonic(), "motion": self.motion}
+
+    def encode(self, frame, stream, quality):
+        width, height = self.resolution if stream == "main" else self.lores_resolution
+        size = int(width * height * (0.02 + 0.0025 * quality))
+
+        if self.encode_cost_s > 0:
+            end = time.perf_counter() + self.encode_cost_s * width * height / (self.resolution[0] * self.resolution[1])
+            while time.perf_counter() < end:
+                pass
+
+        header = f"FAKE {stream} {quality} {frame['sequence']} {frame['time']:.6f}\n".encode()
+        return b"\xff\xd8" + header + bytes(size - len(header) - 4) + b"\xff\xd9"
+
+    def luma(self, frame, step):
+        """Every step-th pixel of every step-th row of the lores luma, as (bytes, width, height)."""
+        lores_width, lores_height = self.lores_resolution
+        width, height = -(-lores_width // step), -(-lores_height // step)
+        # Noise of 0-3 levels on a 32-223 gradient
+        offset = frame["sequence"] * 7919 % (len(self.noise) - width * height)
+        luma = bytearray(32 + (x + y) * 192 // (width + height) + (self.noise[offset + y * width + x] & 3)
+                         for y in range(height) for x in range(width))
+
+        if frame["motion"]:
+            size = max(2, height // 6)
+            left = frame["sequence"] % (width - size)
+            for y in range((height - size) // 2, (height + size) // 2):
+                luma[y * width + left:y * width + left + size] = bytes([250]) * size
+        return bytes(luma), width, height
+
+    def stop(self):
+        pass
+
+
+class RingFrameSource:
+    """Frames encoded by the video process, read from a shared memory ring.
+
+    set_demand(mask, sink_mask, sink_skip) tells the video process which KEYS
+    to encode, from the demand() of the streamer, and is repeated while waiting
+    for frames so that the video process stops encoding when nobody reads them.
+    Frames the video process found unchanged are encoded for the sinks only.
+    """
+
+    def __init__(self, reader, set_demand, demand=None):
+        self.reader = reader
+        self.set_demand = set_demand
+        self.demand = demand
+
+    def start(self):
+        pass
+
+    def capture(self):
+        while True:
+            if self.demand:
+                client_keys, sink_keys, sink_skip = self.demand()
+                self.set_demand(keys_to_mask(client_keys), keys_to_mask(sink_keys), sink_skip)
+            record = self.reader.read_latest()
+            if record is not None:
+                data, timestamp = record
+                jpegs, changed = unpack_encoded_frame(data)
+                return {"time": timestamp, "jpegs": jpegs, "changed": changed}
+            time.sleep(RING_POLL_S)
+
+    def encode(self, frame, stream, quality):
+        jpegs = frame["jpegs"]
+        data = jpegs.get((stream, quality))
+        if data is None:
+            # Encoded before the video process saw the new demand, use the nearest other
+            others = sorted(jpegs, key=lambda key: (key[0] != stream, abs(key[1] - quality)))
+            data = jpegs[others[0]]
+        return data
+
+    def stop(self):
+        pass
+
+
+def parse_fake_frame(data):
+    """Return (stream, quality, sequence, capture time) of a FakeCameraSource frame."""
+    stream, quality, sequence, capture_time = data[2:data.index(b"\n")].decode().split()[1:]
+    return stream, int(quality), int(sequence), float(capture_time)
+
+
+class _SharedFrame:
+    def __init__(self, index, frame, changed=True):
+        self.index = index
+        self.frame = frame
+        # Unchanged frames go to the sinks only
+        self.changed = changed
+        self.time = time.time()
+        self.lock = threading.Lock()
+        # (stream, quality) -> [lock, JPEG]
+        self.encoded = {}
+
+
+class LadderClient:
+    def __init__(self, sock, address, rung_index=0):
+        self.sock = sock
+        self.address = address
+        self.rung_index = rung_index
+        self.backlog = 0.0
+        self.last_index = 0
+        # So that the first frame is sent whatever the rung
+        self.last_sent_index = -LADDER[-1].skip
+        self.frames_sent = 0
+        self.frames_dropped = 0
+        self.bytes_sent = 0
+        self.rung_changes = 0
+
+        now = time.monotonic()
+        self.last_change = now
+        self.clear_since = now
+        self.upgrade_hold = UPGRADE_HOLD_S
+        self.probe_time = None
+        self.drain_mark = 0
+
+    @property
+    def rung(self):
+        return LADDER[self.rung_index]
+
+    def unsent_bytes(self):
+        try:
+            return struct.unpack("i", fcntl.ioctl(self.sock.fileno(), termios.TIOCOUTQ, b"\0\0\0\0"))[0]
+        except (OSError, ValueError):
+            # Closed while sending
+            return 0
+
+    def update(self, backlog, now):
+        """Feed one backlog measurement, in frames, and step the ladder if needed."""
+        self.backlog += BACKLOG_SMOOTHING * (backlog - self.backlog)
+
+        if self.probe_time is not None and now - self.probe_time >= UPGRADE_HOLD_S:
+            # The last step up held
+            self.upgrade_hold = UPGRADE_HOLD_S
+            self.probe_time = None
+
+        if self.backlog > DOWNGRADE_BACKLOG:
+            self.clear_since = now
+            draining = (self.bytes_sent - self.unsent_bytes() < self.drain_mark and
+                        now - self.last_change < MAX_DRAIN_WAIT_S)
+            if (self.rung_index < len(LADDER) - 1 and not draining and
+                    now - self.last_change >= DOWNGRADE_HOLD_S):
+                if self.probe_time is not None:
+                    self.upgrade_hold = min(2 * self.upgrade_hold, MAX_UPGRADE_HOLD_S)
+                    self.probe_time = None
+                self._step(1, now)
+                self.drain_mark = self.bytes_sent
+        elif self.backlog > UPGRADE_BACKLOG:
+            self.clear_since = now
+        elif (self.rung_index > 0 and now - self.clear_since >= self.upgrade_hold and
+                now - self.last_change >= self.upgrade_hold):
+            self._step(-1, now)
+            self.probe_time = now
+            self.clear_since = now
+
+    def _step(self, direction, now):
+        self.rung_index += direction
+        self.rung_changes += 1
+        self.last_change = now
+        self.backlog = 0.0
+        logger.info(f"Video client {self.address}: {'down' if direction > 0 else 'up'} to {self.rung}")
+
+
+class LadderStreamer:
+    """Shares captured frames between clients, each on its own rung of the ladder."""
+
+    def __init__(self, source, framerate, change_detector=None):
+        self.source = source
+        self.framerate = framerate
+        # Frames it finds unchanged are neither encoded nor sent to the clients,
+        # the sinks get every frame
+        self.change_detector = change_detector
+        self.frames_skipped = 0
+        self.clients = []
+        self.clients_lock = threading.Lock()
+        self.sinks = []
+        self.sink_rungs = []
+        self.frame_ready = threading.Condition()
+        self.latest = None
+        self.frames_captured = 0
+        self.encodes = 0
+        self.stats_lock = threading.Lock()
+        self.is_running = False
+
+    def start(self):
+        self.is_running = True
+        threading.Thread(target=self._capture_loop, daemon=True).start()
+
+    def add_client(self, client_socket):
+        address = client_socket.getpeername()
+        client_socket.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, CLIENT_SNDBUF)
+        client_socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        client = LadderClient(client_socket, address)
+        with self.clients_lock:
+            self.clients.append(client)
+        logger.info(f"New video client connected: {address}. Active video clients: {len(self.clients)}")
+        threading.Thread(target=self._serve_client, args=(client,), daemon=True).start()
+        return client
+
+    def add_sink(self, sink, rung):
+        """Call sink(capture time, JPEG) at framerate / rung.skip, from its own thread.
+
+        The sinks get unchanged frames too. Like a client, a sink that falls
+        behind skips to the newest frame and never holds up the capture or the
+        clients.
+        """
+        self.sinks.append(sink)
+        self.sink_rungs.append(rung)
+        threading.Thread(target=self._serve_sink, args=(sink, rung), daemon=True).start()
+
+    def demand(self):
+        """The (stream, quality) pairs the clients and the sinks need now, and the smallest sink skip."""
+        with self.clients_lock:
+            rungs = [client.rung for client in self.clients]
+        return ({(rung.stream, rung.quality) for rung in rungs},
+                {(rung.stream, rung.quality) for rung in self.sink_rungs},
+                min((rung.skip for rung in self.sink_rungs), default=1))
+
+    def stop(self):
+        self.is_running = False
+        with self.frame_ready:
+            self.frame_ready.notify_all()
+        with self.clients_lock:
+            clients = list(self.clients)
+        for client in clients:
+            try:
+                client.sock.close()
+            except OSError:
+                pass
+
+    def _capture_loop(self):
+        try:
+            while self.is_running:
+                if not self.clients and not self.sinks:
+                    time.sleep(0.1)  # Don't waste resources if no clients
+                    continue
+
+                frame = self.source.capture()
+                detector = self.change_detector
+                if detector:
+                    changed = detector.update(self.source.luma(frame, detector.step), time.time())
+                else:
+                    # Frames from the video process were checked there
+                    changed = frame.get("changed", True)
+                if not changed:
+                    self.frames_skipped += 1
+                    if not self.sinks:
+                        continue
+
+                with self.frame_ready:
+                    self.frames_captured += 1
+                    self.latest = _SharedFrame(self.frames_captured, frame, changed)
+                    self.frame_ready.notify_all()
+        except Exception as e:
+            logger.error(f"Error in video capture: {e}")
+
+    def _wait_for_frame(self, last_index):
+        with self.frame_ready:
+            self.frame_ready.wait_for(
+                lambda: not self.is_running or (self.latest is not None and self.latest.index > last_index),
+                timeout=1.0)
+            if self.latest is not None and self.latest.index > last_index:
+                return self.latest
+        return None
+
+    def _encoded(self, entry, rung):
+        key = (rung.stream, rung.quality)
+        with entry.lock:
+            slot = entry.encoded.get(key)
+            if slot is None:
+                slot = entry.encoded[key] = [threading.Lock(), None]
+
+        # Clients that need another stream or quality are not held up by this encode
+        with slot[0]:
+            if slot[1] is None:
+                slot[1] = self.source.encode(entry.frame, rung.stream, rung.quality)
+                with self.stats_lock:
+                    self.encodes += 1
+            return slot[1]
+
+    def _serve_sink(self, sink, rung):
+        last_index = 0
+        last_sent_time = 0.0
+        # By time rather than by index, the video process sends only every
+        # skip-th unchanged frame, and all changed ones
+        interval = (rung.skip - 0.5) / self.framerate
+        while self.is_running:
+            entry = self._wait_for_frame(last_index)
+            if entry is None:
+                continue
+            last_index = entry.index
+
+            if entry.time - last_sent_time < interval:
+                continue
+            last_sent_time = entry.time
+
+            try:
+                sink(entry.time, self._encoded(entry, rung))
+            except Exception as e:
+                logger.error(f"Error in video sink: {e}")
+
+    def _serve_client(self, client):
+        try:
+            while self.is_running:
+                # Always the newest frame, frames captured while sending are skipped
+                entry = self._wait_for_frame(client.last_index)
+                if entry is None:
+                    continue
+                client.last_index = entry.index
+                if not entry.changed:
+                    continue
+
+                rung = client.rung
+                if entry.index - client.last_sent_index < rung.skip:
+                    continue
+
+                data = self._encoded(entry, rung)
+                frame_interval = rung.skip / self.framerate
+
+                # What is still queued from earlier frames when the next one is due.
+                # Do not queue a frame behind a whole frame that is not sent yet.
+                unsent = client.unsent_bytes()
+                if unsent >= len(data):
+                    # The dropped frame is backlog too
+                    client.frames_dropped += 1
+                    client.update(unsent / len(data) + 1.0, time.monotonic())
+                    continue
+
+                start = time.monotonic()
+                client.sock.sendall(struct.pack(">L", len(data)) + data)
+                now = time.monotonic()
+
+                client.last_sent_index = entry.index
+                client.frames_sent += 1
+                client.bytes_sent += len(data) + 4
+                client.update(unsent / len(data) + (now - start) / frame_interval, now)
+        except (BrokenPipeError, ConnectionResetError):
+            pass
+        except OSError as e:
+            if self.is_running:
+                logger.error(f"Error sending video to client {client.address}: {e}")
+        finally:
+            with self.clients_lock:
+                if client in self.clients:
+                    self.clients.remove(client)
+            try:
+                client.sock.close()
+            except OSError:
+                pass
+            logger.info(f"Removed video client {client.address}. Active video clients: {len(self.clients)}")
+
+
+class _ThrottledReader:
+    """Local test client that reads at most rate bytes per second, None for no limit."""
+
+    def __init__(self, port, rate=None):
+        self.rate = rate
+        self.frames = []  # (receive time, stream, quality, sequence, capture time)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        # A small receive window so that the throttling reaches the sender quickly
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 64 * 1024)
+        self.sock.connect(("127.0.0.1", port))
+        self.is_running = True
+        self.thread = threading.Thread(target=self._run, daemon=True)
+        self.thread.start()
+
+    def _recv_exactly(self, length):
+        chunks = []
+        while length > 0:
+            chunk = self.sock.recv(min(length, 16 * 1024))
+            if not chunk:
+                raise ConnectionResetError
+            chunks.append(chunk)
+            length -= len(chunk)
+            if self.rate is not None:
+                self.received += len(chunk)
+                ahead = self.received / self.rate - (time.monotonic() - self.start)
+                if ahead > 0:
+                    time.sleep(ahead)
+        return b"".join(chunks)
+
+    def _run(self):
+        self.received = 0
+        self.start = time.monotonic()
+        try:
+            while self.is_running:
+                (size,) = struct.unpack(">L", self._recv_exactly(4))
+                data = self._recv_exactly(size)
+                self.frames.append((time.monotonic(),) + parse_fake_frame(data))
+        except OSError:
+            pass
+
+    def between(self, start, end):
+        return [frame for frame in self.frames if start <= frame[0] < end]
+
+    def close(self):
+        self.is_running = False
+        self.sock.close()
+
+
+def run_self_test(framerate, throttle_kbps, phase_s):
+    """Stream from a fake camera to a fast and a throttled client, then lift the throttle."""
+    source = FakeCameraSource((1280, 720), framerate)
+    source.start()
+    streamer = LadderStreamer(source, framerate)
+    streamer.start()
+
+    server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server_socket.bind(("127.0.0.1", 0))
+    server_socket.listen(2)
+    port = server_socket.getsockname()[1]
+
+    def accept_loop():
+        try:
+            while True:
+                client_socket, _ = server_socket.accept()
+                streamer.add_client(client_socket)
+        except OSError:
+            pass
+
+    threading.Thread(target=accept_loop, daemon=True).start()
+
+    rate = throttle_kbps * 1000
+    fast = _ThrottledReader(port)
+    slow = _ThrottledReader(port, rate)
+
+    start = time.monotonic()
+    time.sleep(phase_s)
+    throttled_end = time.monotonic()
+    slow.rate = None
+    time.sleep(phase_s)
+    end = time.monotonic()
+
+    fast.close()
+    slow.close()
+    server_socket.close()
+    streamer.stop()
+
+    ok = True
+
+    def check(condition, message):
+        nonlocal ok
+        print(f"{'OK    ' if condition else 'FAILED'} {message}")
+        ok = ok and condition
+
+    def summary(name, frames, duration):
+        streams = {}
+        for _, stream, quality, _, _ in frames:
+            streams[f"{stream} q{quality}"] = streams.get(f"{stream} q{quality}", 0) + 1
+        latencies = sorted(received - captured for received, _, _, _, captured in frames)
+        p95 = latencies[int(0.95 * (len(latencies) - 1))] if latencies else float("inf")
+        print(f"{name}: {len(frames) / duration:5.1f} fps, p95 latency {p95 * 1000:6.1f} ms, {streams}")
+        return p95
+
+    # Let the ladder settle before judging each phase
+    settle = min(4.0, phase_s / 2)
+    fast_frames = fast.between(start + settle, end)
+    slow_throttled = slow.between(start + settle, throttled_end)
+    slow_free = slow.between(end - settle, end)
+
+    summary("Fast client          ", fast_frames, end - start - settle)
+    slow_p95 = summary("Throttled client     ", slow_throttled, throttled_end - start - settle)
+    summary("Throttle lifted, end ", slow_free, settle)
+
+    check(sum(1 for frame in fast_frames if frame[1] == "main" and frame[2] == LADDER[0].quality) >= 0.9 * len(fast_frames),
+          "the fast client stays on the top rung")
+    check(len(fast_frames) >= 0.8 * framerate * (end - start - settle),
+          "the fast client gets the full frame rate")
+    check(len(slow_throttled) > 0 and all(frame[1] == "lores" for frame in slow_throttled),
+          f"the client throttled to {throttle_kbps} kB/s gets lores frames only")
+    check(slow_p95 < 1.0, "the throttled client gets frames less than 1 s old")
+    check(len(slow_free) > 0 and slow_free[-1][1] == "main",
+          "the client is back on the main stream when the throttle is lifted")
+
+    sent = len(fast.frames) + len(slow.frames)
+    print(f"Captured {streamer.frames_captured} frames, encoded {streamer.encodes} JPEGs for {sent} sent frames "
+          f"({streamer.encodes / max(streamer.frames_captured, 1):.2f} encodes per frame)")
+    check(streamer.encodes <= streamer.frames_captured * len({(r.stream, r.quality) for r in LADDER}),
+          "each stream and quality is encoded at most once per frame")
+
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Adaptive JPEG ladder streaming")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=9999)
+    parser.add_argument("--resolution", default="1280x720", help="Main stream size, WIDTHxHEIGHT")
+    parser.add_argument("--framerate", type=int, default=30)
+    parser.add_argument("--fake-camera", action="store_true", help="Stream synthetic frames")
+    parser.add_argument("--self-test", action="store_true",
+                        help="Check the adaptation with a fast and a throttled local client")
+    parser.add_argument("--throttle-kbps", type=int, default=600, help="Throttled client rate in the self test")
+    parser.add_argument("--phase-seconds", type=float, default=10.0, help="Length of each self test phase")
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+
+    if args.self_test:
+        raise SystemExit(0 if run_self_test(args.framerate, args.throttle_kbps, args.phase_seconds) else 1)
+
+    resolution = tuple(map(int, args.resolution.split("x")))
+    source = FakeCameraSource(resolution, args.framerate) if args.fake_camera else PicameraSource(resolution, args.framerate)
+    source.start()
+    streamer = LadderStreamer(source, args.framerate)
+    streamer.start()
+
+    server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server_socket.bind((args.host, args.port))
+    server_socket.listen(5)
+    logger.info(f"Video server started on {args.host}:{args.port}")
+
+    try:
+        while True:
+            client_socket, _ = server_socket.accept()
+            streamer.add_client(client_socket)
+    except KeyboardInterrupt:
+        logger.info("Received shutdown signal.")
+    finally:
+        streamer.stop()
+        source.stop()
+        server_socket.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -1,8 +1,6 @@
 import socket
-import struct
-from picamera2 import Picamera2
-import io
-import threading
+
+from breathing_monitor.video_ladder import LadderStreamer, PicameraSource
 
 class TCPVideoServer:
     def __init__(self, host="192.168.50.175", port=9999, resolution=(720, 1280), framerate=60):
@@ -12,39 +10,21 @@ class TCPVideoServer:
         self.framerate = framerate
         self.server_socket = None
         self.camera = None
+        self.video_streamer = None
         self.is_running = True
 
     def start_camera(self):
         print("Initializing the camera...")
-        self.camera = Picamera2()
-        video_config = self.camera.create_video_configuration(
-            main={"size": self.resolution},
-            controls={"FrameRate": self.framerate}
-        )
-        self.camera.configure(video_config)
+        self.camera = PicameraSource(self.resolution, self.framerate)
         self.camera.start()
+        # Frames are shared and each client gets its own rung of the quality/resolution ladder
+        self.video_streamer = LadderStreamer(self.camera, self.framerate)
+        self.video_streamer.start()
         print(f"Camera started with resolution {self.resolution} at {self.framerate} FPS.")
 
     def handle_client(self, client_socket):
-        try:
-            print(f"Client connected: {client_socket.getpeername()}")
-            stream = io.BytesIO()
-            while self.is_running:
-                stream.seek(0)
-                # Capture a JPEG frame
-                self.camera.capture_file(stream, format="jpeg")
-                frame_data = stream.getvalue()
-                frame_size = len(frame_data)
-
-                # Send frame size and the frame data
-                client_socket.sendall(struct.pack(">L", frame_size) + frame_data)
-        except (BrokenPipeError, ConnectionResetError):
-            print("Client disconnected.")
-        except Exception as e:
-            print(f"Error during streaming: {e}")
-        finally:
-            client_socket.close()
-            print("Connection closed.")
+        print(f"Client connected: {client_socket.getpeername()}")
+        self.video_streamer.add_client(client_socket)
 
     def start_server(self):
         self.server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
@@ -59,7 +39,7 @@ class TCPVideoServer:
         try:
             while self.is_running:
                 client_socket, _ = self.server_socket.accept()
-                threading.Thread(target=self.handle_client, args=(client_socket,), daemon=True).start()
+                self.handle_client(client_socket)
         except KeyboardInterrupt:
             print("Server shutting down.")
         finally:
@@ -67,6 +47,8 @@ class TCPVideoServer:
 
     def stop(self):
         self.is_running = False
+        if self.video_streamer:
+            self.video_streamer.stop()
         if self.camera:
             self.camera.stop()
             print("Camera stopped.")
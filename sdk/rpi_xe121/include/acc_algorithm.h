@@ -20,6 +20,24 @@
 #define ACC_APPROX_BASE_STEP_LENGTH_M (2.5e-3f)
 
 
+/**
+ * @brief Number of coefficients in a second-order section, {b0, b1, b2, 1, a1, a2}
+ */
+#define ACC_ALGORITHM_SOS_SECTION_LENGTH (6U)
+
+
+/**
+ * @brief Number of filter states per second-order section and channel
+ */
+#define ACC_ALGORITHM_SOS_STATE_LENGTH (2U)
+
+
+/**
+ * @brief Highest number of sections supported by acc_algorithm_sosfilt
+ */
+#define ACC_ALGORITHM_SOS_MAX_SECTIONS (4U)
+
+
 /**
  * @brief Roll array elements and push new element last
  *
@@ -55,6 +73,28 @@ void acc_algorithm_roll_and_push_matrix_f32_complex(float complex *data, uint16_
                                                     bool pos_shift);
 
 
+/**
+ * @brief Roll row elements and push a new column for a range of columns
+ *
+ * The columns outside the range are left as they are.
+ *
+ * @param[in, out] data Matrix to be rolled of size rows*cols
+ * @param[in] rows Number of rows in the matrix
+ * @param[in] cols Number of cols in the matrix
+ * @param[in] start_col First column to roll
+ * @param[in] num_cols Number of columns to roll, start_col + num_cols <= cols
+ * @param[in] column The new column of size cols, only the range is used
+ * @param[in] pos_shift If true will be the same as shift=1 in np.roll, otherwise the same as shift=-1
+ */
+void acc_algorithm_roll_and_push_matrix_f32_complex_column_range(float complex       *data,
+                                                                 uint16_t             rows,
+                                                                 uint16_t             cols,
+                                                                 uint16_t             start_col,
+                                                                 uint16_t             num_cols,
+                                                                 const float complex *column,
+                                                                 bool                 pos_shift);
+
+
 /**
  * @brief Roll row elements and push multiple columns
  *
@@ -139,6 +179,31 @@ void acc_algorithm_butter_lowpass(float freq, float fs, float *b, float *a);
 void acc_algorithm_butter_bandpass(float min_freq, float max_freq, float fs, float *b, float *a);
 
 
+/**
+ * @brief Design a 2nd order digital Butterworth lowpass filter as second-order sections
+ *
+ * @param[in] freq Cutoff frequency
+ * @param[in] fs Sampling frequency, > 0 Hz
+ * @param[out] sos Second-order sections, 1 section, length == ACC_ALGORITHM_SOS_SECTION_LENGTH
+ */
+void acc_algorithm_butter_lowpass_sos(float freq, float fs, float *sos);
+
+
+/**
+ * @brief Design a 2nd order digital Butterworth bandpass filter as second-order sections
+ *
+ * The same filter as acc_algorithm_butter_bandpass, but the poles are never expanded
+ * into one polynomial. The polynomial is very sensitive to rounding in float when the
+ * band is low compared to the sampling frequency, the sections are not.
+ *
+ * @param[in] min_freq Low cutoff frequency
+ * @param[in] max_freq High cutoff frequency
+ * @param[in] fs Sampling frequency, > 0 Hz
+ * @param[out] sos Second-order sections, 2 sections, length == 2 * ACC_ALGORITHM_SOS_SECTION_LENGTH
+ */
+void acc_algorithm_butter_bandpass_sos(float min_freq, float max_freq, float fs, float *sos);
+
+
 /**
  * @brief Filter data with a digital filter
  *
@@ -162,6 +227,91 @@ void acc_algorithm_lfilter(const float *b, const float *a, float *data, uint16_t
 void acc_algorithm_lfilter_matrix(const float *b, const float *a, float *data, uint16_t rows, uint16_t cols);
 
 
+/**
+ * @brief Filter data with second-order sections
+ *
+ * @param[in] sos Second-order sections, length == num_sections * ACC_ALGORITHM_SOS_SECTION_LENGTH
+ * @param[in] num_sections Number of sections, <= ACC_ALGORITHM_SOS_MAX_SECTIONS
+ * @param[in] zi Steady state from acc_algorithm_sosfilt_zi to start from the first sample, NULL to start from zero
+ * @param[in, out] data Data array to filter
+ * @param[in] data_length Length of the array
+ */
+void acc_algorithm_sosfilt(const float *sos, uint16_t num_sections, const float *zi, float *data, uint16_t data_length);
+
+
+/**
+ * @brief Calculate the steady state of second-order sections for a unit step
+ *
+ * The equivalent of scipy.signal.sosfilt_zi. Scaled by the first sample of a signal, the
+ * states make the filter start as if that sample had been its input forever, so there is
+ * no start-up transient from the step between zero and the signal.
+ *
+ * @param[in] sos Second-order sections, length == num_sections * ACC_ALGORITHM_SOS_SECTION_LENGTH
+ * @param[in] num_sections Number of sections
+ * @param[out] zi Steady states, length == num_sections * ACC_ALGORITHM_SOS_STATE_LENGTH
+ */
+void acc_algorithm_sosfilt_zi(const float *sos, uint16_t num_sections, float *zi);
+
+
+/**
+ * @brief Initialize the states of multi-channel second-order sections from the first sample
+ *
+ * @param[in] zi Steady states from acc_algorithm_sosfilt_zi
+ * @param[in] num_sections Number of sections
+ * @param[in] x0 First sample of every channel, length == num_channels
+ * @param[in] num_channels Number of channels
+ * @param[out] state Filter states, num_sections * ACC_ALGORITHM_SOS_STATE_LENGTH rows of num_channels
+ */
+void acc_algorithm_sosfilt_init_f32(const float *zi, uint16_t num_sections, const float *x0, uint16_t num_channels, float *state);
+
+
+/**
+ * @brief Initialize the states of multi-channel second-order sections from the first complex sample
+ *
+ * @param[in] zi Steady states from acc_algorithm_sosfilt_zi
+ * @param[in] num_sections Number of sections
+ * @param[in] x0 First sample of every channel, length == num_channels
+ * @param[in] num_channels Number of channels
+ * @param[out] state Filter states, num_sections * ACC_ALGORITHM_SOS_STATE_LENGTH rows of num_channels
+ */
+void acc_algorithm_sosfilt_init_f32_complex(const float         *zi,
+                                            uint16_t             num_sections,
+                                            const float complex *x0,
+                                            uint16_t             num_channels,
+                                            float complex       *state);
+
+
+/**
+ * @brief Filter one sample of every channel with second-order sections
+ *
+ * @param[in] sos Second-order sections, length == num_sections * ACC_ALGORITHM_SOS_SECTION_LENGTH
+ * @param[in] num_sections Number of sections
+ * @param[in, out] state Filter states, num_sections * ACC_ALGORITHM_SOS_STATE_LENGTH rows of num_channels
+ * @param[in] input Sample of every channel, length == num_channels
+ * @param[out] output Filtered sample of every channel, length == num_channels, may be the same array as input
+ * @param[in] num_channels Number of channels
+ */
+void acc_algorithm_sosfilt_f32(const float *sos, uint16_t num_sections, float *state, const float *input, float *output, uint16_t num_channels);
+
+
+/**
+ * @brief Filter one complex sample of every channel with second-order sections
+ *
+ * @param[in] sos Second-order sections, length == num_sections * ACC_ALGORITHM_SOS_SECTION_LENGTH
+ * @param[in] num_sections Number of sections
+ * @param[in, out] state Filter states, num_sections * ACC_ALGORITHM_SOS_STATE_LENGTH rows of num_channels
+ * @param[in] input Sample of every channel, length == num_channels
+ * @param[out] output Filtered sample of every channel, length == num_channels, may be the same array as input
+ * @param[in] num_channels Number of channels
+ */
+void acc_algorithm_sosfilt_f32_complex(const float         *sos,
+                                       uint16_t             num_sections,
+                                       float complex       *state,
+                                       const float complex *input,
+                                       float complex       *output,
+                                       uint16_t             num_channels);
+
+
 /**
  * @brief Apply filter coefficients to filtered data matrix and data matrix
  *
@@ -173,7 +323,7 @@ void acc_algorithm_lfilter_matrix(const float *b, const float *a, float *data, u
  * @param[in] data Data matrix
  * @param[in] data_rows Number of rows in data matrix, == len(b)
  * @param[in] data_cols Number of columns in data matrix, == filt_cols
- * @param[out] output Output filtered data array
+ * @param[out] output Output filtered data array, must not overlap filt_data or data
  * @param[in] output_length Length of output, == data_cols and filt_cols
  */
 void acc_algorithm_apply_filter_f32(const float *a, const float *filt_data, uint16_t filt_rows, uint16_t filt_cols, const float *b,
@@ -191,7 +341,7 @@ void acc_algorithm_apply_filter_f32(const float *a, const float *filt_data, uint
  * @param[in] data Data matrix
  * @param[in] data_rows Number of rows in data matrix, == len(b)
  * @param[in] data_cols Number of columns in data matrix, == filt_cols
- * @param[out] output Output filtered data array
+ * @param[out] output Output filtered data array, must not overlap filt_data or data
  * @param[in] output_length Length of output, == data_cols and filt_cols
  */
 void acc_algorithm_apply_filter_f32_complex(const float *a, const float complex *filt_data, uint16_t filt_rows, uint16_t filt_cols,
@@ -430,6 +580,18 @@ void acc_algorithm_double_buffering_frame_filter(acc_int16_complex_t *frame,
 void acc_algorithm_fftshift_matrix(float *data, uint16_t rows, uint16_t cols);
 
 
+/**
+ * @brief Shift the zero-frequency component to the center along row dimensions for a range of columns
+ *
+ * @param[in, out] data Matrix to be shifted
+ * @param[in] rows Number of rows in the matrix
+ * @param[in] cols Number of cols in the matrix
+ * @param[in] start_col First column to shift
+ * @param[in] num_cols Number of columns to shift, start_col + num_cols <= cols
+ */
+void acc_algorithm_fftshift_matrix_column_range(float *data, uint16_t rows, uint16_t cols, uint16_t start_col, uint16_t num_cols);
+
+
 /**
  * @brief Shift the zero-frequency component to the center
  *
@@ -467,6 +629,39 @@ void acc_algorithm_welch_matrix(const float complex *data,
                                 float               fs);
 
 
+/**
+ * @brief Estimate power spectral density (PSD) using Welch’s method along row dimensions for a range of columns
+ *
+ * Same as @ref acc_algorithm_welch_matrix but only the columns in [start_col, start_col + num_cols)
+ * are processed. Columns outside the range are left untouched in psds.
+ *
+ * @param[in] data Matrix of data
+ * @param[in] rows Number of rows in the matrix
+ * @param[in] cols Number of cols in the matrix
+ * @param[in] start_col First column to process
+ * @param[in] num_cols Number of columns to process, start_col + num_cols <= cols
+ * @param[in] segment_length Length of each segment
+ * @param[in] data_buffer Buffer used for calculations, length = segment_length
+ * @param[out] fft_out Array for fft output data, length = segment_length
+ * @param[out] psds Matrix for output data, size = (cols, segment_length)
+ * @param[in] window Desired window to use, length = segment_length
+ * @param[in] length_shift Integer that specifies the transform length N in accordance with N = 1 << length_shift and N >= segment_length
+ * @param[in] fs Sampling frequency
+ */
+void acc_algorithm_welch_matrix_column_range(const float complex *data,
+                                             uint16_t            rows,
+                                             uint16_t            cols,
+                                             uint16_t            start_col,
+                                             uint16_t            num_cols,
+                                             uint16_t            segment_length,
+                                             float complex       *data_buffer,
+                                             float complex       *fft_out,
+                                             float               *psds,
+                                             const float         *window,
+                                             uint16_t            length_shift,
+                                             float               fs);
+
+
 /**
  * @brief Estimate power spectral density using Welch’s method
  *
@@ -745,4 +940,30 @@ float acc_algorithm_stddev_f32(const float *data, uint16_t length);
 float acc_algorithm_clip_f32(float value, float min, float max);
 
 
+/**
+ * @brief Coherently combine the columns of a matrix of slow-time series into one series
+ *
+ * Every column is normalized to unit energy. The reference column is the one that correlates best with
+ * the others, i.e. with the largest sum of absolute correlations. Every column is weighted by its correlation
+ * with the reference, which also aligns its sign, times its column weight, and columns with an absolute
+ * correlation below min_coherence are left out. The output is the weighted sum of the normalized columns.
+ *
+ * @param[in] matrix Matrix of slow-time series, one per column
+ * @param[in] rows Number of rows in the matrix, the length of the series
+ * @param[in] cols Number of columns in the matrix
+ * @param[in] column_weights Array of length cols with a weight per column, e.g. its amplitude
+ * @param[in] min_coherence Lowest absolute correlation with the reference for a column to be included
+ * @param[out] coherence Array of length cols, the correlation of each column with the reference, 0 if left out
+ * @param[out] output Array of length rows for the combined series
+ * @return The index of the reference column
+ */
+uint16_t acc_algorithm_coherent_combine(const float *matrix,
+                                        uint16_t     rows,
+                                        uint16_t     cols,
+                                        const float *column_weights,
+                                        float        min_coherence,
+                                        float       *coherence,
+                                        float       *output);
+
+
 #endif
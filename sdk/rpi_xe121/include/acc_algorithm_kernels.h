@@ -0,0 +1,128 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+
+#ifndef ACC_ALGORITHM_KERNELS_H_
+#define ACC_ALGORITHM_KERNELS_H_
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Kernel variants
+ *
+ * The scalar variant is always available. The other variants are available
+ * when they are compiled in and supported by the CPU the binary runs on.
+ */
+typedef enum
+{
+	ACC_ALGORITHM_KERNELS_SCALAR,
+	ACC_ALGORITHM_KERNELS_NEON,
+	ACC_ALGORITHM_KERNELS_SSE4,
+	ACC_ALGORITHM_KERNELS_AVX2,
+	ACC_ALGORITHM_KERNELS_NUM_VARIANTS,
+} acc_algorithm_kernels_variant_t;
+
+
+/**
+ * @brief Table of hot inner loops used by the algorithm library
+ *
+ * Every variant gives bit-identical results to the scalar kernels: the SIMD variants use the same
+ * single precision operations in the same order, with full precision square roots and without
+ * fused multiply-add. The exception is denormal input on armv7, where NEON flushes to zero.
+ */
+typedef struct
+{
+	/**
+	 * @brief Radix-2 butterflies between two halves of an FFT block
+	 *
+	 * For k in [0, count): delta = data[(k + half_distance) * stride] * twiddles[k],
+	 * data[(k + half_distance) * stride] = data[k * stride] - delta and data[k * stride] += delta
+	 */
+	void (*fft_butterflies)(float complex *data, uint16_t half_distance, const float complex *twiddles, uint16_t count, uint16_t stride);
+
+	/**
+	 * @brief Scaled accumulate used by the filters, out[i] += coeff * data[i]
+	 */
+	void (*scaled_add_f32)(float *out, const float *data, float coeff, uint32_t length);
+
+	/**
+	 * @brief Accumulate int16 IQ data, sum[2 * i] += real[i], sum[2 * i + 1] += imag[i] and abs_sum[i] += |data[i]|
+	 *
+	 * data holds length points as interleaved real and imaginary values, like acc_int16_complex_t
+	 */
+	void (*accumulate_iq_i16)(const int16_t *data, int32_t *sum, float *abs_sum, uint16_t length);
+} acc_algorithm_kernels_t;
+
+
+/**
+ * @brief Select the best available kernel variant
+ *
+ * The variant can be overridden with the ACC_ALGORITHM_KERNELS environment variable
+ * set to "scalar", "neon", "sse4" or "avx2". The selection is made once, by the first
+ * call of this function or of @ref acc_algorithm_kernels_get, and is safe to race
+ * from several threads.
+ */
+void acc_algorithm_kernels_init(void);
+
+
+/**
+ * @brief Select a specific kernel variant
+ *
+ * Meant for tests and benchmarks, it must not be called while another thread uses
+ * the algorithm library.
+ *
+ * @param[in] variant The variant to select
+ * @return true if the variant is available and was selected, false otherwise
+ */
+bool acc_algorithm_kernels_select(acc_algorithm_kernels_variant_t variant);
+
+
+/**
+ * @brief Get the selected kernel table
+ *
+ * @return The selected kernel table
+ */
+const acc_algorithm_kernels_t *acc_algorithm_kernels_get(void);
+
+
+/**
+ * @brief Get the selected kernel variant
+ *
+ * @return The selected kernel variant
+ */
+acc_algorithm_kernels_variant_t acc_algorithm_kernels_get_selected_variant(void);
+
+
+/**
+ * @brief Get the kernel table of a specific variant
+ *
+ * @param[in] variant The variant
+ * @return The kernel table or NULL if the variant is not available
+ */
+const acc_algorithm_kernels_t *acc_algorithm_kernels_get_variant(acc_algorithm_kernels_variant_t variant);
+
+
+/**
+ * @brief Get the name of a kernel variant
+ *
+ * @param[in] variant The variant
+ * @return Name of the variant
+ */
+const char *acc_algorithm_kernels_variant_name(acc_algorithm_kernels_variant_t variant);
+
+
+/**
+ * @brief Kernel tables of the SIMD variants
+ *
+ * Implemented in separate translation units that are compiled with the instruction
+ * set enabled. They return NULL when the variant is not compiled for the target.
+ * CPU support is checked by the dispatcher before a table is used.
+ */
+const acc_algorithm_kernels_t *acc_algorithm_kernels_neon(void);
+const acc_algorithm_kernels_t *acc_algorithm_kernels_sse4(void);
+const acc_algorithm_kernels_t *acc_algorithm_kernels_avx2(void);
+
+
+#endif
@@ -0,0 +1,135 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#ifndef ACC_ALGORITHM_SHAPED_H_
+#define ACC_ALGORITHM_SHAPED_H_
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions_common.h"
+
+
+/**
+ * @brief Shapes of the preset configurations that have specialised kernels
+ *
+ * Every entry X(name, ...) generates a variant of the kernel with the lengths as
+ * compile-time constants, so that the compiler can unroll the loops and keep the
+ * state in registers. Any other shape uses the generic function in acc_algorithm.h.
+ *
+ * Filter shapes are (name, filt_rows, data_rows, cols), where cols is also the output length.
+ */
+#define ACC_ALGORITHM_SHAPED_FILTER_F32_SHAPES(X) \
+	X(breathing_angle, 4U, 5U, 3U)
+
+#define ACC_ALGORITHM_SHAPED_FILTER_F32_COMPLEX_SHAPES(X) \
+	X(breathing_static, 2U, 3U, 3U)
+
+/**
+ * Mean sweep shapes are (name, sweeps_per_frame, number of points averaged, end_point - start_point).
+ * The number of points in the frame is a stride and stays a runtime argument.
+ */
+#define ACC_ALGORITHM_SHAPED_MEAN_SWEEP_SHAPES(X) \
+	X(breathing, 16U, 3U)
+
+/**
+ * Roll and push shapes are (name, data_rows, cols, matrix_rows)
+ */
+#define ACC_ALGORITHM_SHAPED_ROLL_AND_PUSH_I16_COMPLEX_SHAPES(X) \
+	X(touchless_button_close_or_far, 192U, 3U, 16U)              \
+	X(touchless_button_close_and_far, 192U, 6U, 16U)
+
+
+/**
+ * @brief Function types of the kernels, the same as the generic functions in acc_algorithm.h
+ *
+ * A specialised variant only gives the same result as the generic function for the
+ * shape it was selected for.
+ */
+typedef void (*acc_algorithm_filter_f32_func_t)(const float *a,
+                                                const float *filt_data,
+                                                uint16_t     filt_rows,
+                                                uint16_t     filt_cols,
+                                                const float *b,
+                                                const float *data,
+                                                uint16_t     data_rows,
+                                                uint16_t     data_cols,
+                                                float       *output,
+                                                uint16_t     output_length);
+
+typedef void (*acc_algorithm_filter_f32_complex_func_t)(const float         *a,
+                                                        const float complex *filt_data,
+                                                        uint16_t             filt_rows,
+                                                        uint16_t             filt_cols,
+                                                        const float         *b,
+                                                        const float complex *data,
+                                                        uint16_t             data_rows,
+                                                        uint16_t             data_cols,
+                                                        float complex       *output,
+                                                        uint16_t             output_length);
+
+typedef void (*acc_algorithm_mean_sweep_func_t)(const acc_int16_complex_t *frame,
+                                                uint16_t                   num_points,
+                                                uint16_t                   sweeps_per_frame,
+                                                uint16_t                   start_point,
+                                                uint16_t                   end_point,
+                                                float complex             *sweep);
+
+typedef void (*acc_algorithm_roll_and_push_mult_matrix_i16_complex_func_t)(acc_int16_complex_t       *data,
+                                                                           uint16_t                   data_rows,
+                                                                           uint16_t                   cols,
+                                                                           const acc_int16_complex_t *matrix,
+                                                                           uint16_t                   matrix_rows,
+                                                                           bool                       pos_shift);
+
+
+/**
+ * @brief Select the filter kernel for a shape, see @ref acc_algorithm_apply_filter_f32
+ *
+ * @param[in] filt_rows Number of rows in filt_data
+ * @param[in] data_rows Number of rows in data
+ * @param[in] cols Number of columns in filt_data and data, and the output length
+ * @return A specialised variant for the shape, or acc_algorithm_apply_filter_f32
+ */
+acc_algorithm_filter_f32_func_t acc_algorithm_shaped_filter_f32(uint16_t filt_rows, uint16_t data_rows, uint16_t cols);
+
+
+/**
+ * @brief Select the complex filter kernel for a shape, see @ref acc_algorithm_apply_filter_f32_complex
+ *
+ * @param[in] filt_rows Number of rows in filt_data
+ * @param[in] data_rows Number of rows in data
+ * @param[in] cols Number of columns in filt_data and data, and the output length
+ * @return A specialised variant for the shape, or acc_algorithm_apply_filter_f32_complex
+ */
+acc_algorithm_filter_f32_complex_func_t acc_algorithm_shaped_filter_f32_complex(uint16_t filt_rows, uint16_t data_rows, uint16_t cols);
+
+
+/**
+ * @brief Select the mean sweep kernel for a shape, see @ref acc_algorithm_mean_sweep
+ *
+ * @param[in] sweeps_per_frame Number of sweeps in the frame
+ * @param[in] length Number of points averaged, end_point - start_point
+ * @return A specialised variant for the shape, or acc_algorithm_mean_sweep
+ */
+acc_algorithm_mean_sweep_func_t acc_algorithm_shaped_mean_sweep(uint16_t sweeps_per_frame, uint16_t length);
+
+
+/**
+ * @brief Select the roll and push kernel for a shape, see @ref acc_algorithm_roll_and_push_mult_matrix_i16_complex
+ *
+ * @param[in] data_rows Number of rows in data
+ * @param[in] cols Number of columns in data and matrix
+ * @param[in] matrix_rows Number of rows in matrix
+ * @return A specialised variant for the shape, or acc_algorithm_roll_and_push_mult_matrix_i16_complex
+ */
+acc_algorithm_roll_and_push_mult_matrix_i16_complex_func_t acc_algorithm_shaped_roll_and_push_mult_matrix_i16_complex(uint16_t data_rows,
+                                                                                                                      uint16_t cols,
+                                                                                                                      uint16_t matrix_rows);
+
+
+#endif
@@ -0,0 +1,171 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#ifndef ACC_CONTROL_SOCKET_H_
+#define ACC_CONTROL_SOCKET_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** \example acc_control_socket.c
+ * @brief This is a helper that lets an application be reconfigured while it runs, through a
+ *        local (Unix domain) control socket
+ * @n
+ * A client connects to the socket and sends one command per line, and gets one reply line per
+ * command. The application polls the socket between frames, without blocking, so a change is
+ * always applied at a frame boundary. The only command is
+ * @n
+ *   set <name>=<value> [<name>=<value> ...]
+ * @n
+ * The names and types of the parameters come from a table given by the application, that also
+ * tells which parameters need the sensor to be prepared again. All parameters of a command are
+ * applied together, so e.g. both ends of a range can be moved in one step.
+ * @n
+ * One client is served at a time, the next one is accepted when it disconnects.
+ */
+
+
+/**
+ * @brief Longest command or reply, newline included
+ */
+#define ACC_CONTROL_SOCKET_MAX_LINE_LENGTH (256U)
+
+
+/**
+ * @brief Highest number of parameters in one command
+ */
+#define ACC_CONTROL_SOCKET_MAX_CHANGES (16U)
+
+
+typedef enum
+{
+	ACC_CONTROL_VALUE_U16,
+	ACC_CONTROL_VALUE_FLOAT,
+	ACC_CONTROL_VALUE_BOOL,
+} acc_control_value_type_t;
+
+
+/**
+ * @brief A parameter that can be changed through the control socket
+ */
+typedef struct
+{
+	const char              *name;
+	acc_control_value_type_t type;
+	/** The sensor must be prepared again for a change to take effect */
+	bool needs_prepare;
+} acc_control_param_t;
+
+
+typedef union
+{
+	uint16_t u16;
+	float    f32;
+	bool     b;
+} acc_control_value_t;
+
+
+/**
+ * @brief A parameter change parsed from a command
+ */
+typedef struct
+{
+	uint16_t            param; /**< Index in the parameter table */
+	acc_control_value_t value;
+} acc_control_change_t;
+
+
+/**
+ * @brief The control socket instance
+ */
+typedef struct
+{
+	int      server_socket;
+	int      client_socket;
+	char     path[108]; /**< Same length as sun_path */
+	char     line[ACC_CONTROL_SOCKET_MAX_LINE_LENGTH];
+	uint16_t line_length;
+	bool     discarding;
+} acc_control_socket_t;
+
+
+/**
+ * @brief Open a control socket, replacing a socket file left by an earlier instance
+ *
+ * @param[out] control The control socket instance
+ * @param[in] path Path of the socket file
+ * @return true if successful, false otherwise
+ */
+bool acc_control_socket_open(acc_control_socket_t *control, const char *path);
+
+
+/**
+ * @brief Close a control socket and remove its file
+ *
+ * @param[in, out] control The control socket instance
+ */
+void acc_control_socket_close(acc_control_socket_t *control);
+
+
+/**
+ * @brief Get the next command, without blocking
+ *
+ * Accepts a waiting client and reads what it has sent. Commands that are too long are
+ * answered with an error and never returned.
+ *
+ * @param[in, out] control The control socket instance
+ * @param[out] command The command, without the newline
+ * @param[in] command_size Size of the command buffer, at least ACC_CONTROL_SOCKET_MAX_LINE_LENGTH
+ * @return true if a whole command was received
+ */
+bool acc_control_socket_poll(acc_control_socket_t *control, char *command, size_t command_size);
+
+
+/**
+ * @brief Reply to the last command
+ *
+ * @param[in, out] control The control socket instance
+ * @param[in] reply The reply, without the newline
+ */
+void acc_control_socket_reply(acc_control_socket_t *control, const char *reply);
+
+
+/**
+ * @brief Parse a set command
+ *
+ * @param[in] params The parameter table
+ * @param[in] num_params Number of parameters in the table
+ * @param[in] command The command, modified while parsed
+ * @param[out] changes The changes, at most ACC_CONTROL_SOCKET_MAX_CHANGES
+ * @param[out] num_changes Number of changes
+ * @param[out] error Reason the command could not be parsed
+ * @param[in] error_size Size of the error buffer
+ * @return true if the command was parsed
+ */
+bool acc_control_parse(const acc_control_param_t *params,
+                       uint16_t                   num_params,
+                       char                      *command,
+                       acc_control_change_t      *changes,
+                       uint16_t                  *num_changes,
+                       char                      *error,
+                       size_t                     error_size);
+
+
+/**
+ * @brief Send a command to a control socket and wait for the reply, for clients
+ *
+ * @param[in] path Path of the socket file
+ * @param[in] command The command, without the newline
+ * @param[out] reply The reply, without the newline
+ * @param[in] reply_size Size of the reply buffer
+ * @param[in] timeout_ms The longest time to wait for the reply
+ * @return true if a reply was received
+ */
+bool acc_control_socket_request(const char *path, const char *command, char *reply, size_t reply_size, uint32_t timeout_ms);
+
+
+#endif
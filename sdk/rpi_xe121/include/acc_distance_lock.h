@@ -0,0 +1,105 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+
+#ifndef ACC_DISTANCE_LOCK_H_
+#define ACC_DISTANCE_LOCK_H_
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Early distance lock
+ *
+ * Finds the distance of a breathing target from a short slow-time buffer of mean
+ * sweeps, so that the breathing analysis can start before the presence distance
+ * has been smoothed for the whole distance determination time.
+ *
+ * Every point is low-pass filtered at the highest breathing frequency. The band
+ * energy of a point is the energy of the filtered values in the buffer around
+ * their mean, so static reflections and noise above the breathing band are left
+ * out. The lock is taken when the point with the largest band energy dominates
+ * both the strongest point outside its neighbourhood and the median of all points,
+ * and has done so for a number of consecutive frames.
+ */
+
+typedef struct
+{
+	/** Number of points in the sweeps */
+	uint16_t num_points;
+	/** Frame rate in Hz */
+	float frame_rate;
+	/** Highest breathing frequency in Hz, the cutoff of the low-pass filter */
+	float highest_freq;
+	/** Length of the slow-time buffer in seconds */
+	float buffer_duration_s;
+	/** Points on each side of the best point that are not counted as another target */
+	uint16_t neighbourhood;
+	/** Lowest band energy of the best point relative to the strongest point outside its neighbourhood */
+	float min_dominance;
+	/** Lowest band energy of the best point relative to the median band energy of all points */
+	float min_contrast;
+	/** Number of consecutive frames the best point must pass the tests, within one point */
+	uint16_t stable_frames;
+} acc_distance_lock_config_t;
+
+typedef struct acc_distance_lock acc_distance_lock_t;
+
+
+/**
+ * @brief Set the default tuning of a distance lock config
+ *
+ * The defaults are tuned with example_distance_lock. num_points, frame_rate and
+ * highest_freq have to be set by the caller.
+ *
+ * @param[out] config The config
+ */
+void acc_distance_lock_config_default(acc_distance_lock_config_t *config);
+
+
+/**
+ * @brief Create a distance lock
+ *
+ * @param[in] config The config
+ * @return The distance lock, NULL if creation failed
+ */
+acc_distance_lock_t *acc_distance_lock_create(const acc_distance_lock_config_t *config);
+
+
+/**
+ * @brief Destroy a distance lock
+ *
+ * @param[in] lock The distance lock to destroy, can be NULL
+ */
+void acc_distance_lock_destroy(acc_distance_lock_t *lock);
+
+
+/**
+ * @brief Empty the buffer and drop the lock
+ *
+ * @param[in, out] lock The distance lock
+ */
+void acc_distance_lock_reset(acc_distance_lock_t *lock);
+
+
+/**
+ * @brief Push the mean sweep of a frame and test for a lock
+ *
+ * @param[in, out] lock The distance lock
+ * @param[in] sweep The mean sweep of the frame, num_points values
+ * @param[out] point The locked point, only set when true is returned
+ * @return true if the lock has been taken
+ */
+bool acc_distance_lock_update(acc_distance_lock_t *lock, const float complex *sweep, uint16_t *point);
+
+
+/**
+ * @brief Get the band energies of the last update
+ *
+ * @param[in] lock The distance lock
+ * @return The band energy of every point, all zero until the buffer is full
+ */
+const float *acc_distance_lock_get_band_energies(const acc_distance_lock_t *lock);
+
+
+#endif
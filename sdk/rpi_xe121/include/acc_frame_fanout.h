@@ -0,0 +1,175 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#ifndef ACC_FRAME_FANOUT_H_
+#define ACC_FRAME_FANOUT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions_common.h"
+#include "acc_processing.h"
+
+/** \example acc_frame_fanout.c
+ * @brief This is a helper that feeds every frame from one sensor to several processors
+ * @n
+ * The application reads each frame once, into a buffer from the fan-out, and publishes it.
+ * All processors then get a read-only view of the same frame, e.g. breathing, presence zones
+ * and a recorder on one sensor configuration, without a second read or a copy of the frame.
+ * @n
+ * A processor either runs in the thread that publishes, or in a thread of its own with a queue
+ * of frames. A processor in its own thread that falls behind has frames dropped from its queue
+ * instead of holding up the reads, and its lag and drops are counted. The buffers are reference
+ * counted, so a frame stays valid until the last processor is done with it.
+ */
+
+
+/**
+ * @brief Highest number of processors
+ */
+#define ACC_FRAME_FANOUT_MAX_PROCESSORS (8U)
+
+
+/**
+ * @brief A frame as seen by the processors
+ */
+typedef struct
+{
+	/** The IQ data, shared by all processors, must not be modified */
+	const acc_int16_complex_t *frame;
+	/** The processing metadata of the sensor configuration */
+	const acc_processing_metadata_t *metadata;
+	/** Counts the published frames from 0 */
+	uint32_t sequence;
+	/** Time when the frame was published, in us from an arbitrary start */
+	uint64_t publish_time_us;
+	bool     data_saturated;
+	bool     frame_delayed;
+	bool     calibration_needed;
+	int16_t  temperature;
+} acc_frame_fanout_frame_t;
+
+
+/**
+ * @brief Process a frame
+ *
+ * @param[in] frame The frame
+ * @param[in] user_data The user data of the processor
+ * @return true if successful, false otherwise
+ */
+typedef bool (*acc_frame_fanout_process_func_t)(const acc_frame_fanout_frame_t *frame, void *user_data);
+
+
+typedef struct
+{
+	uint32_t frames;           /**< Number of frames processed */
+	uint32_t dropped;          /**< Number of frames dropped because the queue was full */
+	uint32_t failed;           /**< Number of frames the processor failed to process */
+	uint16_t max_lag;          /**< Most frames waiting in the queue of the processor */
+	uint32_t max_latency_us;   /**< Longest time from publish until processed */
+	uint64_t total_latency_us; /**< Sum of the times from publish until processed */
+} acc_frame_fanout_stats_t;
+
+
+typedef struct acc_frame_fanout acc_frame_fanout_t;
+
+
+/**
+ * @brief Create a fan-out
+ *
+ * @param[in] metadata The processing metadata, referenced by every frame
+ * @param[in] buffer_size Size of the buffers frames are read into
+ * @param[in] queue_depth Most frames waiting for a processor in its own thread
+ * @return The fan-out, NULL on failure
+ */
+acc_frame_fanout_t *acc_frame_fanout_create(const acc_processing_metadata_t *metadata, uint32_t buffer_size, uint16_t queue_depth);
+
+
+/**
+ * @brief Stop and destroy a fan-out
+ *
+ * @param[in] fanout The fan-out
+ */
+void acc_frame_fanout_destroy(acc_frame_fanout_t *fanout);
+
+
+/**
+ * @brief Add a processor, before the fan-out is started
+ *
+ * @param[in] fanout The fan-out
+ * @param[in] name Name of the processor in the statistics
+ * @param[in] process The function that processes a frame
+ * @param[in] user_data Passed to the process function
+ * @param[in] own_thread Run the processor in a thread of its own instead of in the thread that publishes
+ * @param[out] id Identifies the processor in @ref acc_frame_fanout_get_stats
+ * @return true if successful, false otherwise
+ */
+bool acc_frame_fanout_add_processor(acc_frame_fanout_t             *fanout,
+                                    const char                     *name,
+                                    acc_frame_fanout_process_func_t process,
+                                    void                           *user_data,
+                                    bool                            own_thread,
+                                    uint16_t                       *id);
+
+
+/**
+ * @brief Allocate the buffers and start the processor threads
+ *
+ * @param[in] fanout The fan-out
+ * @return true if successful, false otherwise
+ */
+bool acc_frame_fanout_start(acc_frame_fanout_t *fanout);
+
+
+/**
+ * @brief Get the buffer to read the next frame into, e.g. with acc_sensor_read
+ *
+ * @param[in] fanout The fan-out
+ * @return The buffer, buffer_size bytes
+ */
+void *acc_frame_fanout_get_buffer(acc_frame_fanout_t *fanout);
+
+
+/**
+ * @brief Give the frame in the buffer to all processors
+ *
+ * Processors in the thread that publishes have processed the frame when the function returns.
+ *
+ * @param[in] fanout The fan-out
+ * @param[in] result The processing result of the buffer, e.g. from acc_processing_execute,
+ *            with its frame in the buffer from @ref acc_frame_fanout_get_buffer
+ * @return true if all processors in the thread that publishes succeeded
+ */
+bool acc_frame_fanout_publish(acc_frame_fanout_t *fanout, const acc_processing_result_t *result);
+
+
+/**
+ * @brief Process the frames that are left in the queues and stop the processor threads
+ *
+ * @param[in] fanout The fan-out
+ */
+void acc_frame_fanout_stop(acc_frame_fanout_t *fanout);
+
+
+/**
+ * @brief Get the statistics of a processor
+ *
+ * @param[in] fanout The fan-out
+ * @param[in] id The processor
+ * @param[out] stats The statistics
+ */
+void acc_frame_fanout_get_stats(acc_frame_fanout_t *fanout, uint16_t id, acc_frame_fanout_stats_t *stats);
+
+
+/**
+ * @brief Print the statistics of all processors
+ *
+ * @param[in] fanout The fan-out
+ */
+void acc_frame_fanout_print_stats(acc_frame_fanout_t *fanout);
+
+
+#endif
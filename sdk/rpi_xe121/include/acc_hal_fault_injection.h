@@ -0,0 +1,76 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+
+#ifndef ACC_HAL_FAULT_INJECTION_H_
+#define ACC_HAL_FAULT_INJECTION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions_common.h"
+#include "acc_hal_definitions_a121.h"
+
+/**
+ * HAL fault injection
+ *
+ * Wraps the HAL of the board to inject sensor faults, so that the fault
+ * handling of an application can be exercised without a faulty sensor.
+ * Faults are injected periodically, every period events of the kind, in
+ * bursts of burst consecutive events. Without any configured fault the
+ * wrapper passes everything through.
+ *
+ * The faults can also be configured with environment variables, read by
+ * @ref acc_hal_fault_injection_get_implementation, in the form period[:burst]:
+ *   ACC_HAL_FAULT_INTERRUPT_TIMEOUT=500     every 500th interrupt wait times out
+ *   ACC_HAL_FAULT_TRANSFER=20000:50         50 transfers every 20000 transfers return no data
+ */
+
+typedef enum
+{
+	/** The interrupt wait returns false as if the interrupt never came */
+	ACC_HAL_FAULT_INTERRUPT_TIMEOUT,
+	/** The SPI transfer is not done and all bytes read as 0, as if the sensor was unpowered */
+	ACC_HAL_FAULT_TRANSFER,
+	ACC_HAL_FAULT_NUM_FAULTS,
+} acc_hal_fault_t;
+
+
+/**
+ * @brief Get a HAL implementation with fault injection
+ *
+ * Reads the fault configuration from the environment.
+ *
+ * @param[in] hal The HAL implementation of the board
+ * @return The HAL implementation with fault injection, NULL if hal is NULL
+ */
+const acc_hal_a121_t *acc_hal_fault_injection_get_implementation(const acc_hal_a121_t *hal);
+
+
+/**
+ * @brief Configure periodic injection of a fault
+ *
+ * @param[in] fault The fault to inject
+ * @param[in] period Number of events between the start of each burst, 0 to disable
+ * @param[in] burst Number of consecutive events that fail in each burst
+ */
+void acc_hal_fault_injection_set_fault(acc_hal_fault_t fault, uint32_t period, uint32_t burst);
+
+
+/**
+ * @brief Wait for a sensor interrupt, with fault injection
+ *
+ * Same as @ref acc_hal_integration_wait_for_sensor_interrupt
+ */
+bool acc_hal_fault_injection_wait_for_sensor_interrupt(acc_sensor_id_t sensor_id, uint32_t timeout_ms);
+
+
+/**
+ * @brief Get the number of injected faults of a kind
+ *
+ * @param[in] fault The fault
+ * @return The number of events that were failed
+ */
+uint32_t acc_hal_fault_injection_get_count(acc_hal_fault_t fault);
+
+
+#endif
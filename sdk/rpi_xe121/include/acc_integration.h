@@ -5,6 +5,7 @@
 #define ACC_INTEGRATION_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -50,6 +51,62 @@ void *acc_integration_mem_calloc(size_t nmemb, size_t size);
  */
 void acc_integration_mem_free(void *ptr);
 
+/**
+ * @brief Heap statistics of the integration allocator
+ */
+typedef struct
+{
+	size_t   live_bytes;               /**< Bytes currently allocated */
+	size_t   peak_bytes;               /**< Highest number of bytes allocated at the same time */
+	uint32_t live_allocations;         /**< Blocks currently allocated */
+	uint32_t total_allocations;        /**< Blocks allocated since start */
+	uint32_t steady_state_allocations; /**< Blocks allocated in steady state, should be 0 */
+	size_t   pool_size;                /**< Size of the allocation pool, 0 if not used */
+	size_t   pool_free_bytes;          /**< Bytes left in the allocation pool */
+	uint32_t pool_fallbacks;           /**< Allocations that did not fit in the pool and used malloc */
+} acc_integration_mem_stats_t;
+
+/**
+ * @brief Serve allocations from a preallocated pool
+ *
+ * Must be called before the first allocation. Allocations that do not fit in
+ * the pool fall back to malloc and are counted in pool_fallbacks. The pool can
+ * also be enabled by setting the ACC_MEM_POOL_SIZE environment variable to the
+ * pool size in bytes.
+ *
+ * @param[in] size The size of the pool in bytes
+ * @return true if the pool was created, false otherwise
+ */
+bool acc_integration_mem_pool_init(size_t size);
+
+/**
+ * @brief Enter steady state
+ *
+ * Every allocation until @ref acc_integration_mem_steady_state_end is reported
+ * with its call site. If the ACC_MEM_STEADY_STATE environment variable is set
+ * to "abort", the application is aborted instead. Calls can be nested.
+ */
+void acc_integration_mem_steady_state_begin(void);
+
+/**
+ * @brief Leave steady state
+ */
+void acc_integration_mem_steady_state_end(void);
+
+/**
+ * @brief Get the heap statistics
+ *
+ * @param[out] stats The heap statistics
+ */
+void acc_integration_mem_get_stats(acc_integration_mem_stats_t *stats);
+
+/**
+ * @brief Print the heap statistics and the allocations per call site
+ *
+ * Call sites are printed as return addresses, use addr2line to resolve them.
+ */
+void acc_integration_mem_print_stats(void);
+
 /**
  * @brief Get current time
  *
@@ -60,4 +117,15 @@ void acc_integration_mem_free(void *ptr);
  */
 uint32_t acc_integration_get_time(void);
 
+
+/**
+ * @brief Get current time in microseconds
+ *
+ * Wraps in the same way as @ref acc_integration_get_time, after 2^32 - 1 microseconds.
+ * Use the difference between two values to measure durations.
+ *
+ * @returns Current time as microseconds
+ */
+uint32_t acc_integration_get_time_us(void);
+
 #endif
@@ -0,0 +1,72 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+
+#ifndef ACC_IQ_CODEC_H_
+#define ACC_IQ_CODEC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions_common.h"
+
+/**
+ * Lossless codec for IQ frames
+ *
+ * Each value is predicted from the same point in the previous sweep, or from
+ * the previous point for the first sweep of the frame. The prediction residuals
+ * are zigzag encoded and bit-packed in blocks of ACC_IQ_CODEC_BLOCK_LENGTH values
+ * that share one bit width. A frame that does not compress is stored as is, so
+ * an encoded frame is never more than one byte larger than the raw frame.
+ *
+ * Encoded frame layout:
+ *   - 1 byte method, see acc_iq_codec_method_t
+ *   - ACC_IQ_CODEC_METHOD_STORED: the int16 values, little endian, real before imag
+ *   - ACC_IQ_CODEC_METHOD_DELTA_PACKED: for each block, 1 byte bit width w (0-16)
+ *     followed by 2 * w bytes with the residuals packed LSB first
+ */
+
+#define ACC_IQ_CODEC_BLOCK_LENGTH (16U)
+
+/**
+ * @brief The largest possible size of an encoded frame
+ */
+#define ACC_IQ_CODEC_MAX_ENCODED_SIZE(num_points, sweeps_per_frame) (1U + (4U * (uint32_t)(num_points) * (uint32_t)(sweeps_per_frame)))
+
+typedef enum
+{
+	ACC_IQ_CODEC_METHOD_STORED       = 0,
+	ACC_IQ_CODEC_METHOD_DELTA_PACKED = 1,
+} acc_iq_codec_method_t;
+
+
+/**
+ * @brief Encode an IQ frame
+ *
+ * @param[in] frame The frame, sweeps_per_frame sweeps of num_points points
+ * @param[in] num_points The number of points in each sweep
+ * @param[in] sweeps_per_frame The number of sweeps in the frame
+ * @param[out] buffer The encoded frame
+ * @param[in] buffer_size The size of buffer, at least ACC_IQ_CODEC_MAX_ENCODED_SIZE
+ * @return The size of the encoded frame, 0 if the buffer is too small
+ */
+uint32_t acc_iq_codec_encode(const acc_int16_complex_t *frame,
+                             uint16_t                   num_points,
+                             uint16_t                   sweeps_per_frame,
+                             uint8_t                   *buffer,
+                             uint32_t                   buffer_size);
+
+
+/**
+ * @brief Decode an IQ frame
+ *
+ * @param[in] buffer The encoded frame
+ * @param[in] size The size of the encoded frame
+ * @param[in] num_points The number of points in each sweep
+ * @param[in] sweeps_per_frame The number of sweeps in the frame
+ * @param[out] frame The decoded frame, sweeps_per_frame * num_points values
+ * @return true if the encoded frame was valid, false otherwise
+ */
+bool acc_iq_codec_decode(const uint8_t *buffer, uint32_t size, uint16_t num_points, uint16_t sweeps_per_frame, acc_int16_complex_t *frame);
+
+
+#endif
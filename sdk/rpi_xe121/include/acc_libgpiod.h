@@ -33,6 +33,24 @@ typedef struct
 	gpio_direction_t   direction;
 } gpio_pin_t;
 
+/**
+ * Number of buckets in the wake-up latency histograms
+ *
+ * Bucket 0 counts latencies below 1 us, bucket i counts latencies in
+ * [2^(i-1), 2^i) us and the last bucket counts everything above.
+ */
+#define ACC_LIBGPIOD_LATENCY_BUCKETS 16
+
+typedef struct
+{
+	uint32_t already_high;      /**< Waits where the pin was high on entry */
+	uint32_t busy_poll_wakeups; /**< Waits completed while busy-polling */
+	uint32_t event_wakeups;     /**< Waits completed by the blocking event wait */
+	uint32_t timeouts;          /**< Waits that timed out */
+	uint32_t busy_poll_latency[ACC_LIBGPIOD_LATENCY_BUCKETS];
+	uint32_t event_latency[ACC_LIBGPIOD_LATENCY_BUCKETS];
+} acc_libgpiod_wait_stats_t;
+
 /**
  * Initialize gpio and configure a list of gpios
  *
@@ -82,4 +100,46 @@ bool acc_libgpiod_set(int pin, gpio_pin_value_t value);
  */
 bool acc_libgpiod_wait_for_interrupt(int pin, uint32_t timeout_ms);
 
+/**
+ * Configure busy-polling in acc_libgpiod_wait_for_interrupt()
+ *
+ * When the window is non-zero the interrupt pin value is polled in a tight loop
+ * for up to window_us before falling back to the blocking event wait. This avoids
+ * the kernel wake-up latency for short frames at the cost of CPU time.
+ *
+ * The pin value is read with gpiod_line_get_value() or, if use_mmap is true, from
+ * the memory-mapped GPIO level register in /dev/gpiomem. The register layout is
+ * that of the BCM2835-BCM2711 (Raspberry Pi 1-4). If the mapping fails gpiod is used.
+ *
+ * The defaults can also be set with the environment variables ACC_GPIO_BUSY_POLL_US
+ * and ACC_GPIO_MMAP, which are read by acc_libgpiod_init().
+ *
+ * @param[in] window_us The busy-poll window in microseconds, 0 to disable
+ * @param[in] use_mmap Read the pin value from the memory-mapped GPIO registers
+ */
+void acc_libgpiod_set_busy_poll(uint32_t window_us, bool use_mmap);
+
+/**
+ * Get the wake-up statistics of acc_libgpiod_wait_for_interrupt()
+ *
+ * Both latencies are the time from the kernel timestamp of the rising edge until
+ * the wait returns. A busy-poll wakeup that sees the pin high before the kernel
+ * has queued the edge event is counted but has no latency in the histogram.
+ * The statistics are guarded by a mutex, so they can be read, reset and printed
+ * from another thread than the one waiting.
+ *
+ * @param[out] stats The statistics
+ */
+void acc_libgpiod_get_wait_stats(acc_libgpiod_wait_stats_t *stats);
+
+/**
+ * Reset the wake-up statistics
+ */
+void acc_libgpiod_reset_wait_stats(void);
+
+/**
+ * Print the wake-up statistics and latency histograms
+ */
+void acc_libgpiod_print_wait_stats(void);
+
 #endif
@@ -0,0 +1,49 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+
+#ifndef ACC_LIBGPIOD_FAKE_H_
+#define ACC_LIBGPIOD_FAKE_H_
+
+#include <stdint.h>
+
+/**
+ * Fake GPIO backend
+ *
+ * acc_libgpiod_fake.c implements the part of the libgpiod API that is used by
+ * acc_libgpiod.c. Linking it instead of libgpiod allows the interrupt wait logic
+ * to be run on a host without GPIO hardware.
+ *
+ * An interrupt line produces a rising edge every period and stays high for
+ * a part of the period, like a sensor that measures with a fixed frame rate.
+ */
+
+/**
+ * Generate periodic interrupts on an input pin
+ *
+ * The first rising edge occurs one period after the call.
+ *
+ * @param[in] pin The pin
+ * @param[in] period_us The time between rising edges in microseconds, 0 to stop
+ * @param[in] high_us The time the pin stays high after each rising edge
+ */
+void acc_libgpiod_fake_set_interrupt(unsigned int pin, uint32_t period_us, uint32_t high_us);
+
+/**
+ * Get the number of edge events queued on an interrupt pin and not read
+ *
+ * @param[in] pin The pin
+ *
+ * @return The number of queued events
+ */
+uint32_t acc_libgpiod_fake_get_queued_events(unsigned int pin);
+
+/**
+ * Get the value of an output pin
+ *
+ * @param[in] pin The pin
+ *
+ * @return The last value set on the pin
+ */
+int acc_libgpiod_fake_get_output(unsigned int pin);
+
+#endif
@@ -295,6 +295,28 @@ float acc_vector_iq_coherent_mean_amplitude(const acc_vector_iq_t *vector_a);
 float acc_vector_iq_noncoherent_mean_amplitude(const acc_vector_iq_t *vector_a);
 
 
+/**
+ * @brief Coherent and non-coherent mean amplitudes of all points in a frame
+ *
+ * Calculate the same values as acc_vector_iq_coherent_mean_amplitude and
+ * acc_vector_iq_noncoherent_mean_amplitude on the sweep vector of every point,
+ * see acc_get_iq_point_vector, but in one pass over the frame in sweep order.
+ * The sums are accumulated in integers and the amplitudes with the SIMD kernels
+ * of the algorithm library, without gathering each point into a vector.
+ *
+ * @param[in] frame The IQ frame
+ * @param[in] sweep_data_length Number of points in a sweep
+ * @param[in] sweeps_per_frame Number of sweeps in the frame
+ * @param[out] coherent_out The coherent mean amplitude of each point, sweep_data_length long
+ * @param[out] noncoherent_out The non-coherent mean amplitude of each point, sweep_data_length long
+ */
+void acc_processing_helper_point_mean_amplitudes(const acc_int16_complex_t *frame,
+                                                 uint32_t                   sweep_data_length,
+                                                 uint32_t                   sweeps_per_frame,
+                                                 acc_vector_float_t        *coherent_out,
+                                                 acc_vector_float_t        *noncoherent_out);
+
+
 /**
  * @brief Phase of an IQ vector
  *
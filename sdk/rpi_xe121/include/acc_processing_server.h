@@ -0,0 +1,109 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#ifndef ACC_PROCESSING_SERVER_H_
+#define ACC_PROCESSING_SERVER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "acc_definitions_a121.h"
+#include "acc_processing.h"
+#include "acc_sensor.h"
+#include "acc_socket_server.h"
+
+/** \example acc_processing_server.c
+ * @brief This is the protocol of acc_processing_server_a121
+ * @n
+ * Runs a processing chain on the sensor data and streams only the results to the
+ * client, optionally together with every n:th raw frame. This uses a fraction of
+ * the bandwidth of the exploration server, which streams every raw frame.
+ * @n
+ * The client sends newline terminated JSON commands:
+ *   {"cmd":"get_system_info"}
+ *   {"cmd":"start_streaming","processing":"breathing","raw_decimation":0,"raw_encoding":"none"}
+ *   {"cmd":"stop_streaming"}
+ * @n
+ * The server answers each command with a JSON line with a "status" member and,
+ * while streaming, sends one JSON line per processed frame with a "type" member
+ * that names the processing chain. A raw frame is sent as the JSON line
+ *   {"type":"raw","frame":<n>,"num_points":<points>,"sweeps_per_frame":<sweeps>,"encoded_size":<size>}
+ * followed by encoded_size bytes. With raw_encoding "none" these are the
+ * num_points * sweeps_per_frame acc_int16_complex_t values in host byte order,
+ * with raw_encoding "iq_delta" the frame is encoded with acc_iq_codec.
+ * @n
+ * The processing chains and the sensor are given by the application, so that the
+ * protocol can be run against a fake sensor, see example_processing_server_loopback.
+ * There can only be one server in a process.
+ */
+
+
+/**
+ * @brief Longest command line, longer commands are truncated
+ */
+#define ACC_PROCESSING_SERVER_MAX_COMMAND_SIZE (1024U)
+
+
+/**
+ * @brief A processing chain that can be streamed
+ */
+typedef struct
+{
+	/** Name of the chain in the start_streaming command */
+	const char *name;
+	/** Create the chain and get the size of the sensor buffer and of the frames */
+	bool (*create)(uint32_t *buffer_size, uint16_t *num_points, uint16_t *sweeps_per_frame);
+	/** Prepare the calibrated sensor for the chain */
+	bool (*prepare)(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size);
+	/** Process a frame in the buffer into a JSON result line without the newline */
+	bool (*process)(void *buffer, char *message, size_t message_size, acc_processing_result_t *processing_result);
+	/** Destroy the chain, also after a failed create */
+	void (*destroy)(void);
+} acc_processing_server_chain_t;
+
+
+/**
+ * @brief The sensor the chains are run on
+ */
+typedef struct
+{
+	/** Power up and calibrate the sensor, then prepare it with the prepare function of the chain */
+	bool (*prepare)(const acc_processing_server_chain_t *chain, void *buffer, uint32_t buffer_size);
+	/** Calibrate the prepared sensor again without powering it down, then prepare it with the prepare function of the chain */
+	bool (*recalibrate)(const acc_processing_server_chain_t *chain, void *buffer, uint32_t buffer_size);
+	/** Measure and read a frame into the buffer */
+	bool (*measure)(void *buffer, uint32_t buffer_size);
+	/** Power down the sensor, also when it was never prepared */
+	void (*release)(void);
+} acc_processing_server_sensor_t;
+
+
+typedef struct
+{
+	const acc_processing_server_chain_t  *chains;
+	uint16_t                              num_chains;
+	const acc_processing_server_sensor_t *sensor;
+	/** Reported by get_system_info */
+	const char *rss_version;
+	uint16_t    sensor_count;
+} acc_processing_server_config_t;
+
+
+/**
+ * @brief Serve clients on an open socket server until shutdown is set
+ *
+ * One client is served at a time. Set shutdown and shut the server socket down
+ * to return while waiting for a client.
+ *
+ * @param[in] socket_server The open socket server
+ * @param[in] config The chains and the sensor, must stay valid while serving
+ * @param[in] shutdown Return when set, checked between frames and clients
+ */
+void acc_processing_server_serve(acc_socket_server_t *socket_server, const acc_processing_server_config_t *config, volatile bool *shutdown);
+
+
+#endif
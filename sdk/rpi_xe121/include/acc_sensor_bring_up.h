@@ -0,0 +1,80 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#ifndef ACC_SENSOR_BRING_UP_H_
+#define ACC_SENSOR_BRING_UP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_config.h"
+#include "acc_definitions_a121.h"
+#include "acc_definitions_common.h"
+#include "acc_sensor.h"
+
+/** \example acc_sensor_bring_up.c
+ * @brief This is a helper that brings up several sensors at the same time
+ * The sensors are enabled back to back so that they share the crystal startup
+ * time, and the calibration steps of all sensors are interleaved so that one
+ * sensor measures while another is accessed over SPI.
+ * The time each sensor reaches each stage is recorded and can be printed as
+ * a startup timeline.
+ */
+
+
+typedef struct
+{
+	/** Set by the caller */
+	acc_sensor_id_t     sensor_id;
+	void               *buffer;
+	uint32_t            buffer_size;
+	const acc_config_t *config; /**< Optional, the sensor is prepared with this config if not NULL */
+
+	/** Set by @ref acc_sensor_bring_up_run */
+	acc_sensor_t     *sensor;
+	acc_cal_result_t  cal_result;
+	bool              ok;
+	uint16_t          calibration_steps;
+	uint32_t          enabled_us;    /**< Time from start until the sensor was enabled */
+	uint32_t          created_us;    /**< Time from start until the sensor instance was created */
+	uint32_t          calibrated_us; /**< Time from start until the calibration was complete */
+	uint32_t          ready_us;      /**< Time from start until the sensor was reset and prepared */
+} acc_sensor_bring_up_t;
+
+
+/**
+ * @brief Power on, create, calibrate and optionally prepare a number of sensors
+ *
+ * A sensor that fails is disabled and powered off, the others continue.
+ * The ok member of each entry tells if that sensor was brought up.
+ *
+ * @param[in, out] sensors The sensors to bring up
+ * @param[in] sensor_count The number of sensors
+ * @param[in] timeout_ms The maximum time to wait for each calibration step
+ * @return true if all sensors were brought up, false otherwise
+ */
+bool acc_sensor_bring_up_run(acc_sensor_bring_up_t *sensors, uint16_t sensor_count, uint32_t timeout_ms);
+
+
+/**
+ * @brief Destroy the sensor instances and power off the sensors
+ *
+ * @param[in, out] sensors The sensors
+ * @param[in] sensor_count The number of sensors
+ */
+void acc_sensor_bring_up_release(acc_sensor_bring_up_t *sensors, uint16_t sensor_count);
+
+
+/**
+ * @brief Print the startup timeline of the sensors
+ *
+ * @param[in] sensors The sensors
+ * @param[in] sensor_count The number of sensors
+ */
+void acc_sensor_bring_up_print_timeline(const acc_sensor_bring_up_t *sensors, uint16_t sensor_count);
+
+
+#endif
@@ -0,0 +1,151 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#ifndef ACC_SENSOR_RECOVERY_H_
+#define ACC_SENSOR_RECOVERY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions_a121.h"
+#include "acc_definitions_common.h"
+#include "acc_sensor.h"
+
+/** \example acc_sensor_recovery.c
+ * @brief This is a helper that measures with a sensor and recovers from sensor faults in-process
+ * When a measurement fails, the sensor is recovered in escalating steps:
+ *   - Reset the sensor by disabling and enabling it and prepare it with the cached calibration
+ *   - Calibrate the sensor again and prepare it
+ *   - Power cycle the sensor, create a new sensor instance, calibrate and prepare it
+ * The application prepares the sensor through a callback, e.g. with a detector, so the
+ * detector and its processing state are kept through the recovery.
+ */
+
+
+typedef enum
+{
+	ACC_SENSOR_RECOVERY_FAULT_MEASURE,
+	ACC_SENSOR_RECOVERY_FAULT_INTERRUPT_TIMEOUT,
+	ACC_SENSOR_RECOVERY_FAULT_READ,
+	ACC_SENSOR_RECOVERY_FAULT_CALIBRATION,
+	ACC_SENSOR_RECOVERY_NUM_FAULTS,
+} acc_sensor_recovery_fault_t;
+
+
+typedef enum
+{
+	ACC_SENSOR_RECOVERY_STEP_RESET,
+	ACC_SENSOR_RECOVERY_STEP_RECALIBRATE,
+	ACC_SENSOR_RECOVERY_STEP_POWER_CYCLE,
+	ACC_SENSOR_RECOVERY_NUM_STEPS,
+} acc_sensor_recovery_step_t;
+
+
+typedef struct
+{
+	uint32_t faults[ACC_SENSOR_RECOVERY_NUM_FAULTS];    /**< Number of faults of each kind */
+	uint32_t recoveries[ACC_SENSOR_RECOVERY_NUM_STEPS]; /**< Number of recoveries completed by each step */
+	uint32_t failed_recoveries;                         /**< Number of recoveries where all steps failed */
+	uint32_t last_duration_us;                          /**< Duration of the last recovery */
+	uint32_t max_duration_us;                           /**< Duration of the longest recovery */
+	uint64_t total_duration_us;                         /**< Total time spent recovering */
+} acc_sensor_recovery_stats_t;
+
+
+/**
+ * @brief Prepare the sensor for measurements, e.g. through a detector
+ */
+typedef bool (*acc_sensor_recovery_prepare_func_t)(acc_sensor_t           *sensor,
+                                                   const acc_cal_result_t *cal_result,
+                                                   void                   *buffer,
+                                                   uint32_t                buffer_size,
+                                                   void                   *user_data);
+
+
+/**
+ * @brief Wait for the sensor interrupt, same as acc_hal_integration_wait_for_sensor_interrupt
+ */
+typedef bool (*acc_sensor_recovery_wait_func_t)(acc_sensor_id_t sensor_id, uint32_t timeout_ms);
+
+
+typedef struct
+{
+	/** Set by the caller */
+	acc_sensor_id_t                    sensor_id;
+	void                              *buffer;
+	uint32_t                           buffer_size;
+	uint32_t                           timeout_ms;
+	acc_sensor_recovery_prepare_func_t prepare;
+	void                              *prepare_user_data;
+	acc_sensor_recovery_wait_func_t    wait_for_interrupt; /**< Optional, NULL for acc_hal_integration_wait_for_sensor_interrupt */
+
+	/** Set by the helper */
+	acc_sensor_t               *sensor;
+	acc_cal_result_t            cal_result;
+	acc_sensor_recovery_stats_t stats;
+} acc_sensor_recovery_t;
+
+
+/**
+ * @brief Power on, create, calibrate and prepare the sensor
+ *
+ * @param[in, out] recovery The recovery state, with the caller members set
+ * @return true if successful, false otherwise
+ */
+bool acc_sensor_recovery_start(acc_sensor_recovery_t *recovery);
+
+
+/**
+ * @brief Measure and read a frame into the buffer, recovering the sensor on failure
+ *
+ * A frame is read after a successful recovery, so the caller can continue
+ * processing as if nothing happened. When the fault comes back on that frame,
+ * the next recovery starts at the step after the one that recovered, so a
+ * reset that does not clear the fault escalates to a recalibration.
+ *
+ * @param[in, out] recovery The recovery state
+ * @return true if a frame was read, false if the sensor could not be recovered
+ */
+bool acc_sensor_recovery_measure(acc_sensor_recovery_t *recovery);
+
+
+/**
+ * @brief Calibrate and prepare the sensor, e.g. on a calibration_needed indication
+ *
+ * @param[in, out] recovery The recovery state
+ * @return true if successful, false if the sensor could not be recovered
+ */
+bool acc_sensor_recovery_recalibrate(acc_sensor_recovery_t *recovery);
+
+
+/**
+ * @brief Prepare the sensor again with the cached calibration, e.g. after a configuration change
+ *
+ * The buffer and the prepare user data may be changed before the call.
+ *
+ * @param[in, out] recovery The recovery state
+ * @return true if successful, false otherwise
+ */
+bool acc_sensor_recovery_prepare(acc_sensor_recovery_t *recovery);
+
+
+/**
+ * @brief Destroy the sensor instance and power off the sensor
+ *
+ * @param[in, out] recovery The recovery state
+ */
+void acc_sensor_recovery_stop(acc_sensor_recovery_t *recovery);
+
+
+/**
+ * @brief Print the fault and recovery statistics
+ *
+ * @param[in] recovery The recovery state
+ */
+void acc_sensor_recovery_print_stats(const acc_sensor_recovery_t *recovery);
+
+
+#endif
@@ -0,0 +1,121 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+
+#ifndef ACC_SENSOR_SIM_H_
+#define ACC_SENSOR_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions_a121.h"
+
+/**
+ * Sensor timing simulator
+ *
+ * Models the timing of an A121 measurement without a sensor: the frame timer,
+ * the measurement duration, the data ready interrupt and the frame delayed
+ * indication that is set when the data of a frame is read too late for the
+ * next frame to start on time. It only models timing, no radar data is produced.
+ *
+ * The measure, wait and read functions follow acc_sensor_measure(),
+ * acc_hal_integration_wait_for_sensor_interrupt() and acc_sensor_read(), so a
+ * processing loop can be run against the simulator on any Linux host to
+ * evaluate its processing time budget.
+ */
+
+typedef struct
+{
+	acc_config_profile_t profile;
+	uint16_t             num_points;
+	uint8_t              hwaas;
+	uint16_t             sweeps_per_frame;
+	/** Sweep rate in Hz, 0 for the maximum sweep rate */
+	float sweep_rate;
+	/** Frame rate in Hz, 0 to start each frame when measure is called */
+	float frame_rate;
+	/**
+	 * Sweep duration in microseconds, 0 to estimate it from profile, points and hwaas.
+	 * The exact value for a config is 1 / max_sweep_rate from acc_processing_metadata_t.
+	 */
+	uint32_t sweep_duration_us;
+} acc_sensor_sim_config_t;
+
+typedef struct
+{
+	uint32_t frames;         /**< Number of frames read */
+	uint32_t frames_delayed; /**< Number of frames read with frame_delayed set */
+	uint32_t missed_ticks;   /**< Number of frame timer ticks without a frame */
+} acc_sensor_sim_stats_t;
+
+typedef struct acc_sensor_sim acc_sensor_sim_t;
+
+
+/**
+ * @brief Create a simulated sensor
+ *
+ * @param[in] config The configuration to simulate
+ * @return Simulated sensor, NULL on failure
+ */
+acc_sensor_sim_t *acc_sensor_sim_create(const acc_sensor_sim_config_t *config);
+
+
+/**
+ * @brief Destroy a simulated sensor
+ *
+ * @param[in] sim The simulated sensor
+ */
+void acc_sensor_sim_destroy(acc_sensor_sim_t *sim);
+
+
+/**
+ * @brief Get the simulated duration of one measurement (frame)
+ *
+ * @param[in] sim The simulated sensor
+ * @return The measurement duration in microseconds
+ */
+uint32_t acc_sensor_sim_get_measurement_duration_us(const acc_sensor_sim_t *sim);
+
+
+/**
+ * @brief Start a measurement
+ *
+ * With a frame rate the measurement starts on the next frame timer tick. If the
+ * tick has already passed the measurement starts immediately and the frame is
+ * reported as delayed when it is read.
+ *
+ * @param[in] sim The simulated sensor
+ * @return true if successful, false if a measurement is already ongoing
+ */
+bool acc_sensor_sim_measure(acc_sensor_sim_t *sim);
+
+
+/**
+ * @brief Wait for the data ready interrupt
+ *
+ * @param[in] sim The simulated sensor
+ * @param[in] timeout_ms The maximum time to wait in milliseconds
+ * @return true if the data is ready, false if timeout occurred
+ */
+bool acc_sensor_sim_wait_for_interrupt(acc_sensor_sim_t *sim, uint32_t timeout_ms);
+
+
+/**
+ * @brief Read the data of a measurement
+ *
+ * @param[in] sim The simulated sensor
+ * @param[out] frame_delayed Set if the frame did not start on its frame timer tick
+ * @return true if successful, false if no data is ready
+ */
+bool acc_sensor_sim_read(acc_sensor_sim_t *sim, bool *frame_delayed);
+
+
+/**
+ * @brief Get the frame statistics of a simulated sensor
+ *
+ * @param[in] sim The simulated sensor
+ * @param[out] stats The statistics
+ */
+void acc_sensor_sim_get_stats(const acc_sensor_sim_t *sim, acc_sensor_sim_stats_t *stats);
+
+
+#endif
@@ -0,0 +1,90 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+
+#ifndef ACC_SLIDING_MEDIAN_H_
+#define ACC_SLIDING_MEDIAN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Sliding window median
+ *
+ * Keeps the median of the last capacity pushed values. NaN values take up a
+ * place in the window but are left out of the median, so a window with NaNs
+ * gives the same median as acc_algorithm_median_f32 on its non-NaN values.
+ *
+ * The non-NaN values are kept in two indexed heaps, a max heap with the lower
+ * half and a min heap with the upper half, so that a push, which also drops
+ * the oldest value in a full window, costs O(log capacity) instead of sorting
+ * the whole window.
+ */
+
+typedef struct acc_sliding_median acc_sliding_median_t;
+
+
+/**
+ * @brief Create a sliding median
+ *
+ * @param[in] capacity The window length, at least 1
+ * @return The sliding median, NULL if creation failed
+ */
+acc_sliding_median_t *acc_sliding_median_create(uint16_t capacity);
+
+
+/**
+ * @brief Destroy a sliding median
+ *
+ * @param[in] median The sliding median to destroy, can be NULL
+ */
+void acc_sliding_median_destroy(acc_sliding_median_t *median);
+
+
+/**
+ * @brief Remove all values from the window
+ *
+ * @param[in, out] median The sliding median
+ */
+void acc_sliding_median_reset(acc_sliding_median_t *median);
+
+
+/**
+ * @brief Push a value into the window, dropping the oldest value if the window is full
+ *
+ * @param[in, out] median The sliding median
+ * @param[in] value The value, NaN if there is no value
+ */
+void acc_sliding_median_push(acc_sliding_median_t *median, float value);
+
+
+/**
+ * @brief Get the median of the non-NaN values in the window
+ *
+ * For an even number of values, the median is the mean of the two middle values.
+ *
+ * @param[in] median The sliding median
+ * @param[out] median_value The median
+ * @return true if there is at least one non-NaN value in the window, false otherwise
+ */
+bool acc_sliding_median_get(const acc_sliding_median_t *median, float *median_value);
+
+
+/**
+ * @brief Get the number of values in the window, including NaNs
+ *
+ * @param[in] median The sliding median
+ * @return The number of values
+ */
+uint16_t acc_sliding_median_get_length(const acc_sliding_median_t *median);
+
+
+/**
+ * @brief Get the number of NaN values in the window
+ *
+ * @param[in] median The sliding median
+ * @return The number of NaN values
+ */
+uint16_t acc_sliding_median_get_num_nan(const acc_sliding_median_t *median);
+
+
+#endif
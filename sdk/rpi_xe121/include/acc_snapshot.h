@@ -0,0 +1,194 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#ifndef ACC_SNAPSHOT_H_
+#define ACC_SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** \example acc_snapshot.c
+ * @brief This is a helper that stores processing state in a versioned snapshot, so that an
+ *        application can continue where it was after a restart
+ * @n
+ * A snapshot is a header followed by the payload that the application writes field by field.
+ * The header holds a magic number and a version of the payload layout, a hash of the configuration
+ * the state belongs to, the time of the snapshot and a checksum of the payload. A snapshot is only
+ * read back if all of them match and the snapshot is recent enough. The payload is stored in the
+ * byte order of the machine, snapshots are meant to be restored on the machine that wrote them.
+ * @n
+ * Files are written to a temporary file that is synced and renamed over the old snapshot, so a
+ * crash while writing leaves either the old or the new snapshot, never a mix.
+ */
+
+
+/**
+ * @brief Size of the snapshot header in bytes
+ */
+#define ACC_SNAPSHOT_HEADER_SIZE (32U)
+
+
+/**
+ * @brief Initial value of a hash calculated with @ref acc_snapshot_hash
+ */
+#define ACC_SNAPSHOT_HASH_INIT (2166136261U)
+
+
+typedef enum
+{
+	ACC_SNAPSHOT_STATUS_OK,
+	ACC_SNAPSHOT_STATUS_INVALID,       /**< Too short, wrong magic number or checksum mismatch */
+	ACC_SNAPSHOT_STATUS_VERSION,       /**< Written with another version of the payload layout */
+	ACC_SNAPSHOT_STATUS_CONFIG,        /**< Written with another configuration */
+	ACC_SNAPSHOT_STATUS_STALE,         /**< Older than the allowed age, or from the future */
+	ACC_SNAPSHOT_STATUS_NUM_STATUSES,
+} acc_snapshot_status_t;
+
+
+/**
+ * @brief Writer or reader of the payload of a snapshot
+ */
+typedef struct
+{
+	uint8_t       *write_buffer;
+	const uint8_t *read_buffer;
+	uint32_t       buffer_size;
+	uint32_t       offset;
+	bool           ok;
+} acc_snapshot_t;
+
+
+/**
+ * @brief Update a hash with data
+ *
+ * 32-bit FNV-1a, used both for the configuration hash and the payload checksum.
+ *
+ * @param[in] hash The hash so far, ACC_SNAPSHOT_HASH_INIT for the first data
+ * @param[in] data The data
+ * @param[in] size Size of the data in bytes
+ * @return The updated hash
+ */
+uint32_t acc_snapshot_hash(uint32_t hash, const void *data, uint32_t size);
+
+
+/**
+ * @brief Start writing a snapshot
+ *
+ * With buffer NULL, nothing is written and the offset after @ref acc_snapshot_end_write
+ * is the size the snapshot would have.
+ *
+ * @param[out] snapshot The snapshot writer
+ * @param[in] buffer Buffer for the whole snapshot, header included, or NULL
+ * @param[in] buffer_size Size of the buffer in bytes
+ */
+void acc_snapshot_begin_write(acc_snapshot_t *snapshot, void *buffer, uint32_t buffer_size);
+
+
+/**
+ * @brief Append data to the payload of a snapshot
+ *
+ * @param[in, out] snapshot The snapshot writer
+ * @param[in] data The data
+ * @param[in] size Size of the data in bytes
+ */
+void acc_snapshot_write(acc_snapshot_t *snapshot, const void *data, uint32_t size);
+
+
+/**
+ * @brief Finish a snapshot by writing its header
+ *
+ * @param[in, out] snapshot The snapshot writer
+ * @param[in] magic Identifies the kind of state in the snapshot
+ * @param[in] version Version of the payload layout
+ * @param[in] config_hash Hash of the configuration the state belongs to
+ * @param[in] timestamp_ms Wall clock time of the snapshot in ms
+ * @param[out] snapshot_size Size of the whole snapshot in bytes
+ * @return true if everything fit in the buffer
+ */
+bool acc_snapshot_end_write(acc_snapshot_t *snapshot,
+                            uint32_t        magic,
+                            uint16_t        version,
+                            uint32_t        config_hash,
+                            uint64_t        timestamp_ms,
+                            uint32_t       *snapshot_size);
+
+
+/**
+ * @brief Validate the header of a snapshot and start reading its payload
+ *
+ * @param[out] snapshot The snapshot reader
+ * @param[in] buffer The snapshot
+ * @param[in] size Size of the snapshot in bytes
+ * @param[in] magic Expected kind of state
+ * @param[in] version Expected version of the payload layout
+ * @param[in] config_hash Hash of the current configuration
+ * @param[in] now_ms Current wall clock time in ms
+ * @param[in] max_age_ms Highest allowed age of the snapshot
+ * @return ACC_SNAPSHOT_STATUS_OK if the payload can be read
+ */
+acc_snapshot_status_t acc_snapshot_begin_read(acc_snapshot_t *snapshot,
+                                              const void     *buffer,
+                                              uint32_t        size,
+                                              uint32_t        magic,
+                                              uint16_t        version,
+                                              uint32_t        config_hash,
+                                              uint64_t        now_ms,
+                                              uint32_t        max_age_ms);
+
+
+/**
+ * @brief Read data from the payload of a snapshot
+ *
+ * @param[in, out] snapshot The snapshot reader
+ * @param[out] data The data, left untouched if the payload is too short
+ * @param[in] size Size of the data in bytes
+ * @return true if the payload held the data
+ */
+bool acc_snapshot_read(acc_snapshot_t *snapshot, void *data, uint32_t size);
+
+
+/**
+ * @brief Check that the whole payload of a snapshot has been read
+ *
+ * @param[in] snapshot The snapshot reader
+ * @return true if all reads succeeded and the payload was read to its end
+ */
+bool acc_snapshot_end_read(const acc_snapshot_t *snapshot);
+
+
+/**
+ * @brief Get a description of a snapshot status
+ *
+ * @param[in] status The status
+ * @return The description
+ */
+const char *acc_snapshot_status_str(acc_snapshot_status_t status);
+
+
+/**
+ * @brief Atomically replace a snapshot file
+ *
+ * @param[in] path Path of the snapshot file
+ * @param[in] data The snapshot
+ * @param[in] size Size of the snapshot in bytes
+ * @return true if the new snapshot is in place
+ */
+bool acc_snapshot_file_write(const char *path, const void *data, uint32_t size);
+
+
+/**
+ * @brief Read a snapshot file
+ *
+ * @param[in] path Path of the snapshot file
+ * @param[out] buffer Buffer for the snapshot
+ * @param[in] buffer_size Size of the buffer in bytes
+ * @param[out] size Size of the snapshot in bytes
+ * @return true if the file exists and fits in the buffer
+ */
+bool acc_snapshot_file_read(const char *path, void *buffer, uint32_t buffer_size, uint32_t *size);
+
+
+#endif
@@ -0,0 +1,150 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#ifndef ACC_SURFACE_VELOCITY_PSD_H_
+#define ACC_SURFACE_VELOCITY_PSD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions_common.h"
+
+/**
+ * Distance-locked PSD of example_surface_velocity
+ *
+ * Keeps a slow-time series of every distance, estimates the power spectral density
+ * of each distance with Welch's method, low-pass filters it and selects the distance
+ * with the largest energy outside the slow zone.
+ *
+ * When the selected distance has been the same for a number of frames, the slow-time
+ * series is only kept and the PSD only calculated for that distance and its
+ * neighbours. A neighbour has to lead for
+ * a number of consecutive frames before the lock is dropped, so bin jitter between
+ * two distances does not drop it. The lock is also dropped when the energy at the
+ * locked distance falls, and periodically to verify it.
+ *
+ * The slow-time series and the low-pass filtered PSDs of the distances that were
+ * not tracked while locked are outdated when the lock is dropped. The selected
+ * distance is held while their slow-time series fill up with new sweeps, their PSDs
+ * are then restarted from the PSD of the frame, and the selected distance is held
+ * until they have settled, so that the distances are not selected by comparing
+ * restarted PSDs with filtered ones.
+ */
+
+typedef struct
+{
+	/** Number of distances in a sweep */
+	uint16_t num_distances;
+	/** Number of sweeps in a frame */
+	uint16_t sweeps_per_frame;
+	/** Number of sweeps in the slow-time series */
+	uint16_t time_series_length;
+	/** Sweep rate in Hz */
+	float sweep_rate;
+	/** Low-pass filter coefficient of the PSDs */
+	float psd_lp_coeff;
+	/** Half the number of frequency bins around zero that are left out when selecting a distance */
+	uint16_t slow_zone_half_length;
+	/** Number of frames the selected distance must be the same before it is locked, 0 to never lock */
+	uint16_t lock_frames;
+	/** Number of distances on each side of the locked distance that are tracked */
+	uint16_t lock_half_width;
+	/** Number of consecutive frames a neighbour must lead before the lock is dropped */
+	uint16_t unlock_frames;
+	/** Number of locked frames after which the lock is dropped to verify it */
+	uint16_t rescan_interval;
+	/** The lock is dropped when the energy falls below this fraction of the energy when it was locked */
+	float rescan_energy_ratio;
+	/** Number of frames the selected distance is held after the slow-time series are full again */
+	uint16_t settle_frames;
+} acc_surface_velocity_psd_config_t;
+
+typedef struct
+{
+	uint32_t frames;        /**< Number of updates */
+	uint32_t locked_frames; /**< Number of updates with the distance locked */
+	uint32_t locks;         /**< Number of times the lock was taken */
+	uint32_t unlocks_moved; /**< Number of times the lock was dropped for a neighbour */
+	uint32_t unlocks_lost;  /**< Number of times the lock was dropped for falling energy */
+	uint32_t rescans;       /**< Number of times the lock was dropped to verify it */
+} acc_surface_velocity_psd_stats_t;
+
+typedef struct acc_surface_velocity_psd acc_surface_velocity_psd_t;
+
+
+/**
+ * @brief Create a distance-locked PSD
+ *
+ * @param[in] config The config
+ * @return The PSD, NULL if creation failed
+ */
+acc_surface_velocity_psd_t *acc_surface_velocity_psd_create(const acc_surface_velocity_psd_config_t *config);
+
+
+/**
+ * @brief Destroy a distance-locked PSD
+ *
+ * @param[in] psd The PSD to destroy, can be NULL
+ */
+void acc_surface_velocity_psd_destroy(acc_surface_velocity_psd_t *psd);
+
+
+/**
+ * @brief Get the length of the PSD segments
+ *
+ * @param[in] psd The PSD
+ * @return Number of frequency bins of the PSD
+ */
+uint16_t acc_surface_velocity_psd_get_segment_length(const acc_surface_velocity_psd_t *psd);
+
+
+/**
+ * @brief Get the index of the zero frequency bin
+ *
+ * @param[in] psd The PSD
+ * @return The middle index
+ */
+uint16_t acc_surface_velocity_psd_get_middle_index(const acc_surface_velocity_psd_t *psd);
+
+
+/**
+ * @brief Push a frame and select a distance
+ *
+ * @param[in, out] psd The PSD
+ * @param[in] frame The frame, sweeps_per_frame sweeps of num_distances points
+ * @return The selected distance index
+ */
+uint16_t acc_surface_velocity_psd_update(acc_surface_velocity_psd_t *psd, const acc_int16_complex_t *frame);
+
+
+/**
+ * @brief Get the low-pass filtered PSD of the selected distance
+ *
+ * @param[in] psd The PSD
+ * @return The PSD of the last update, segment_length values with zero frequency at the middle index
+ */
+const float *acc_surface_velocity_psd_get_psd(const acc_surface_velocity_psd_t *psd);
+
+
+/**
+ * @brief Check if the distance is locked
+ *
+ * @param[in] psd The PSD
+ * @return true if the next update only calculates the PSD of the locked distance and its neighbours
+ */
+bool acc_surface_velocity_psd_is_locked(const acc_surface_velocity_psd_t *psd);
+
+
+/**
+ * @brief Get the statistics
+ *
+ * @param[in] psd The PSD
+ * @param[out] stats The statistics
+ */
+void acc_surface_velocity_psd_get_stats(const acc_surface_velocity_psd_t *psd, acc_surface_velocity_psd_stats_t *stats);
+
+
+#endif
@@ -11,6 +11,7 @@
 #include <stdint.h>
 
 #include "acc_detector_presence.h"
+#include "acc_snapshot.h"
 
 /**
  * @brief Breathing application context handle
@@ -48,6 +49,16 @@ typedef struct
 	 * Time to determine distance to presence
 	 */
 	uint16_t distance_determination_duration_s;
+	/**
+	 * Start the breathing analysis as soon as one distance clearly has the most
+	 * breathing band motion, instead of after the whole distance determination time
+	 */
+	bool use_early_distance_lock;
+	/**
+	 * Filter with second-order sections that start from the steady state of the first
+	 * sweep, instead of direct form filters that start from zero
+	 */
+	bool use_sos_filters;
 	/**
 	 * Presence config
 	 */
@@ -103,6 +114,16 @@ ref_app_breathing_config_t *ref_app_breathing_config_create(void);
  */
 void ref_app_breathing_config_destroy(ref_app_breathing_config_t *config);
 
+/**
+ * @brief Check that a configuration for the ref app breathing can be used
+ *
+ * The reasons a configuration can not be used are printed.
+ *
+ * @param[in] config The configuration to check
+ * @return true if the configuration is valid, false otherwise
+ */
+bool ref_app_breathing_config_validate(ref_app_breathing_config_t *config);
+
 /**
  * @brief Create a handle for the ref app breathing
  *
@@ -127,6 +148,15 @@ void ref_app_breathing_destroy(ref_app_breathing_handle_t *handle);
  */
 bool ref_app_breathing_get_buffer_size(ref_app_breathing_handle_t *handle, uint32_t *buffer_size);
 
+/**
+ * @brief Get the number of IQ points in each frame measured for the provided ref app breathing handle
+ *
+ * @param[in] handle The ref app breathing handle
+ * @param[out] frame_data_length The number of points in a frame, num_points * sweeps_per_frame
+ * @return true if successful, false otherwise
+ */
+bool ref_app_breathing_get_frame_data_length(ref_app_breathing_handle_t *handle, uint16_t *frame_data_length);
+
 /**
  * @brief Prepare the application to do a measurement
  *
@@ -158,4 +188,69 @@ bool ref_app_breathing_prepare(ref_app_breathing_handle_t *handle,
  */
 bool ref_app_breathing_process(ref_app_breathing_handle_t *handle, void *buffer, ref_app_breathing_result_t *result);
 
+/**
+ * @brief Get the largest size of a processing state snapshot for the provided ref app breathing handle
+ *
+ * @param[in] handle The ref app breathing handle
+ * @param[out] snapshot_size The snapshot size in bytes
+ * @return true if successful, false otherwise
+ */
+bool ref_app_breathing_get_snapshot_size(ref_app_breathing_handle_t *handle, uint32_t *snapshot_size);
+
+/**
+ * @brief Save the processing state in a snapshot
+ *
+ * The snapshot holds the distance, the filter states, the breathing time series and the
+ * smoothed amplitudes, so that a restarted application can continue where it was.
+ *
+ * @param[in] handle The ref app breathing handle
+ * @param[in] timestamp_ms Wall clock time in ms, compared with now_ms on restore
+ * @param[out] buffer Buffer for the snapshot
+ * @param[in] buffer_size Size of the buffer, at least the size from @ref ref_app_breathing_get_snapshot_size
+ * @param[out] snapshot_size Size of the written snapshot in bytes
+ * @return true if successful, false otherwise
+ */
+bool ref_app_breathing_snapshot_save(ref_app_breathing_handle_t *handle,
+                                     uint64_t                    timestamp_ms,
+                                     void                       *buffer,
+                                     uint32_t                    buffer_size,
+                                     uint32_t                   *snapshot_size);
+
+/**
+ * @brief Restore the processing state from a snapshot
+ *
+ * The snapshot is only restored if it was saved with the same configuration and is at most
+ * max_age_ms old, otherwise the handle is left as it is. After a restore, the next frame with
+ * a full time series gives a breathing rate, and the restored state is kept while the presence
+ * detector settles.
+ *
+ * @param[in] handle The ref app breathing handle, created but not processed any frames
+ * @param[in] snapshot The snapshot
+ * @param[in] snapshot_size Size of the snapshot in bytes
+ * @param[in] now_ms Current wall clock time in ms
+ * @param[in] max_age_ms Highest allowed age of the snapshot
+ * @return ACC_SNAPSHOT_STATUS_OK if the state was restored, otherwise the reason it was not
+ */
+acc_snapshot_status_t ref_app_breathing_snapshot_restore(ref_app_breathing_handle_t *handle,
+                                                         const void                 *snapshot,
+                                                         uint32_t                    snapshot_size,
+                                                         uint64_t                    now_ms,
+                                                         uint32_t                    max_age_ms);
+
+/**
+ * @brief Change the processing configuration without preparing the sensor again
+ *
+ * Only possible if the new configuration measures the same frames as the one the handle
+ * was created with, i.e. only the breathing parameters of ref_app_breathing_config_t differ.
+ * The presence detector and the distance to the person are kept. The breathing time series
+ * is also kept if its length, the breathing rates and the filters are unchanged, otherwise
+ * a new time series is started at the kept distance.
+ *
+ * @param[in, out] handle The ref app breathing handle
+ * @param[in] config The new configuration
+ * @return true if the handle uses the new configuration, false if it is unchanged and the
+ *         new configuration needs a new handle and a prepare
+ */
+bool ref_app_breathing_reconfigure(ref_app_breathing_handle_t *handle, ref_app_breathing_config_t *config);
+
 #endif
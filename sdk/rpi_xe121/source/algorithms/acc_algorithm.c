@@ -9,14 +9,21 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "acc_alg_basic_utils.h"
 #include "acc_algorithm.h"
+#include "acc_algorithm_kernels.h"
 #include "acc_definitions_a121.h"
 #include "acc_definitions_common.h"
 
 #define DOUBLE_BUFFERING_MEAN_ABS_DEV_OUTLIER_TH 5
 
+/**
+ * Number of FFT twiddle factors computed at a time and passed to the butterfly kernel
+ */
+#define FFT_TWIDDLE_CHUNK_LENGTH 64U
+
 //-----------------------------
 // Private declarations
 //-----------------------------
@@ -60,6 +67,12 @@ static void welch(const float complex *data,
 
 static void filter_inplace_apply(uint16_t sample_idx, const float *b, const float *a, float state[5], float *data);
 
+static float butter_bandpass_poles(float min_freq, float max_freq, float fs, float complex p_z[4]);
+
+static void sosfilt(const float *sos, uint16_t num_sections, float *state, const float *input, float *output, uint32_t num_channels);
+
+static void sosfilt_init(const float *zi, uint16_t num_sections, const float *x0, uint32_t num_channels, float *state);
+
 static float complex get_data_padded_f32_to_f32_complex(const float *data, uint16_t data_length, uint16_t index, uint16_t stride);
 
 static float complex get_data_padded_f32_complex(const float complex *data, uint16_t data_length, uint16_t index, uint16_t stride);
@@ -234,6 +247,36 @@ void acc_algorithm_roll_and_push_matrix_f32_complex(float complex *data, uint16_
 	}
 }
 
+void acc_algorithm_roll_and_push_matrix_f32_complex_column_range(float complex       *data,
+                                                                 uint16_t             rows,
+                                                                 uint16_t             cols,
+                                                                 uint16_t             start_col,
+                                                                 uint16_t             num_cols,
+                                                                 const float complex *column,
+                                                                 bool                 pos_shift)
+{
+	size_t row_size = num_cols * sizeof(*data);
+
+	if (pos_shift)
+	{
+		for (uint16_t r = rows - 1U; r > 0U; r--)
+		{
+			memcpy(&data[(r * cols) + start_col], &data[((r - 1U) * cols) + start_col], row_size);
+		}
+
+		memcpy(&data[start_col], &column[start_col], row_size);
+	}
+	else
+	{
+		for (uint16_t r = 1U; r < rows; r++)
+		{
+			memcpy(&data[((r - 1U) * cols) + start_col], &data[(r * cols) + start_col], row_size);
+		}
+
+		memcpy(&data[((rows - 1U) * cols) + start_col], &column[start_col], row_size);
+	}
+}
+
 void acc_algorithm_roll_and_push_mult_matrix_i16_complex(acc_int16_complex_t       *data,
                                                          uint16_t                   data_rows,
                                                          uint16_t                   cols,
@@ -378,59 +421,13 @@ void acc_algorithm_butter_lowpass(float freq, float fs, float *b, float *a)
 
 void acc_algorithm_butter_bandpass(float min_freq, float max_freq, float fs, float *b, float *a)
 {
-	float min_f = (2.0f * min_freq) / fs;
-	float max_f = (2.0f * max_freq) / fs;
-
-	// Values are centered around 0 to ensure an exactly real pole
-	float complex p[2];
-
-	p[0]    = -cexpf(((-1.0f * (float)M_PI) / 4.0f) * I);
-	p[1]    = -cexpf(((1.0f * (float)M_PI) / 4.0f) * I);
-	float k = 1.0f;
-
-	// Pre-wrap frequencies for digital filter design
-	min_f = 4.0f * tanf(((float)M_PI * min_f) / 2.0f);
-	max_f = 4.0f * tanf(((float)M_PI * max_f) / 2.0f);
-
-	// Transform lowpass filter prototype to a bandspass filter
-	float         bw = max_f - min_f;
-	float complex w0 = (float complex)sqrtf(min_f * max_f);
-
-	// Scale poles and zeros to desired bandwidth
-	float complex scale = (float complex)(bw / 2.0f);
-
-	p[0] = scale * p[0];
-	p[1] = scale * p[1];
-
-	// Duplicate poles and zeros and shift from baseband to +w0 and -w0
-	float complex p_bp[4];
-
-	w0      *= w0;
-	p_bp[0]  = p[0] + csqrtf((p[0] * p[0]) - w0);
-	p_bp[1]  = p[1] + csqrtf((p[1] * p[1]) - w0);
-	p_bp[2]  = p[0] - csqrtf((p[0] * p[0]) - w0);
-	p_bp[3]  = p[1] - csqrtf((p[1] * p[1]) - w0);
-
-	// Cancel out gain change from frequency scaling
-	float k_bp = k * bw * bw;
-
-	// Bilinear transform the poles and zeros
-	float complex real_four = (float complex)4.0f;
 	float complex p_z[4];
 
-	p_z[0] = acc_algorithm_cdiv(real_four + p_bp[0], real_four - p_bp[0]);
-	p_z[1] = acc_algorithm_cdiv(real_four + p_bp[1], real_four - p_bp[1]);
-	p_z[2] = acc_algorithm_cdiv(real_four + p_bp[2], real_four - p_bp[2]);
-	p_z[3] = acc_algorithm_cdiv(real_four + p_bp[3], real_four - p_bp[3]);
+	float k_z = butter_bandpass_poles(min_freq, max_freq, fs, p_z);
 
 	// Any zeroes that were at infinity get moved to the Nyquist Frequency
 	float z_z[4] = {1.0f, 1.0f, -1.0f, -1.0f};
 
-	// Compensate for gain change
-	float complex z_prod = 16.0f;
-	float complex p_prod = (real_four - p_bp[0]) * (real_four - p_bp[1]) * (real_four - p_bp[2]) * (real_four - p_bp[3]);
-	float         k_z    = k_bp * crealf(acc_algorithm_cdiv(z_prod, p_prod));
-
 	// Calculate polynomial transfer functions
 	a[0] = -(p_z[0] + p_z[1] + p_z[2] + p_z[3]);
 	a[1] = (p_z[0] * p_z[1]) + (p_z[0] * p_z[2]) + (p_z[0] * p_z[3]) + (p_z[1] * p_z[2]) + (p_z[1] * p_z[3]) + (p_z[2] * p_z[3]);
@@ -443,6 +440,49 @@ void acc_algorithm_butter_bandpass(float min_freq, float max_freq, float fs, flo
 	b[4] = k_z * (z_z[0] * z_z[1] * z_z[2] * z_z[3]);
 }
 
+void acc_algorithm_butter_lowpass_sos(float freq, float fs, float *sos)
+{
+	// A 2nd order filter is a single section
+	float b[3];
+	float a[2];
+
+	acc_algorithm_butter_lowpass(freq, fs, b, a);
+
+	sos[0] = b[0];
+	sos[1] = b[1];
+	sos[2] = b[2];
+	sos[3] = 1.0f;
+	sos[4] = a[0];
+	sos[5] = a[1];
+}
+
+void acc_algorithm_butter_bandpass_sos(float min_freq, float max_freq, float fs, float *sos)
+{
+	float complex p_z[4];
+
+	float k_z = butter_bandpass_poles(min_freq, max_freq, fs, p_z);
+
+	// p_z[0], p_z[1] and p_z[2], p_z[3] are complex conjugate pairs. Each pair gets one zero at 1 and one
+	// at the Nyquist frequency, and the gain is put in the first section.
+	float *section = sos;
+
+	for (uint16_t s = 0U; s < 2U; s++)
+	{
+		float complex p_0 = p_z[2U * s];
+		float complex p_1 = p_z[(2U * s) + 1U];
+		float         k   = (s == 0U) ? k_z : 1.0f;
+
+		section[0] = k;
+		section[1] = 0.0f;
+		section[2] = -k;
+		section[3] = 1.0f;
+		section[4] = -crealf(p_0 + p_1);
+		section[5] = crealf(p_0 * p_1);
+
+		section += ACC_ALGORITHM_SOS_SECTION_LENGTH;
+	}
+}
+
 void acc_algorithm_lfilter(const float *b, const float *a, float *data, uint16_t data_length)
 {
 	float filter_states[5] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
@@ -461,6 +501,80 @@ void acc_algorithm_lfilter_matrix(const float *b, const float *a, float *data, u
 	}
 }
 
+void acc_algorithm_sosfilt(const float *sos, uint16_t num_sections, const float *zi, float *data, uint16_t data_length)
+{
+	float state[ACC_ALGORITHM_SOS_STATE_LENGTH * ACC_ALGORITHM_SOS_MAX_SECTIONS];
+
+	if (data_length == 0U)
+	{
+		return;
+	}
+
+	if (zi != NULL)
+	{
+		sosfilt_init(zi, num_sections, data, 1U, state);
+	}
+	else
+	{
+		memset(state, 0, sizeof(state));
+	}
+
+	for (uint16_t i = 0U; i < data_length; i++)
+	{
+		sosfilt(sos, num_sections, state, &data[i], &data[i], 1U);
+	}
+}
+
+void acc_algorithm_sosfilt_zi(const float *sos, uint16_t num_sections, float *zi)
+{
+	float scale = 1.0f;
+
+	for (uint16_t s = 0U; s < num_sections; s++)
+	{
+		const float *section = &sos[s * ACC_ALGORITHM_SOS_SECTION_LENGTH];
+
+		// The output for a unit step in steady state is the DC gain, the states follow from the difference equations
+		float gain = (section[0] + section[1] + section[2]) / (1.0f + section[4] + section[5]);
+
+		zi[ACC_ALGORITHM_SOS_STATE_LENGTH * s]         = scale * (gain - section[0]);
+		zi[(ACC_ALGORITHM_SOS_STATE_LENGTH * s) + 1U] = scale * (section[2] - (section[5] * gain));
+
+		// The next section sees the step scaled by the gain of this one
+		scale *= gain;
+	}
+}
+
+void acc_algorithm_sosfilt_init_f32(const float *zi, uint16_t num_sections, const float *x0, uint16_t num_channels, float *state)
+{
+	sosfilt_init(zi, num_sections, x0, num_channels, state);
+}
+
+void acc_algorithm_sosfilt_init_f32_complex(const float         *zi,
+                                            uint16_t             num_sections,
+                                            const float complex *x0,
+                                            uint16_t             num_channels,
+                                            float complex       *state)
+{
+	// Real and imaginary parts are filtered independently, so the complex arrays are processed as float arrays of twice the length
+	sosfilt_init(zi, num_sections, (const float *)x0, 2U * (uint32_t)num_channels, (float *)state);
+}
+
+void acc_algorithm_sosfilt_f32(const float *sos, uint16_t num_sections, float *state, const float *input, float *output, uint16_t num_channels)
+{
+	sosfilt(sos, num_sections, state, input, output, num_channels);
+}
+
+void acc_algorithm_sosfilt_f32_complex(const float         *sos,
+                                       uint16_t             num_sections,
+                                       float complex       *state,
+                                       const float complex *input,
+                                       float complex       *output,
+                                       uint16_t             num_channels)
+{
+	// Real and imaginary parts are filtered independently, so the complex arrays are processed as float arrays of twice the length
+	sosfilt(sos, num_sections, (float *)state, (const float *)input, (float *)output, 2U * (uint32_t)num_channels);
+}
+
 void acc_algorithm_apply_filter_f32(const float *a,
                                     const float *filt_data,
                                     uint16_t     filt_rows,
@@ -472,19 +586,21 @@ void acc_algorithm_apply_filter_f32(const float *a,
                                     float       *output,
                                     uint16_t     output_length)
 {
+	const acc_algorithm_kernels_t *kernels = acc_algorithm_kernels_get();
+
 	for (uint16_t i = 0U; i < output_length; i++)
 	{
 		output[i] = 0.0f;
+	}
 
-		for (uint16_t r = 0U; r < filt_rows; r++)
-		{
-			output[i] -= a[r] * filt_data[i + (r * filt_cols)];
-		}
+	for (uint16_t r = 0U; r < filt_rows; r++)
+	{
+		kernels->scaled_add_f32(output, &filt_data[r * filt_cols], -a[r], output_length);
+	}
 
-		for (uint16_t r = 0U; r < data_rows; r++)
-		{
-			output[i] += b[r] * data[i + (r * data_cols)];
-		}
+	for (uint16_t r = 0U; r < data_rows; r++)
+	{
+		kernels->scaled_add_f32(output, &data[r * data_cols], b[r], output_length);
 	}
 }
 
@@ -499,24 +615,25 @@ void acc_algorithm_apply_filter_f32_complex(const float         *a,
                                             float complex       *output,
                                             uint16_t             output_length)
 {
-	for (uint16_t i = 0U; i < output_length; i++)
-	{
-		float real = 0.0f;
-		float imag = 0.0f;
+	const acc_algorithm_kernels_t *kernels = acc_algorithm_kernels_get();
 
-		for (uint16_t r = 0U; r < filt_rows; r++)
-		{
-			real -= a[r] * crealf(filt_data[i + (r * filt_cols)]);
-			imag -= a[r] * cimagf(filt_data[i + (r * filt_cols)]);
-		}
+	// Real and imaginary parts are filtered independently, so the complex arrays are processed as float arrays of twice the length
+	float   *output_f32        = (float *)output;
+	uint32_t output_length_f32 = 2U * (uint32_t)output_length;
 
-		for (uint16_t r = 0U; r < data_rows; r++)
-		{
-			real += b[r] * crealf(data[i + (r * data_cols)]);
-			imag += b[r] * cimagf(data[i + (r * data_cols)]);
-		}
+	for (uint32_t i = 0U; i < output_length_f32; i++)
+	{
+		output_f32[i] = 0.0f;
+	}
 
-		output[i] = real + (imag * I);
+	for (uint16_t r = 0U; r < filt_rows; r++)
+	{
+		kernels->scaled_add_f32(output_f32, (const float *)&filt_data[r * filt_cols], -a[r], output_length_f32);
+	}
+
+	for (uint16_t r = 0U; r < data_rows; r++)
+	{
+		kernels->scaled_add_f32(output_f32, (const float *)&data[r * data_cols], b[r], output_length_f32);
 	}
 }
 
@@ -854,6 +971,14 @@ void acc_algorithm_fftshift_matrix(float *data, uint16_t rows, uint16_t cols)
 	}
 }
 
+void acc_algorithm_fftshift_matrix_column_range(float *data, uint16_t rows, uint16_t cols, uint16_t start_col, uint16_t num_cols)
+{
+	for (uint16_t i = start_col; i < (start_col + num_cols); i++)
+	{
+		fftshift(&(data[i]), rows, cols);
+	}
+}
+
 void acc_algorithm_fftshift(float *data, uint16_t data_length)
 {
 	fftshift(data, data_length, 1U);
@@ -876,6 +1001,25 @@ void acc_algorithm_welch_matrix(const float complex *data,
 	}
 }
 
+void acc_algorithm_welch_matrix_column_range(const float complex *data,
+                                             uint16_t             rows,
+                                             uint16_t             cols,
+                                             uint16_t             start_col,
+                                             uint16_t             num_cols,
+                                             uint16_t             segment_length,
+                                             float complex       *data_buffer,
+                                             float complex       *fft_out,
+                                             float               *psds,
+                                             const float         *window,
+                                             uint16_t             length_shift,
+                                             float                fs)
+{
+	for (uint16_t i = start_col; i < (start_col + num_cols); i++)
+	{
+		welch(&(data[i]), rows, segment_length, data_buffer, fft_out, &(psds[i]), window, length_shift, fs, cols);
+	}
+}
+
 void acc_algorithm_welch(const float complex *data,
                          uint16_t             data_length,
                          uint16_t             segment_length,
@@ -1448,6 +1592,86 @@ float acc_algorithm_clip_f32(float value, float min, float max)
 	return res;
 }
 
+uint16_t acc_algorithm_coherent_combine(const float *matrix,
+                                        uint16_t     rows,
+                                        uint16_t     cols,
+                                        const float *column_weights,
+                                        float        min_coherence,
+                                        float       *coherence,
+                                        float       *output)
+{
+	// The inverse norm of every column, 0 for a column without energy
+	for (uint16_t c = 0U; c < cols; c++)
+	{
+		float energy = 0.0f;
+
+		for (uint16_t r = 0U; r < rows; r++)
+		{
+			energy += matrix[(r * cols) + c] * matrix[(r * cols) + c];
+		}
+
+		coherence[c] = energy > 0.0f ? 1.0f / sqrtf(energy) : 0.0f;
+	}
+
+	uint16_t reference  = 0U;
+	float    best_score = -1.0f;
+
+	for (uint16_t c = 0U; c < cols; c++)
+	{
+		float score = 0.0f;
+
+		for (uint16_t k = 0U; k < cols; k++)
+		{
+			float dot = 0.0f;
+
+			for (uint16_t r = 0U; r < rows; r++)
+			{
+				dot += matrix[(r * cols) + c] * matrix[(r * cols) + k];
+			}
+
+			score += fabsf(dot) * coherence[c] * coherence[k];
+		}
+
+		if (score > best_score)
+		{
+			best_score = score;
+			reference  = c;
+		}
+	}
+
+	float reference_inv_norm = coherence[reference];
+
+	for (uint16_t r = 0U; r < rows; r++)
+	{
+		output[r] = 0.0f;
+	}
+
+	for (uint16_t c = 0U; c < cols; c++)
+	{
+		float dot = 0.0f;
+
+		for (uint16_t r = 0U; r < rows; r++)
+		{
+			dot += matrix[(r * cols) + c] * matrix[(r * cols) + reference];
+		}
+
+		float inv_norm    = coherence[c];
+		float correlation = dot * inv_norm * reference_inv_norm;
+		coherence[c]      = fabsf(correlation) >= min_coherence ? correlation : 0.0f;
+		float scale       = coherence[c] * column_weights[c] * inv_norm;
+
+		if (scale != 0.0f)
+		{
+			for (uint16_t r = 0U; r < rows; r++)
+			{
+				output[r] += scale * matrix[(r * cols) + c];
+			}
+		}
+	}
+
+	return reference;
+}
+
 //-----------------------------
 // Private definitions
 //-----------------------------
@@ -1576,6 +1800,93 @@ static void filter_inplace_apply(uint16_t sample_idx, const float *b, const floa
 	data[sample_idx] = y;
 }
 
+static float butter_bandpass_poles(float min_freq, float max_freq, float fs, float complex p_z[4])
+{
+	float min_f = (2.0f * min_freq) / fs;
+	float max_f = (2.0f * max_freq) / fs;
+
+	// Values are centered around 0 to ensure an exactly real pole
+	float complex p[2];
+
+	p[0]    = -cexpf(((-1.0f * (float)M_PI) / 4.0f) * I);
+	p[1]    = -cexpf(((1.0f * (float)M_PI) / 4.0f) * I);
+	float k = 1.0f;
+
+	// Pre-wrap frequencies for digital filter design
+	min_f = 4.0f * tanf(((float)M_PI * min_f) / 2.0f);
+	max_f = 4.0f * tanf(((float)M_PI * max_f) / 2.0f);
+
+	// Transform lowpass filter prototype to a bandspass filter
+	float         bw = max_f - min_f;
+	float complex w0 = (float complex)sqrtf(min_f * max_f);
+
+	// Scale poles and zeros to desired bandwidth
+	float complex scale = (float complex)(bw / 2.0f);
+
+	p[0] = scale * p[0];
+	p[1] = scale * p[1];
+
+	// Duplicate poles and zeros and shift from baseband to +w0 and -w0
+	float complex p_bp[4];
+
+	w0      *= w0;
+	p_bp[0]  = p[0] + csqrtf((p[0] * p[0]) - w0);
+	p_bp[1]  = p[1] + csqrtf((p[1] * p[1]) - w0);
+	p_bp[2]  = p[0] - csqrtf((p[0] * p[0]) - w0);
+	p_bp[3]  = p[1] - csqrtf((p[1] * p[1]) - w0);
+
+	// Cancel out gain change from frequency scaling
+	float k_bp = k * bw * bw;
+
+	// Bilinear transform the poles and zeros
+	float complex real_four = (float complex)4.0f;
+
+	p_z[0] = acc_algorithm_cdiv(real_four + p_bp[0], real_four - p_bp[0]);
+	p_z[1] = acc_algorithm_cdiv(real_four + p_bp[1], real_four - p_bp[1]);
+	p_z[2] = acc_algorithm_cdiv(real_four + p_bp[2], real_four - p_bp[2]);
+	p_z[3] = acc_algorithm_cdiv(real_four + p_bp[3], real_four - p_bp[3]);
+
+	// Compensate for gain change
+	float complex z_prod = 16.0f;
+	float complex p_prod = (real_four - p_bp[0]) * (real_four - p_bp[1]) * (real_four - p_bp[2]) * (real_four - p_bp[3]);
+
+	return k_bp * crealf(acc_algorithm_cdiv(z_prod, p_prod));
+}
+
+static void sosfilt(const float *sos, uint16_t num_sections, float *state, const float *input, float *output, uint32_t num_channels)
+{
+	for (uint32_t c = 0U; c < num_channels; c++)
+	{
+		float x = input[c];
+
+		// Transposed direct form II, the output of each section is the input of the next
+		for (uint16_t s = 0U; s < num_sections; s++)
+		{
+			const float *section = &sos[s * ACC_ALGORITHM_SOS_SECTION_LENGTH];
+			float       *z       = &state[ACC_ALGORITHM_SOS_STATE_LENGTH * s * num_channels];
+			float        y       = (section[0] * x) + z[c];
+
+			z[c]                = (section[1] * x) - (section[4] * y) + z[num_channels + c];
+			z[num_channels + c] = (section[2] * x) - (section[5] * y);
+
+			x = y;
+		}
+
+		output[c] = x;
+	}
+}
+
+static void sosfilt_init(const float *zi, uint16_t num_sections, const float *x0, uint32_t num_channels, float *state)
+{
+	for (uint16_t k = 0U; k < (ACC_ALGORITHM_SOS_STATE_LENGTH * num_sections); k++)
+	{
+		for (uint32_t c = 0U; c < num_channels; c++)
+		{
+			state[(k * num_channels) + c] = zi[k] * x0[c];
+		}
+	}
+}
+
 static float complex get_data_padded_f32_to_f32_complex(const float *data, uint16_t data_length, uint16_t index, uint16_t stride)
 {
 	float    real = 0.0f;
@@ -1730,8 +2041,10 @@ static void small_fft_transformation(uint16_t length_shift, float complex *outpu
 	}
 
 	// Main part of the FFT computation
-	uint16_t      block_length = 4U;
-	float complex phase_incr   = -I;
+	const acc_algorithm_kernels_t *kernels      = acc_algorithm_kernels_get();
+	uint16_t                       block_length = 4U;
+	float complex                  phase_incr   = -I;
+	float complex                  twiddles[FFT_TWIDDLE_CHUNK_LENGTH];
 
 	while (block_length < full_data_length)
 	{
@@ -1739,19 +2052,27 @@ static void small_fft_transformation(uint16_t length_shift, float complex *outpu
 		phase_incr = (phase_incr + 1.0f) / cabsf(phase_incr + 1.0f);
 
 		float complex phase = 1.0f;
-		for (uint16_t m = 0U; m < block_length; m++)
+		for (uint16_t m = 0U; m < block_length; m += FFT_TWIDDLE_CHUNK_LENGTH)
 		{
-			for (uint16_t i = m; i < full_data_length; i += block_length << 1U)
+			uint16_t count = block_length - m;
+
+			if (count > FFT_TWIDDLE_CHUNK_LENGTH)
 			{
-				float complex delta = output[(i + block_length) * stride] * phase;
+				count = FFT_TWIDDLE_CHUNK_LENGTH;
+			}
 
-				output[(i + block_length) * stride] = output[i * stride] - delta;
+			for (uint16_t k = 0U; k < count; k++)
+			{
+				twiddles[k] = phase;
 
-				output[i * stride] += delta;
+				// This phase increment is the leading error source for large transforms
+				phase = phase * phase_incr;
 			}
 
-			// This phase increment is the leading error source for large transforms
-			phase = phase * phase_incr;
+			for (uint16_t i = m; i < full_data_length; i += block_length << 1U)
+			{
+				kernels->fft_butterflies(&output[i * stride], block_length, twiddles, count, stride);
+			}
 		}
 
 		block_length <<= 1U;
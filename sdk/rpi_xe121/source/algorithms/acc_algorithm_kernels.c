@@ -0,0 +1,231 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__arm__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#endif
+
+#include "acc_algorithm_kernels.h"
+
+#if defined(__arm__) && !defined(__aarch64__) && !defined(HWCAP_NEON)
+#define HWCAP_NEON (1UL << 12)
+#endif
+
+#define KERNELS_ENV_VARIABLE "ACC_ALGORITHM_KERNELS"
+
+//-----------------------------
+// Private declarations
+//-----------------------------
+
+static void fft_butterflies_scalar(float complex *data, uint16_t half_distance, const float complex *twiddles, uint16_t count, uint16_t stride);
+
+static void scaled_add_f32_scalar(float *out, const float *data, float coeff, uint32_t length);
+
+static void accumulate_iq_i16_scalar(const int16_t *data, int32_t *sum, float *abs_sum, uint16_t length);
+
+static void select_default_variant(void);
+
+static bool cpu_supports(acc_algorithm_kernels_variant_t variant);
+
+static const acc_algorithm_kernels_t scalar_kernels = {
+	.fft_butterflies   = fft_butterflies_scalar,
+	.scaled_add_f32    = scaled_add_f32_scalar,
+	.accumulate_iq_i16 = accumulate_iq_i16_scalar,
+};
+
+static const char *variant_names[ACC_ALGORITHM_KERNELS_NUM_VARIANTS] = {
+	"scalar",
+	"neon",
+	"sse4",
+	"avx2",
+};
+
+static pthread_once_t                  init_once        = PTHREAD_ONCE_INIT;
+static const acc_algorithm_kernels_t  *selected_kernels = NULL;
+static acc_algorithm_kernels_variant_t selected_variant = ACC_ALGORITHM_KERNELS_SCALAR;
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+
+void acc_algorithm_kernels_init(void)
+{
+	(void)pthread_once(&init_once, select_default_variant);
+}
+
+bool acc_algorithm_kernels_select(acc_algorithm_kernels_variant_t variant)
+{
+	const acc_algorithm_kernels_t *kernels = acc_algorithm_kernels_get_variant(variant);
+
+	if (kernels == NULL)
+	{
+		return false;
+	}
+
+	// The default selection must not replace this one later
+	acc_algorithm_kernels_init();
+
+	selected_variant = variant;
+	selected_kernels = kernels;
+
+	return true;
+}
+
+const acc_algorithm_kernels_t *acc_algorithm_kernels_get(void)
+{
+	acc_algorithm_kernels_init();
+
+	return selected_kernels;
+}
+
+acc_algorithm_kernels_variant_t acc_algorithm_kernels_get_selected_variant(void)
+{
+	(void)acc_algorithm_kernels_get();
+
+	return selected_variant;
+}
+
+const acc_algorithm_kernels_t *acc_algorithm_kernels_get_variant(acc_algorithm_kernels_variant_t variant)
+{
+	const acc_algorithm_kernels_t *kernels = NULL;
+
+	if (!cpu_supports(variant))
+	{
+		return NULL;
+	}
+
+	switch (variant)
+	{
+		case ACC_ALGORITHM_KERNELS_SCALAR:
+			kernels = &scalar_kernels;
+			break;
+		case ACC_ALGORITHM_KERNELS_NEON:
+			kernels = acc_algorithm_kernels_neon();
+			break;
+		case ACC_ALGORITHM_KERNELS_SSE4:
+			kernels = acc_algorithm_kernels_sse4();
+			break;
+		case ACC_ALGORITHM_KERNELS_AVX2:
+			kernels = acc_algorithm_kernels_avx2();
+			break;
+		default:
+			break;
+	}
+
+	return kernels;
+}
+
+const char *acc_algorithm_kernels_variant_name(acc_algorithm_kernels_variant_t variant)
+{
+	return (variant < ACC_ALGORITHM_KERNELS_NUM_VARIANTS) ? variant_names[variant] : "unknown";
+}
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+
+static void fft_butterflies_scalar(float complex *data, uint16_t half_distance, const float complex *twiddles, uint16_t count, uint16_t stride)
+{
+	for (uint16_t k = 0U; k < count; k++)
+	{
+		float complex delta = data[(k + half_distance) * stride] * twiddles[k];
+
+		data[(k + half_distance) * stride] = data[k * stride] - delta;
+
+		data[k * stride] += delta;
+	}
+}
+
+static void scaled_add_f32_scalar(float *out, const float *data, float coeff, uint32_t length)
+{
+	for (uint32_t i = 0U; i < length; i++)
+	{
+		out[i] += coeff * data[i];
+	}
+}
+
+static void accumulate_iq_i16_scalar(const int16_t *data, int32_t *sum, float *abs_sum, uint16_t length)
+{
+	for (uint16_t i = 0U; i < length; i++)
+	{
+		float real = (float)data[2U * i];
+		float imag = (float)data[(2U * i) + 1U];
+
+		sum[2U * i] += data[2U * i];
+		sum[(2U * i) + 1U] += data[(2U * i) + 1U];
+		abs_sum[i] += sqrtf((real * real) + (imag * imag));
+	}
+}
+
+static void select_default_variant(void)
+{
+	acc_algorithm_kernels_variant_t best = ACC_ALGORITHM_KERNELS_SCALAR;
+
+	for (uint16_t i = 0U; i < ACC_ALGORITHM_KERNELS_NUM_VARIANTS; i++)
+	{
+		if (acc_algorithm_kernels_get_variant((acc_algorithm_kernels_variant_t)i) != NULL)
+		{
+			best = (acc_algorithm_kernels_variant_t)i;
+		}
+	}
+
+	const char *requested = getenv(KERNELS_ENV_VARIABLE);
+
+	if (requested != NULL)
+	{
+		for (uint16_t i = 0U; i < ACC_ALGORITHM_KERNELS_NUM_VARIANTS; i++)
+		{
+			if ((strcmp(requested, variant_names[i]) == 0) && (acc_algorithm_kernels_get_variant((acc_algorithm_kernels_variant_t)i) != NULL))
+			{
+				best = (acc_algorithm_kernels_variant_t)i;
+			}
+		}
+	}
+
+	selected_variant = best;
+	selected_kernels = acc_algorithm_kernels_get_variant(best);
+}
+
+static bool cpu_supports(acc_algorithm_kernels_variant_t variant)
+{
+	bool supported = false;
+
+	switch (variant)
+	{
+		case ACC_ALGORITHM_KERNELS_SCALAR:
+			supported = true;
+			break;
+		case ACC_ALGORITHM_KERNELS_NEON:
+#if defined(__aarch64__)
+			supported = true;
+#elif defined(__arm__)
+			supported = (getauxval(AT_HWCAP) & HWCAP_NEON) != 0U;
+#endif
+			break;
+		case ACC_ALGORITHM_KERNELS_SSE4:
+#if defined(__x86_64__) || defined(__i386__)
+			supported = __builtin_cpu_supports("sse4.1") != 0;
+#endif
+			break;
+		case ACC_ALGORITHM_KERNELS_AVX2:
+#if defined(__x86_64__) || defined(__i386__)
+			supported = __builtin_cpu_supports("avx2") != 0;
+#endif
+			break;
+		default:
+			break;
+	}
+
+	return supported;
+}
@@ -0,0 +1,164 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "acc_algorithm_kernels.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+//-----------------------------
+// Private declarations
+//-----------------------------
+
+static void fft_butterflies_avx2(float complex *data, uint16_t half_distance, const float complex *twiddles, uint16_t count, uint16_t stride);
+
+static void scaled_add_f32_avx2(float *out, const float *data, float coeff, uint32_t length);
+
+static void accumulate_iq_i16_avx2(const int16_t *data, int32_t *sum, float *abs_sum, uint16_t length);
+
+static __m256 complex_mul(__m256 a, __m256 b);
+
+static __m256 deinterleave(__m256 v0, __m256 v1, int imag);
+
+static const acc_algorithm_kernels_t avx2_kernels = {
+	.fft_butterflies   = fft_butterflies_avx2,
+	.scaled_add_f32    = scaled_add_f32_avx2,
+	.accumulate_iq_i16 = accumulate_iq_i16_avx2,
+};
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+
+const acc_algorithm_kernels_t *acc_algorithm_kernels_avx2(void)
+{
+	return &avx2_kernels;
+}
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+
+static void fft_butterflies_avx2(float complex *data, uint16_t half_distance, const float complex *twiddles, uint16_t count, uint16_t stride)
+{
+	uint16_t k = 0U;
+
+	if (stride == 1U)
+	{
+		float       *lo = (float *)data;
+		float       *hi = (float *)&data[half_distance];
+		const float *tw = (const float *)twiddles;
+
+		for (; (k + 4U) <= count; k += 4U)
+		{
+			__m256 l     = _mm256_loadu_ps(&lo[2U * k]);
+			__m256 delta = complex_mul(_mm256_loadu_ps(&hi[2U * k]), _mm256_loadu_ps(&tw[2U * k]));
+
+			_mm256_storeu_ps(&hi[2U * k], _mm256_sub_ps(l, delta));
+			_mm256_storeu_ps(&lo[2U * k], _mm256_add_ps(l, delta));
+		}
+	}
+
+	for (; k < count; k++)
+	{
+		float complex delta = data[(k + half_distance) * stride] * twiddles[k];
+
+		data[(k + half_distance) * stride] = data[k * stride] - delta;
+
+		data[k * stride] += delta;
+	}
+}
+
+static void scaled_add_f32_avx2(float *out, const float *data, float coeff, uint32_t length)
+{
+	__m256   c = _mm256_set1_ps(coeff);
+	uint32_t i = 0U;
+
+	// Multiply and add are kept separate (no FMA) to give the same result as the scalar kernel
+	for (; (i + 8U) <= length; i += 8U)
+	{
+		_mm256_storeu_ps(&out[i], _mm256_add_ps(_mm256_loadu_ps(&out[i]), _mm256_mul_ps(c, _mm256_loadu_ps(&data[i]))));
+	}
+
+	for (; i < length; i++)
+	{
+		out[i] += coeff * data[i];
+	}
+}
+
+static void accumulate_iq_i16_avx2(const int16_t *data, int32_t *sum, float *abs_sum, uint16_t length)
+{
+	uint16_t i = 0U;
+
+	for (; (i + 8U) <= length; i += 8U)
+	{
+		__m256i iq = _mm256_loadu_si256((const __m256i *)(const void *)&data[2U * i]);
+		__m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(iq));
+		__m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(iq, 1));
+
+		__m256i *sum_lo = (__m256i *)(void *)&sum[2U * i];
+		__m256i *sum_hi = (__m256i *)(void *)&sum[(2U * i) + 8U];
+
+		_mm256_storeu_si256(sum_lo, _mm256_add_epi32(_mm256_loadu_si256(sum_lo), lo));
+		_mm256_storeu_si256(sum_hi, _mm256_add_epi32(_mm256_loadu_si256(sum_hi), hi));
+
+		__m256 v0   = _mm256_cvtepi32_ps(lo);
+		__m256 v1   = _mm256_cvtepi32_ps(hi);
+		__m256 real = deinterleave(v0, v1, 0);
+		__m256 imag = deinterleave(v0, v1, 1);
+		__m256 abs  = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(real, real), _mm256_mul_ps(imag, imag)));
+
+		_mm256_storeu_ps(&abs_sum[i], _mm256_add_ps(_mm256_loadu_ps(&abs_sum[i]), abs));
+	}
+
+	for (; i < length; i++)
+	{
+		float real = (float)data[2U * i];
+		float imag = (float)data[(2U * i) + 1U];
+
+		sum[2U * i] += data[2U * i];
+		sum[(2U * i) + 1U] += data[(2U * i) + 1U];
+		abs_sum[i] += sqrtf((real * real) + (imag * imag));
+	}
+}
+
+/**
+ * @brief Multiply four pairs of interleaved complex numbers
+ */
+static __m256 complex_mul(__m256 a, __m256 b)
+{
+	__m256 b_real    = _mm256_moveldup_ps(b);
+	__m256 b_imag    = _mm256_movehdup_ps(b);
+	__m256 a_swapped = _mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1));
+
+	return _mm256_addsub_ps(_mm256_mul_ps(a, b_real), _mm256_mul_ps(a_swapped, b_imag));
+}
+
+/**
+ * @brief Extract the real (imag == 0) or imaginary parts of eight interleaved complex numbers
+ */
+static __m256 deinterleave(__m256 v0, __m256 v1, int imag)
+{
+	// The shuffle works within 128-bit lanes, the permute restores the element order
+	__m256 parts = (imag != 0) ? _mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)) : _mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+
+	return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(parts), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+#else
+
+const acc_algorithm_kernels_t *acc_algorithm_kernels_avx2(void)
+{
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,166 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "acc_algorithm_kernels.h"
+
+#if defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+//-----------------------------
+// Private declarations
+//-----------------------------
+
+static void fft_butterflies_neon(float complex *data, uint16_t half_distance, const float complex *twiddles, uint16_t count, uint16_t stride);
+
+static void scaled_add_f32_neon(float *out, const float *data, float coeff, uint32_t length);
+
+static void accumulate_iq_i16_neon(const int16_t *data, int32_t *sum, float *abs_sum, uint16_t length);
+
+static float32x4_t sqrt_f32(float32x4_t x);
+
+static const acc_algorithm_kernels_t neon_kernels = {
+	.fft_butterflies   = fft_butterflies_neon,
+	.scaled_add_f32    = scaled_add_f32_neon,
+	.accumulate_iq_i16 = accumulate_iq_i16_neon,
+};
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+
+const acc_algorithm_kernels_t *acc_algorithm_kernels_neon(void)
+{
+	return &neon_kernels;
+}
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+
+static void fft_butterflies_neon(float complex *data, uint16_t half_distance, const float complex *twiddles, uint16_t count, uint16_t stride)
+{
+	uint16_t k = 0U;
+
+	if (stride == 1U)
+	{
+		float       *lo = (float *)data;
+		float       *hi = (float *)&data[half_distance];
+		const float *tw = (const float *)twiddles;
+
+		for (; (k + 4U) <= count; k += 4U)
+		{
+			// vld2q de-interleaves into real (val[0]) and imaginary (val[1]) parts
+			float32x4x2_t l = vld2q_f32(&lo[2U * k]);
+			float32x4x2_t h = vld2q_f32(&hi[2U * k]);
+			float32x4x2_t t = vld2q_f32(&tw[2U * k]);
+
+			float32x4_t delta_real = vsubq_f32(vmulq_f32(h.val[0], t.val[0]), vmulq_f32(h.val[1], t.val[1]));
+			float32x4_t delta_imag = vaddq_f32(vmulq_f32(h.val[0], t.val[1]), vmulq_f32(h.val[1], t.val[0]));
+
+			h.val[0] = vsubq_f32(l.val[0], delta_real);
+			h.val[1] = vsubq_f32(l.val[1], delta_imag);
+			l.val[0] = vaddq_f32(l.val[0], delta_real);
+			l.val[1] = vaddq_f32(l.val[1], delta_imag);
+
+			vst2q_f32(&hi[2U * k], h);
+			vst2q_f32(&lo[2U * k], l);
+		}
+	}
+
+	for (; k < count; k++)
+	{
+		float complex delta = data[(k + half_distance) * stride] * twiddles[k];
+
+		data[(k + half_distance) * stride] = data[k * stride] - delta;
+
+		data[k * stride] += delta;
+	}
+}
+
+static void scaled_add_f32_neon(float *out, const float *data, float coeff, uint32_t length)
+{
+	float32x4_t c = vdupq_n_f32(coeff);
+	uint32_t    i = 0U;
+
+	// Multiply and add are kept separate (no vmla/vfma) to give the same result as the scalar kernel
+	for (; (i + 4U) <= length; i += 4U)
+	{
+		vst1q_f32(&out[i], vaddq_f32(vld1q_f32(&out[i]), vmulq_f32(c, vld1q_f32(&data[i]))));
+	}
+
+	for (; i < length; i++)
+	{
+		out[i] += coeff * data[i];
+	}
+}
+
+static void accumulate_iq_i16_neon(const int16_t *data, int32_t *sum, float *abs_sum, uint16_t length)
+{
+	uint16_t i = 0U;
+
+	for (; (i + 4U) <= length; i += 4U)
+	{
+		int16x4x2_t iq   = vld2_s16(&data[2U * i]);
+		int32x4_t   real = vmovl_s16(iq.val[0]);
+		int32x4_t   imag = vmovl_s16(iq.val[1]);
+		int32x4x2_t acc  = vld2q_s32(&sum[2U * i]);
+
+		acc.val[0] = vaddq_s32(acc.val[0], real);
+		acc.val[1] = vaddq_s32(acc.val[1], imag);
+		vst2q_s32(&sum[2U * i], acc);
+
+		float32x4_t real_f = vcvtq_f32_s32(real);
+		float32x4_t imag_f = vcvtq_f32_s32(imag);
+		float32x4_t abs    = sqrt_f32(vaddq_f32(vmulq_f32(real_f, real_f), vmulq_f32(imag_f, imag_f)));
+
+		vst1q_f32(&abs_sum[i], vaddq_f32(vld1q_f32(&abs_sum[i]), abs));
+	}
+
+	for (; i < length; i++)
+	{
+		float real = (float)data[2U * i];
+		float imag = (float)data[(2U * i) + 1U];
+
+		sum[2U * i] += data[2U * i];
+		sum[(2U * i) + 1U] += data[(2U * i) + 1U];
+		abs_sum[i] += sqrtf((real * real) + (imag * imag));
+	}
+}
+
+static float32x4_t sqrt_f32(float32x4_t x)
+{
+#if defined(__aarch64__)
+	return vsqrtq_f32(x);
+#else
+	// armv7 NEON has no square root. The VFP one is used per lane, it is correctly rounded like
+	// sqrtf in the scalar kernel, where the reciprocal square root estimate is not.
+	float lanes[4];
+
+	vst1q_f32(lanes, x);
+
+	for (uint16_t i = 0U; i < 4U; i++)
+	{
+		lanes[i] = sqrtf(lanes[i]);
+	}
+
+	return vld1q_f32(lanes);
+#endif
+}
+
+#else
+
+const acc_algorithm_kernels_t *acc_algorithm_kernels_neon(void)
+{
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,150 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "acc_algorithm_kernels.h"
+
+#if defined(__SSE4_1__)
+
+#include <smmintrin.h>
+
+//-----------------------------
+// Private declarations
+//-----------------------------
+
+static void fft_butterflies_sse4(float complex *data, uint16_t half_distance, const float complex *twiddles, uint16_t count, uint16_t stride);
+
+static void scaled_add_f32_sse4(float *out, const float *data, float coeff, uint32_t length);
+
+static void accumulate_iq_i16_sse4(const int16_t *data, int32_t *sum, float *abs_sum, uint16_t length);
+
+static __m128 complex_mul(__m128 a, __m128 b);
+
+static const acc_algorithm_kernels_t sse4_kernels = {
+	.fft_butterflies   = fft_butterflies_sse4,
+	.scaled_add_f32    = scaled_add_f32_sse4,
+	.accumulate_iq_i16 = accumulate_iq_i16_sse4,
+};
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+
+const acc_algorithm_kernels_t *acc_algorithm_kernels_sse4(void)
+{
+	return &sse4_kernels;
+}
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+
+static void fft_butterflies_sse4(float complex *data, uint16_t half_distance, const float complex *twiddles, uint16_t count, uint16_t stride)
+{
+	uint16_t k = 0U;
+
+	if (stride == 1U)
+	{
+		float       *lo = (float *)data;
+		float       *hi = (float *)&data[half_distance];
+		const float *tw = (const float *)twiddles;
+
+		for (; (k + 2U) <= count; k += 2U)
+		{
+			__m128 l     = _mm_loadu_ps(&lo[2U * k]);
+			__m128 delta = complex_mul(_mm_loadu_ps(&hi[2U * k]), _mm_loadu_ps(&tw[2U * k]));
+
+			_mm_storeu_ps(&hi[2U * k], _mm_sub_ps(l, delta));
+			_mm_storeu_ps(&lo[2U * k], _mm_add_ps(l, delta));
+		}
+	}
+
+	for (; k < count; k++)
+	{
+		float complex delta = data[(k + half_distance) * stride] * twiddles[k];
+
+		data[(k + half_distance) * stride] = data[k * stride] - delta;
+
+		data[k * stride] += delta;
+	}
+}
+
+static void scaled_add_f32_sse4(float *out, const float *data, float coeff, uint32_t length)
+{
+	__m128   c = _mm_set1_ps(coeff);
+	uint32_t i = 0U;
+
+	for (; (i + 4U) <= length; i += 4U)
+	{
+		_mm_storeu_ps(&out[i], _mm_add_ps(_mm_loadu_ps(&out[i]), _mm_mul_ps(c, _mm_loadu_ps(&data[i]))));
+	}
+
+	for (; i < length; i++)
+	{
+		out[i] += coeff * data[i];
+	}
+}
+
+static void accumulate_iq_i16_sse4(const int16_t *data, int32_t *sum, float *abs_sum, uint16_t length)
+{
+	uint16_t i = 0U;
+
+	for (; (i + 4U) <= length; i += 4U)
+	{
+		__m128i iq = _mm_loadu_si128((const __m128i *)(const void *)&data[2U * i]);
+		__m128i lo = _mm_cvtepi16_epi32(iq);
+		__m128i hi = _mm_cvtepi16_epi32(_mm_srli_si128(iq, 8));
+
+		__m128i *sum_lo = (__m128i *)(void *)&sum[2U * i];
+		__m128i *sum_hi = (__m128i *)(void *)&sum[(2U * i) + 4U];
+
+		_mm_storeu_si128(sum_lo, _mm_add_epi32(_mm_loadu_si128(sum_lo), lo));
+		_mm_storeu_si128(sum_hi, _mm_add_epi32(_mm_loadu_si128(sum_hi), hi));
+
+		__m128 v0   = _mm_cvtepi32_ps(lo);
+		__m128 v1   = _mm_cvtepi32_ps(hi);
+		__m128 real = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 imag = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+		__m128 abs  = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(real, real), _mm_mul_ps(imag, imag)));
+
+		_mm_storeu_ps(&abs_sum[i], _mm_add_ps(_mm_loadu_ps(&abs_sum[i]), abs));
+	}
+
+	for (; i < length; i++)
+	{
+		float real = (float)data[2U * i];
+		float imag = (float)data[(2U * i) + 1U];
+
+		sum[2U * i] += data[2U * i];
+		sum[(2U * i) + 1U] += data[(2U * i) + 1U];
+		abs_sum[i] += sqrtf((real * real) + (imag * imag));
+	}
+}
+
+/**
+ * @brief Multiply two pairs of interleaved complex numbers
+ */
+static __m128 complex_mul(__m128 a, __m128 b)
+{
+	__m128 b_real    = _mm_moveldup_ps(b);
+	__m128 b_imag    = _mm_movehdup_ps(b);
+	__m128 a_swapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+
+	return _mm_addsub_ps(_mm_mul_ps(a, b_real), _mm_mul_ps(a_swapped, b_imag));
+}
+
+#else
+
+const acc_algorithm_kernels_t *acc_algorithm_kernels_sse4(void)
+{
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,328 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_algorithm.h"
+#include "acc_algorithm_shaped.h"
+
+// Set to "generic" to use the generic functions for every shape, e.g. to compare the two on target
+#define SHAPED_ENV_VARIABLE "ACC_ALGORITHM_SHAPED"
+
+//-----------------------------
+// Private declarations
+//-----------------------------
+
+static bool specialisation_enabled(void);
+
+/*
+ * The kernel bodies are written for runtime lengths. Every variant below calls them with
+ * its lengths as constants, and the bodies are inlined into the variants so that the
+ * compiler sees fixed trip counts.
+ */
+
+static inline void filter_f32_body(const float *a,
+                                   const float *filt_data,
+                                   uint16_t     filt_rows,
+                                   const float *b,
+                                   const float *data,
+                                   uint16_t     data_rows,
+                                   uint16_t     cols,
+                                   float       *output);
+
+static inline void mean_sweep_body(const acc_int16_complex_t *frame,
+                                   uint16_t                   num_points,
+                                   uint16_t                   sweeps_per_frame,
+                                   uint16_t                   start_point,
+                                   uint16_t                   length,
+                                   float                     *real_sum,
+                                   float                     *imag_sum,
+                                   float complex             *sweep);
+
+static inline void roll_and_push_mult_matrix_i16_complex_body(acc_int16_complex_t       *data,
+                                                              uint16_t                   data_rows,
+                                                              uint16_t                   cols,
+                                                              const acc_int16_complex_t *matrix,
+                                                              uint16_t                   matrix_rows,
+                                                              bool                       pos_shift);
+
+//-----------------------------
+// Specialised variants
+//-----------------------------
+
+#define FILTER_F32_VARIANT(name, FILT_ROWS, DATA_ROWS, COLS)                                                 \
+	static void filter_f32_##name(const float *a,                                                            \
+	                              const float *filt_data,                                                    \
+	                              uint16_t     filt_rows,                                                    \
+	                              uint16_t     filt_cols,                                                    \
+	                              const float *b,                                                            \
+	                              const float *data,                                                         \
+	                              uint16_t     data_rows,                                                    \
+	                              uint16_t     data_cols,                                                    \
+	                              float       *output,                                                       \
+	                              uint16_t     output_length)                                                \
+	{                                                                                                        \
+		(void)filt_rows;                                                                                     \
+		(void)filt_cols;                                                                                     \
+		(void)data_rows;                                                                                     \
+		(void)data_cols;                                                                                     \
+		(void)output_length;                                                                                 \
+		filter_f32_body(a, filt_data, FILT_ROWS, b, data, DATA_ROWS, COLS, output);                          \
+	}
+
+// Real and imaginary parts are filtered independently, a complex column is two float columns
+#define FILTER_F32_COMPLEX_VARIANT(name, FILT_ROWS, DATA_ROWS, COLS)                                           \
+	static void filter_f32_complex_##name(const float         *a,                                              \
+	                                      const float complex *filt_data,                                      \
+	                                      uint16_t             filt_rows,                                      \
+	                                      uint16_t             filt_cols,                                      \
+	                                      const float         *b,                                              \
+	                                      const float complex *data,                                           \
+	                                      uint16_t             data_rows,                                      \
+	                                      uint16_t             data_cols,                                      \
+	                                      float complex       *output,                                         \
+	                                      uint16_t             output_length)                                  \
+	{                                                                                                          \
+		(void)filt_rows;                                                                                       \
+		(void)filt_cols;                                                                                       \
+		(void)data_rows;                                                                                       \
+		(void)data_cols;                                                                                       \
+		(void)output_length;                                                                                   \
+		filter_f32_body(                                                                                       \
+		    a, (const float *)filt_data, FILT_ROWS, b, (const float *)data, DATA_ROWS, 2U * (COLS), (float *)output); \
+	}
+
+#define MEAN_SWEEP_VARIANT(name, SWEEPS_PER_FRAME, LENGTH)                                    \
+	static void mean_sweep_##name(const acc_int16_complex_t *frame,                           \
+	                              uint16_t                   num_points,                      \
+	                              uint16_t                   sweeps_per_frame,                \
+	                              uint16_t                   start_point,                     \
+	                              uint16_t                   end_point,                       \
+	                              float complex             *sweep)                           \
+	{                                                                                                         \
+		float real_sum[LENGTH];                                                                               \
+		float imag_sum[LENGTH];                                                                               \
+		(void)sweeps_per_frame;                                                                               \
+		(void)end_point;                                                                                      \
+		mean_sweep_body(frame, num_points, SWEEPS_PER_FRAME, start_point, LENGTH, real_sum, imag_sum, sweep); \
+	}
+
+// The variant moves the buffer once, which needs matrix_rows <= data_rows, checked at compile time
+#define ROLL_AND_PUSH_I16_COMPLEX_VARIANT(name, DATA_ROWS, COLS, MATRIX_ROWS)                                         \
+	typedef char roll_and_push_##name##_fits[((MATRIX_ROWS) <= (DATA_ROWS)) ? 1 : -1];                                \
+	static void roll_and_push_mult_matrix_i16_complex_##name(acc_int16_complex_t       *data,                             \
+	                                                         uint16_t                   data_rows,                        \
+	                                                         uint16_t                   cols,                             \
+	                                                         const acc_int16_complex_t *matrix,                           \
+	                                                         uint16_t                   matrix_rows,                      \
+	                                                         bool                       pos_shift)                        \
+	{                                                                                                                     \
+		(void)data_rows;                                                                                                  \
+		(void)cols;                                                                                                       \
+		(void)matrix_rows;                                                                                                \
+		roll_and_push_mult_matrix_i16_complex_body(data, DATA_ROWS, COLS, matrix, MATRIX_ROWS, pos_shift);                \
+	}
+
+ACC_ALGORITHM_SHAPED_FILTER_F32_SHAPES(FILTER_F32_VARIANT)
+ACC_ALGORITHM_SHAPED_FILTER_F32_COMPLEX_SHAPES(FILTER_F32_COMPLEX_VARIANT)
+ACC_ALGORITHM_SHAPED_MEAN_SWEEP_SHAPES(MEAN_SWEEP_VARIANT)
+ACC_ALGORITHM_SHAPED_ROLL_AND_PUSH_I16_COMPLEX_SHAPES(ROLL_AND_PUSH_I16_COMPLEX_VARIANT)
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+
+acc_algorithm_filter_f32_func_t acc_algorithm_shaped_filter_f32(uint16_t filt_rows, uint16_t data_rows, uint16_t cols)
+{
+	acc_algorithm_filter_f32_func_t func = acc_algorithm_apply_filter_f32;
+
+#define SELECT(name, FILT_ROWS, DATA_ROWS, COLS)                                   \
+	if ((filt_rows == (FILT_ROWS)) && (data_rows == (DATA_ROWS)) && (cols == (COLS))) \
+	{                                                                              \
+		func = filter_f32_##name;                                                  \
+	}
+
+	if (specialisation_enabled())
+	{
+		ACC_ALGORITHM_SHAPED_FILTER_F32_SHAPES(SELECT)
+	}
+
+#undef SELECT
+
+	return func;
+}
+
+acc_algorithm_filter_f32_complex_func_t acc_algorithm_shaped_filter_f32_complex(uint16_t filt_rows, uint16_t data_rows, uint16_t cols)
+{
+	acc_algorithm_filter_f32_complex_func_t func = acc_algorithm_apply_filter_f32_complex;
+
+#define SELECT(name, FILT_ROWS, DATA_ROWS, COLS)                                   \
+	if ((filt_rows == (FILT_ROWS)) && (data_rows == (DATA_ROWS)) && (cols == (COLS))) \
+	{                                                                              \
+		func = filter_f32_complex_##name;                                          \
+	}
+
+	if (specialisation_enabled())
+	{
+		ACC_ALGORITHM_SHAPED_FILTER_F32_COMPLEX_SHAPES(SELECT)
+	}
+
+#undef SELECT
+
+	return func;
+}
+
+acc_algorithm_mean_sweep_func_t acc_algorithm_shaped_mean_sweep(uint16_t sweeps_per_frame, uint16_t length)
+{
+	acc_algorithm_mean_sweep_func_t func = acc_algorithm_mean_sweep;
+
+#define SELECT(name, SWEEPS_PER_FRAME, LENGTH)                                 \
+	if ((sweeps_per_frame == (SWEEPS_PER_FRAME)) && (length == (LENGTH))) \
+	{                                                                      \
+		func = mean_sweep_##name;                                          \
+	}
+
+	if (specialisation_enabled())
+	{
+		ACC_ALGORITHM_SHAPED_MEAN_SWEEP_SHAPES(SELECT)
+	}
+
+#undef SELECT
+
+	return func;
+}
+
+acc_algorithm_roll_and_push_mult_matrix_i16_complex_func_t acc_algorithm_shaped_roll_and_push_mult_matrix_i16_complex(uint16_t data_rows,
+                                                                                                                      uint16_t cols,
+                                                                                                                      uint16_t matrix_rows)
+{
+	acc_algorithm_roll_and_push_mult_matrix_i16_complex_func_t func = acc_algorithm_roll_and_push_mult_matrix_i16_complex;
+
+#define SELECT(name, DATA_ROWS, COLS, MATRIX_ROWS)                                              \
+	if ((data_rows == (DATA_ROWS)) && (cols == (COLS)) && (matrix_rows == (MATRIX_ROWS))) \
+	{                                                                                      \
+		func = roll_and_push_mult_matrix_i16_complex_##name;                               \
+	}
+
+	if (specialisation_enabled())
+	{
+		ACC_ALGORITHM_SHAPED_ROLL_AND_PUSH_I16_COMPLEX_SHAPES(SELECT)
+	}
+
+#undef SELECT
+
+	return func;
+}
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+
+static bool specialisation_enabled(void)
+{
+	const char *requested = getenv(SHAPED_ENV_VARIABLE);
+
+	return (requested == NULL) || (strcmp(requested, "generic") != 0);
+}
+
+static inline void filter_f32_body(const float *a,
+                                   const float *filt_data,
+                                   uint16_t     filt_rows,
+                                   const float *b,
+                                   const float *data,
+                                   uint16_t     data_rows,
+                                   uint16_t     cols,
+                                   float       *output)
+{
+	// Same order of operations per element as acc_algorithm_apply_filter_f32, feedback rows first
+	for (uint16_t c = 0U; c < cols; c++)
+	{
+		float sum = 0.0f;
+
+		for (uint16_t r = 0U; r < filt_rows; r++)
+		{
+			sum += -a[r] * filt_data[(r * cols) + c];
+		}
+
+		for (uint16_t r = 0U; r < data_rows; r++)
+		{
+			sum += b[r] * data[(r * cols) + c];
+		}
+
+		output[c] = sum;
+	}
+}
+
+static inline void mean_sweep_body(const acc_int16_complex_t *frame,
+                                   uint16_t                   num_points,
+                                   uint16_t                   sweeps_per_frame,
+                                   uint16_t                   start_point,
+                                   uint16_t                   length,
+                                   float                     *real_sum,
+                                   float                     *imag_sum,
+                                   float complex             *sweep)
+{
+	/*
+	 * Sweep by sweep, so that the points of a sweep are read together. The sums of every
+	 * point are still taken in sweep order, as in acc_algorithm_mean_sweep.
+	 */
+	for (uint16_t n = 0U; n < length; n++)
+	{
+		real_sum[n] = 0.0f;
+		imag_sum[n] = 0.0f;
+	}
+
+	for (uint16_t i = 0U; i < sweeps_per_frame; i++)
+	{
+		const acc_int16_complex_t *points = &frame[(i * num_points) + start_point];
+
+		for (uint16_t n = 0U; n < length; n++)
+		{
+			real_sum[n] += (float)points[n].real;
+			imag_sum[n] += (float)points[n].imag;
+		}
+	}
+
+	for (uint16_t n = 0U; n < length; n++)
+	{
+		sweep[n] = (real_sum[n] / (float)sweeps_per_frame) + ((imag_sum[n] / (float)sweeps_per_frame) * I);
+	}
+}
+
+static inline void roll_and_push_mult_matrix_i16_complex_body(acc_int16_complex_t       *data,
+                                                              uint16_t                   data_rows,
+                                                              uint16_t                   cols,
+                                                              const acc_int16_complex_t *matrix,
+                                                              uint16_t                   matrix_rows,
+                                                              bool                       pos_shift)
+{
+	/*
+	 * The generic function pushes one matrix row at a time and moves the whole buffer for
+	 * every row. With matrix_rows <= data_rows, which the variants check, the buffer is
+	 * moved once by matrix_rows and the matrix rows are copied in, in the order the row by
+	 * row pushes would leave them.
+	 */
+	uint16_t kept_rows = data_rows - matrix_rows;
+
+	if (pos_shift)
+	{
+		memmove(&data[matrix_rows * cols], data, (size_t)kept_rows * cols * sizeof(*data));
+
+		for (uint16_t m_rows = 0U; m_rows < matrix_rows; m_rows++)
+		{
+			memcpy(&data[(matrix_rows - 1U - m_rows) * cols], &matrix[m_rows * cols], cols * sizeof(*data));
+		}
+	}
+	else
+	{
+		memmove(data, &data[matrix_rows * cols], (size_t)kept_rows * cols * sizeof(*data));
+		memcpy(&data[kept_rows * cols], matrix, (size_t)matrix_rows * cols * sizeof(*data));
+	}
+}
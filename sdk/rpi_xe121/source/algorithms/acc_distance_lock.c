@@ -0,0 +1,245 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_algorithm.h"
+#include "acc_distance_lock.h"
+#include "acc_integration.h"
+
+#define NO_POINT (0xFFFFU)
+
+struct acc_distance_lock
+{
+	acc_distance_lock_config_t config;
+
+	uint16_t buffer_length;
+	float    lp_coeff;
+
+	/** Low-pass filtered sweeps, buffer_length rows of num_points */
+	float complex *buffer;
+	/** The low-pass filter state, num_points */
+	float complex *filtered;
+	float         *band_energies;
+	float         *scratch;
+
+	uint16_t write_idx;
+	uint16_t length;
+	uint16_t candidate;
+	uint16_t candidate_frames;
+};
+
+//-----------------------------
+// Private declarations
+//-----------------------------
+
+static void update_band_energies(acc_distance_lock_t *lock);
+
+static bool passes_tests(acc_distance_lock_t *lock, uint16_t *best_point);
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+
+void acc_distance_lock_config_default(acc_distance_lock_config_t *config)
+{
+	config->num_points        = 0U;
+	config->frame_rate        = 0.0f;
+	config->highest_freq      = 0.0f;
+	config->buffer_duration_s = 2.0f;
+	config->neighbourhood     = 2U;
+	config->min_dominance     = 8.0f;
+	config->min_contrast      = 10.0f;
+	config->stable_frames     = 5U;
+}
+
+
+acc_distance_lock_t *acc_distance_lock_create(const acc_distance_lock_config_t *config)
+{
+	if ((config->num_points == 0U) || (config->frame_rate <= 0.0f) || (config->highest_freq <= 0.0f))
+	{
+		return NULL;
+	}
+
+	uint16_t buffer_length = (uint16_t)((config->buffer_duration_s * config->frame_rate) + 0.5f);
+
+	if (buffer_length < 2U)
+	{
+		return NULL;
+	}
+
+	// One allocation, ordered by alignment
+	size_t size = sizeof(acc_distance_lock_t) + (((size_t)buffer_length + 1U) * config->num_points * sizeof(float complex)) +
+	              (2U * config->num_points * sizeof(float));
+
+	acc_distance_lock_t *lock = acc_integration_mem_alloc(size);
+
+	if (lock == NULL)
+	{
+		return NULL;
+	}
+
+	uint8_t *memory = (uint8_t *)lock + sizeof(acc_distance_lock_t);
+
+	lock->config        = *config;
+	lock->buffer_length = buffer_length;
+	lock->lp_coeff      = acc_algorithm_exp_smoothing_coefficient(config->frame_rate, 1.0f / (2.0f * (float)M_PI * config->highest_freq));
+	lock->buffer        = (float complex *)memory;
+	lock->filtered      = &lock->buffer[buffer_length * config->num_points];
+	lock->band_energies = (float *)&lock->filtered[config->num_points];
+	lock->scratch       = &lock->band_energies[config->num_points];
+
+	acc_distance_lock_reset(lock);
+
+	return lock;
+}
+
+
+void acc_distance_lock_destroy(acc_distance_lock_t *lock)
+{
+	if (lock != NULL)
+	{
+		acc_integration_mem_free(lock);
+	}
+}
+
+
+void acc_distance_lock_reset(acc_distance_lock_t *lock)
+{
+	lock->write_idx        = 0U;
+	lock->length           = 0U;
+	lock->candidate        = NO_POINT;
+	lock->candidate_frames = 0U;
+
+	memset(lock->band_energies, 0, lock->config.num_points * sizeof(*lock->band_energies));
+}
+
+
+bool acc_distance_lock_update(acc_distance_lock_t *lock, const float complex *sweep, uint16_t *point)
+{
+	uint16_t       num_points = lock->config.num_points;
+	float complex *row        = &lock->buffer[lock->write_idx * num_points];
+
+	for (uint16_t p = 0U; p < num_points; p++)
+	{
+		if (lock->length == 0U)
+		{
+			lock->filtered[p] = sweep[p];
+		}
+
+		lock->filtered[p] = (lock->lp_coeff * lock->filtered[p]) + ((1.0f - lock->lp_coeff) * sweep[p]);
+		row[p]            = lock->filtered[p];
+	}
+
+	lock->write_idx = (lock->write_idx + 1U) % lock->buffer_length;
+
+	if (lock->length < lock->buffer_length)
+	{
+		lock->length++;
+	}
+
+	if (lock->length < lock->buffer_length)
+	{
+		return false;
+	}
+
+	update_band_energies(lock);
+
+	uint16_t best_point;
+
+	if (!passes_tests(lock, &best_point))
+	{
+		lock->candidate        = NO_POINT;
+		lock->candidate_frames = 0U;
+
+		return false;
+	}
+
+	// A target between two points may alternate between them, that still counts as the same target
+	bool same_target = (lock->candidate != NO_POINT) && (abs((int32_t)best_point - (int32_t)lock->candidate) <= 1);
+
+	lock->candidate_frames = same_target ? (lock->candidate_frames + 1U) : 1U;
+	lock->candidate        = best_point;
+
+	if (lock->candidate_frames >= lock->config.stable_frames)
+	{
+		*point = best_point;
+
+		return true;
+	}
+
+	return false;
+}
+
+
+const float *acc_distance_lock_get_band_energies(const acc_distance_lock_t *lock)
+{
+	return lock->band_energies;
+}
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+
+static void update_band_energies(acc_distance_lock_t *lock)
+{
+	uint16_t num_points = lock->config.num_points;
+
+	for (uint16_t p = 0U; p < num_points; p++)
+	{
+		float complex mean = 0.0f;
+
+		for (uint16_t r = 0U; r < lock->buffer_length; r++)
+		{
+			mean += lock->buffer[(r * num_points) + p];
+		}
+
+		mean /= (float)lock->buffer_length;
+
+		float energy = 0.0f;
+
+		for (uint16_t r = 0U; r < lock->buffer_length; r++)
+		{
+			float complex deviation = lock->buffer[(r * num_points) + p] - mean;
+
+			energy += (crealf(deviation) * crealf(deviation)) + (cimagf(deviation) * cimagf(deviation));
+		}
+
+		lock->band_energies[p] = energy / (float)lock->buffer_length;
+	}
+}
+
+
+static bool passes_tests(acc_distance_lock_t *lock, uint16_t *best_point)
+{
+	uint16_t     num_points = lock->config.num_points;
+	const float *energies   = lock->band_energies;
+	uint16_t     best       = acc_algorithm_argmax(energies, num_points);
+	float        competitor = 0.0f;
+
+	for (uint16_t p = 0U; p < num_points; p++)
+	{
+		if (abs((int32_t)p - (int32_t)best) > (int32_t)lock->config.neighbourhood)
+		{
+			competitor = fmaxf(competitor, energies[p]);
+		}
+	}
+
+	memcpy(lock->scratch, energies, num_points * sizeof(*lock->scratch));
+
+	float median = acc_algorithm_median_f32(lock->scratch, num_points);
+
+	*best_point = best;
+
+	return (energies[best] > 0.0f) && (energies[best] >= (lock->config.min_dominance * competitor)) &&
+	       (energies[best] >= (lock->config.min_contrast * median));
+}
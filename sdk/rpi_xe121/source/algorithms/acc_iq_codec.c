@@ -0,0 +1,278 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions_common.h"
+#include "acc_iq_codec.h"
+
+/**
+ * Number of complex points in a block, each point gives two values
+ */
+#define BLOCK_POINTS (ACC_IQ_CODEC_BLOCK_LENGTH / 2U)
+
+//-----------------------------
+// Private declarations
+//-----------------------------
+
+static uint32_t encode_delta_packed(const acc_int16_complex_t *frame, uint16_t num_points, uint32_t point_count, uint8_t *out, uint32_t limit);
+
+static bool decode_delta_packed(const uint8_t *in, uint32_t size, uint16_t num_points, uint32_t point_count, acc_int16_complex_t *frame);
+
+static void encode_stored(const acc_int16_complex_t *frame, uint32_t point_count, uint8_t *out);
+
+static void decode_stored(const uint8_t *in, uint32_t point_count, acc_int16_complex_t *frame);
+
+static uint32_t pack_block(const uint16_t *residuals, uint8_t width, uint8_t *out);
+
+static void unpack_block(const uint8_t *in, uint8_t width, uint16_t *residuals);
+
+static inline acc_int16_complex_t predict(const acc_int16_complex_t *frame, uint32_t index, uint16_t num_points);
+
+static inline uint16_t zigzag_residual(int16_t value, int16_t prediction);
+
+static inline int16_t unzigzag_value(uint16_t residual, int16_t prediction);
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+
+uint32_t acc_iq_codec_encode(const acc_int16_complex_t *frame,
+                             uint16_t                   num_points,
+                             uint16_t                   sweeps_per_frame,
+                             uint8_t                   *buffer,
+                             uint32_t                   buffer_size)
+{
+	uint32_t point_count = (uint32_t)num_points * sweeps_per_frame;
+	uint32_t raw_size    = 4U * point_count;
+
+	if (buffer_size < ACC_IQ_CODEC_MAX_ENCODED_SIZE(num_points, sweeps_per_frame))
+	{
+		return 0U;
+	}
+
+	// Give up on packing as soon as it would not be smaller than the raw frame
+	uint32_t packed_size = encode_delta_packed(frame, num_points, point_count, &buffer[1], raw_size);
+
+	if (packed_size > 0U)
+	{
+		buffer[0] = (uint8_t)ACC_IQ_CODEC_METHOD_DELTA_PACKED;
+		return 1U + packed_size;
+	}
+
+	buffer[0] = (uint8_t)ACC_IQ_CODEC_METHOD_STORED;
+	encode_stored(frame, point_count, &buffer[1]);
+
+	return 1U + raw_size;
+}
+
+bool acc_iq_codec_decode(const uint8_t *buffer, uint32_t size, uint16_t num_points, uint16_t sweeps_per_frame, acc_int16_complex_t *frame)
+{
+	uint32_t point_count = (uint32_t)num_points * sweeps_per_frame;
+
+	if (size < 1U)
+	{
+		return false;
+	}
+
+	switch ((acc_iq_codec_method_t)buffer[0])
+	{
+		case ACC_IQ_CODEC_METHOD_STORED:
+			if (size != (1U + (4U * point_count)))
+			{
+				return false;
+			}
+
+			decode_stored(&buffer[1], point_count, frame);
+			return true;
+		case ACC_IQ_CODEC_METHOD_DELTA_PACKED:
+			return decode_delta_packed(&buffer[1], size - 1U, num_points, point_count, frame);
+		default:
+			return false;
+	}
+}
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+
+static uint32_t encode_delta_packed(const acc_int16_complex_t *frame, uint16_t num_points, uint32_t point_count, uint8_t *out, uint32_t limit)
+{
+	uint32_t pos = 0U;
+
+	for (uint32_t start = 0U; start < point_count; start += BLOCK_POINTS)
+	{
+		uint16_t residuals[ACC_IQ_CODEC_BLOCK_LENGTH] = {0};
+		uint16_t all_bits                             = 0U;
+		uint32_t end                                  = (start + BLOCK_POINTS) < point_count ? (start + BLOCK_POINTS) : point_count;
+
+		for (uint32_t i = start; i < end; i++)
+		{
+			acc_int16_complex_t prediction = predict(frame, i, num_points);
+			uint16_t            real       = zigzag_residual(frame[i].real, prediction.real);
+			uint16_t            imag       = zigzag_residual(frame[i].imag, prediction.imag);
+
+			residuals[2U * (i - start)]        = real;
+			residuals[(2U * (i - start)) + 1U] = imag;
+			all_bits |= (uint16_t)(real | imag);
+		}
+
+		uint8_t width = 0U;
+
+		while ((all_bits >> width) != 0U)
+		{
+			width++;
+		}
+
+		if ((pos + 1U + (2U * width)) >= limit)
+		{
+			return 0U;
+		}
+
+		out[pos++] = width;
+		pos += pack_block(residuals, width, &out[pos]);
+	}
+
+	return pos;
+}
+
+static bool decode_delta_packed(const uint8_t *in, uint32_t size, uint16_t num_points, uint32_t point_count, acc_int16_complex_t *frame)
+{
+	uint32_t pos = 0U;
+
+	for (uint32_t start = 0U; start < point_count; start += BLOCK_POINTS)
+	{
+		uint16_t residuals[ACC_IQ_CODEC_BLOCK_LENGTH];
+		uint32_t end = (start + BLOCK_POINTS) < point_count ? (start + BLOCK_POINTS) : point_count;
+
+		if (pos >= size)
+		{
+			return false;
+		}
+
+		uint8_t width = in[pos++];
+
+		if ((width > 16U) || ((pos + (2U * width)) > size))
+		{
+			return false;
+		}
+
+		unpack_block(&in[pos], width, residuals);
+		pos += 2U * width;
+
+		for (uint32_t i = start; i < end; i++)
+		{
+			acc_int16_complex_t prediction = predict(frame, i, num_points);
+
+			frame[i].real = unzigzag_value(residuals[2U * (i - start)], prediction.real);
+			frame[i].imag = unzigzag_value(residuals[(2U * (i - start)) + 1U], prediction.imag);
+		}
+	}
+
+	return pos == size;
+}
+
+static void encode_stored(const acc_int16_complex_t *frame, uint32_t point_count, uint8_t *out)
+{
+	for (uint32_t i = 0U; i < point_count; i++)
+	{
+		uint16_t real = (uint16_t)frame[i].real;
+		uint16_t imag = (uint16_t)frame[i].imag;
+
+		out[(4U * i)]      = (uint8_t)real;
+		out[(4U * i) + 1U] = (uint8_t)(real >> 8);
+		out[(4U * i) + 2U] = (uint8_t)imag;
+		out[(4U * i) + 3U] = (uint8_t)(imag >> 8);
+	}
+}
+
+static void decode_stored(const uint8_t *in, uint32_t point_count, acc_int16_complex_t *frame)
+{
+	for (uint32_t i = 0U; i < point_count; i++)
+	{
+		frame[i].real = (int16_t)(uint16_t)(in[(4U * i)] | (in[(4U * i) + 1U] << 8));
+		frame[i].imag = (int16_t)(uint16_t)(in[(4U * i) + 2U] | (in[(4U * i) + 3U] << 8));
+	}
+}
+
+static uint32_t pack_block(const uint16_t *residuals, uint8_t width, uint8_t *out)
+{
+	uint64_t bits      = 0U;
+	uint32_t bit_count = 0U;
+	uint32_t pos       = 0U;
+
+	// A block of 16 values of width bits always ends on a byte boundary
+	for (uint16_t i = 0U; i < ACC_IQ_CODEC_BLOCK_LENGTH; i++)
+	{
+		bits |= (uint64_t)residuals[i] << bit_count;
+		bit_count += width;
+
+		while (bit_count >= 8U)
+		{
+			out[pos++] = (uint8_t)bits;
+			bits >>= 8;
+			bit_count -= 8U;
+		}
+	}
+
+	return pos;
+}
+
+static void unpack_block(const uint8_t *in, uint8_t width, uint16_t *residuals)
+{
+	uint64_t bits      = 0U;
+	uint32_t bit_count = 0U;
+	uint32_t pos       = 0U;
+	uint32_t mask      = (1U << width) - 1U;
+
+	for (uint16_t i = 0U; i < ACC_IQ_CODEC_BLOCK_LENGTH; i++)
+	{
+		while (bit_count < width)
+		{
+			bits |= (uint64_t)in[pos++] << bit_count;
+			bit_count += 8U;
+		}
+
+		residuals[i] = (uint16_t)(bits & mask);
+		bits >>= width;
+		bit_count -= width;
+	}
+}
+
+static inline acc_int16_complex_t predict(const acc_int16_complex_t *frame, uint32_t index, uint16_t num_points)
+{
+	acc_int16_complex_t zero = {0, 0};
+
+	if (index >= num_points)
+	{
+		// Same point in the previous sweep
+		return frame[index - num_points];
+	}
+
+	if (index > 0U)
+	{
+		// Previous point in the first sweep
+		return frame[index - 1U];
+	}
+
+	return zero;
+}
+
+static inline uint16_t zigzag_residual(int16_t value, int16_t prediction)
+{
+	// The difference wraps modulo 2^16, which is undone by the wrapping addition when decoding
+	uint16_t delta = (uint16_t)((uint16_t)value - (uint16_t)prediction);
+
+	return (uint16_t)((uint16_t)(delta << 1) ^ (((delta & 0x8000U) != 0U) ? 0xffffU : 0U));
+}
+
+static inline int16_t unzigzag_value(uint16_t residual, int16_t prediction)
+{
+	uint16_t delta = (uint16_t)((residual >> 1) ^ (0U - (residual & 1U)));
+
+	return (int16_t)(uint16_t)((uint16_t)prediction + delta);
+}
@@ -0,0 +1,337 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "acc_integration.h"
+#include "acc_sliding_median.h"
+
+#define HEAP_LOW  (0U)
+#define HEAP_HIGH (1U)
+#define HEAP_NONE (0xFFU)
+
+typedef struct
+{
+	/** Slot indexes of the values in the heap */
+	uint16_t *slots;
+	uint16_t  length;
+	/** -1 for the max heap, 1 for the min heap, so that both heaps keep the smallest signed value on top */
+	float sign;
+} heap_t;
+
+struct acc_sliding_median
+{
+	uint16_t capacity;
+	uint16_t length;
+	uint16_t write_idx;
+	uint16_t num_nan;
+
+	/** The window as a ring buffer of slots, capacity long */
+	float *values;
+	/** The heap each slot is in, HEAP_NONE for NaN */
+	uint8_t *heap_of;
+	/** The position of each slot in its heap */
+	uint16_t *positions;
+
+	/** Max heap with the lower half and min heap with the upper half of the non-NaN values */
+	heap_t heaps[2];
+};
+
+//-----------------------------
+// Private declarations
+//-----------------------------
+
+static void remove_slot(acc_sliding_median_t *median, uint16_t slot);
+
+static void insert_slot(acc_sliding_median_t *median, uint16_t slot);
+
+static void rebalance(acc_sliding_median_t *median);
+
+static void heap_insert(acc_sliding_median_t *median, uint8_t heap_idx, uint16_t slot);
+
+static uint16_t heap_remove(acc_sliding_median_t *median, uint8_t heap_idx, uint16_t pos);
+
+static void heap_sift_up(acc_sliding_median_t *median, heap_t *heap, uint16_t pos);
+
+static void heap_sift_down(acc_sliding_median_t *median, heap_t *heap, uint16_t pos);
+
+static inline bool heap_above(const acc_sliding_median_t *median, const heap_t *heap, uint16_t slot_a, uint16_t slot_b);
+
+static inline void heap_set(acc_sliding_median_t *median, heap_t *heap, uint16_t pos, uint16_t slot);
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+
+acc_sliding_median_t *acc_sliding_median_create(uint16_t capacity)
+{
+	if (capacity == 0U)
+	{
+		return NULL;
+	}
+
+	// One allocation, ordered by alignment
+	size_t size = sizeof(acc_sliding_median_t) + (capacity * sizeof(float)) + (3U * capacity * sizeof(uint16_t)) + (capacity * sizeof(uint8_t));
+
+	acc_sliding_median_t *median = acc_integration_mem_alloc(size);
+
+	if (median == NULL)
+	{
+		return NULL;
+	}
+
+	uint8_t *memory = (uint8_t *)median + sizeof(acc_sliding_median_t);
+
+	median->capacity               = capacity;
+	median->values                 = (float *)memory;
+	median->positions              = (uint16_t *)&memory[capacity * sizeof(float)];
+	median->heaps[HEAP_LOW].slots  = &median->positions[capacity];
+	median->heaps[HEAP_HIGH].slots = &median->positions[2U * capacity];
+	median->heap_of                = (uint8_t *)&median->positions[3U * capacity];
+
+	median->heaps[HEAP_LOW].sign  = -1.0f;
+	median->heaps[HEAP_HIGH].sign = 1.0f;
+
+	acc_sliding_median_reset(median);
+
+	return median;
+}
+
+
+void acc_sliding_median_destroy(acc_sliding_median_t *median)
+{
+	if (median != NULL)
+	{
+		acc_integration_mem_free(median);
+	}
+}
+
+
+void acc_sliding_median_reset(acc_sliding_median_t *median)
+{
+	median->length                  = 0U;
+	median->write_idx               = 0U;
+	median->num_nan                 = 0U;
+	median->heaps[HEAP_LOW].length  = 0U;
+	median->heaps[HEAP_HIGH].length = 0U;
+}
+
+
+void acc_sliding_median_push(acc_sliding_median_t *median, float value)
+{
+	uint16_t slot = median->write_idx;
+
+	if (median->length == median->capacity)
+	{
+		remove_slot(median, slot);
+	}
+	else
+	{
+		median->length++;
+	}
+
+	median->values[slot] = value;
+
+	if (fpclassify(value) == FP_NAN)
+	{
+		median->heap_of[slot] = HEAP_NONE;
+		median->num_nan++;
+	}
+	else
+	{
+		insert_slot(median, slot);
+	}
+
+	median->write_idx = (slot + 1U) % median->capacity;
+}
+
+
+bool acc_sliding_median_get(const acc_sliding_median_t *median, float *median_value)
+{
+	const heap_t *low  = &median->heaps[HEAP_LOW];
+	const heap_t *high = &median->heaps[HEAP_HIGH];
+
+	if (low->length == 0U)
+	{
+		return false;
+	}
+
+	float lower = median->values[low->slots[0]];
+
+	// Same arithmetic as acc_algorithm_median_f32 so that the results are identical
+	if (low->length == high->length)
+	{
+		*median_value = (lower + median->values[high->slots[0]]) / 2.0f;
+	}
+	else
+	{
+		*median_value = lower;
+	}
+
+	return true;
+}
+
+
+uint16_t acc_sliding_median_get_length(const acc_sliding_median_t *median)
+{
+	return median->length;
+}
+
+
+uint16_t acc_sliding_median_get_num_nan(const acc_sliding_median_t *median)
+{
+	return median->num_nan;
+}
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+
+static void remove_slot(acc_sliding_median_t *median, uint16_t slot)
+{
+	uint8_t heap_idx = median->heap_of[slot];
+
+	if (heap_idx == HEAP_NONE)
+	{
+		median->num_nan--;
+	}
+	else
+	{
+		(void)heap_remove(median, heap_idx, median->positions[slot]);
+		rebalance(median);
+	}
+}
+
+
+static void insert_slot(acc_sliding_median_t *median, uint16_t slot)
+{
+	const heap_t *low = &median->heaps[HEAP_LOW];
+
+	// Every value in the low heap must be less than or equal to every value in the high heap
+	bool to_low = (low->length == 0U) || (median->values[slot] <= median->values[low->slots[0]]);
+
+	heap_insert(median, to_low ? HEAP_LOW : HEAP_HIGH, slot);
+	rebalance(median);
+}
+
+
+static void rebalance(acc_sliding_median_t *median)
+{
+	// The low heap has the same length as the high heap, or one more
+	if (median->heaps[HEAP_LOW].length > (median->heaps[HEAP_HIGH].length + 1U))
+	{
+		heap_insert(median, HEAP_HIGH, heap_remove(median, HEAP_LOW, 0U));
+	}
+	else if (median->heaps[HEAP_HIGH].length > median->heaps[HEAP_LOW].length)
+	{
+		heap_insert(median, HEAP_LOW, heap_remove(median, HEAP_HIGH, 0U));
+	}
+}
+
+
+static void heap_insert(acc_sliding_median_t *median, uint8_t heap_idx, uint16_t slot)
+{
+	heap_t *heap = &median->heaps[heap_idx];
+
+	median->heap_of[slot] = heap_idx;
+	heap_set(median, heap, heap->length, slot);
+	heap->length++;
+
+	heap_sift_up(median, heap, heap->length - 1U);
+}
+
+
+static uint16_t heap_remove(acc_sliding_median_t *median, uint8_t heap_idx, uint16_t pos)
+{
+	heap_t  *heap = &median->heaps[heap_idx];
+	uint16_t slot = heap->slots[pos];
+
+	heap->length--;
+
+	if (pos < heap->length)
+	{
+		// Move the last slot into the hole, it can belong either above or below it
+		heap_set(median, heap, pos, heap->slots[heap->length]);
+		// If it moves up, the slot that takes its place already belongs there and sifting down is a no-op
+		heap_sift_up(median, heap, pos);
+		heap_sift_down(median, heap, pos);
+	}
+
+	return slot;
+}
+
+
+static void heap_sift_up(acc_sliding_median_t *median, heap_t *heap, uint16_t pos)
+{
+	uint16_t slot = heap->slots[pos];
+
+	while (pos > 0U)
+	{
+		uint16_t parent = (pos - 1U) / 2U;
+
+		if (!heap_above(median, heap, slot, heap->slots[parent]))
+		{
+			break;
+		}
+
+		heap_set(median, heap, pos, heap->slots[parent]);
+		pos = parent;
+	}
+
+	heap_set(median, heap, pos, slot);
+}
+
+
+static void heap_sift_down(acc_sliding_median_t *median, heap_t *heap, uint16_t pos)
+{
+	if (pos >= heap->length)
+	{
+		return;
+	}
+
+	uint16_t slot = heap->slots[pos];
+
+	while (true)
+	{
+		uint16_t child = (2U * pos) + 1U;
+
+		if (child >= heap->length)
+		{
+			break;
+		}
+
+		if (((child + 1U) < heap->length) && heap_above(median, heap, heap->slots[child + 1U], heap->slots[child]))
+		{
+			child++;
+		}
+
+		if (!heap_above(median, heap, heap->slots[child], slot))
+		{
+			break;
+		}
+
+		heap_set(median, heap, pos, heap->slots[child]);
+		pos = child;
+	}
+
+	heap_set(median, heap, pos, slot);
+}
+
+
+static inline bool heap_above(const acc_sliding_median_t *median, const heap_t *heap, uint16_t slot_a, uint16_t slot_b)
+{
+	return (heap->sign * median->values[slot_a]) < (heap->sign * median->values[slot_b]);
+}
+
+
+static inline void heap_set(acc_sliding_median_t *median, heap_t *heap, uint16_t pos, uint16_t slot)
+{
+	heap->slots[pos]        = slot;
+	median->positions[slot] = pos;
+}
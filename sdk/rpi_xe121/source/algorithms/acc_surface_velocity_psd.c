@@ -0,0 +1,481 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "acc_algorithm.h"
+#include "acc_integration.h"
+#include "acc_surface_velocity_psd.h"
+
+struct acc_surface_velocity_psd
+{
+	acc_surface_velocity_psd_config_t config;
+
+	uint16_t segment_length;
+	uint16_t padded_segment_length_shift;
+	uint16_t middle_index;
+
+	/** Slow-time series, time_series_length rows of num_distances */
+	float complex *time_series;
+	float complex *time_series_buffer;
+	float complex *fft_out;
+	float complex *sweep;
+	/** PSDs of the last frame and low-pass filtered PSDs, segment_length rows of num_distances */
+	float *psds;
+	float *lp_psds;
+	float *psd;
+	float *window;
+
+	uint16_t distance_index;
+	uint16_t stable_frames;
+	bool     locked;
+	bool     lp_psds_stale;
+	bool     verifying;
+	uint16_t lock_start_col;
+	uint16_t lock_num_cols;
+	uint16_t moved_frames;
+	uint16_t prime_frames_left;
+	uint16_t settle_frames_left;
+	uint16_t frames_since_scan;
+	float    lock_peak_energy;
+
+	acc_surface_velocity_psd_stats_t stats;
+};
+
+//-----------------------------
+// Private declarations
+//-----------------------------
+
+static void push_frame(acc_surface_velocity_psd_t *psd, const acc_int16_complex_t *frame);
+
+static void update_lp_psds(acc_surface_velocity_psd_t *psd, uint16_t start_col, uint16_t num_cols, bool warming_up);
+
+static uint16_t update_locked(acc_surface_velocity_psd_t *psd);
+
+static void update_lock(acc_surface_velocity_psd_t *psd, uint16_t index);
+
+static void drop_lock(acc_surface_velocity_psd_t *psd, bool verify);
+
+static float get_peak_energy(const acc_surface_velocity_psd_t *psd, uint16_t distance_index);
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+
+acc_surface_velocity_psd_t *acc_surface_velocity_psd_create(const acc_surface_velocity_psd_config_t *config)
+{
+	if ((config->num_distances == 0U) || (config->sweeps_per_frame == 0U) || (config->time_series_length < config->sweeps_per_frame) ||
+	    (config->time_series_length < 8U) || (config->sweep_rate <= 0.0f))
+	{
+		return NULL;
+	}
+
+	uint16_t segment_length = config->time_series_length / 4U;
+
+	if ((segment_length % 2U) != 0U)
+	{
+		segment_length += 1U;
+	}
+
+	uint16_t padded_segment_length_shift = 0U;
+
+	while ((1U << padded_segment_length_shift) < segment_length)
+	{
+		padded_segment_length_shift++;
+	}
+
+	size_t num_distances = config->num_distances;
+	size_t matrix_length = segment_length * num_distances;
+
+	// One allocation, ordered by alignment
+	size_t size = sizeof(acc_surface_velocity_psd_t) +
+	              ((((size_t)config->time_series_length * num_distances) + segment_length + (1U << padded_segment_length_shift) + num_distances) *
+	               sizeof(float complex)) +
+	              (((2U * matrix_length) + (2U * (size_t)segment_length)) * sizeof(float));
+
+	acc_surface_velocity_psd_t *psd = acc_integration_mem_alloc(size);
+
+	if (psd == NULL)
+	{
+		return NULL;
+	}
+
+	memset(psd, 0, size);
+
+	uint8_t *memory = (uint8_t *)psd + sizeof(acc_surface_velocity_psd_t);
+
+	psd->config                      = *config;
+	psd->segment_length              = segment_length;
+	psd->padded_segment_length_shift = padded_segment_length_shift;
+	psd->middle_index                = (uint16_t)rintf((float)segment_length / 2.0f);
+	psd->time_series                 = (float complex *)memory;
+	psd->time_series_buffer          = &psd->time_series[config->time_series_length * num_distances];
+	psd->fft_out                     = &psd->time_series_buffer[segment_length];
+	psd->sweep                       = &psd->fft_out[1U << padded_segment_length_shift];
+	psd->psds                        = (float *)&psd->sweep[num_distances];
+	psd->lp_psds                     = &psd->psds[matrix_length];
+	psd->psd                         = &psd->lp_psds[matrix_length];
+	psd->window                      = &psd->psd[segment_length];
+
+	acc_algorithm_hann(segment_length, psd->window);
+
+	return psd;
+}
+
+
+void acc_surface_velocity_psd_destroy(acc_surface_velocity_psd_t *psd)
+{
+	if (psd != NULL)
+	{
+		acc_integration_mem_free(psd);
+	}
+}
+
+
+uint16_t acc_surface_velocity_psd_get_segment_length(const acc_surface_velocity_psd_t *psd)
+{
+	return psd->segment_length;
+}
+
+
+uint16_t acc_surface_velocity_psd_get_middle_index(const acc_surface_velocity_psd_t *psd)
+{
+	return psd->middle_index;
+}
+
+
+uint16_t acc_surface_velocity_psd_update(acc_surface_velocity_psd_t *psd, const acc_int16_complex_t *frame)
+{
+	const acc_surface_velocity_psd_config_t *config = &psd->config;
+
+	push_frame(psd, frame);
+
+	bool     locked     = psd->locked;
+	uint16_t start_col  = locked ? psd->lock_start_col : 0U;
+	uint16_t num_cols   = locked ? psd->lock_num_cols : config->num_distances;
+	bool     warming_up = ((uint32_t)psd->stats.frames * config->sweeps_per_frame) < config->time_series_length;
+
+	acc_algorithm_welch_matrix_column_range(psd->time_series,
+	                                        config->time_series_length,
+	                                        config->num_distances,
+	                                        start_col,
+	                                        num_cols,
+	                                        psd->segment_length,
+	                                        psd->time_series_buffer,
+	                                        psd->fft_out,
+	                                        psd->psds,
+	                                        psd->window,
+	                                        psd->padded_segment_length_shift,
+	                                        config->sweep_rate);
+
+	acc_algorithm_fftshift_matrix_column_range(psd->psds, psd->segment_length, config->num_distances, start_col, num_cols);
+
+	update_lp_psds(psd, start_col, num_cols, warming_up);
+
+	uint16_t index;
+
+	if (locked)
+	{
+		index = update_locked(psd);
+
+		psd->stats.locked_frames += 1U;
+	}
+	else if (psd->prime_frames_left > 0U)
+	{
+		// The slow-time series of the distances that were not tracked still hold sweeps from before the lock
+		index = psd->distance_index;
+
+		psd->prime_frames_left -= 1U;
+		psd->lp_psds_stale      = psd->prime_frames_left > 0U;
+	}
+	else if (psd->settle_frames_left > 0U)
+	{
+		// The restarted PSDs are not comparable with the tracked ones yet
+		index = psd->distance_index;
+
+		psd->settle_frames_left -= 1U;
+	}
+	else
+	{
+		index = acc_algorithm_get_distance_idx(
+		    psd->lp_psds, config->num_distances, psd->segment_length, psd->middle_index, config->slow_zone_half_length);
+
+		// The neighbours were tracked while locked, a rescan only looks for a stronger distance outside them
+		if (psd->verifying && (index >= psd->lock_start_col) && (index < (psd->lock_start_col + psd->lock_num_cols)))
+		{
+			index = psd->distance_index;
+		}
+
+		psd->verifying = false;
+
+		if (!warming_up)
+		{
+			update_lock(psd, index);
+		}
+	}
+
+	psd->distance_index  = index;
+	psd->stats.frames   += 1U;
+
+	for (uint16_t i = 0U; i < psd->segment_length; i++)
+	{
+		psd->psd[i] = psd->lp_psds[(i * config->num_distances) + index];
+	}
+
+	return index;
+}
+
+
+const float *acc_surface_velocity_psd_get_psd(const acc_surface_velocity_psd_t *psd)
+{
+	return psd->psd;
+}
+
+
+bool acc_surface_velocity_psd_is_locked(const acc_surface_velocity_psd_t *psd)
+{
+	return psd->locked;
+}
+
+
+void acc_surface_velocity_psd_get_stats(const acc_surface_velocity_psd_t *psd, acc_surface_velocity_psd_stats_t *stats)
+{
+	*stats = psd->stats;
+}
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+
+/**
+ * @brief Push the sweeps of a frame to the slow-time series
+ *
+ * While locked, only the slow-time series of the locked distance and its neighbours are kept.
+ *
+ * @param psd The PSD
+ * @param frame The frame
+ */
+static void push_frame(acc_surface_velocity_psd_t *psd, const acc_int16_complex_t *frame)
+{
+	uint16_t num_distances = psd->config.num_distances;
+	uint16_t start_col     = psd->locked ? psd->lock_start_col : 0U;
+	uint16_t num_cols      = psd->locked ? psd->lock_num_cols : num_distances;
+
+	for (uint16_t i = 0U; i < psd->config.sweeps_per_frame; i++)
+	{
+		for (uint16_t j = start_col; j < (start_col + num_cols); j++)
+		{
+			uint16_t index = (i * num_distances) + j;
+
+			psd->sweep[j] = ((float)frame[index].real) + (((float)frame[index].imag) * I);
+		}
+
+		acc_algorithm_roll_and_push_matrix_f32_complex_column_range(
+		    psd->time_series, psd->config.time_series_length, num_distances, start_col, num_cols, psd->sweep, false);
+	}
+}
+
+
+/**
+ * @brief Low-pass filter the PSDs of a range of distances
+ *
+ * The distances that were not tracked while locked are restarted from the PSD of the frame
+ * until their slow-time series are full again.
+ *
+ * @param psd The PSD
+ * @param start_col First distance with a new PSD
+ * @param num_cols Number of distances with a new PSD
+ * @param warming_up Restart all distances, the time series is not full yet
+ */
+static void update_lp_psds(acc_surface_velocity_psd_t *psd, uint16_t start_col, uint16_t num_cols, bool warming_up)
+{
+	uint16_t num_distances = psd->config.num_distances;
+	float    coeff         = psd->config.psd_lp_coeff;
+	bool     restart_stale = psd->lp_psds_stale && !psd->locked;
+
+	for (uint16_t j = start_col; j < (start_col + num_cols); j++)
+	{
+		bool stale = restart_stale && ((j < psd->lock_start_col) || (j >= (psd->lock_start_col + psd->lock_num_cols)));
+
+		if (warming_up || stale)
+		{
+			for (uint16_t i = 0U; i < psd->segment_length; i++)
+			{
+				psd->lp_psds[(i * num_distances) + j] = psd->psds[(i * num_distances) + j];
+			}
+		}
+	}
+
+	for (uint16_t i = 0U; i < psd->segment_length; i++)
+	{
+		for (uint16_t j = start_col; j < (start_col + num_cols); j++)
+		{
+			uint16_t index = (i * num_distances) + j;
+
+			psd->lp_psds[index] = (psd->lp_psds[index] * coeff) + (psd->psds[index] * (1.0f - coeff));
+		}
+	}
+}
+
+
+/**
+ * @brief Check the locked distance against its neighbours
+ *
+ * @param psd The PSD
+ * @return The locked distance index
+ */
+static uint16_t update_locked(acc_surface_velocity_psd_t *psd)
+{
+	const acc_surface_velocity_psd_config_t *config = &psd->config;
+
+	uint16_t leader = psd->lock_start_col;
+	float    max    = -INFINITY;
+
+	for (uint16_t j = psd->lock_start_col; j < (psd->lock_start_col + psd->lock_num_cols); j++)
+	{
+		float energy = get_peak_energy(psd, j);
+
+		if (energy > max)
+		{
+			max    = energy;
+			leader = j;
+		}
+	}
+
+	if (leader != psd->distance_index)
+	{
+		psd->moved_frames += 1U;
+	}
+	else
+	{
+		psd->moved_frames = 0U;
+	}
+
+	psd->frames_since_scan += 1U;
+
+	float energy = get_peak_energy(psd, psd->distance_index);
+
+	if (psd->moved_frames >= config->unlock_frames)
+	{
+		psd->stats.unlocks_moved += 1U;
+		drop_lock(psd, false);
+	}
+	else if (energy < (psd->lock_peak_energy * config->rescan_energy_ratio))
+	{
+		psd->stats.unlocks_lost += 1U;
+		drop_lock(psd, false);
+	}
+	else if (psd->frames_since_scan >= config->rescan_interval)
+	{
+		psd->stats.rescans += 1U;
+		drop_lock(psd, true);
+	}
+	else
+	{
+		// Keep the lock
+	}
+
+	return psd->distance_index;
+}
+
+
+/**
+ * @brief Lock the distance once it has been selected for enough frames
+ *
+ * @param psd The PSD
+ * @param index Distance index selected from all distances
+ */
+static void update_lock(acc_surface_velocity_psd_t *psd, uint16_t index)
+{
+	uint16_t lock_frames = psd->config.lock_frames;
+	uint16_t half_width  = psd->config.lock_half_width;
+
+	if (lock_frames == 0U)
+	{
+		return;
+	}
+
+	if (index == psd->distance_index)
+	{
+		if (psd->stable_frames < lock_frames)
+		{
+			psd->stable_frames += 1U;
+		}
+	}
+	else
+	{
+		psd->stable_frames = 1U;
+	}
+
+	if (psd->stable_frames >= lock_frames)
+	{
+		uint16_t start_col = (index > half_width) ? (uint16_t)(index - half_width) : 0U;
+		uint16_t end_col   = ((index + half_width) < psd->config.num_distances) ? (index + half_width) : (psd->config.num_distances - 1U);
+
+		psd->locked             = true;
+		psd->lock_start_col     = start_col;
+		psd->lock_num_cols      = end_col - start_col + 1U;
+		psd->moved_frames       = 0U;
+		psd->frames_since_scan  = 0U;
+		psd->lock_peak_energy   = get_peak_energy(psd, index);
+		psd->stats.locks       += 1U;
+	}
+}
+
+
+/**
+ * @brief Drop the lock and keep the slow-time series of all distances from the next frame
+ *
+ * @param psd The PSD
+ * @param verify The lock is verified, take it again at once if the same distance is selected
+ */
+static void drop_lock(acc_surface_velocity_psd_t *psd, bool verify)
+{
+	uint16_t sweeps_per_frame = psd->config.sweeps_per_frame;
+
+	psd->locked             = false;
+	psd->lp_psds_stale      = true;
+	psd->prime_frames_left  = (psd->config.time_series_length + sweeps_per_frame - 1U) / sweeps_per_frame;
+	psd->settle_frames_left = psd->config.settle_frames;
+	psd->verifying          = verify;
+
+	if (!verify)
+	{
+		psd->stable_frames = 0U;
+	}
+}
+
+
+/**
+ * @brief Get the largest low-pass filtered PSD value of a distance, disregarding the slow zone
+ *
+ * @param psd The PSD
+ * @param distance_index Distance index
+ * @return Peak energy
+ */
+static float get_peak_energy(const acc_surface_velocity_psd_t *psd, uint16_t distance_index)
+{
+	uint16_t slow_zone_start = psd->middle_index - psd->config.slow_zone_half_length;
+	uint16_t slow_zone_end   = psd->middle_index + psd->config.slow_zone_half_length;
+	float    max             = -INFINITY;
+
+	for (uint16_t i = 0U; i < psd->segment_length; i++)
+	{
+		if ((i >= slow_zone_start) && (i < slow_zone_end))
+		{
+			continue;
+		}
+
+		max = fmaxf(max, psd->lp_psds[(i * psd->config.num_distances) + distance_index]);
+	}
+
+	return max;
+}
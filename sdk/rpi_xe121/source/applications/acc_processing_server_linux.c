@@ -0,0 +1,507 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <float.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_config.h"
+#include "acc_definitions_a121.h"
+#include "acc_definitions_common.h"
+#include "acc_detector_presence.h"
+#include "acc_hal_definitions_a121.h"
+#include "acc_hal_integration_a121.h"
+#include "acc_processing.h"
+#include "acc_processing_server.h"
+#include "acc_rss_a121.h"
+#include "acc_sensor.h"
+#include "acc_sensor_bring_up.h"
+#include "acc_socket_server.h"
+#include "acc_version.h"
+
+#include "example_vibration.h"
+#include "ref_app_breathing.h"
+
+/**
+ * Processing server
+ *
+ * Serves the protocol of acc_processing_server.h with the breathing, presence and
+ * vibration processing chains on sensor 1.
+ */
+
+#define DEFAULT_TCP_IP_PORT (6112)
+#define SENSOR_ID           (1U)
+#define SENSOR_TIMEOUT_MS   (1000U)
+
+static bool breathing_create(uint32_t *buffer_size, uint16_t *num_points, uint16_t *sweeps_per_frame);
+
+static bool breathing_prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size);
+
+static bool breathing_process(void *buffer, char *message, size_t message_size, acc_processing_result_t *processing_result);
+
+static void breathing_destroy(void);
+
+static bool presence_create(uint32_t *buffer_size, uint16_t *num_points, uint16_t *sweeps_per_frame);
+
+static bool presence_prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size);
+
+static bool presence_process(void *buffer, char *message, size_t message_size, acc_processing_result_t *processing_result);
+
+static void presence_destroy(void);
+
+static bool vibration_create(uint32_t *buffer_size, uint16_t *num_points, uint16_t *sweeps_per_frame);
+
+static bool vibration_prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size);
+
+static bool vibration_process(void *buffer, char *message, size_t message_size, acc_processing_result_t *processing_result);
+
+static void vibration_destroy(void);
+
+static bool sensor_prepare(const acc_processing_server_chain_t *chain, void *buffer, uint32_t buffer_size);
+
+static bool sensor_recalibrate(const acc_processing_server_chain_t *chain, void *buffer, uint32_t buffer_size);
+
+static bool sensor_measure(void *buffer, uint32_t buffer_size);
+
+static void sensor_release(void);
+
+static const acc_processing_server_chain_t processing_chains[] = {
+    {"breathing", breathing_create, breathing_prepare, breathing_process, breathing_destroy},
+    {"presence", presence_create, presence_prepare, presence_process, presence_destroy},
+    {"vibration", vibration_create, vibration_prepare, vibration_process, vibration_destroy},
+};
+
+#define NBR_PROCESSING_CHAINS (sizeof(processing_chains) / sizeof(processing_chains[0]))
+
+static const acc_processing_server_sensor_t processing_sensor = {sensor_prepare, sensor_recalibrate, sensor_measure, sensor_release};
+
+static volatile bool server_shutdown = false;
+
+static acc_socket_server_t socket_server = {0};
+
+static acc_sensor_bring_up_t bring_up = {0};
+
+static ref_app_breathing_config_t *breathing_config = NULL;
+static ref_app_breathing_handle_t *breathing_handle = NULL;
+
+static acc_detector_presence_config_t *presence_config = NULL;
+static acc_detector_presence_handle_t *presence_handle = NULL;
+
+static acc_vibration_config_t  vibration_config;
+static acc_vibration_handle_t *vibration_handle     = NULL;
+static acc_processing_t       *vibration_processing = NULL;
+
+static void main_sig_handler(int sig)
+{
+	printf("\nMain thread interrupted [%d]\n", sig);
+	signal(sig, SIG_IGN);
+	server_shutdown = true;
+}
+
+static void print_usage(char *application_name)
+{
+	fprintf(stderr, "Usage: %s [OPTION]...\n", application_name);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "-h, --help                      this help\n");
+	fprintf(stderr, "-p, --port                      the TCP/IP port to use\n");
+}
+
+int main(int argc, char *argv[])
+{
+	static struct option long_options[] = {{"help", no_argument, 0, 'h'}, {"port", required_argument, 0, 'p'}, {NULL, 0, NULL, 0}};
+
+	int character_code;
+	int option_index = 0;
+	int tcp_ip_port  = DEFAULT_TCP_IP_PORT;
+
+	while ((character_code = getopt_long(argc, argv, "h?p:", long_options, &option_index)) != -1)
+	{
+		switch (character_code)
+		{
+			case 'p':
+			{
+				int value = atoi(optarg);
+				if (value > 0)
+				{
+					tcp_ip_port = value;
+				}
+				else
+				{
+					fprintf(stderr, "ERROR: Invalid tcp/ip port '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+
+				break;
+			}
+			default:
+			{
+				print_usage(basename(argv[0]));
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	printf("Acconeer software version %s\n", acc_version_get());
+
+	const acc_hal_a121_t *hal = acc_hal_rss_integration_get_implementation();
+
+	if (!acc_rss_hal_register(hal))
+	{
+		return EXIT_FAILURE;
+	}
+
+	struct sigaction sa = {0};
+
+	sa.sa_handler = main_sig_handler;
+	if (sigaction(SIGINT, &sa, NULL) < 0)
+	{
+		fprintf(stderr, "ERROR: sigaction\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Ignore broken pipe shutdown, default behavior is to close application */
+	signal(SIGPIPE, SIG_IGN);
+
+	printf("Starting processing server (port=%d)\n", tcp_ip_port);
+
+	if (!acc_socket_server_open(&socket_server, tcp_ip_port, ACC_PROCESSING_SERVER_MAX_COMMAND_SIZE))
+	{
+		fprintf(stderr, "ERROR: Could not create socket server\n");
+		return EXIT_FAILURE;
+	}
+
+	acc_processing_server_config_t config;
+
+	config.chains       = processing_chains;
+	config.num_chains   = NBR_PROCESSING_CHAINS;
+	config.sensor       = &processing_sensor;
+	config.rss_version  = acc_version_get();
+	config.sensor_count = acc_hal_integration_sensor_count();
+
+	acc_processing_server_serve(&socket_server, &config, &server_shutdown);
+
+	acc_socket_server_close(&socket_server);
+
+	printf("Shutdown complete.\n");
+
+	return EXIT_SUCCESS;
+}
+
+static bool sensor_prepare(const acc_processing_server_chain_t *chain, void *buffer, uint32_t buffer_size)
+{
+	acc_sensor_bring_up_release(&bring_up, 1U);
+
+	bring_up.sensor_id   = SENSOR_ID;
+	bring_up.buffer      = buffer;
+	bring_up.buffer_size = buffer_size;
+	bring_up.config      = NULL;
+
+	if (!acc_sensor_bring_up_run(&bring_up, 1U, SENSOR_TIMEOUT_MS))
+	{
+		printf("Sensor bring-up failed\n");
+		return false;
+	}
+
+	if (!chain->prepare(bring_up.sensor, &bring_up.cal_result, buffer, buffer_size))
+	{
+		printf("Prepare of %s processing failed\n", chain->name);
+		acc_sensor_status(bring_up.sensor);
+		return false;
+	}
+
+	return true;
+}
+
+static bool sensor_recalibrate(const acc_processing_server_chain_t *chain, void *buffer, uint32_t buffer_size)
+{
+	bool           status              = false;
+	bool           cal_complete        = false;
+	const uint16_t calibration_retries = 1U;
+
+	// Random disturbances may cause the calibration to fail. At failure, retry at least once.
+	for (uint16_t i = 0; !status && (i <= calibration_retries); i++)
+	{
+		// Reset sensor before calibration by disabling/enabling it
+		acc_hal_integration_sensor_disable(SENSOR_ID);
+		acc_hal_integration_sensor_enable(SENSOR_ID);
+
+		do
+		{
+			status = acc_sensor_calibrate(bring_up.sensor, &cal_complete, &bring_up.cal_result, buffer, buffer_size);
+
+			if (status && !cal_complete)
+			{
+				status = acc_hal_integration_wait_for_sensor_interrupt(SENSOR_ID, SENSOR_TIMEOUT_MS);
+			}
+		} while (status && !cal_complete);
+	}
+
+	if (!status)
+	{
+		printf("Sensor recalibration failed\n");
+		acc_sensor_status(bring_up.sensor);
+		return false;
+	}
+
+	// Reset sensor after calibration by disabling/enabling it
+	acc_hal_integration_sensor_disable(SENSOR_ID);
+	acc_hal_integration_sensor_enable(SENSOR_ID);
+
+	if (!chain->prepare(bring_up.sensor, &bring_up.cal_result, buffer, buffer_size))
+	{
+		printf("Prepare of %s processing failed\n", chain->name);
+		acc_sensor_status(bring_up.sensor);
+		return false;
+	}
+
+	return true;
+}
+
+static bool sensor_measure(void *buffer, uint32_t buffer_size)
+{
+	if (!acc_sensor_measure(bring_up.sensor))
+	{
+		printf("acc_sensor_measure failed\n");
+		acc_sensor_status(bring_up.sensor);
+		return false;
+	}
+
+	if (!acc_hal_integration_wait_for_sensor_interrupt(SENSOR_ID, SENSOR_TIMEOUT_MS))
+	{
+		printf("Sensor interrupt timeout\n");
+		acc_sensor_status(bring_up.sensor);
+		return false;
+	}
+
+	if (!acc_sensor_read(bring_up.sensor, buffer, buffer_size))
+	{
+		printf("acc_sensor_read failed\n");
+		acc_sensor_status(bring_up.sensor);
+		return false;
+	}
+
+	return true;
+}
+
+static void sensor_release(void)
+{
+	acc_sensor_bring_up_release(&bring_up, 1U);
+}
+
+static bool breathing_create(uint32_t *buffer_size, uint16_t *num_points, uint16_t *sweeps_per_frame)
+{
+	breathing_config = ref_app_breathing_config_create();
+	if (breathing_config == NULL)
+	{
+		return false;
+	}
+
+	// Same as the sitting preset of ref_app_breathing_main.c
+	acc_detector_presence_config_end_set(breathing_config->presence_config, 1.5f);
+	acc_detector_presence_config_intra_detection_threshold_set(breathing_config->presence_config, 6.0f);
+
+	breathing_handle = ref_app_breathing_create(breathing_config);
+
+	uint16_t frame_data_length = 0U;
+
+	if ((breathing_handle == NULL) || !ref_app_breathing_get_frame_data_length(breathing_handle, &frame_data_length))
+	{
+		return false;
+	}
+
+	*sweeps_per_frame = acc_detector_presence_config_sweeps_per_frame_get(breathing_config->presence_config);
+	*num_points       = frame_data_length / *sweeps_per_frame;
+
+	return ref_app_breathing_get_buffer_size(breathing_handle, buffer_size);
+}
+
+static bool breathing_prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size)
+{
+	return ref_app_breathing_prepare(breathing_handle, breathing_config, sensor, cal_result, buffer, buffer_size);
+}
+
+static bool breathing_process(void *buffer, char *message, size_t message_size, acc_processing_result_t *processing_result)
+{
+	ref_app_breathing_result_t result = {0};
+
+	if (!ref_app_breathing_process(breathing_handle, buffer, &result))
+	{
+		return false;
+	}
+
+	*processing_result = result.presence_result.processing_result;
+
+	snprintf(message,
+	         message_size,
+	         "{\"type\":\"breathing\",\"app_state\":%u,\"result_ready\":%s,\"breathing_rate\":%.2f,"
+	         "\"presence_detected\":%s,\"presence_distance\":%.3f,\"frame_delayed\":%s}",
+	         (unsigned int)result.app_state,
+	         result.result_ready ? "true" : "false",
+	         (double)result.breathing_rate,
+	         result.presence_result.presence_detected ? "true" : "false",
+	         (double)result.presence_result.presence_distance,
+	         processing_result->frame_delayed ? "true" : "false");
+
+	return true;
+}
+
+static void breathing_destroy(void)
+{
+	if (breathing_config != NULL)
+	{
+		ref_app_breathing_config_destroy(breathing_config);
+		breathing_config = NULL;
+	}
+
+	if (breathing_handle != NULL)
+	{
+		ref_app_breathing_destroy(breathing_handle);
+		breathing_handle = NULL;
+	}
+}
+
+static bool presence_create(uint32_t *buffer_size, uint16_t *num_points, uint16_t *sweeps_per_frame)
+{
+	acc_detector_presence_metadata_t metadata;
+
+	presence_config = acc_detector_presence_config_create();
+	if (presence_config == NULL)
+	{
+		return false;
+	}
+
+	presence_handle = acc_detector_presence_create(presence_config, &metadata);
+	if (presence_handle == NULL)
+	{
+		return false;
+	}
+
+	*num_points       = metadata.num_points;
+	*sweeps_per_frame = acc_detector_presence_config_sweeps_per_frame_get(presence_config);
+
+	return acc_detector_presence_get_buffer_size(presence_handle, buffer_size);
+}
+
+static bool presence_prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size)
+{
+	return acc_detector_presence_prepare(presence_handle, presence_config, sensor, cal_result, buffer, buffer_size);
+}
+
+static bool presence_process(void *buffer, char *message, size_t message_size, acc_processing_result_t *processing_result)
+{
+	acc_detector_presence_result_t result;
+
+	if (!acc_detector_presence_process(presence_handle, buffer, &result))
+	{
+		return false;
+	}
+
+	*processing_result = result.processing_result;
+
+	snprintf(message,
+	         message_size,
+	         "{\"type\":\"presence\",\"presence_detected\":%s,\"intra_presence_score\":%.3f,"
+	         "\"inter_presence_score\":%.3f,\"presence_distance\":%.3f,\"frame_delayed\":%s}",
+	         result.presence_detected ? "true" : "false",
+	         (double)result.intra_presence_score,
+	         (double)result.inter_presence_score,
+	         (double)result.presence_distance,
+	         processing_result->frame_delayed ? "true" : "false");
+
+	return true;
+}
+
+static void presence_destroy(void)
+{
+	if (presence_config != NULL)
+	{
+		acc_detector_presence_config_destroy(presence_config);
+		presence_config = NULL;
+	}
+
+	if (presence_handle != NULL)
+	{
+		acc_detector_presence_destroy(presence_handle);
+		presence_handle = NULL;
+	}
+}
+
+static bool vibration_create(uint32_t *buffer_size, uint16_t *num_points, uint16_t *sweeps_per_frame)
+{
+	acc_processing_metadata_t proc_meta;
+
+	acc_vibration_preset_set(&vibration_config, ACC_VIBRATION_PRESET_LOW_FREQUENCY);
+
+	vibration_handle = acc_vibration_handle_create(&vibration_config);
+	if (vibration_handle == NULL)
+	{
+		return false;
+	}
+
+	vibration_processing = acc_processing_create(acc_vibration_handle_sensor_config_get(vibration_handle), &proc_meta);
+	if (vibration_processing == NULL)
+	{
+		return false;
+	}
+
+	*sweeps_per_frame = acc_config_sweeps_per_frame_get(acc_vibration_handle_sensor_config_get(vibration_handle));
+	*num_points       = proc_meta.frame_data_length / *sweeps_per_frame;
+
+	return acc_rss_get_buffer_size(acc_vibration_handle_sensor_config_get(vibration_handle), buffer_size);
+}
+
+static bool vibration_prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size)
+{
+	return acc_sensor_prepare(sensor, acc_vibration_handle_sensor_config_get(vibration_handle), cal_result, buffer, buffer_size);
+}
+
+static bool vibration_process(void *buffer, char *message, size_t message_size, acc_processing_result_t *processing_result)
+{
+	acc_vibration_result_t result = {0};
+
+	acc_processing_execute(vibration_processing, buffer, processing_result);
+
+	if (processing_result->calibration_needed)
+	{
+		return true;
+	}
+
+	acc_vibration_process(processing_result, vibration_handle, &vibration_config, &result);
+
+	bool displacement_valid = result.max_displacement != FLT_MAX;
+
+	snprintf(message,
+	         message_size,
+	         "{\"type\":\"vibration\",\"max_sweep_amplitude\":%.3f,\"max_displacement\":%.3f,"
+	         "\"max_displacement_freq\":%.3f,\"displacement_valid\":%s,\"frame_delayed\":%s}",
+	         (double)result.max_sweep_amplitude,
+	         displacement_valid ? (double)result.max_displacement : 0.0,
+	         displacement_valid ? (double)result.max_displacement_freq : 0.0,
+	         displacement_valid ? "true" : "false",
+	         processing_result->frame_delayed ? "true" : "false");
+
+	return true;
+}
+
+static void vibration_destroy(void)
+{
+	if (vibration_processing != NULL)
+	{
+		acc_processing_destroy(vibration_processing);
+		vibration_processing = NULL;
+	}
+
+	if (vibration_handle != NULL)
+	{
+		acc_vibration_handle_destroy(vibration_handle);
+		vibration_handle = NULL;
+	}
+}
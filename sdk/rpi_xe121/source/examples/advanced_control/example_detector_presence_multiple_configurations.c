@@ -17,6 +17,7 @@
 #include "acc_integration.h"
 #include "acc_rss_a121.h"
 #include "acc_sensor.h"
+#include "acc_sensor_bring_up.h"
 
 #include "acc_version.h"
 
@@ -26,8 +27,8 @@
  * The example executes as follows:
  *   - Create a first presence configuration
  *   - Create a second presence configuration
- *   - Create a sensor instance
- *   - Calibrate the sensor
+ *   - Create a sensor instance and calibrate the sensor with the bring-up helper
+ *   - Print the startup timeline
  *   - Loop forever:
  *     - Loop configurations (i):
  *       - Create a detector instance with the i:th configuration
@@ -155,41 +156,26 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	acc_hal_integration_sensor_supply_on(SENSOR_ID);
-	acc_hal_integration_sensor_enable(SENSOR_ID);
+	// Power on, create and calibrate the sensor. The helper also resets the sensor
+	// after calibration. Add more entries to bring up several sensors in parallel.
+	acc_sensor_bring_up_t bring_up = {
+	    .sensor_id   = SENSOR_ID,
+	    .buffer      = buffer,
+	    .buffer_size = buffer_size,
+	    .config      = NULL,
+	};
 
-	sensor = acc_sensor_create(SENSOR_ID);
-	if (sensor == NULL)
+	if (!acc_sensor_bring_up_run(&bring_up, 1U, SENSOR_TIMEOUT_MS))
 	{
-		printf("acc_sensor_create() failed\n");
+		printf("Sensor bring-up failed\n");
 		cleanup(presence_handle, presence_config, sensor, buffer, NBR_CONFIGS);
 		return EXIT_FAILURE;
 	}
 
-	bool             status;
-	bool             cal_complete = false;
-	acc_cal_result_t cal_result;
-
-	do
-	{
-		status = acc_sensor_calibrate(sensor, &cal_complete, &cal_result, buffer, buffer_size);
-
-		if (status && !cal_complete)
-		{
-			status = acc_hal_integration_wait_for_sensor_interrupt(SENSOR_ID, SENSOR_TIMEOUT_MS);
-		}
-	} while (status && !cal_complete);
-
-	if (!status)
-	{
-		printf("acc_sensor_calibrate() failed\n");
-		cleanup(presence_handle, presence_config, sensor, buffer, NBR_CONFIGS);
-		return EXIT_FAILURE;
-	}
+	acc_sensor_bring_up_print_timeline(&bring_up, 1U);
 
-	// Reset sensor after calibration by disabling it
-	acc_hal_integration_sensor_disable(SENSOR_ID);
-	acc_hal_integration_sensor_enable(SENSOR_ID);
+	sensor                      = bring_up.sensor;
+	acc_cal_result_t cal_result = bring_up.cal_result;
 
 	while (true)
 	{
@@ -0,0 +1,452 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "acc_control_socket.h"
+
+#define SET_COMMAND "set"
+
+static bool accept_client(acc_control_socket_t *control);
+
+static void close_client(acc_control_socket_t *control);
+
+static bool take_line(acc_control_socket_t *control, char *command, size_t command_size);
+
+static bool parse_value(acc_control_value_type_t type, const char *text, acc_control_value_t *value);
+
+static bool set_address(struct sockaddr_un *addr, const char *path);
+
+static bool write_all(int fd, const char *data, size_t size);
+
+static uint64_t get_time_ms(void);
+
+
+bool acc_control_socket_open(acc_control_socket_t *control, const char *path)
+{
+	struct sockaddr_un addr;
+
+	control->server_socket = -1;
+	control->client_socket = -1;
+	control->line_length   = 0U;
+	control->discarding    = false;
+
+	if (!set_address(&addr, path))
+	{
+		fprintf(stderr, "ERROR: Control socket path too long: %s\n", path);
+		return false;
+	}
+
+	int s = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if (s < 0)
+	{
+		fprintf(stderr, "ERROR: socket(AF_UNIX, SOCK_STREAM, 0): (%d) %s\n", errno, strerror(errno));
+		return false;
+	}
+
+	// A socket file from an instance that did not shut down cleanly would make bind fail
+	(void)unlink(path);
+
+	if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		fprintf(stderr, "ERROR: bind(%s): (%d) %s\n", path, errno, strerror(errno));
+		close(s);
+		return false;
+	}
+
+	if (listen(s, 1) < 0)
+	{
+		fprintf(stderr, "ERROR: listen(): (%d) %s\n", errno, strerror(errno));
+		close(s);
+		(void)unlink(path);
+		return false;
+	}
+
+	strncpy(control->path, path, sizeof(control->path) - 1U);
+	control->path[sizeof(control->path) - 1U] = '\0';
+	control->server_socket                    = s;
+
+	return true;
+}
+
+
+void acc_control_socket_close(acc_control_socket_t *control)
+{
+	close_client(control);
+
+	if (control->server_socket >= 0)
+	{
+		close(control->server_socket);
+		control->server_socket = -1;
+		(void)unlink(control->path);
+	}
+}
+
+
+bool acc_control_socket_poll(acc_control_socket_t *control, char *command, size_t command_size)
+{
+	if (control->server_socket < 0)
+	{
+		return false;
+	}
+
+	if ((control->client_socket < 0) && !accept_client(control))
+	{
+		return false;
+	}
+
+	// A command left over from an earlier read is handled before more is read
+	if (take_line(control, command, command_size))
+	{
+		return true;
+	}
+
+	ssize_t length = read(control->client_socket, &control->line[control->line_length], sizeof(control->line) - control->line_length);
+
+	if (length == 0)
+	{
+		close_client(control);
+		return false;
+	}
+
+	if (length < 0)
+	{
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+		{
+			close_client(control);
+		}
+
+		return false;
+	}
+
+	control->line_length += (uint16_t)length;
+
+	return take_line(control, command, command_size);
+}
+
+
+void acc_control_socket_reply(acc_control_socket_t *control, const char *reply)
+{
+	if (control->client_socket < 0)
+	{
+		return;
+	}
+
+	// A client that does not read its replies is dropped instead of blocking the frame loop
+	if (!write_all(control->client_socket, reply, strlen(reply)) || !write_all(control->client_socket, "\n", 1U))
+	{
+		close_client(control);
+	}
+}
+
+
+bool acc_control_parse(const acc_control_param_t *params,
+                       uint16_t                   num_params,
+                       char                      *command,
+                       acc_control_change_t      *changes,
+                       uint16_t                  *num_changes,
+                       char                      *error,
+                       size_t                     error_size)
+{
+	char *save_ptr = NULL;
+	char *token    = strtok_r(command, " \t\r", &save_ptr);
+
+	*num_changes = 0U;
+
+	if ((token == NULL) || (strcmp(token, SET_COMMAND) != 0))
+	{
+		snprintf(error, error_size, "unknown command");
+		return false;
+	}
+
+	while ((token = strtok_r(NULL, " \t\r", &save_ptr)) != NULL)
+	{
+		char *value = strchr(token, '=');
+
+		if (value == NULL)
+		{
+			snprintf(error, error_size, "expected <name>=<value>, got %s", token);
+			return false;
+		}
+
+		*value = '\0';
+		value++;
+
+		uint16_t param = 0U;
+
+		while ((param < num_params) && (strcmp(params[param].name, token) != 0))
+		{
+			param++;
+		}
+
+		if (param == num_params)
+		{
+			snprintf(error, error_size, "unknown parameter %s", token);
+			return false;
+		}
+
+		if (*num_changes == ACC_CONTROL_SOCKET_MAX_CHANGES)
+		{
+			snprintf(error, error_size, "too many parameters");
+			return false;
+		}
+
+		changes[*num_changes].param = param;
+
+		if (!parse_value(params[param].type, value, &changes[*num_changes].value))
+		{
+			snprintf(error, error_size, "invalid value for %s", token);
+			return false;
+		}
+
+		(*num_changes)++;
+	}
+
+	if (*num_changes == 0U)
+	{
+		snprintf(error, error_size, "no parameters");
+		return false;
+	}
+
+	return true;
+}
+
+
+bool acc_control_socket_request(const char *path, const char *command, char *reply, size_t reply_size, uint32_t timeout_ms)
+{
+	struct sockaddr_un addr;
+
+	if ((reply_size == 0U) || !set_address(&addr, path))
+	{
+		return false;
+	}
+
+	int s = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (s < 0)
+	{
+		return false;
+	}
+
+	bool ok = (connect(s, (struct sockaddr *)&addr, sizeof(addr)) == 0) && write_all(s, command, strlen(command)) && write_all(s, "\n", 1U);
+
+	size_t   length   = 0U;
+	bool     complete = false;
+	uint64_t end_ms   = get_time_ms() + timeout_ms;
+
+	while (ok && !complete)
+	{
+		uint64_t      now_ms = get_time_ms();
+		struct pollfd fds    = {.fd = s, .events = POLLIN};
+
+		ok = (now_ms < end_ms) && (poll(&fds, 1, (int)(end_ms - now_ms)) > 0);
+
+		if (ok)
+		{
+			char    c;
+			ssize_t result = read(s, &c, 1U);
+
+			ok       = (result == 1) && (length < (reply_size - 1U));
+			complete = ok && (c == '\n');
+
+			if (ok && !complete)
+			{
+				reply[length++] = c;
+			}
+		}
+	}
+
+	reply[length] = '\0';
+	close(s);
+
+	return complete;
+}
+
+
+static bool accept_client(acc_control_socket_t *control)
+{
+	int s = accept4(control->server_socket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+	if (s < 0)
+	{
+		return false;
+	}
+
+	control->client_socket = s;
+	control->line_length   = 0U;
+	control->discarding    = false;
+
+	return true;
+}
+
+
+static void close_client(acc_control_socket_t *control)
+{
+	if (control->client_socket >= 0)
+	{
+		close(control->client_socket);
+		control->client_socket = -1;
+	}
+
+	control->line_length = 0U;
+	control->discarding  = false;
+}
+
+
+static bool take_line(acc_control_socket_t *control, char *command, size_t command_size)
+{
+	char *newline = memchr(control->line, '\n', control->line_length);
+
+	if (newline == NULL)
+	{
+		if (control->line_length == sizeof(control->line))
+		{
+			// Too long, the rest of the command is thrown away up to its newline
+			if (!control->discarding)
+			{
+				acc_control_socket_reply(control, "error command too long");
+			}
+
+			control->discarding  = true;
+			control->line_length = 0U;
+		}
+
+		return false;
+	}
+
+	uint16_t length    = (uint16_t)(newline - control->line);
+	bool     returned  = !control->discarding && (length < command_size);
+	uint16_t remaining = control->line_length - length - 1U;
+
+	if (returned)
+	{
+		memcpy(command, control->line, length);
+		command[length] = '\0';
+	}
+
+	memmove(control->line, newline + 1, remaining);
+	control->line_length = remaining;
+	control->discarding  = false;
+
+	return returned;
+}
+
+
+static bool parse_value(acc_control_value_type_t type, const char *text, acc_control_value_t *value)
+{
+	char *end = NULL;
+
+	if (text[0] == '\0')
+	{
+		return false;
+	}
+
+	errno = 0;
+
+	switch (type)
+	{
+		case ACC_CONTROL_VALUE_U16:
+		{
+			unsigned long result = strtoul(text, &end, 10);
+
+			if ((text[0] == '-') || (errno != 0) || (*end != '\0') || (result > UINT16_MAX))
+			{
+				return false;
+			}
+
+			value->u16 = (uint16_t)result;
+			return true;
+		}
+		case ACC_CONTROL_VALUE_FLOAT:
+		{
+			float result = strtof(text, &end);
+
+			if ((errno != 0) || (*end != '\0') || !isfinite(result))
+			{
+				return false;
+			}
+
+			value->f32 = result;
+			return true;
+		}
+		case ACC_CONTROL_VALUE_BOOL:
+			if ((strcmp(text, "true") == 0) || (strcmp(text, "1") == 0))
+			{
+				value->b = true;
+				return true;
+			}
+
+			if ((strcmp(text, "false") == 0) || (strcmp(text, "0") == 0))
+			{
+				value->b = false;
+				return true;
+			}
+
+			return false;
+		default:
+			return false;
+	}
+}
+
+
+static bool set_address(struct sockaddr_un *addr, const char *path)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+
+	if (strlen(path) >= sizeof(addr->sun_path))
+	{
+		return false;
+	}
+
+	strncpy(addr->sun_path, path, sizeof(addr->sun_path) - 1U);
+
+	return true;
+}
+
+
+static bool write_all(int fd, const char *data, size_t size)
+{
+	size_t written = 0U;
+
+	while (written < size)
+	{
+		ssize_t result = send(fd, &data[written], size - written, MSG_NOSIGNAL);
+
+		if (result <= 0)
+		{
+			return false;
+		}
+
+		written += (size_t)result;
+	}
+
+	return true;
+}
+
+
+static uint64_t get_time_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000U) + ((uint64_t)ts.tv_nsec / 1000000U);
+}
@@ -0,0 +1,491 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "acc_frame_fanout.h"
+#include "acc_integration.h"
+
+#define NO_SLOT (0xFFFFU)
+
+typedef struct
+{
+	uint8_t                 *buffer;
+	uint16_t                 refs;
+	acc_frame_fanout_frame_t frame;
+} slot_t;
+
+typedef struct
+{
+	acc_frame_fanout_t             *fanout;
+	const char                     *name;
+	acc_frame_fanout_process_func_t process;
+	void                           *user_data;
+	bool                            own_thread;
+	pthread_t                       thread;
+	pthread_cond_t                  cond;
+	bool                            thread_started;
+
+	/** Ring of slot indices, queue_depth long */
+	uint16_t                *queue;
+	uint16_t                 queue_start;
+	uint16_t                 queue_length;
+	acc_frame_fanout_stats_t stats;
+} processor_t;
+
+struct acc_frame_fanout
+{
+	const acc_processing_metadata_t *metadata;
+	uint32_t                         buffer_size;
+	uint16_t                         queue_depth;
+
+	pthread_mutex_t mutex;
+	bool            running;
+
+	processor_t processors[ACC_FRAME_FANOUT_MAX_PROCESSORS];
+	uint16_t    num_processors;
+
+	slot_t  *slots;
+	uint16_t num_slots;
+	uint16_t current_slot;
+	uint32_t sequence;
+};
+
+
+static void *processor_thread(void *arg);
+
+static void process_frame(processor_t *processor, slot_t *slot);
+
+static void release_slot(acc_frame_fanout_t *fanout, slot_t *slot);
+
+static uint64_t get_time_us(void);
+
+
+acc_frame_fanout_t *acc_frame_fanout_create(const acc_processing_metadata_t *metadata, uint32_t buffer_size, uint16_t queue_depth)
+{
+	if ((buffer_size == 0U) || (queue_depth == 0U))
+	{
+		return NULL;
+	}
+
+	acc_frame_fanout_t *fanout = acc_integration_mem_alloc(sizeof(*fanout));
+
+	if (fanout == NULL)
+	{
+		return NULL;
+	}
+
+	memset(fanout, 0, sizeof(*fanout));
+
+	fanout->metadata     = metadata;
+	fanout->buffer_size  = buffer_size;
+	fanout->queue_depth  = queue_depth;
+	fanout->current_slot = NO_SLOT;
+
+	pthread_mutex_init(&fanout->mutex, NULL);
+
+	return fanout;
+}
+
+
+void acc_frame_fanout_destroy(acc_frame_fanout_t *fanout)
+{
+	if (fanout == NULL)
+	{
+		return;
+	}
+
+	acc_frame_fanout_stop(fanout);
+
+	for (uint16_t i = 0U; i < fanout->num_processors; i++)
+	{
+		processor_t *processor = &fanout->processors[i];
+
+		if (processor->own_thread)
+		{
+			pthread_cond_destroy(&processor->cond);
+		}
+
+		if (processor->queue != NULL)
+		{
+			acc_integration_mem_free(processor->queue);
+		}
+	}
+
+	if (fanout->slots != NULL)
+	{
+		for (uint16_t i = 0U; i < fanout->num_slots; i++)
+		{
+			if (fanout->slots[i].buffer != NULL)
+			{
+				acc_integration_mem_free(fanout->slots[i].buffer);
+			}
+		}
+
+		acc_integration_mem_free(fanout->slots);
+	}
+
+	pthread_mutex_destroy(&fanout->mutex);
+	acc_integration_mem_free(fanout);
+}
+
+
+bool acc_frame_fanout_add_processor(acc_frame_fanout_t             *fanout,
+                                    const char                     *name,
+                                    acc_frame_fanout_process_func_t process,
+                                    void                           *user_data,
+                                    bool                            own_thread,
+                                    uint16_t                       *id)
+{
+	if (fanout->running || (fanout->slots != NULL) || (fanout->num_processors == ACC_FRAME_FANOUT_MAX_PROCESSORS))
+	{
+		return false;
+	}
+
+	processor_t *processor = &fanout->processors[fanout->num_processors];
+
+	memset(processor, 0, sizeof(*processor));
+
+	processor->fanout     = fanout;
+	processor->name       = name;
+	processor->process    = process;
+	processor->user_data  = user_data;
+	processor->own_thread = own_thread;
+
+	if (own_thread)
+	{
+		processor->queue = acc_integration_mem_alloc(fanout->queue_depth * sizeof(*processor->queue));
+
+		if (processor->queue == NULL)
+		{
+			return false;
+		}
+
+		pthread_cond_init(&processor->cond, NULL);
+	}
+
+	*id = fanout->num_processors;
+	fanout->num_processors++;
+
+	return true;
+}
+
+
+bool acc_frame_fanout_start(acc_frame_fanout_t *fanout)
+{
+	if (fanout->running || (fanout->slots != NULL))
+	{
+		return false;
+	}
+
+	uint16_t num_threaded = 0U;
+
+	for (uint16_t i = 0U; i < fanout->num_processors; i++)
+	{
+		if (fanout->processors[i].own_thread)
+		{
+			num_threaded++;
+		}
+	}
+
+	// Each processor in its own thread holds at most its queue and the frame it processes,
+	// with one more buffer to read into there is always a free buffer, so reads never wait
+	fanout->num_slots = (num_threaded * (fanout->queue_depth + 1U)) + 1U;
+	fanout->slots     = acc_integration_mem_alloc(fanout->num_slots * sizeof(*fanout->slots));
+
+	if (fanout->slots == NULL)
+	{
+		return false;
+	}
+
+	memset(fanout->slots, 0, fanout->num_slots * sizeof(*fanout->slots));
+
+	for (uint16_t i = 0U; i < fanout->num_slots; i++)
+	{
+		fanout->slots[i].buffer = acc_integration_mem_alloc(fanout->buffer_size);
+
+		if (fanout->slots[i].buffer == NULL)
+		{
+			return false;
+		}
+	}
+
+	fanout->running = true;
+
+	for (uint16_t i = 0U; i < fanout->num_processors; i++)
+	{
+		processor_t *processor = &fanout->processors[i];
+
+		if (processor->own_thread)
+		{
+			if (pthread_create(&processor->thread, NULL, processor_thread, processor) != 0)
+			{
+				acc_frame_fanout_stop(fanout);
+				return false;
+			}
+
+			processor->thread_started = true;
+		}
+	}
+
+	return true;
+}
+
+
+void *acc_frame_fanout_get_buffer(acc_frame_fanout_t *fanout)
+{
+	pthread_mutex_lock(&fanout->mutex);
+
+	if (fanout->current_slot == NO_SLOT)
+	{
+		for (uint16_t i = 0U; i < fanout->num_slots; i++)
+		{
+			if (fanout->slots[i].refs == 0U)
+			{
+				// Held by the reader until it is published
+				fanout->slots[i].refs = 1U;
+				fanout->current_slot  = i;
+				break;
+			}
+		}
+	}
+
+	void *buffer = (fanout->current_slot != NO_SLOT) ? fanout->slots[fanout->current_slot].buffer : NULL;
+
+	pthread_mutex_unlock(&fanout->mutex);
+
+	return buffer;
+}
+
+
+bool acc_frame_fanout_publish(acc_frame_fanout_t *fanout, const acc_processing_result_t *result)
+{
+	if (!fanout->running || (fanout->current_slot == NO_SLOT))
+	{
+		return false;
+	}
+
+	slot_t        *slot  = &fanout->slots[fanout->current_slot];
+	const uint8_t *frame = (const uint8_t *)result->frame;
+
+	// The frame must be in the buffer that was read into, anything else would have been copied
+	if ((frame < slot->buffer) || (frame >= &slot->buffer[fanout->buffer_size]))
+	{
+		return false;
+	}
+
+	slot->frame.frame              = result->frame;
+	slot->frame.metadata           = fanout->metadata;
+	slot->frame.sequence           = fanout->sequence++;
+	slot->frame.publish_time_us    = get_time_us();
+	slot->frame.data_saturated     = result->data_saturated;
+	slot->frame.frame_delayed      = result->frame_delayed;
+	slot->frame.calibration_needed = result->calibration_needed;
+	slot->frame.temperature        = result->temperature;
+
+	pthread_mutex_lock(&fanout->mutex);
+
+	fanout->current_slot = NO_SLOT;
+
+	for (uint16_t i = 0U; i < fanout->num_processors; i++)
+	{
+		processor_t *processor = &fanout->processors[i];
+
+		if (!processor->own_thread)
+		{
+			continue;
+		}
+
+		if (processor->queue_length == fanout->queue_depth)
+		{
+			processor->stats.dropped++;
+			continue;
+		}
+
+		uint16_t end = (processor->queue_start + processor->queue_length) % fanout->queue_depth;
+
+		processor->queue[end] = (uint16_t)(slot - fanout->slots);
+		processor->queue_length++;
+		slot->refs++;
+
+		if (processor->queue_length > processor->stats.max_lag)
+		{
+			processor->stats.max_lag = processor->queue_length;
+		}
+
+		pthread_cond_signal(&processor->cond);
+	}
+
+	pthread_mutex_unlock(&fanout->mutex);
+
+	uint32_t failed_before = 0U;
+	uint32_t failed_after  = 0U;
+
+	for (uint16_t i = 0U; i < fanout->num_processors; i++)
+	{
+		processor_t *processor = &fanout->processors[i];
+
+		if (!processor->own_thread)
+		{
+			failed_before += processor->stats.failed;
+			process_frame(processor, slot);
+			failed_after += processor->stats.failed;
+		}
+	}
+
+	release_slot(fanout, slot);
+
+	return failed_after == failed_before;
+}
+
+
+void acc_frame_fanout_stop(acc_frame_fanout_t *fanout)
+{
+	pthread_mutex_lock(&fanout->mutex);
+
+	fanout->running = false;
+
+	for (uint16_t i = 0U; i < fanout->num_processors; i++)
+	{
+		if (fanout->processors[i].own_thread)
+		{
+			pthread_cond_signal(&fanout->processors[i].cond);
+		}
+	}
+
+	pthread_mutex_unlock(&fanout->mutex);
+
+	for (uint16_t i = 0U; i < fanout->num_processors; i++)
+	{
+		processor_t *processor = &fanout->processors[i];
+
+		if (processor->thread_started)
+		{
+			pthread_join(processor->thread, NULL);
+			processor->thread_started = false;
+		}
+	}
+}
+
+
+void acc_frame_fanout_get_stats(acc_frame_fanout_t *fanout, uint16_t id, acc_frame_fanout_stats_t *stats)
+{
+	pthread_mutex_lock(&fanout->mutex);
+	*stats = fanout->processors[id].stats;
+	pthread_mutex_unlock(&fanout->mutex);
+}
+
+
+void acc_frame_fanout_print_stats(acc_frame_fanout_t *fanout)
+{
+	printf("%-16s %8s %8s %8s %8s %10s %10s\n", "Processor", "frames", "dropped", "failed", "max lag", "mean us", "max us");
+
+	for (uint16_t i = 0U; i < fanout->num_processors; i++)
+	{
+		acc_frame_fanout_stats_t stats;
+
+		acc_frame_fanout_get_stats(fanout, i, &stats);
+
+		uint64_t mean_us = (stats.frames > 0U) ? (stats.total_latency_us / stats.frames) : 0U;
+
+		printf("%-16s %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu16 " %10" PRIu64 " %10" PRIu32 "\n",
+		       fanout->processors[i].name,
+		       stats.frames,
+		       stats.dropped,
+		       stats.failed,
+		       stats.max_lag,
+		       mean_us,
+		       stats.max_latency_us);
+	}
+}
+
+
+static void *processor_thread(void *arg)
+{
+	processor_t        *processor = arg;
+	acc_frame_fanout_t *fanout    = processor->fanout;
+
+	pthread_mutex_lock(&fanout->mutex);
+
+	while (true)
+	{
+		while (fanout->running && (processor->queue_length == 0U))
+		{
+			pthread_cond_wait(&processor->cond, &fanout->mutex);
+		}
+
+		// The frames that are left are processed before the thread stops
+		if (processor->queue_length == 0U)
+		{
+			break;
+		}
+
+		slot_t *slot = &fanout->slots[processor->queue[processor->queue_start]];
+
+		processor->queue_start = (processor->queue_start + 1U) % fanout->queue_depth;
+		processor->queue_length--;
+
+		pthread_mutex_unlock(&fanout->mutex);
+
+		process_frame(processor, slot);
+		release_slot(fanout, slot);
+
+		pthread_mutex_lock(&fanout->mutex);
+	}
+
+	pthread_mutex_unlock(&fanout->mutex);
+
+	return NULL;
+}
+
+
+static void process_frame(processor_t *processor, slot_t *slot)
+{
+	bool     ok         = processor->process(&slot->frame, processor->user_data);
+	uint64_t latency_us = get_time_us() - slot->frame.publish_time_us;
+
+	pthread_mutex_lock(&processor->fanout->mutex);
+
+	processor->stats.frames++;
+	processor->stats.total_latency_us += latency_us;
+
+	if (latency_us > processor->stats.max_latency_us)
+	{
+		processor->stats.max_latency_us = (uint32_t)latency_us;
+	}
+
+	if (!ok)
+	{
+		processor->stats.failed++;
+	}
+
+	pthread_mutex_unlock(&processor->fanout->mutex);
+}
+
+
+static void release_slot(acc_frame_fanout_t *fanout, slot_t *slot)
+{
+	pthread_mutex_lock(&fanout->mutex);
+	slot->refs--;
+	pthread_mutex_unlock(&fanout->mutex);
+}
+
+
+static uint64_t get_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000U) + ((uint64_t)ts.tv_nsec / 1000U);
+}
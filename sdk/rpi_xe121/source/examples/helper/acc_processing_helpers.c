@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "acc_algorithm_kernels.h"
 #include "acc_control_helper.h"
 #include "acc_processing_helpers.h"
 
@@ -23,6 +24,9 @@
 #define MAX_DATA_ENTRY_LEN_IQ    87
 #define MAX_DATA_ENTRY_LEN_FLOAT 44
 
+// Points accumulated at a time, the integer sums for a chunk are kept on the stack
+#define POINT_CHUNK_LENGTH 64U
+
 
 acc_vector_iq_t *acc_vector_iq_alloc(uint32_t data_length)
 {
@@ -343,6 +347,51 @@ float acc_vector_iq_noncoherent_mean_amplitude(const acc_vector_iq_t *vector_a)
 }
 
 
+void acc_processing_helper_point_mean_amplitudes(const acc_int16_complex_t *frame,
+                                                 uint32_t                   sweep_data_length,
+                                                 uint32_t                   sweeps_per_frame,
+                                                 acc_vector_float_t        *coherent_out,
+                                                 acc_vector_float_t        *noncoherent_out)
+{
+	assert(sweeps_per_frame > 0);
+	assert(coherent_out->data_length == sweep_data_length);
+	assert(noncoherent_out->data_length == sweep_data_length);
+
+	const acc_algorithm_kernels_t *kernels = acc_algorithm_kernels_get();
+
+	int32_t sum[2 * POINT_CHUNK_LENGTH];
+
+	for (uint32_t start = 0; start < sweep_data_length; start += POINT_CHUNK_LENGTH)
+	{
+		uint32_t length = sweep_data_length - start;
+
+		if (length > POINT_CHUNK_LENGTH)
+		{
+			length = POINT_CHUNK_LENGTH;
+		}
+
+		memset(sum, 0, 2 * length * sizeof(sum[0]));
+		memset(&noncoherent_out->data[start], 0, length * sizeof(float));
+
+		for (uint32_t sweep = 0; sweep < sweeps_per_frame; sweep++)
+		{
+			const int16_t *iq = (const int16_t *)&frame[sweep * sweep_data_length + start];
+
+			kernels->accumulate_iq_i16(iq, sum, &noncoherent_out->data[start], (uint16_t)length);
+		}
+
+		for (uint32_t i = 0; i < length; i++)
+		{
+			float real = (float)sum[2 * i] / sweeps_per_frame;
+			float imag = (float)sum[2 * i + 1] / sweeps_per_frame;
+
+			coherent_out->data[start + i]     = sqrtf(real * real + imag * imag);
+			noncoherent_out->data[start + i] /= sweeps_per_frame;
+		}
+	}
+}
+
+
 void acc_vector_iq_phase(const acc_vector_iq_t *vector_a, acc_vector_float_t *vector_out)
 {
 	assert(vector_a->data_length == vector_out->data_length);
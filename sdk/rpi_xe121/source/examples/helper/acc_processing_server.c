@@ -0,0 +1,515 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_definitions_common.h"
+#include "acc_integration.h"
+#include "acc_iq_codec.h"
+#include "acc_processing_server.h"
+#include "acc_socket_server.h"
+
+#define MAX_MESSAGE_SIZE (512)
+#define MAX_VALUE_SIZE   (32)
+
+typedef enum
+{
+	RAW_ENCODING_NONE,
+	RAW_ENCODING_IQ_DELTA,
+} raw_encoding_t;
+
+typedef struct
+{
+	const acc_processing_server_chain_t *chain;
+	void                                *buffer;
+	uint32_t                             buffer_size;
+	uint16_t                             num_points;
+	uint16_t                             sweeps_per_frame;
+	uint32_t                             raw_decimation;
+	raw_encoding_t                       raw_encoding;
+	uint8_t                             *encoded_frame;
+	uint32_t                             frame_count;
+	bool                                 streaming;
+} session_t;
+
+static void input_data_function(const void *data, size_t size);
+
+static bool session_start(const acc_processing_server_chain_t *chain, uint32_t raw_decimation, raw_encoding_t raw_encoding);
+
+static void session_stop(void);
+
+static bool session_step(void);
+
+static void handle_command(const char *command);
+
+static bool json_get_string(const char *json, const char *key, char *value, size_t value_size);
+
+static bool json_get_uint(const char *json, const char *key, uint32_t *value);
+
+static void send_raw_frame(const acc_int16_complex_t *frame);
+
+static void write_message(const char *message);
+
+static const char *raw_encoding_names[] = {"none", "iq_delta"};
+
+#define NBR_RAW_ENCODINGS (sizeof(raw_encoding_names) / sizeof(raw_encoding_names[0]))
+
+static acc_socket_server_t                  *server        = NULL;
+static const acc_processing_server_config_t *server_config = NULL;
+
+static char   command_line[ACC_PROCESSING_SERVER_MAX_COMMAND_SIZE];
+static size_t command_line_length = 0;
+
+static session_t session = {0};
+
+void acc_processing_server_serve(acc_socket_server_t *socket_server, const acc_processing_server_config_t *config, volatile bool *shutdown)
+{
+	server        = socket_server;
+	server_config = config;
+
+	acc_socket_server_set_input_data_func(socket_server, input_data_function);
+
+	while (!*shutdown)
+	{
+		printf("Waiting for new connections...\n");
+		fflush(stdout);
+
+		acc_socket_server_client_close(socket_server);
+		session_stop();
+		command_line_length = 0;
+
+		if (!acc_socket_server_wait_for_client(socket_server))
+		{
+			continue;
+		}
+
+		printf("Got new connection.\n");
+
+		while (!*shutdown)
+		{
+			/* Block while idle, otherwise only check for commands between frames */
+			if (!acc_socket_server_poll_events(socket_server, !session.streaming, 0))
+			{
+				break;
+			}
+
+			if (session.streaming && !session_step())
+			{
+				write_message("{\"status\":\"error\",\"message\":\"measurement failed\"}");
+				session_stop();
+			}
+		}
+	}
+
+	session_stop();
+
+	acc_socket_server_client_close(socket_server);
+}
+
+static void input_data_function(const void *data, size_t size)
+{
+	const char *input = data;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		if (input[i] == '\n')
+		{
+			command_line[command_line_length] = '\0';
+			handle_command(command_line);
+			command_line_length = 0;
+		}
+		else if (command_line_length < (sizeof(command_line) - 1))
+		{
+			command_line[command_line_length++] = input[i];
+		}
+	}
+}
+
+static void handle_command(const char *command)
+{
+	char cmd[MAX_VALUE_SIZE];
+	char message[MAX_MESSAGE_SIZE];
+
+	if (!json_get_string(command, "cmd", cmd, sizeof(cmd)))
+	{
+		write_message("{\"status\":\"error\",\"message\":\"missing cmd\"}");
+		return;
+	}
+
+	if (strcmp(cmd, "get_system_info") == 0)
+	{
+		int length = snprintf(message,
+		                      sizeof(message),
+		                      "{\"status\":\"ok\",\"rss_version\":\"%s\",\"sensor_count\":%u,\"processing\":[",
+		                      server_config->rss_version,
+		                      (unsigned int)server_config->sensor_count);
+
+		for (size_t i = 0; (i < server_config->num_chains) && (length > 0) && ((size_t)length < sizeof(message)); i++)
+		{
+			length += snprintf(&message[length], sizeof(message) - length, "%s\"%s\"", i > 0 ? "," : "", server_config->chains[i].name);
+		}
+
+		if ((length > 0) && ((size_t)length < sizeof(message)))
+		{
+			length += snprintf(&message[length], sizeof(message) - length, "],\"raw_encoding\":[");
+		}
+
+		for (size_t i = 0; (i < NBR_RAW_ENCODINGS) && (length > 0) && ((size_t)length < sizeof(message)); i++)
+		{
+			length += snprintf(&message[length], sizeof(message) - length, "%s\"%s\"", i > 0 ? "," : "", raw_encoding_names[i]);
+		}
+
+		if ((length > 0) && ((size_t)length < sizeof(message)))
+		{
+			snprintf(&message[length], sizeof(message) - length, "]}");
+		}
+
+		write_message(message);
+	}
+	else if (strcmp(cmd, "start_streaming") == 0)
+	{
+		char           processing[MAX_VALUE_SIZE];
+		char           encoding[MAX_VALUE_SIZE];
+		uint32_t       raw_decimation = 0U;
+		raw_encoding_t raw_encoding   = RAW_ENCODING_NONE;
+		bool           encoding_valid = true;
+
+		const acc_processing_server_chain_t *chain = NULL;
+
+		if (!json_get_string(command, "processing", processing, sizeof(processing)))
+		{
+			snprintf(processing, sizeof(processing), "%s", server_config->chains[0].name);
+		}
+
+		(void)json_get_uint(command, "raw_decimation", &raw_decimation);
+
+		// Only the encodings listed by get_system_info are accepted, so a client that
+		// does not ask for an encoding always gets uncompressed frames
+		if (json_get_string(command, "raw_encoding", encoding, sizeof(encoding)))
+		{
+			encoding_valid = false;
+
+			for (size_t i = 0; i < NBR_RAW_ENCODINGS; i++)
+			{
+				if (strcmp(encoding, raw_encoding_names[i]) == 0)
+				{
+					raw_encoding   = (raw_encoding_t)i;
+					encoding_valid = true;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < server_config->num_chains; i++)
+		{
+			if (strcmp(processing, server_config->chains[i].name) == 0)
+			{
+				chain = &server_config->chains[i];
+			}
+		}
+
+		session_stop();
+
+		if (chain == NULL)
+		{
+			write_message("{\"status\":\"error\",\"message\":\"unknown processing\"}");
+		}
+		else if (!encoding_valid)
+		{
+			write_message("{\"status\":\"error\",\"message\":\"unknown raw_encoding\"}");
+		}
+		else if (!session_start(chain, raw_decimation, raw_encoding))
+		{
+			write_message("{\"status\":\"error\",\"message\":\"setup failed\"}");
+		}
+		else
+		{
+			snprintf(message,
+			         sizeof(message),
+			         "{\"status\":\"start\",\"processing\":\"%s\",\"raw_decimation\":%" PRIu32
+			         ",\"raw_encoding\":\"%s\",\"num_points\":%u,\"sweeps_per_frame\":%u}",
+			         chain->name,
+			         raw_decimation,
+			         raw_encoding_names[raw_encoding],
+			         (unsigned int)session.num_points,
+			         (unsigned int)session.sweeps_per_frame);
+			write_message(message);
+		}
+	}
+	else if (strcmp(cmd, "stop_streaming") == 0)
+	{
+		session_stop();
+		write_message("{\"status\":\"stop\"}");
+	}
+	else
+	{
+		write_message("{\"status\":\"error\",\"message\":\"unknown cmd\"}");
+	}
+}
+
+static bool session_start(const acc_processing_server_chain_t *chain, uint32_t raw_decimation, raw_encoding_t raw_encoding)
+{
+	session.chain          = chain;
+	session.raw_decimation = raw_decimation;
+	session.raw_encoding   = raw_encoding;
+	session.frame_count    = 0U;
+
+	if (!chain->create(&session.buffer_size, &session.num_points, &session.sweeps_per_frame))
+	{
+		printf("Failed to create %s processing\n", chain->name);
+		session_stop();
+		return false;
+	}
+
+	if (raw_encoding != RAW_ENCODING_NONE)
+	{
+		session.encoded_frame = acc_integration_mem_alloc(ACC_IQ_CODEC_MAX_ENCODED_SIZE(session.num_points, session.sweeps_per_frame));
+		if (session.encoded_frame == NULL)
+		{
+			printf("Failed to allocate encoding buffer\n");
+			session_stop();
+			return false;
+		}
+	}
+
+	session.buffer = acc_integration_mem_alloc(session.buffer_size);
+	if (session.buffer == NULL)
+	{
+		printf("Failed to allocate buffer\n");
+		session_stop();
+		return false;
+	}
+
+	if (!server_config->sensor->prepare(chain, session.buffer, session.buffer_size))
+	{
+		session_stop();
+		return false;
+	}
+
+	session.streaming = true;
+
+	return true;
+}
+
+static void session_stop(void)
+{
+	server_config->sensor->release();
+
+	if (session.chain != NULL)
+	{
+		session.chain->destroy();
+		session.chain = NULL;
+	}
+
+	if (session.buffer != NULL)
+	{
+		acc_integration_mem_free(session.buffer);
+		session.buffer = NULL;
+	}
+
+	if (session.encoded_frame != NULL)
+	{
+		acc_integration_mem_free(session.encoded_frame);
+		session.encoded_frame = NULL;
+	}
+
+	session.streaming = false;
+}
+
+static bool session_step(void)
+{
+	if (!server_config->sensor->measure(session.buffer, session.buffer_size))
+	{
+		return false;
+	}
+
+	char                    message[MAX_MESSAGE_SIZE];
+	acc_processing_result_t processing_result = {0};
+
+	if (!session.chain->process(session.buffer, message, sizeof(message), &processing_result))
+	{
+		printf("Processing failed\n");
+		return false;
+	}
+
+	if (processing_result.calibration_needed)
+	{
+		printf("Sensor recalibration needed ...\n");
+		return server_config->sensor->recalibrate(session.chain, session.buffer, session.buffer_size);
+	}
+
+	if ((session.raw_decimation > 0U) && ((session.frame_count % session.raw_decimation) == 0U) && (processing_result.frame != NULL))
+	{
+		send_raw_frame(processing_result.frame);
+	}
+
+	write_message(message);
+
+	session.frame_count++;
+
+	return true;
+}
+
+static void send_raw_frame(const acc_int16_complex_t *frame)
+{
+	char        header[MAX_MESSAGE_SIZE];
+	const void *data = frame;
+	uint32_t    size = (uint32_t)session.num_points * session.sweeps_per_frame * sizeof(acc_int16_complex_t);
+
+	if (session.raw_encoding == RAW_ENCODING_IQ_DELTA)
+	{
+		data = session.encoded_frame;
+		size = acc_iq_codec_encode(frame,
+		                           session.num_points,
+		                           session.sweeps_per_frame,
+		                           session.encoded_frame,
+		                           ACC_IQ_CODEC_MAX_ENCODED_SIZE(session.num_points, session.sweeps_per_frame));
+	}
+
+	snprintf(header,
+	         sizeof(header),
+	         "{\"type\":\"raw\",\"frame\":%" PRIu32 ",\"num_points\":%u,\"sweeps_per_frame\":%u,\"encoded_size\":%" PRIu32 "}",
+	         session.frame_count,
+	         (unsigned int)session.num_points,
+	         (unsigned int)session.sweeps_per_frame,
+	         size);
+	write_message(header);
+	acc_socket_server_setup_write_data(server, data, size);
+}
+
+static const char *json_skip_whitespace(const char *p)
+{
+	while ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n'))
+	{
+		p++;
+	}
+
+	return p;
+}
+
+/**
+ * @brief Find the closing quote of a JSON string
+ *
+ * @param[in] p The first character after the opening quote
+ * @return Pointer to the closing quote, NULL if the string is not terminated
+ */
+static const char *json_string_end(const char *p)
+{
+	while ((*p != '"') && (*p != '\0'))
+	{
+		// An escaped character, e.g. a quote, does not end the string
+		if ((*p == '\\') && (p[1] != '\0'))
+		{
+			p++;
+		}
+
+		p++;
+	}
+
+	return (*p == '"') ? p : NULL;
+}
+
+/**
+ * @brief Find the value of a key in a flat JSON object
+ *
+ * Only a string that follows { or , and is followed by : is a key, so a value that
+ * is the same as a key name is not taken for the key.
+ *
+ * @return Pointer to the first character of the value, NULL if the key is not found
+ */
+static const char *json_find_value(const char *json, const char *key)
+{
+	size_t key_length = strlen(key);
+	char   previous   = '\0';
+
+	for (const char *p = json_skip_whitespace(json); *p != '\0'; p = json_skip_whitespace(p + 1))
+	{
+		if (*p != '"')
+		{
+			previous = *p;
+			continue;
+		}
+
+		const char *end = json_string_end(p + 1);
+
+		if (end == NULL)
+		{
+			return NULL;
+		}
+
+		if (((previous == '{') || (previous == ',')) && ((size_t)(end - (p + 1)) == key_length) && (strncmp(p + 1, key, key_length) == 0))
+		{
+			const char *colon = json_skip_whitespace(end + 1);
+
+			if (*colon == ':')
+			{
+				return json_skip_whitespace(colon + 1);
+			}
+		}
+
+		previous = '"';
+		p        = end;
+	}
+
+	return NULL;
+}
+
+static bool json_get_string(const char *json, const char *key, char *value, size_t value_size)
+{
+	const char *p = json_find_value(json, key);
+
+	if ((p == NULL) || (*p != '"'))
+	{
+		return false;
+	}
+
+	p++;
+
+	size_t length = 0;
+
+	while ((p[length] != '"') && (p[length] != '\0') && (length < (value_size - 1)))
+	{
+		value[length] = p[length];
+		length++;
+	}
+
+	value[length] = '\0';
+
+	return p[length] == '"';
+}
+
+static bool json_get_uint(const char *json, const char *key, uint32_t *value)
+{
+	const char *p   = json_find_value(json, key);
+	char       *end = NULL;
+
+	if (p == NULL)
+	{
+		return false;
+	}
+
+	unsigned long parsed = strtoul(p, &end, 10);
+
+	if (end == p)
+	{
+		return false;
+	}
+
+	*value = (uint32_t)parsed;
+
+	return true;
+}
+
+static void write_message(const char *message)
+{
+	acc_socket_server_setup_write_data(server, message, strlen(message));
+	acc_socket_server_setup_write_data(server, "\n", 1);
+}
@@ -0,0 +1,230 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "acc_hal_integration_a121.h"
+#include "acc_integration.h"
+#include "acc_rss_a121.h"
+#include "acc_sensor.h"
+#include "acc_sensor_bring_up.h"
+
+
+static void fail_sensor(acc_sensor_bring_up_t *bring_up, const char *reason);
+
+static uint16_t calibrate_all(acc_sensor_bring_up_t *sensors, uint16_t sensor_count, uint32_t timeout_ms, uint32_t start_us);
+
+
+bool acc_sensor_bring_up_run(acc_sensor_bring_up_t *sensors, uint16_t sensor_count, uint32_t timeout_ms)
+{
+	uint32_t start_us = acc_integration_get_time_us();
+	bool     all_ok   = true;
+
+	// Enable all sensors back to back, the integration waits for the crystal
+	// startup on the first SPI transfer so the sensors start up in parallel
+	for (uint16_t i = 0U; i < sensor_count; i++)
+	{
+		sensors[i].sensor            = NULL;
+		sensors[i].ok                = true;
+		sensors[i].calibration_steps = 0U;
+		sensors[i].created_us        = 0U;
+		sensors[i].calibrated_us     = 0U;
+		sensors[i].ready_us          = 0U;
+
+		acc_hal_integration_sensor_supply_on(sensors[i].sensor_id);
+		acc_hal_integration_sensor_enable(sensors[i].sensor_id);
+
+		sensors[i].enabled_us = acc_integration_get_time_us() - start_us;
+	}
+
+	for (uint16_t i = 0U; i < sensor_count; i++)
+	{
+		sensors[i].sensor = acc_sensor_create(sensors[i].sensor_id);
+		if (sensors[i].sensor == NULL)
+		{
+			fail_sensor(&sensors[i], "acc_sensor_create() failed");
+			continue;
+		}
+
+		sensors[i].created_us = acc_integration_get_time_us() - start_us;
+	}
+
+	uint16_t calibrated_count = calibrate_all(sensors, sensor_count, timeout_ms, start_us);
+
+	if (calibrated_count > 0U)
+	{
+		// Reset the sensors after calibration by disabling them. All sensors are
+		// disabled before any is enabled so that the settle time is shared.
+		for (uint16_t i = 0U; i < sensor_count; i++)
+		{
+			if (sensors[i].ok)
+			{
+				acc_hal_integration_sensor_disable(sensors[i].sensor_id);
+			}
+		}
+
+		for (uint16_t i = 0U; i < sensor_count; i++)
+		{
+			if (sensors[i].ok)
+			{
+				acc_hal_integration_sensor_enable(sensors[i].sensor_id);
+			}
+		}
+	}
+
+	for (uint16_t i = 0U; i < sensor_count; i++)
+	{
+		if (!sensors[i].ok)
+		{
+			all_ok = false;
+			continue;
+		}
+
+		if (sensors[i].config != NULL)
+		{
+			if (!acc_sensor_prepare(sensors[i].sensor, sensors[i].config, &sensors[i].cal_result, sensors[i].buffer, sensors[i].buffer_size))
+			{
+				acc_sensor_status(sensors[i].sensor);
+				fail_sensor(&sensors[i], "acc_sensor_prepare() failed");
+				all_ok = false;
+				continue;
+			}
+		}
+
+		sensors[i].ready_us = acc_integration_get_time_us() - start_us;
+	}
+
+	return all_ok;
+}
+
+
+void acc_sensor_bring_up_release(acc_sensor_bring_up_t *sensors, uint16_t sensor_count)
+{
+	for (uint16_t i = 0U; i < sensor_count; i++)
+	{
+		if (sensors[i].sensor != NULL)
+		{
+			acc_sensor_destroy(sensors[i].sensor);
+			sensors[i].sensor = NULL;
+		}
+
+		if (sensors[i].ok)
+		{
+			acc_hal_integration_sensor_disable(sensors[i].sensor_id);
+			acc_hal_integration_sensor_supply_off(sensors[i].sensor_id);
+			sensors[i].ok = false;
+		}
+	}
+}
+
+
+void acc_sensor_bring_up_print_timeline(const acc_sensor_bring_up_t *sensors, uint16_t sensor_count)
+{
+	printf("Sensor bring-up timeline (us from start):\n");
+	printf("%6s %8s %8s %10s %8s %9s\n", "sensor", "enabled", "created", "calibrated", "ready", "cal steps");
+
+	for (uint16_t i = 0U; i < sensor_count; i++)
+	{
+		if (sensors[i].ok)
+		{
+			printf("%6" PRIsensor_id " %8" PRIu32 " %8" PRIu32 " %10" PRIu32 " %8" PRIu32 " %9u\n",
+			       sensors[i].sensor_id,
+			       sensors[i].enabled_us,
+			       sensors[i].created_us,
+			       sensors[i].calibrated_us,
+			       sensors[i].ready_us,
+			       (unsigned int)sensors[i].calibration_steps);
+		}
+		else
+		{
+			printf("%6" PRIsensor_id " %8s\n", sensors[i].sensor_id, "failed");
+		}
+	}
+}
+
+
+static void fail_sensor(acc_sensor_bring_up_t *bring_up, const char *reason)
+{
+	printf("Sensor %" PRIsensor_id ": %s\n", bring_up->sensor_id, reason);
+
+	if (bring_up->sensor != NULL)
+	{
+		acc_sensor_destroy(bring_up->sensor);
+		bring_up->sensor = NULL;
+	}
+
+	acc_hal_integration_sensor_disable(bring_up->sensor_id);
+	acc_hal_integration_sensor_supply_off(bring_up->sensor_id);
+
+	bring_up->ok = false;
+}
+
+
+/**
+ * @brief Calibrate all sensors with the calibration steps interleaved
+ *
+ * Each pass starts the next calibration step on every sensor that is not done.
+ * The sensors measure in parallel, so when the interrupt of the first sensor has
+ * been handled the interrupts of the others have usually already arrived.
+ */
+static uint16_t calibrate_all(acc_sensor_bring_up_t *sensors, uint16_t sensor_count, uint32_t timeout_ms, uint32_t start_us)
+{
+	uint16_t pending_count    = 0U;
+	uint16_t calibrated_count = 0U;
+
+	for (uint16_t i = 0U; i < sensor_count; i++)
+	{
+		if (sensors[i].ok)
+		{
+			pending_count++;
+		}
+	}
+
+	while (pending_count > 0U)
+	{
+		for (uint16_t i = 0U; i < sensor_count; i++)
+		{
+			if (!sensors[i].ok || (sensors[i].calibrated_us != 0U))
+			{
+				continue;
+			}
+
+			if ((sensors[i].calibration_steps > 0U) && !acc_hal_integration_wait_for_sensor_interrupt(sensors[i].sensor_id, timeout_ms))
+			{
+				fail_sensor(&sensors[i], "calibration interrupt timeout");
+				pending_count--;
+				continue;
+			}
+
+			bool cal_complete = false;
+
+			sensors[i].calibration_steps++;
+
+			if (!acc_sensor_calibrate(sensors[i].sensor, &cal_complete, &sensors[i].cal_result, sensors[i].buffer, sensors[i].buffer_size))
+			{
+				fail_sensor(&sensors[i], "acc_sensor_calibrate() failed");
+				pending_count--;
+				continue;
+			}
+
+			if (cal_complete)
+			{
+				uint32_t calibrated_us = acc_integration_get_time_us() - start_us;
+
+				// Zero marks a sensor that is not calibrated yet
+				sensors[i].calibrated_us = (calibrated_us != 0U) ? calibrated_us : 1U;
+				pending_count--;
+				calibrated_count++;
+			}
+		}
+	}
+
+	return calibrated_count;
+}
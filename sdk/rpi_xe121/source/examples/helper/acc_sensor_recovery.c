@@ -0,0 +1,348 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "acc_hal_integration_a121.h"
+#include "acc_integration.h"
+#include "acc_rss_a121.h"
+#include "acc_sensor.h"
+#include "acc_sensor_recovery.h"
+
+#define CALIBRATION_RETRIES (1U)
+
+static const char *fault_names[ACC_SENSOR_RECOVERY_NUM_FAULTS] = {
+	"measure",
+	"interrupt timeout",
+	"read",
+	"calibration",
+};
+
+static const char *step_names[ACC_SENSOR_RECOVERY_NUM_STEPS] = {
+	"reset",
+	"recalibrate",
+	"power cycle",
+};
+
+
+static bool recover(acc_sensor_recovery_t       *recovery,
+                    acc_sensor_recovery_fault_t  fault,
+                    acc_sensor_recovery_step_t   first_step,
+                    acc_sensor_recovery_step_t  *recovered_by);
+
+static bool run_step(acc_sensor_recovery_t *recovery, acc_sensor_recovery_step_t step);
+
+static bool calibrate(acc_sensor_recovery_t *recovery);
+
+static bool measure(acc_sensor_recovery_t *recovery, acc_sensor_recovery_fault_t *fault);
+
+static bool wait_for_interrupt(acc_sensor_recovery_t *recovery);
+
+
+bool acc_sensor_recovery_start(acc_sensor_recovery_t *recovery)
+{
+	for (uint16_t i = 0U; i < ACC_SENSOR_RECOVERY_NUM_FAULTS; i++)
+	{
+		recovery->stats.faults[i] = 0U;
+	}
+
+	for (uint16_t i = 0U; i < ACC_SENSOR_RECOVERY_NUM_STEPS; i++)
+	{
+		recovery->stats.recoveries[i] = 0U;
+	}
+
+	recovery->stats.failed_recoveries = 0U;
+	recovery->stats.last_duration_us  = 0U;
+	recovery->stats.max_duration_us   = 0U;
+	recovery->stats.total_duration_us = 0U;
+
+	acc_hal_integration_sensor_supply_on(recovery->sensor_id);
+	acc_hal_integration_sensor_enable(recovery->sensor_id);
+
+	recovery->sensor = acc_sensor_create(recovery->sensor_id);
+	if (recovery->sensor == NULL)
+	{
+		printf("acc_sensor_create() failed\n");
+		return false;
+	}
+
+	if (!calibrate(recovery))
+	{
+		printf("Sensor calibration failed\n");
+		return false;
+	}
+
+	if (!recovery->prepare(recovery->sensor, &recovery->cal_result, recovery->buffer, recovery->buffer_size, recovery->prepare_user_data))
+	{
+		printf("Sensor prepare failed\n");
+		return false;
+	}
+
+	return true;
+}
+
+
+bool acc_sensor_recovery_measure(acc_sensor_recovery_t *recovery)
+{
+	acc_sensor_recovery_fault_t fault;
+	acc_sensor_recovery_step_t  first_step = ACC_SENSOR_RECOVERY_STEP_RESET;
+	acc_sensor_recovery_step_t  recovered_by;
+
+	// Read a new frame after each recovery so that the caller always gets a frame to process.
+	// A fault that comes back was not cleared by the step that recovered from it, so the
+	// next recovery starts at the step after it. After a power cycle there is no step left.
+	while (!measure(recovery, &fault))
+	{
+		if (!recover(recovery, fault, first_step, &recovered_by))
+		{
+			return false;
+		}
+
+		first_step = (acc_sensor_recovery_step_t)(recovered_by + 1U);
+	}
+
+	return true;
+}
+
+
+bool acc_sensor_recovery_recalibrate(acc_sensor_recovery_t *recovery)
+{
+	if (calibrate(recovery) &&
+	    recovery->prepare(recovery->sensor, &recovery->cal_result, recovery->buffer, recovery->buffer_size, recovery->prepare_user_data))
+	{
+		return true;
+	}
+
+	acc_sensor_recovery_step_t recovered_by;
+
+	return recover(recovery, ACC_SENSOR_RECOVERY_FAULT_CALIBRATION, ACC_SENSOR_RECOVERY_STEP_RECALIBRATE, &recovered_by);
+}
+
+
+bool acc_sensor_recovery_prepare(acc_sensor_recovery_t *recovery)
+{
+	// The calibration does not depend on the configuration, so it is reused
+	return recovery->prepare(recovery->sensor, &recovery->cal_result, recovery->buffer, recovery->buffer_size, recovery->prepare_user_data);
+}
+
+
+void acc_sensor_recovery_stop(acc_sensor_recovery_t *recovery)
+{
+	acc_hal_integration_sensor_disable(recovery->sensor_id);
+	acc_hal_integration_sensor_supply_off(recovery->sensor_id);
+
+	if (recovery->sensor != NULL)
+	{
+		acc_sensor_destroy(recovery->sensor);
+		recovery->sensor = NULL;
+	}
+}
+
+
+void acc_sensor_recovery_print_stats(const acc_sensor_recovery_t *recovery)
+{
+	const acc_sensor_recovery_stats_t *stats      = &recovery->stats;
+	uint32_t                           recoveries = 0U;
+
+	printf("Sensor faults:");
+	for (uint16_t i = 0U; i < ACC_SENSOR_RECOVERY_NUM_FAULTS; i++)
+	{
+		printf(" %s %" PRIu32 "%s", fault_names[i], stats->faults[i], (i + 1U) < ACC_SENSOR_RECOVERY_NUM_FAULTS ? "," : "\n");
+	}
+
+	printf("Recovered by:");
+	for (uint16_t i = 0U; i < ACC_SENSOR_RECOVERY_NUM_STEPS; i++)
+	{
+		printf(" %s %" PRIu32 ",", step_names[i], stats->recoveries[i]);
+		recoveries += stats->recoveries[i];
+	}
+
+	printf(" failed %" PRIu32 "\n", stats->failed_recoveries);
+
+	if (recoveries > 0U)
+	{
+		printf("Recovery time: last %" PRIu32 " us, max %" PRIu32 " us, mean %" PRIu32 " us\n",
+		       stats->last_duration_us,
+		       stats->max_duration_us,
+		       (uint32_t)(stats->total_duration_us / recoveries));
+	}
+}
+
+
+/**
+ * @brief Run the recovery steps from first_step until one succeeds
+ *
+ * @param[out] recovered_by The step that succeeded, only set if true is returned
+ */
+static bool recover(acc_sensor_recovery_t       *recovery,
+                    acc_sensor_recovery_fault_t  fault,
+                    acc_sensor_recovery_step_t   first_step,
+                    acc_sensor_recovery_step_t  *recovered_by)
+{
+	uint32_t start_us = acc_integration_get_time_us();
+	bool     status   = false;
+
+	recovery->stats.faults[fault]++;
+
+	printf("Sensor %s fault, recovering ...\n", fault_names[fault]);
+
+	for (uint16_t step = (uint16_t)first_step; !status && (step < ACC_SENSOR_RECOVERY_NUM_STEPS); step++)
+	{
+		status = run_step(recovery, (acc_sensor_recovery_step_t)step);
+
+		if (status)
+		{
+			uint32_t duration_us = acc_integration_get_time_us() - start_us;
+
+			*recovered_by = (acc_sensor_recovery_step_t)step;
+
+			recovery->stats.recoveries[step]++;
+			recovery->stats.last_duration_us = duration_us;
+			recovery->stats.total_duration_us += duration_us;
+
+			if (duration_us > recovery->stats.max_duration_us)
+			{
+				recovery->stats.max_duration_us = duration_us;
+			}
+
+			printf("Sensor recovered by %s in %" PRIu32 " us\n", step_names[step], duration_us);
+		}
+	}
+
+	if (!status)
+	{
+		recovery->stats.failed_recoveries++;
+		printf("Sensor recovery failed\n");
+	}
+
+	return status;
+}
+
+
+static bool run_step(acc_sensor_recovery_t *recovery, acc_sensor_recovery_step_t step)
+{
+	switch (step)
+	{
+		case ACC_SENSOR_RECOVERY_STEP_RESET:
+			// The calibration is still valid, only the sensor state is lost
+			acc_hal_integration_sensor_disable(recovery->sensor_id);
+			acc_hal_integration_sensor_enable(recovery->sensor_id);
+			break;
+		case ACC_SENSOR_RECOVERY_STEP_RECALIBRATE:
+			if (!calibrate(recovery))
+			{
+				return false;
+			}
+
+			break;
+		case ACC_SENSOR_RECOVERY_STEP_POWER_CYCLE:
+			if (recovery->sensor != NULL)
+			{
+				acc_sensor_destroy(recovery->sensor);
+			}
+
+			acc_hal_integration_sensor_disable(recovery->sensor_id);
+			acc_hal_integration_sensor_supply_off(recovery->sensor_id);
+			acc_hal_integration_sensor_supply_on(recovery->sensor_id);
+			acc_hal_integration_sensor_enable(recovery->sensor_id);
+
+			recovery->sensor = acc_sensor_create(recovery->sensor_id);
+			if ((recovery->sensor == NULL) || !calibrate(recovery))
+			{
+				return false;
+			}
+
+			break;
+		default:
+			return false;
+	}
+
+	return recovery->prepare(recovery->sensor, &recovery->cal_result, recovery->buffer, recovery->buffer_size, recovery->prepare_user_data);
+}
+
+
+static bool calibrate(acc_sensor_recovery_t *recovery)
+{
+	bool status       = false;
+	bool cal_complete = false;
+
+	// Random disturbances may cause the calibration to fail. At failure, retry at least once.
+	for (uint16_t i = 0U; !status && (i <= CALIBRATION_RETRIES); i++)
+	{
+		// Reset sensor before calibration by disabling/enabling it
+		acc_hal_integration_sensor_disable(recovery->sensor_id);
+		acc_hal_integration_sensor_enable(recovery->sensor_id);
+
+		do
+		{
+			status = acc_sensor_calibrate(recovery->sensor, &cal_complete, &recovery->cal_result, recovery->buffer, recovery->buffer_size);
+
+			if (status && !cal_complete)
+			{
+				status = wait_for_interrupt(recovery);
+			}
+		} while (status && !cal_complete);
+	}
+
+	if (status)
+	{
+		// Reset sensor after calibration by disabling/enabling it
+		acc_hal_integration_sensor_disable(recovery->sensor_id);
+		acc_hal_integration_sensor_enable(recovery->sensor_id);
+	}
+	else
+	{
+		printf("acc_sensor_calibrate() failed\n");
+		acc_sensor_status(recovery->sensor);
+	}
+
+	return status;
+}
+
+
+static bool measure(acc_sensor_recovery_t *recovery, acc_sensor_recovery_fault_t *fault)
+{
+	if (!acc_sensor_measure(recovery->sensor))
+	{
+		printf("acc_sensor_measure failed\n");
+		acc_sensor_status(recovery->sensor);
+		*fault = ACC_SENSOR_RECOVERY_FAULT_MEASURE;
+		return false;
+	}
+
+	if (!wait_for_interrupt(recovery))
+	{
+		printf("Sensor interrupt timeout\n");
+		acc_sensor_status(recovery->sensor);
+		*fault = ACC_SENSOR_RECOVERY_FAULT_INTERRUPT_TIMEOUT;
+		return false;
+	}
+
+	if (!acc_sensor_read(recovery->sensor, recovery->buffer, recovery->buffer_size))
+	{
+		printf("acc_sensor_read() failed\n");
+		acc_sensor_status(recovery->sensor);
+		*fault = ACC_SENSOR_RECOVERY_FAULT_READ;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool wait_for_interrupt(acc_sensor_recovery_t *recovery)
+{
+	if (recovery->wait_for_interrupt != NULL)
+	{
+		return recovery->wait_for_interrupt(recovery->sensor_id, recovery->timeout_ms);
+	}
+
+	return acc_hal_integration_wait_for_sensor_interrupt(recovery->sensor_id, recovery->timeout_ms);
+}
@@ -0,0 +1,299 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "acc_snapshot.h"
+
+#define FNV_PRIME (16777619U)
+
+#define MAGIC_OFFSET            (0U)
+#define VERSION_OFFSET          (4U)
+#define HEADER_SIZE_OFFSET      (6U)
+#define PAYLOAD_SIZE_OFFSET     (8U)
+#define CONFIG_HASH_OFFSET      (12U)
+#define TIMESTAMP_OFFSET        (16U)
+#define PAYLOAD_CHECKSUM_OFFSET (24U)
+#define HEADER_CHECKSUM_OFFSET  (28U)
+
+#define MAX_PATH_LENGTH (256U)
+
+static const char *status_strs[ACC_SNAPSHOT_STATUS_NUM_STATUSES] = {
+	"ok",
+	"invalid",
+	"other version",
+	"other configuration",
+	"stale",
+};
+
+
+static void put(uint8_t *buffer, uint32_t offset, const void *data, uint32_t size);
+
+static void get(const uint8_t *buffer, uint32_t offset, void *data, uint32_t size);
+
+
+uint32_t acc_snapshot_hash(uint32_t hash, const void *data, uint32_t size)
+{
+	const uint8_t *bytes = data;
+
+	for (uint32_t i = 0U; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+
+void acc_snapshot_begin_write(acc_snapshot_t *snapshot, void *buffer, uint32_t buffer_size)
+{
+	snapshot->write_buffer = buffer;
+	snapshot->read_buffer  = NULL;
+	snapshot->buffer_size  = buffer_size;
+	snapshot->offset       = ACC_SNAPSHOT_HEADER_SIZE;
+	snapshot->ok           = (buffer == NULL) || (buffer_size >= ACC_SNAPSHOT_HEADER_SIZE);
+}
+
+
+void acc_snapshot_write(acc_snapshot_t *snapshot, const void *data, uint32_t size)
+{
+	if (snapshot->write_buffer != NULL)
+	{
+		if (snapshot->ok && (size <= (snapshot->buffer_size - snapshot->offset)))
+		{
+			put(snapshot->write_buffer, snapshot->offset, data, size);
+		}
+		else
+		{
+			snapshot->ok = false;
+		}
+	}
+
+	snapshot->offset += size;
+}
+
+
+bool acc_snapshot_end_write(acc_snapshot_t *snapshot,
+                            uint32_t        magic,
+                            uint16_t        version,
+                            uint32_t        config_hash,
+                            uint64_t        timestamp_ms,
+                            uint32_t       *snapshot_size)
+{
+	*snapshot_size = snapshot->offset;
+
+	if ((snapshot->write_buffer == NULL) || !snapshot->ok)
+	{
+		return snapshot->ok;
+	}
+
+	uint8_t *buffer       = snapshot->write_buffer;
+	uint16_t header_size  = ACC_SNAPSHOT_HEADER_SIZE;
+	uint32_t payload_size = snapshot->offset - ACC_SNAPSHOT_HEADER_SIZE;
+	uint32_t checksum     = acc_snapshot_hash(ACC_SNAPSHOT_HASH_INIT, &buffer[ACC_SNAPSHOT_HEADER_SIZE], payload_size);
+
+	put(buffer, MAGIC_OFFSET, &magic, sizeof(magic));
+	put(buffer, VERSION_OFFSET, &version, sizeof(version));
+	put(buffer, HEADER_SIZE_OFFSET, &header_size, sizeof(header_size));
+	put(buffer, PAYLOAD_SIZE_OFFSET, &payload_size, sizeof(payload_size));
+	put(buffer, CONFIG_HASH_OFFSET, &config_hash, sizeof(config_hash));
+	put(buffer, TIMESTAMP_OFFSET, &timestamp_ms, sizeof(timestamp_ms));
+	put(buffer, PAYLOAD_CHECKSUM_OFFSET, &checksum, sizeof(checksum));
+
+	uint32_t header_checksum = acc_snapshot_hash(ACC_SNAPSHOT_HASH_INIT, buffer, HEADER_CHECKSUM_OFFSET);
+
+	put(buffer, HEADER_CHECKSUM_OFFSET, &header_checksum, sizeof(header_checksum));
+
+	return true;
+}
+
+
+acc_snapshot_status_t acc_snapshot_begin_read(acc_snapshot_t *snapshot,
+                                              const void     *buffer,
+                                              uint32_t        size,
+                                              uint32_t        magic,
+                                              uint16_t        version,
+                                              uint32_t        config_hash,
+                                              uint64_t        now_ms,
+                                              uint32_t        max_age_ms)
+{
+	const uint8_t *bytes = buffer;
+
+	snapshot->write_buffer = NULL;
+	snapshot->read_buffer  = bytes;
+	snapshot->buffer_size  = 0U;
+	snapshot->offset       = ACC_SNAPSHOT_HEADER_SIZE;
+	snapshot->ok           = false;
+
+	if (size < ACC_SNAPSHOT_HEADER_SIZE)
+	{
+		return ACC_SNAPSHOT_STATUS_INVALID;
+	}
+
+	uint32_t stored_magic;
+	uint16_t stored_version;
+	uint16_t header_size;
+	uint32_t payload_size;
+	uint32_t stored_config_hash;
+	uint64_t timestamp_ms;
+	uint32_t checksum;
+	uint32_t header_checksum;
+
+	get(bytes, MAGIC_OFFSET, &stored_magic, sizeof(stored_magic));
+	get(bytes, VERSION_OFFSET, &stored_version, sizeof(stored_version));
+	get(bytes, HEADER_SIZE_OFFSET, &header_size, sizeof(header_size));
+	get(bytes, PAYLOAD_SIZE_OFFSET, &payload_size, sizeof(payload_size));
+	get(bytes, CONFIG_HASH_OFFSET, &stored_config_hash, sizeof(stored_config_hash));
+	get(bytes, TIMESTAMP_OFFSET, &timestamp_ms, sizeof(timestamp_ms));
+	get(bytes, PAYLOAD_CHECKSUM_OFFSET, &checksum, sizeof(checksum));
+	get(bytes, HEADER_CHECKSUM_OFFSET, &header_checksum, sizeof(header_checksum));
+
+	if ((stored_magic != magic) || (header_size != ACC_SNAPSHOT_HEADER_SIZE) ||
+	    (header_checksum != acc_snapshot_hash(ACC_SNAPSHOT_HASH_INIT, bytes, HEADER_CHECKSUM_OFFSET)) ||
+	    (payload_size != (size - ACC_SNAPSHOT_HEADER_SIZE)) ||
+	    (checksum != acc_snapshot_hash(ACC_SNAPSHOT_HASH_INIT, &bytes[ACC_SNAPSHOT_HEADER_SIZE], payload_size)))
+	{
+		return ACC_SNAPSHOT_STATUS_INVALID;
+	}
+
+	if (stored_version != version)
+	{
+		return ACC_SNAPSHOT_STATUS_VERSION;
+	}
+
+	if (stored_config_hash != config_hash)
+	{
+		return ACC_SNAPSHOT_STATUS_CONFIG;
+	}
+
+	// A snapshot from the future means that the clock has been set back, its age is unknown
+	if ((timestamp_ms > now_ms) || ((now_ms - timestamp_ms) > max_age_ms))
+	{
+		return ACC_SNAPSHOT_STATUS_STALE;
+	}
+
+	snapshot->buffer_size = size;
+	snapshot->ok          = true;
+
+	return ACC_SNAPSHOT_STATUS_OK;
+}
+
+
+bool acc_snapshot_read(acc_snapshot_t *snapshot, void *data, uint32_t size)
+{
+	if (snapshot->ok && (size <= (snapshot->buffer_size - snapshot->offset)))
+	{
+		get(snapshot->read_buffer, snapshot->offset, data, size);
+		snapshot->offset += size;
+	}
+	else
+	{
+		snapshot->ok = false;
+	}
+
+	return snapshot->ok;
+}
+
+
+bool acc_snapshot_end_read(const acc_snapshot_t *snapshot)
+{
+	return snapshot->ok && (snapshot->offset == snapshot->buffer_size);
+}
+
+
+const char *acc_snapshot_status_str(acc_snapshot_status_t status)
+{
+	return (status < ACC_SNAPSHOT_STATUS_NUM_STATUSES) ? status_strs[status] : "unknown";
+}
+
+
+bool acc_snapshot_file_write(const char *path, const void *data, uint32_t size)
+{
+	char tmp_path[MAX_PATH_LENGTH];
+
+	int length = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+	if ((length < 0) || ((size_t)length >= sizeof(tmp_path)))
+	{
+		return false;
+	}
+
+	int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	const uint8_t *bytes   = data;
+	uint32_t       written = 0U;
+	bool           ok      = true;
+
+	while (ok && (written < size))
+	{
+		ssize_t result = write(fd, &bytes[written], size - written);
+
+		ok = result > 0;
+
+		if (ok)
+		{
+			written += (uint32_t)result;
+		}
+	}
+
+	// The data must be on disk before the rename makes it the snapshot
+	ok = ok && (fsync(fd) == 0);
+	ok = (close(fd) == 0) && ok;
+	ok = ok && (rename(tmp_path, path) == 0);
+
+	if (!ok)
+	{
+		(void)unlink(tmp_path);
+	}
+
+	return ok;
+}
+
+
+bool acc_snapshot_file_read(const char *path, void *buffer, uint32_t buffer_size, uint32_t *size)
+{
+	FILE *file = fopen(path, "rb");
+
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	size_t length = fread(buffer, 1U, buffer_size, file);
+
+	// A file that fills the buffer exactly is fine, one with more data than that is not
+	bool ok = (ferror(file) == 0) && ((length < buffer_size) || (fgetc(file) == EOF));
+
+	fclose(file);
+
+	*size = (uint32_t)length;
+
+	return ok;
+}
+
+
+static void put(uint8_t *buffer, uint32_t offset, const void *data, uint32_t size)
+{
+	memcpy(&buffer[offset], data, size);
+}
+
+
+static void get(const uint8_t *buffer, uint32_t offset, void *data, uint32_t size)
+{
+	memcpy(data, &buffer[offset], size);
+}
@@ -76,13 +76,13 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	uint32_t sweep_data_length   = control_helper_state.proc_meta.sweep_data_length;
-	uint32_t point_vector_length = SWEEPS_PER_FRAME;
+	uint32_t sweep_data_length = control_helper_state.proc_meta.sweep_data_length;
 
-	acc_vector_float_t *phase_spread = acc_vector_float_alloc(sweep_data_length);
-	acc_vector_iq_t    *point_vector = acc_vector_iq_alloc(point_vector_length);
+	acc_vector_float_t *phase_spread     = acc_vector_float_alloc(sweep_data_length);
+	acc_vector_float_t *coherent_mean    = acc_vector_float_alloc(sweep_data_length);
+	acc_vector_float_t *noncoherent_mean = acc_vector_float_alloc(sweep_data_length);
 
-	bool mem_ok = (phase_spread != NULL) && (point_vector != NULL);
+	bool mem_ok = (phase_spread != NULL) && (coherent_mean != NULL) && (noncoherent_mean != NULL);
 	if (!mem_ok)
 	{
 		printf("Memory allocation for vectors failed\n");
@@ -99,10 +99,15 @@ int main(int argc, char *argv[])
 			break;
 		}
 
+		// The coherent and noncoherent means of the sweeps of all points are calculated in one pass over the frame
+		acc_processing_helper_point_mean_amplitudes(control_helper_state.proc_result.frame,
+		                                            sweep_data_length,
+		                                            SWEEPS_PER_FRAME,
+		                                            coherent_mean,
+		                                            noncoherent_mean);
+
 		for (uint32_t p = 0U; p < sweep_data_length; p++)
 		{
-			acc_get_iq_point_vector(&control_helper_state, p, point_vector);
-
 			// The ratio of the coherent average to the noncoherent average is used to determine
 			// the amount of phase spread. When the phases of the values in the array are similar,
 			// the coherent average approaches the noncoherent average. However, if the phase
@@ -116,10 +121,7 @@ int main(int argc, char *argv[])
 
 			// We set the phase spread to be 1 minus the ratio.
 
-			float coherent_mean    = acc_vector_iq_coherent_mean_amplitude(point_vector);
-			float noncoherent_mean = acc_vector_iq_noncoherent_mean_amplitude(point_vector);
-
-			phase_spread->data[p] = 1 - coherent_mean / noncoherent_mean;
+			phase_spread->data[p] = 1 - coherent_mean->data[p] / noncoherent_mean->data[p];
 		}
 
 		// Print a line with a dot or star for each distance point. A star ('*') means that there
@@ -134,7 +136,8 @@ int main(int argc, char *argv[])
 	}
 
 clean_up:
-	acc_vector_iq_free(point_vector);
+	acc_vector_float_free(noncoherent_mean);
+	acc_vector_float_free(coherent_mean);
 	acc_vector_float_free(phase_spread);
 	acc_control_helper_destroy(&control_helper_state);
 
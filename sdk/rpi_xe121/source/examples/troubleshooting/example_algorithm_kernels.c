@@ -0,0 +1,245 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "acc_algorithm.h"
+#include "acc_algorithm_kernels.h"
+
+/** \example example_algorithm_kernels.c
+ * @brief This is an example that verifies the algorithm kernel variants on the current CPU
+ * @n
+ * The example executes as follows:
+ *   - List the kernel variants available on the CPU
+ *   - Run every kernel of every available variant on the same input as the scalar kernels
+ *   - Check that the output is bit-identical to the scalar output, and print the largest error
+ *   - Run the FFT and filter functions of acc_algorithm with every variant selected
+ *   - Print the time per call for each variant
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host algorithm_host
+ */
+
+#define VECTOR_LENGTH   (509U)
+#define FFT_LENGTH      (512U)
+#define FFT_SHIFT       (9U)
+#define FILTER_LENGTH   (100U)
+#define TIMING_ROUNDS   (2000U)
+
+typedef struct
+{
+	float complex x[VECTOR_LENGTH];
+	float complex y[VECTOR_LENGTH];
+	float complex acc[VECTOR_LENGTH];
+	float         out[VECTOR_LENGTH];
+	float         real[VECTOR_LENGTH];
+	int16_t       iq[2U * VECTOR_LENGTH];
+	int32_t       iq_sum[2U * VECTOR_LENGTH];
+	float complex fft_out[FFT_LENGTH];
+	float complex filter_out[FILTER_LENGTH];
+} kernel_buffers_t;
+
+static kernel_buffers_t reference;
+static kernel_buffers_t candidate;
+
+static void fill_input(kernel_buffers_t *buffers);
+
+static void run_kernels(const acc_algorithm_kernels_t *kernels, kernel_buffers_t *buffers);
+
+static void run_algorithms(kernel_buffers_t *buffers);
+
+static float max_error_f32(const float *a, const float *b, uint16_t length);
+
+static float max_error_f32_complex(const float complex *a, const float complex *b, uint16_t length);
+
+static float time_us_per_round(acc_algorithm_kernels_variant_t variant);
+
+static double now_us(void);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	bool all_ok = true;
+
+	acc_algorithm_kernels_variant_t default_variant = acc_algorithm_kernels_get_selected_variant();
+	const acc_algorithm_kernels_t  *scalar          = acc_algorithm_kernels_get_variant(ACC_ALGORITHM_KERNELS_SCALAR);
+
+	fill_input(&reference);
+	run_kernels(scalar, &reference);
+
+	(void)acc_algorithm_kernels_select(ACC_ALGORITHM_KERNELS_SCALAR);
+	run_algorithms(&reference);
+
+	for (uint16_t v = 0U; v < ACC_ALGORITHM_KERNELS_NUM_VARIANTS; v++)
+	{
+		acc_algorithm_kernels_variant_t variant = (acc_algorithm_kernels_variant_t)v;
+		const acc_algorithm_kernels_t  *kernels = acc_algorithm_kernels_get_variant(variant);
+
+		if (kernels == NULL)
+		{
+			printf("%-6s: not available\n", acc_algorithm_kernels_variant_name(variant));
+			continue;
+		}
+
+		fill_input(&candidate);
+		run_kernels(kernels, &candidate);
+
+		float kernel_error = max_error_f32_complex(reference.x, candidate.x, VECTOR_LENGTH);
+		kernel_error       = fmaxf(kernel_error, max_error_f32(reference.real, candidate.real, VECTOR_LENGTH));
+		kernel_error       = fmaxf(kernel_error, max_error_f32(reference.out, candidate.out, VECTOR_LENGTH));
+
+		bool sums_equal = memcmp(reference.iq_sum, candidate.iq_sum, sizeof(reference.iq_sum)) == 0;
+
+		(void)acc_algorithm_kernels_select(variant);
+		run_algorithms(&candidate);
+
+		float fft_error = max_error_f32_complex(reference.fft_out, candidate.fft_out, FFT_LENGTH);
+		fft_error       = fmaxf(fft_error, max_error_f32_complex(reference.filter_out, candidate.filter_out, FILTER_LENGTH));
+
+		// The variants must not change the results, not even in the last bit
+		bool ok = (kernel_error == 0.0f) && sums_equal && (fft_error == 0.0f);
+
+		printf("%-6s: %s, max error kernels %g, fft/filter %g, %.2f us per round\n",
+		       acc_algorithm_kernels_variant_name(variant),
+		       ok ? "OK" : "FAILED",
+		       (double)kernel_error,
+		       (double)fft_error,
+		       (double)time_us_per_round(variant));
+
+		all_ok = all_ok && ok;
+	}
+
+	printf("Selected variant: %s\n", acc_algorithm_kernels_variant_name(default_variant));
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void fill_input(kernel_buffers_t *buffers)
+{
+	// Deterministic input in the int16 range of the sensor data, including zeros and axis values
+	uint32_t seed = 12345U;
+
+	for (uint16_t i = 0U; i < VECTOR_LENGTH; i++)
+	{
+		float values[4];
+
+		for (uint16_t j = 0U; j < 4U; j++)
+		{
+			seed      = (seed * 1103515245U) + 12345U;
+			values[j] = (float)((int32_t)((seed >> 16) & 0xffffU) - 32768) / 16.0f;
+		}
+
+		buffers->x[i]    = values[0] + (values[1] * I);
+		buffers->y[i]    = values[2] + (values[3] * I);
+		buffers->acc[i]  = values[1] + (values[2] * I);
+		buffers->real[i] = values[3];
+		buffers->out[i]  = values[0];
+
+		buffers->iq[2U * i]            = (int16_t)(values[1] * 16.0f);
+		buffers->iq[(2U * i) + 1U]     = (int16_t)(values[2] * 16.0f);
+		buffers->iq_sum[2U * i]        = (int32_t)i;
+		buffers->iq_sum[(2U * i) + 1U] = -(int32_t)i;
+	}
+
+	buffers->x[0] = 0.0f;
+	buffers->x[1] = -1.0f;
+	buffers->x[2] = 1.0f * I;
+	buffers->x[3] = -1.0f * I;
+
+	for (uint16_t i = 0U; i < FFT_LENGTH; i++)
+	{
+		buffers->fft_out[i] = 0.0f;
+	}
+}
+
+static void run_kernels(const acc_algorithm_kernels_t *kernels, kernel_buffers_t *buffers)
+{
+	float complex twiddles[VECTOR_LENGTH / 2U];
+
+	for (uint16_t i = 0U; i < (VECTOR_LENGTH / 2U); i++)
+	{
+		twiddles[i] = cexpf(-I * (float)M_PI * (float)i / (float)(VECTOR_LENGTH / 2U));
+	}
+
+	kernels->scaled_add_f32(buffers->real, (const float *)buffers->y, 0.25f, VECTOR_LENGTH);
+	kernels->fft_butterflies(buffers->x, VECTOR_LENGTH / 2U, twiddles, VECTOR_LENGTH / 2U, 1U);
+	kernels->accumulate_iq_i16(buffers->iq, buffers->iq_sum, buffers->out, VECTOR_LENGTH);
+}
+
+static void run_algorithms(kernel_buffers_t *buffers)
+{
+	const float b[5] = {0.1f, 0.2f, 0.3f, 0.2f, 0.1f};
+	const float a[4] = {-0.5f, 0.25f, -0.125f, 0.0625f};
+
+	acc_algorithm_fft(buffers->acc, VECTOR_LENGTH, FFT_SHIFT, buffers->fft_out);
+	acc_algorithm_apply_filter_f32_complex(a, buffers->acc, 4U, FILTER_LENGTH, b, buffers->x, 5U, FILTER_LENGTH, buffers->filter_out, FILTER_LENGTH);
+}
+
+static float max_error_f32(const float *a, const float *b, uint16_t length)
+{
+	float max_error = 0.0f;
+
+	for (uint16_t i = 0U; i < length; i++)
+	{
+		float error = fabsf(a[i] - b[i]) / fmaxf(1.0f, fabsf(a[i]));
+
+		max_error = fmaxf(max_error, error);
+	}
+
+	return max_error;
+}
+
+static float max_error_f32_complex(const float complex *a, const float complex *b, uint16_t length)
+{
+	float max_error = 0.0f;
+
+	for (uint16_t i = 0U; i < length; i++)
+	{
+		float error = cabsf(a[i] - b[i]) / fmaxf(1.0f, cabsf(a[i]));
+
+		max_error = fmaxf(max_error, error);
+	}
+
+	return max_error;
+}
+
+static float time_us_per_round(acc_algorithm_kernels_variant_t variant)
+{
+	const acc_algorithm_kernels_t *kernels = acc_algorithm_kernels_get_variant(variant);
+
+	(void)acc_algorithm_kernels_select(variant);
+
+	double start = now_us();
+
+	for (uint16_t i = 0U; i < TIMING_ROUNDS; i++)
+	{
+		fill_input(&candidate);
+		run_kernels(kernels, &candidate);
+		run_algorithms(&candidate);
+	}
+
+	return (float)((now_us() - start) / (double)TIMING_ROUNDS);
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
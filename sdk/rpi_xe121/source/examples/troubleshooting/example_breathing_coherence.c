@@ -0,0 +1,355 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "acc_algorithm.h"
+
+/** \example example_breathing_coherence.c
+ * @brief This is an example that compares the breathing rate accuracy of the weighted spectrum sum and
+ *        the coherent combination of the range bins, as used by ref_app_breathing
+ * @n
+ * The example executes as follows:
+ *   - Generate synthetic band-passed breathing phase series for a few range bins, with phase noise
+ *     that grows as the bin amplitude falls and, in the cluttered scene, a strong bin with noise only
+ *   - Estimate the breathing rate from the amplitude weighted sum of the spectra of all bins, with one
+ *     FFT per bin, as ref_app_breathing did
+ *   - Estimate it from the spectrum of the coherent combination of the bins, with one FFT
+ *   - Print the mean absolute error, the share of estimates within 2 breaths per minute and the time
+ *     per estimate of both, for a range of time series lengths
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host breathing_coherence_host
+ */
+
+#define FRAME_RATE        (10.0f)
+#define LOWEST_RATE_BPM   (6.0f)
+#define HIGHEST_RATE_BPM  (60.0f)
+#define NUM_BINS          (5U)
+#define SETTLE_FRAMES     (100U)
+#define MAX_SERIES_LENGTH (256U)
+#define TRIALS            (300U)
+#define MIN_COHERENCE     (0.3f)
+#define GOOD_ERROR_BPM    (2.0f)
+
+#define B_ANGLE_LENGTH (5U)
+#define A_ANGLE_LENGTH (4U)
+
+typedef struct
+{
+	const char *name;
+	// Amplitude of each bin, the phase noise is inversely proportional to it
+	float amplitude[NUM_BINS];
+	// Whether a bin sees the breathing motion, the others only see noise
+	bool breathing[NUM_BINS];
+	// Standard deviation of the extra noise of the bins that do not see the breathing motion
+	float clutter_noise;
+} scene_t;
+
+static const scene_t scenes[] = {
+	{"clean", {0.5f, 1.0f, 0.7f, 0.35f, 0.25f}, {true, true, true, true, true}, 0.0f},
+	{"clutter", {0.5f, 1.0f, 0.7f, 0.35f, 3.0f}, {true, true, true, true, false}, 3.0f},
+};
+
+static const uint16_t series_lengths_s[] = {5U, 8U, 10U, 15U, 20U};
+
+#define NBR_SCENES        (sizeof(scenes) / sizeof(scenes[0]))
+#define NBR_SERIES_LENGTH (sizeof(series_lengths_s) / sizeof(series_lengths_s[0]))
+
+typedef struct
+{
+	float    abs_error_sum;
+	uint16_t good;
+	double   time_us;
+} method_stats_t;
+
+static uint32_t seed = 12345U;
+
+static bool run_scene(const scene_t *scene, uint16_t series_length_s, float *coherent_error, float *weighted_error);
+
+static void generate_series(const scene_t *scene, float rate_bpm, uint16_t length, float *bins, float *matrix);
+
+static float estimate_weighted(const float *matrix, const float *amplitude, uint16_t length, uint16_t length_shift);
+
+static float estimate_coherent(const float *matrix, const float *amplitude, uint16_t length, uint16_t length_shift);
+
+static float peak_rate(const float *psd, uint16_t psd_length, float freq_delta);
+
+static float uniform(void);
+
+static float gaussian(void);
+
+static double now_us(void);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	bool all_ok = true;
+
+	printf("Mean absolute error, share of estimates within %.0f bpm and time per estimate, %u trials\n",
+	       (double)GOOD_ERROR_BPM,
+	       (unsigned int)TRIALS);
+
+	for (uint16_t s = 0U; s < NBR_SCENES; s++)
+	{
+		float coherent_error[NBR_SERIES_LENGTH];
+		float weighted_error[NBR_SERIES_LENGTH];
+
+		for (uint16_t l = 0U; l < NBR_SERIES_LENGTH; l++)
+		{
+			all_ok = run_scene(&scenes[s], series_lengths_s[l], &coherent_error[l], &weighted_error[l]) && all_ok;
+		}
+
+		// The coherent combination should need a shorter series for the accuracy of the full weighted one
+		uint16_t longest  = NBR_SERIES_LENGTH - 1U;
+		uint16_t shortest = longest;
+
+		while ((shortest > 0U) && (coherent_error[shortest - 1U] <= weighted_error[longest]))
+		{
+			shortest--;
+		}
+
+		printf("%-7s: coherent %2u s is as accurate as weighted %2u s\n",
+		       scenes[s].name,
+		       (unsigned int)series_lengths_s[shortest],
+		       (unsigned int)series_lengths_s[longest]);
+	}
+
+	printf("%s\n", all_ok ? "OK" : "FAILED");
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool run_scene(const scene_t *scene, uint16_t series_length_s, float *coherent_error, float *weighted_error)
+{
+	uint16_t length       = (uint16_t)(series_length_s * FRAME_RATE);
+	uint16_t length_shift = 0U;
+
+	while ((1U << length_shift) < length)
+	{
+		length_shift++;
+	}
+
+	float *bins   = malloc((SETTLE_FRAMES + length) * NUM_BINS * sizeof(*bins));
+	float *matrix = malloc((SETTLE_FRAMES + length) * NUM_BINS * sizeof(*matrix));
+
+	if ((bins == NULL) || (matrix == NULL))
+	{
+		printf("Memory allocation failed\n");
+		free(bins);
+		free(matrix);
+		return false;
+	}
+
+	method_stats_t coherent = {0};
+	method_stats_t weighted = {0};
+
+	for (uint16_t trial = 0U; trial < TRIALS; trial++)
+	{
+		float rate_bpm = 10.0f + (30.0f * uniform());
+
+		generate_series(scene, rate_bpm, SETTLE_FRAMES + length, bins, matrix);
+
+		const float *series = &matrix[SETTLE_FRAMES * NUM_BINS];
+
+		double start        = now_us();
+		float  weighted_bpm = estimate_weighted(series, scene->amplitude, length, length_shift);
+		weighted.time_us += now_us() - start;
+
+		start              = now_us();
+		float coherent_bpm = estimate_coherent(series, scene->amplitude, length, length_shift);
+		coherent.time_us += now_us() - start;
+
+		weighted.abs_error_sum += fabsf(weighted_bpm - rate_bpm);
+		weighted.good          += (fabsf(weighted_bpm - rate_bpm) <= GOOD_ERROR_BPM) ? 1U : 0U;
+		coherent.abs_error_sum += fabsf(coherent_bpm - rate_bpm);
+		coherent.good          += (fabsf(coherent_bpm - rate_bpm) <= GOOD_ERROR_BPM) ? 1U : 0U;
+	}
+
+	free(bins);
+	free(matrix);
+
+	*coherent_error = coherent.abs_error_sum / (float)TRIALS;
+	*weighted_error = weighted.abs_error_sum / (float)TRIALS;
+
+	// The combination may not lose accuracy anywhere, beyond a margin well below the resolution of the spectrum
+	bool ok = *coherent_error <= ((*weighted_error * 1.1f) + 0.05f);
+
+	printf("%-7s %2u s: weighted %5.2f bpm, %3u %% good, %6.1f us, coherent %5.2f bpm, %3u %% good, %6.1f us: %s\n",
+	       scene->name,
+	       (unsigned int)series_length_s,
+	       (double)*weighted_error,
+	       (unsigned int)(100U * weighted.good / TRIALS),
+	       weighted.time_us / TRIALS,
+	       (double)*coherent_error,
+	       (unsigned int)(100U * coherent.good / TRIALS),
+	       coherent.time_us / TRIALS,
+	       ok ? "OK" : "FAILED");
+
+	return ok;
+}
+
+static void generate_series(const scene_t *scene, float rate_bpm, uint16_t length, float *bins, float *matrix)
+{
+	float b[B_ANGLE_LENGTH];
+	float a[A_ANGLE_LENGTH];
+
+	acc_algorithm_butter_bandpass(LOWEST_RATE_BPM / 60.0f, HIGHEST_RATE_BPM / 60.0f, FRAME_RATE, b, a);
+
+	float phase = 2.0f * (float)M_PI * uniform();
+	float omega = 2.0f * (float)M_PI * rate_bpm / 60.0f / FRAME_RATE;
+
+	for (uint16_t c = 0U; c < NUM_BINS; c++)
+	{
+		// Bins on the other side of a strong reflector see the motion with the opposite sign
+		float sign        = (uniform() < 0.5f) ? -1.0f : 1.0f;
+		float phase_noise = 0.35f / scene->amplitude[c];
+
+		for (uint16_t r = 0U; r < length; r++)
+		{
+			float value = phase_noise * gaussian();
+
+			if (scene->breathing[c])
+			{
+				value += sign * sinf((omega * (float)r) + phase);
+			}
+			else
+			{
+				value += scene->clutter_noise * gaussian();
+			}
+
+			bins[(c * length) + r] = value;
+		}
+	}
+
+	// Band-pass every bin as ref_app_breathing does with the unwrapped phase, then store them as its
+	// breathing motion buffer, one column per bin
+	acc_algorithm_lfilter_matrix(b, a, bins, NUM_BINS, length);
+
+	for (uint16_t r = 0U; r < length; r++)
+	{
+		for (uint16_t c = 0U; c < NUM_BINS; c++)
+		{
+			matrix[(r * NUM_BINS) + c] = bins[(c * length) + r];
+		}
+	}
+}
+
+static float estimate_weighted(const float *matrix, const float *amplitude, uint16_t length, uint16_t length_shift)
+{
+	static float         hamming[MAX_SERIES_LENGTH];
+	static float         windowed[MAX_SERIES_LENGTH * NUM_BINS];
+	static float complex spectrum[((MAX_SERIES_LENGTH / 2U) + 1U) * NUM_BINS];
+	static float         psd[(MAX_SERIES_LENGTH / 2U) + 1U];
+
+	uint16_t psd_length    = (uint16_t)((1U << length_shift) / 2U) + 1U;
+	float    amplitude_sum = 0.0f;
+
+	acc_algorithm_hamming(length, hamming);
+
+	for (uint16_t r = 0U; r < length; r++)
+	{
+		for (uint16_t c = 0U; c < NUM_BINS; c++)
+		{
+			windowed[(r * NUM_BINS) + c] = matrix[(r * NUM_BINS) + c] * hamming[r];
+		}
+	}
+
+	for (uint16_t c = 0U; c < NUM_BINS; c++)
+	{
+		amplitude_sum += amplitude[c];
+	}
+
+	acc_algorithm_rfft_matrix(windowed, length, NUM_BINS, length_shift, spectrum, 0U);
+
+	for (uint16_t r = 0U; r < psd_length; r++)
+	{
+		float sum_psd = 0.0f;
+
+		for (uint16_t c = 0U; c < NUM_BINS; c++)
+		{
+			sum_psd += cabsf(spectrum[(r * NUM_BINS) + c]) * amplitude[c];
+		}
+
+		psd[r] = sum_psd / amplitude_sum;
+	}
+
+	return peak_rate(psd, psd_length, acc_algorithm_fftfreq_delta(1U << length_shift, 1.0f / FRAME_RATE));
+}
+
+static float estimate_coherent(const float *matrix, const float *amplitude, uint16_t length, uint16_t length_shift)
+{
+	static float         hamming[MAX_SERIES_LENGTH];
+	static float         combined[MAX_SERIES_LENGTH];
+	static float         coherence[NUM_BINS];
+	static float complex spectrum[(MAX_SERIES_LENGTH / 2U) + 1U];
+	static float         psd[(MAX_SERIES_LENGTH / 2U) + 1U];
+
+	uint16_t psd_length = (uint16_t)((1U << length_shift) / 2U) + 1U;
+
+	acc_algorithm_hamming(length, hamming);
+	acc_algorithm_coherent_combine(matrix, length, NUM_BINS, amplitude, MIN_COHERENCE, coherence, combined);
+
+	for (uint16_t r = 0U; r < length; r++)
+	{
+		combined[r] *= hamming[r];
+	}
+
+	acc_algorithm_rfft(combined, length, length_shift, spectrum);
+
+	for (uint16_t r = 0U; r < psd_length; r++)
+	{
+		psd[r] = cabsf(spectrum[r]);
+	}
+
+	return peak_rate(psd, psd_length, acc_algorithm_fftfreq_delta(1U << length_shift, 1.0f / FRAME_RATE));
+}
+
+static float peak_rate(const float *psd, uint16_t psd_length, float freq_delta)
+{
+	uint16_t peak_loc = acc_algorithm_argmax(psd, psd_length);
+
+	if ((peak_loc == 0U) || (peak_loc >= (psd_length - 1U)))
+	{
+		return (float)peak_loc * freq_delta * 60.0f;
+	}
+
+	return acc_algorithm_interpolate_peaks_equidistant(psd, 0.0f, freq_delta, peak_loc) * 60.0f;
+}
+
+static float uniform(void)
+{
+	seed = (seed * 1103515245U) + 12345U;
+
+	return (float)((seed >> 8) & 0xffffU) / 65536.0f;
+}
+
+static float gaussian(void)
+{
+	float u1 = uniform() + (1.0f / 131072.0f);
+	float u2 = uniform();
+
+	return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
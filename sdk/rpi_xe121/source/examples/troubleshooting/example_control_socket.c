@@ -0,0 +1,413 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "acc_control_socket.h"
+#include "acc_integration.h"
+#include "acc_sensor_sim.h"
+
+/** \example example_control_socket.c
+ * @brief This is an example that reconfigures a running frame loop through a control socket,
+ *        the way ref_app_breathing_main does
+ * @n
+ * The example executes as follows:
+ *   - Run a frame loop against the sensor timing simulator, polling the control socket between frames
+ *   - From a client thread, send changes through the socket:
+ *     - Processing changes are applied in place, changes of the frame rate recreate the simulated
+ *       sensor, which is where the application prepares the sensor again
+ *     - Unknown parameters, invalid values and invalid configurations are rejected and leave the
+ *       configuration as it was
+ *     - Commands split over several writes, several commands in one write and too long commands
+ *   - Print the time to apply and the time between frames of each change
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host control_socket_host
+ */
+
+#define SENSOR_TIMEOUT_MS (1000U)
+#define REPLY_TIMEOUT_MS  (2000U)
+#define MAX_FRAMES        (2000U)
+
+#define MAX_TIME_SERIES_LENGTH (32768U)
+
+typedef enum
+{
+	PARAM_TIME_SERIES_LENGTH_S,
+	PARAM_USE_SOS_FILTERS,
+	PARAM_FRAME_RATE,
+	NUM_PARAMS,
+} param_t;
+
+static const acc_control_param_t params[NUM_PARAMS] = {
+	[PARAM_TIME_SERIES_LENGTH_S] = {"time_series_length_s", ACC_CONTROL_VALUE_U16, false},
+	[PARAM_USE_SOS_FILTERS]      = {"use_sos_filters", ACC_CONTROL_VALUE_BOOL, false},
+	[PARAM_FRAME_RATE]           = {"frame_rate", ACC_CONTROL_VALUE_FLOAT, true},
+};
+
+typedef struct
+{
+	const char *command;
+	const char *expected;
+} request_t;
+
+static const request_t requests[] = {
+	{"set time_series_length_s=30", "ok in_place"},
+	{"set use_sos_filters=true time_series_length_s=25", "ok in_place"},
+	{"set frame_rate=20", "ok in_place"},
+	{"set frame_rate=10", "ok prepared"},
+	{"set time_series_length_s=0", "error invalid configuration"},
+	{"set frame_rate=50 time_series_length_s=0", "error invalid configuration"},
+	{"set time_series_length_s=20", "ok in_place"},
+	{"set foo=1", "error unknown parameter foo"},
+	{"set frame_rate=abc", "error invalid value for frame_rate"},
+	{"set time_series_length_s=70000", "error invalid value for time_series_length_s"},
+	{"set frame_rate", "error expected <name>=<value>, got frame_rate"},
+	{"set", "error no parameters"},
+	{"get frame_rate", "error unknown command"},
+};
+
+static const char *socket_path;
+
+static volatile bool client_done = false;
+
+static bool all_ok = true;
+
+static void *client_thread(void *arg);
+
+static bool check(bool ok, const char *name, const char *reply);
+
+static bool send_text(int fd, const char *text);
+
+static bool read_line(int fd, char *line, size_t line_size);
+
+static bool validate(const acc_control_value_t *values);
+
+static acc_sensor_sim_t *create_sim(float frame_rate);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	char path[64];
+
+	snprintf(path, sizeof(path), "/tmp/example_control_socket_%ld", (long)getpid());
+	socket_path = path;
+
+	acc_control_socket_t control;
+	acc_control_value_t  values[NUM_PARAMS] = {
+		[PARAM_TIME_SERIES_LENGTH_S] = {.u16 = 20U},
+		[PARAM_USE_SOS_FILTERS]      = {.b = false},
+		[PARAM_FRAME_RATE]           = {.f32 = 20.0f},
+	};
+
+	acc_sensor_sim_t *sim = create_sim(values[PARAM_FRAME_RATE].f32);
+
+	if ((sim == NULL) || !acc_control_socket_open(&control, socket_path))
+	{
+		printf("Failed to start\n");
+		acc_sensor_sim_destroy(sim);
+		return EXIT_FAILURE;
+	}
+
+	pthread_t client;
+
+	if (pthread_create(&client, NULL, client_thread, NULL) != 0)
+	{
+		printf("Failed to start client thread\n");
+		acc_control_socket_close(&control);
+		acc_sensor_sim_destroy(sim);
+		return EXIT_FAILURE;
+	}
+
+	char     command[ACC_CONTROL_SOCKET_MAX_LINE_LENGTH];
+	char     reply[ACC_CONTROL_SOCKET_MAX_LINE_LENGTH];
+	uint32_t frame_ms      = acc_integration_get_time();
+	uint32_t apply_ms      = 0U;
+	uint32_t frames        = 0U;
+	bool     reply_pending = false;
+	bool     in_place      = false;
+
+	printf("%-50s %8s %8s %8s\n", "Change", "apply", "gap", "period");
+
+	while (!client_done && (frames < MAX_FRAMES))
+	{
+		bool frame_delayed;
+
+		if (!acc_sensor_sim_measure(sim) || !acc_sensor_sim_wait_for_interrupt(sim, SENSOR_TIMEOUT_MS) || !acc_sensor_sim_read(sim, &frame_delayed))
+		{
+			printf("Failed to read frame\n");
+			all_ok = false;
+			break;
+		}
+
+		uint32_t prev_frame_ms = frame_ms;
+
+		frame_ms = acc_integration_get_time();
+		frames++;
+
+		// Processing of the frame would be here
+
+		if (reply_pending)
+		{
+			uint32_t gap_ms    = frame_ms - prev_frame_ms;
+			uint32_t period_ms = (uint32_t)(1000.0f / values[PARAM_FRAME_RATE].f32);
+
+			snprintf(reply,
+			         sizeof(reply),
+			         "ok %s apply_ms=%" PRIu32 " gap_ms=%" PRIu32 " period_ms=%" PRIu32,
+			         in_place ? "in_place" : "prepared",
+			         apply_ms,
+			         gap_ms,
+			         period_ms);
+			acc_control_socket_reply(&control, reply);
+
+			reply_pending = false;
+		}
+
+		if (!acc_control_socket_poll(&control, command, sizeof(command)))
+		{
+			continue;
+		}
+
+		uint32_t             start_ms = acc_integration_get_time();
+		acc_control_change_t changes[ACC_CONTROL_SOCKET_MAX_CHANGES];
+		uint16_t             num_changes;
+		char                 error[ACC_CONTROL_SOCKET_MAX_LINE_LENGTH / 2U];
+
+		if (!acc_control_parse(params, NUM_PARAMS, command, changes, &num_changes, error, sizeof(error)))
+		{
+			snprintf(reply, sizeof(reply), "error %s", error);
+			acc_control_socket_reply(&control, reply);
+			continue;
+		}
+
+		acc_control_value_t new_values[NUM_PARAMS];
+		bool                needs_prepare = false;
+
+		memcpy(new_values, values, sizeof(new_values));
+
+		for (uint16_t i = 0U; i < num_changes; i++)
+		{
+			// The frame rate is the only parameter that needs a prepare, and it is a float
+			if (params[changes[i].param].needs_prepare && (values[changes[i].param].f32 != changes[i].value.f32))
+			{
+				needs_prepare = true;
+			}
+
+			new_values[changes[i].param] = changes[i].value;
+		}
+
+		if (!validate(new_values))
+		{
+			acc_control_socket_reply(&control, "error invalid configuration");
+			continue;
+		}
+
+		if (needs_prepare)
+		{
+			acc_sensor_sim_t *new_sim = create_sim(new_values[PARAM_FRAME_RATE].f32);
+
+			if (new_sim == NULL)
+			{
+				acc_control_socket_reply(&control, "error sensor prepare failed");
+				continue;
+			}
+
+			acc_sensor_sim_destroy(sim);
+			sim = new_sim;
+		}
+
+		memcpy(values, new_values, sizeof(new_values));
+
+		in_place      = !needs_prepare;
+		apply_ms      = acc_integration_get_time() - start_ms;
+		reply_pending = true;
+	}
+
+	client_done = true;
+	pthread_join(client, NULL);
+
+	acc_sensor_sim_stats_t stats;
+
+	acc_sensor_sim_get_stats(sim, &stats);
+
+	// The client waits with a command split in two, that must not hold up the frames
+	all_ok = check(stats.frames_delayed == 0U, "no delayed frames", "") && all_ok;
+
+	acc_control_socket_close(&control);
+	acc_sensor_sim_destroy(sim);
+
+	all_ok = check(access(socket_path, F_OK) != 0, "socket file removed", "") && all_ok;
+
+	printf("%s\n", all_ok ? "OK" : "FAILED");
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void *client_thread(void *arg)
+{
+	(void)arg;
+
+	char reply[ACC_CONTROL_SOCKET_MAX_LINE_LENGTH];
+
+	// One connection per request, so the server has to accept the next client each time
+	for (size_t i = 0U; i < (sizeof(requests) / sizeof(requests[0])); i++)
+	{
+		bool ok = acc_control_socket_request(socket_path, requests[i].command, reply, sizeof(reply), REPLY_TIMEOUT_MS);
+
+		if (strncmp(requests[i].expected, "ok", 2U) == 0)
+		{
+			uint32_t apply_ms  = 0U;
+			uint32_t gap_ms    = 0U;
+			uint32_t period_ms = 0U;
+			char     kind[16];
+
+			ok = ok && (sscanf(reply, "ok %15s apply_ms=%" SCNu32 " gap_ms=%" SCNu32 " period_ms=%" SCNu32, kind, &apply_ms, &gap_ms, &period_ms) == 4) &&
+			     (strncmp(reply, requests[i].expected, strlen("ok ") + strlen(kind)) == 0);
+
+			// An in place change must not take more time than a frame
+			if (ok && (strcmp(kind, "in_place") == 0))
+			{
+				ok = gap_ms < (2U * period_ms);
+			}
+
+			// A rejected change in between must have left the frame rate of the last accepted one
+			if (ok && (strcmp(requests[i].command, "set time_series_length_s=20") == 0))
+			{
+				ok = period_ms == 100U;
+			}
+
+			if (ok)
+			{
+				printf("%-50s %5" PRIu32 " ms %5" PRIu32 " ms %5" PRIu32 " ms\n", requests[i].command, apply_ms, gap_ms, period_ms);
+			}
+		}
+		else
+		{
+			ok = ok && (strcmp(reply, requests[i].expected) == 0);
+		}
+
+		all_ok = check(ok, requests[i].command, reply) && all_ok;
+	}
+
+	// Commands split over writes, several in one write and too long ones
+	struct sockaddr_un addr;
+	int                s = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1U);
+
+	bool ok = (s >= 0) && (connect(s, (struct sockaddr *)&addr, sizeof(addr)) == 0) && send_text(s, "set time_series_");
+
+	usleep(250000U);
+
+	ok = ok && send_text(s, "length_s=15\nset use_sos_filters=false\n") && read_line(s, reply, sizeof(reply)) &&
+	     (strncmp(reply, "ok in_place", 11U) == 0) && read_line(s, reply, sizeof(reply)) && (strncmp(reply, "ok in_place", 11U) == 0);
+	all_ok = check(ok, "split and joined commands", reply) && all_ok;
+
+	char long_command[ACC_CONTROL_SOCKET_MAX_LINE_LENGTH + 64U];
+
+	memset(long_command, 'x', sizeof(long_command) - 2U);
+	long_command[sizeof(long_command) - 2U] = '\n';
+	long_command[sizeof(long_command) - 1U] = '\0';
+
+	ok = ok && send_text(s, long_command) && send_text(s, "set time_series_length_s=20\n") && read_line(s, reply, sizeof(reply)) &&
+	     (strcmp(reply, "error command too long") == 0) && read_line(s, reply, sizeof(reply)) && (strncmp(reply, "ok in_place", 11U) == 0);
+	all_ok = check(ok, "too long command", reply) && all_ok;
+
+	if (s >= 0)
+	{
+		close(s);
+	}
+
+	client_done = true;
+
+	return NULL;
+}
+
+static bool check(bool ok, const char *name, const char *reply)
+{
+	if (!ok)
+	{
+		printf("%-50s FAILED, reply \"%s\"\n", name, reply);
+	}
+
+	return ok;
+}
+
+static bool send_text(int fd, const char *text)
+{
+	size_t length = strlen(text);
+
+	return send(fd, text, length, MSG_NOSIGNAL) == (ssize_t)length;
+}
+
+static bool read_line(int fd, char *line, size_t line_size)
+{
+	size_t length = 0U;
+
+	while (length < (line_size - 1U))
+	{
+		struct pollfd fds = {.fd = fd, .events = POLLIN};
+		char          c;
+
+		if ((poll(&fds, 1, (int)REPLY_TIMEOUT_MS) <= 0) || (read(fd, &c, 1U) != 1))
+		{
+			break;
+		}
+
+		if (c == '\n')
+		{
+			line[length] = '\0';
+			return true;
+		}
+
+		line[length++] = c;
+	}
+
+	line[length] = '\0';
+
+	return false;
+}
+
+static bool validate(const acc_control_value_t *values)
+{
+	float frame_rate         = values[PARAM_FRAME_RATE].f32;
+	float time_series_length = (float)values[PARAM_TIME_SERIES_LENGTH_S].u16 * frame_rate;
+
+	return (frame_rate > 0.0f) && (frame_rate <= 100.0f) && (time_series_length >= 2.0f) && (time_series_length <= (float)MAX_TIME_SERIES_LENGTH);
+}
+
+static acc_sensor_sim_t *create_sim(float frame_rate)
+{
+	acc_sensor_sim_config_t config = {
+	    .profile           = ACC_CONFIG_PROFILE_3,
+	    .num_points        = 50U,
+	    .hwaas             = 32U,
+	    .sweeps_per_frame  = 16U,
+	    .sweep_rate        = 0.0f,
+	    .frame_rate        = frame_rate,
+	    .sweep_duration_us = 0U,
+	};
+
+	return acc_sensor_sim_create(&config);
+}
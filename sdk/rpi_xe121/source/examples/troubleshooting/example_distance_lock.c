@@ -0,0 +1,456 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_algorithm.h"
+#include "acc_definitions_common.h"
+#include "acc_distance_lock.h"
+
+/** \example example_distance_lock.c
+ * @brief This is an example that measures the early distance lock of ref_app_breathing
+ * @n
+ * The example executes as follows:
+ *   - Generate synthetic frames of the default ref_app_breathing presence config for a
+ *     number of scenes, or read frames from a recording
+ *   - Run the distance lock from the first frame until it locks or the distance
+ *     determination time has passed, which is when the presence based distance is used
+ *   - Print the share of early locks, the share of locks at a point more than one point
+ *     from the target, and the time to lock, for a few dominance thresholds
+ *
+ * A recording is a file with raw frames of acc_int16_complex_t in little endian byte order,
+ * see example_iq_codec, and is given with its frame shape and optionally the point of the target:
+ *   example_distance_lock <recording> <num_points> <sweeps_per_frame> <frame_rate> [<target_point>]
+ * The lock is run from every second of the recording.
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host distance_lock_host
+ */
+
+// The default presence config of ref_app_breathing, 0.3 m to 1.5 m with step length 24
+#define START_M            (0.3f)
+#define STEP_M             (0.06f)
+#define NUM_POINTS         (21U)
+#define SWEEPS_PER_FRAME   (16U)
+#define FRAME_RATE_HZ      (10U)
+#define FRAME_RATE         ((float)FRAME_RATE_HZ)
+#define HIGHEST_FREQ       (1.0f)
+#define DETERMINATION_S    (5U)
+#define DETERMINATION_LEN  (DETERMINATION_S * FRAME_RATE_HZ)
+#define TRIALS             (200U)
+#define MAX_RECORDED_BYTES (64U * 1024U * 1024U)
+// Profile 3 pulse, with the wavelength of the 60 GHz carrier
+#define PULSE_WIDTH_M (0.06f)
+#define WAVELENGTH_M  (0.005f)
+
+typedef struct
+{
+	const char *name;
+	/** Amplitude and chest displacement of the breathing target, 0 amplitude for no target */
+	float target_amplitude;
+	float displacement_m;
+	float lowest_rate_bpm;
+	float highest_rate_bpm;
+	/** A second reflector with slow random motion in the breathing band, 0 amplitude for none */
+	float distractor_amplitude;
+	float distractor_displacement_m;
+	float noise;
+} scene_t;
+
+static const scene_t scenes[] = {
+	{"adult", 2000.0f, 0.004f, 10.0f, 25.0f, 0.0f, 0.0f, 40.0f},
+	{"infant", 600.0f, 0.0015f, 25.0f, 50.0f, 0.0f, 0.0f, 40.0f},
+	{"weak", 150.0f, 0.001f, 10.0f, 40.0f, 0.0f, 0.0f, 150.0f},
+	{"curtain_weak", 2000.0f, 0.004f, 10.0f, 25.0f, 600.0f, 0.001f, 40.0f},
+	{"curtain_close", 1000.0f, 0.003f, 10.0f, 30.0f, 1500.0f, 0.002f, 40.0f},
+	{"empty", 0.0f, 0.0f, 10.0f, 25.0f, 0.0f, 0.0f, 40.0f},
+	{"curtain", 0.0f, 0.0f, 10.0f, 25.0f, 1500.0f, 0.002f, 40.0f},
+};
+
+#define NBR_SCENES (sizeof(scenes) / sizeof(scenes[0]))
+
+static const float dominances[] = {2.0f, 4.0f, 8.0f, 16.0f};
+
+#define NBR_DOMINANCES (sizeof(dominances) / sizeof(dominances[0]))
+
+typedef struct
+{
+	uint32_t runs;
+	uint32_t locks;
+	uint32_t false_locks;
+	float    lock_times_s[TRIALS];
+} lock_stats_t;
+
+static uint32_t seed = 12345U;
+
+static float random_uniform(void);
+
+static float random_normal(void);
+
+static void generate_frames(const scene_t *scene, acc_int16_complex_t *frames, uint16_t num_frames, int32_t *target_point);
+
+static bool run_lock(acc_distance_lock_t         *lock,
+                     const acc_int16_complex_t   *frames,
+                     uint16_t                     num_points,
+                     uint16_t                     sweeps_per_frame,
+                     uint16_t                     num_frames,
+                     uint16_t                    *locked_point,
+                     uint16_t                    *lock_frames);
+
+static void add_run(lock_stats_t *stats, bool locked, uint16_t locked_point, uint16_t lock_frames, int32_t target_point, float frame_rate);
+
+static bool run_synthetic(void);
+
+static bool run_recording(const char *path, uint16_t num_points, uint16_t sweeps_per_frame, float frame_rate, int32_t target_point);
+
+static void print_stats(const char *name, float dominance, lock_stats_t *stats);
+
+static int compare_f32(const void *a, const void *b);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	bool ok;
+
+	if ((argc == 5) || (argc == 6))
+	{
+		int32_t target_point = (argc == 6) ? (int32_t)strtol(argv[5], NULL, 10) : -1;
+
+		ok = run_recording(argv[1], (uint16_t)strtoul(argv[2], NULL, 10), (uint16_t)strtoul(argv[3], NULL, 10), strtof(argv[4], NULL), target_point);
+	}
+	else if (argc == 1)
+	{
+		ok = run_synthetic();
+	}
+	else
+	{
+		printf("Usage: %s [<recording> <num_points> <sweeps_per_frame> <frame_rate> [<target_point>]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static float random_uniform(void)
+{
+	seed = (seed * 1103515245U) + 12345U;
+
+	return ((float)((seed >> 8) & 0xffffU) + 0.5f) / 65536.0f;
+}
+
+static float random_normal(void)
+{
+	float u1 = random_uniform();
+	float u2 = random_uniform();
+
+	return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+static void generate_frames(const scene_t *scene, acc_int16_complex_t *frames, uint16_t num_frames, int32_t *target_point)
+{
+	float target_m      = 0.5f + (0.7f * random_uniform());
+	float rate_hz       = (scene->lowest_rate_bpm + ((scene->highest_rate_bpm - scene->lowest_rate_bpm) * random_uniform())) / 60.0f;
+	float breath_phase  = 2.0f * (float)M_PI * random_uniform();
+	float distractor_m  = (target_m < 0.9f) ? (target_m + 0.4f + (0.1f * random_uniform())) : (target_m - 0.4f - (0.1f * random_uniform()));
+	float static_m      = 0.35f + (0.1f * random_uniform());
+	float static_phase  = 2.0f * (float)M_PI * random_uniform();
+	float sweep_dt      = 1.0f / (FRAME_RATE * (float)SWEEPS_PER_FRAME * 4.0f);
+	float distractor_x  = 0.0f;
+	float distractor_v  = 0.0f;
+	float distractor_lp = expf(-2.0f * (float)M_PI * 0.3f / FRAME_RATE);
+
+	// Without a breathing target the presence distance goes to the distractor, so that is where a lock belongs
+	if (scene->target_amplitude > 0.0f)
+	{
+		*target_point = (int32_t)(((target_m - START_M) / STEP_M) + 0.5f);
+	}
+	else if (scene->distractor_amplitude > 0.0f)
+	{
+		*target_point = (int32_t)(((distractor_m - START_M) / STEP_M) + 0.5f);
+	}
+	else
+	{
+		*target_point = -1;
+	}
+
+	for (uint16_t f = 0U; f < num_frames; f++)
+	{
+		// The distractor moves as low-pass filtered noise, with a spectrum over the breathing band
+		distractor_v = (distractor_lp * distractor_v) + ((1.0f - distractor_lp) * random_normal());
+		distractor_x = (distractor_lp * distractor_x) + ((1.0f - distractor_lp) * distractor_v * 8.0f);
+
+		for (uint16_t s = 0U; s < SWEEPS_PER_FRAME; s++)
+		{
+			float t              = ((float)f / FRAME_RATE) + ((float)s * sweep_dt);
+			float chest_m        = target_m + (scene->displacement_m * sinf((2.0f * (float)M_PI * rate_hz * t) + breath_phase));
+			float distractor_now = distractor_m + (scene->distractor_displacement_m * distractor_x);
+
+			for (uint16_t p = 0U; p < NUM_POINTS; p++)
+			{
+				float         point_m = START_M + ((float)p * STEP_M);
+				float complex value   = 3000.0f * expf(-powf((point_m - static_m) / PULSE_WIDTH_M, 2.0f)) * cexpf(static_phase * I);
+
+				value += scene->target_amplitude * expf(-powf((point_m - chest_m) / PULSE_WIDTH_M, 2.0f)) *
+				         cexpf((4.0f * (float)M_PI * chest_m / WAVELENGTH_M) * I);
+				value += scene->distractor_amplitude * expf(-powf((point_m - distractor_now) / PULSE_WIDTH_M, 2.0f)) *
+				         cexpf((4.0f * (float)M_PI * distractor_now / WAVELENGTH_M) * I);
+				value += scene->noise * (random_normal() + (random_normal() * I));
+
+				acc_int16_complex_t *sample = &frames[(((uint32_t)f * SWEEPS_PER_FRAME) + s) * NUM_POINTS + p];
+
+				sample->real = (int16_t)lroundf(crealf(value));
+				sample->imag = (int16_t)lroundf(cimagf(value));
+			}
+		}
+	}
+}
+
+static bool run_lock(acc_distance_lock_t         *lock,
+                     const acc_int16_complex_t   *frames,
+                     uint16_t                     num_points,
+                     uint16_t                     sweeps_per_frame,
+                     uint16_t                     num_frames,
+                     uint16_t                    *locked_point,
+                     uint16_t                    *lock_frames)
+{
+	float complex sweep[num_points];
+	uint32_t      frame_length = (uint32_t)num_points * sweeps_per_frame;
+
+	acc_distance_lock_reset(lock);
+
+	for (uint16_t f = 0U; f < num_frames; f++)
+	{
+		acc_algorithm_mean_sweep(&frames[f * frame_length], num_points, sweeps_per_frame, 0U, num_points, sweep);
+
+		if (acc_distance_lock_update(lock, sweep, locked_point))
+		{
+			*lock_frames = f + 1U;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void add_run(lock_stats_t *stats, bool locked, uint16_t locked_point, uint16_t lock_frames, int32_t target_point, float frame_rate)
+{
+	stats->runs++;
+
+	if (locked)
+	{
+		stats->lock_times_s[stats->locks] = (float)lock_frames / frame_rate;
+		stats->locks++;
+
+		// Without a target every lock is false, with one the analysed points must still cover it
+		if ((target_point < 0) || (abs((int32_t)locked_point - target_point) > 1))
+		{
+			stats->false_locks++;
+		}
+	}
+}
+
+static bool run_synthetic(void)
+{
+	static acc_int16_complex_t frames[DETERMINATION_LEN * SWEEPS_PER_FRAME * NUM_POINTS];
+	static lock_stats_t        stats[NBR_SCENES][NBR_DOMINANCES];
+
+	bool                       ok = true;
+	acc_distance_lock_config_t config;
+
+	acc_distance_lock_config_default(&config);
+	config.num_points   = NUM_POINTS;
+	config.frame_rate   = FRAME_RATE;
+	config.highest_freq = HIGHEST_FREQ;
+
+	printf("Synthetic scenes, %u trials each, distance determination time %u s\n", (unsigned int)TRIALS, (unsigned int)DETERMINATION_S);
+
+	for (uint16_t s = 0U; s < NBR_SCENES; s++)
+	{
+		for (uint16_t trial = 0U; trial < TRIALS; trial++)
+		{
+			int32_t target_point;
+
+			generate_frames(&scenes[s], frames, DETERMINATION_LEN, &target_point);
+
+			for (uint16_t d = 0U; d < NBR_DOMINANCES; d++)
+			{
+				config.min_dominance = dominances[d];
+
+				acc_distance_lock_t *lock = acc_distance_lock_create(&config);
+
+				if (lock == NULL)
+				{
+					printf("acc_distance_lock_create() failed\n");
+					return false;
+				}
+
+				uint16_t locked_point = 0U;
+				uint16_t lock_frames  = 0U;
+				bool     locked       = run_lock(lock, frames, NUM_POINTS, SWEEPS_PER_FRAME, DETERMINATION_LEN, &locked_point, &lock_frames);
+
+				add_run(&stats[s][d], locked, locked_point, lock_frames, target_point, FRAME_RATE);
+				acc_distance_lock_destroy(lock);
+			}
+		}
+	}
+
+	for (uint16_t s = 0U; s < NBR_SCENES; s++)
+	{
+		for (uint16_t d = 0U; d < NBR_DOMINANCES; d++)
+		{
+			print_stats(scenes[s].name, dominances[d], &stats[s][d]);
+		}
+	}
+
+	// With the default dominance, few false locks in any scene, and most clear targets locked early
+	acc_distance_lock_config_default(&config);
+
+	for (uint16_t d = 0U; d < NBR_DOMINANCES; d++)
+	{
+		if (dominances[d] != config.min_dominance)
+		{
+			continue;
+		}
+
+		for (uint16_t s = 0U; s < NBR_SCENES; s++)
+		{
+			ok = ok && ((stats[s][d].false_locks * 100U) <= (2U * stats[s][d].runs));
+		}
+
+		ok = ok && ((stats[0][d].locks * 100U) >= (90U * stats[0][d].runs));
+	}
+
+	printf("%s\n", ok ? "OK" : "FAILED");
+
+	return ok;
+}
+
+static bool run_recording(const char *path, uint16_t num_points, uint16_t sweeps_per_frame, float frame_rate, int32_t target_point)
+{
+	uint32_t frame_length = (uint32_t)num_points * sweeps_per_frame;
+	FILE    *file         = fopen(path, "rb");
+
+	if ((file == NULL) || (frame_length == 0U) || (frame_rate <= 0.0f))
+	{
+		printf("Failed to read %s\n", path);
+		if (file != NULL)
+		{
+			fclose(file);
+		}
+
+		return false;
+	}
+
+	uint32_t             max_frames = MAX_RECORDED_BYTES / (4U * frame_length);
+	acc_int16_complex_t *frames     = malloc((size_t)max_frames * frame_length * sizeof(*frames));
+	uint8_t             *bytes      = malloc((size_t)max_frames * frame_length * 4U);
+	size_t               num_frames = 0U;
+
+	if ((frames != NULL) && (bytes != NULL))
+	{
+		num_frames = fread(bytes, 4U * frame_length, max_frames, file);
+	}
+
+	fclose(file);
+
+	// Little endian on disk, independent of the host byte order
+	for (size_t i = 0U; i < (num_frames * frame_length); i++)
+	{
+		frames[i].real = (int16_t)((uint16_t)bytes[4U * i] | ((uint16_t)bytes[(4U * i) + 1U] << 8));
+		frames[i].imag = (int16_t)((uint16_t)bytes[(4U * i) + 2U] | ((uint16_t)bytes[(4U * i) + 3U] << 8));
+	}
+
+	free(bytes);
+
+	uint16_t determination_frames = (uint16_t)((float)DETERMINATION_S * frame_rate);
+
+	if ((frames == NULL) || (num_frames < determination_frames))
+	{
+		printf("Less than %u s of frames in %s\n", (unsigned int)DETERMINATION_S, path);
+		free(frames);
+		return false;
+	}
+
+	acc_distance_lock_config_t config;
+
+	acc_distance_lock_config_default(&config);
+	config.num_points   = num_points;
+	config.frame_rate   = frame_rate;
+	config.highest_freq = HIGHEST_FREQ;
+
+	printf("%s: %u frames, target point %d\n", path, (unsigned int)num_frames, (int)target_point);
+
+	for (uint16_t d = 0U; d < NBR_DOMINANCES; d++)
+	{
+		lock_stats_t stats;
+
+		memset(&stats, 0, sizeof(stats));
+		config.min_dominance = dominances[d];
+
+		acc_distance_lock_t *lock = acc_distance_lock_create(&config);
+
+		if (lock == NULL)
+		{
+			free(frames);
+			return false;
+		}
+
+		// From every second of the recording, as if the presence was detected there
+		for (size_t start = 0U; ((start + determination_frames) <= num_frames) && (stats.runs < TRIALS); start += (size_t)frame_rate)
+		{
+			uint16_t locked_point = 0U;
+			uint16_t lock_frames  = 0U;
+			bool     locked =
+			    run_lock(lock, &frames[start * frame_length], num_points, sweeps_per_frame, determination_frames, &locked_point, &lock_frames);
+
+			add_run(&stats, locked, locked_point, lock_frames, target_point, frame_rate);
+		}
+
+		acc_distance_lock_destroy(lock);
+		print_stats(path, dominances[d], &stats);
+	}
+
+	free(frames);
+
+	return true;
+}
+
+static void print_stats(const char *name, float dominance, lock_stats_t *stats)
+{
+	printf("%-13s dominance %3.0f: early lock %5.1f %%, false lock %5.1f %%",
+	       name,
+	       (double)dominance,
+	       100.0 * (double)stats->locks / (double)stats->runs,
+	       100.0 * (double)stats->false_locks / (double)stats->runs);
+
+	if (stats->locks > 0U)
+	{
+		qsort(stats->lock_times_s, stats->locks, sizeof(stats->lock_times_s[0]), compare_f32);
+
+		float median_s = stats->lock_times_s[stats->locks / 2U];
+		float p90_s    = stats->lock_times_s[(stats->locks * 9U) / 10U];
+
+		printf(", time to lock median %4.1f s, 90 %% %4.1f s", (double)median_s, (double)p90_s);
+	}
+
+	printf("\n");
+}
+
+static int compare_f32(const void *a, const void *b)
+{
+	float fa = *(const float *)a;
+	float fb = *(const float *)b;
+
+	return (fa > fb) - (fa < fb);
+}
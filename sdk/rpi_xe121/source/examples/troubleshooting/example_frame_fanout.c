@@ -0,0 +1,532 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "acc_definitions_common.h"
+#include "acc_frame_fanout.h"
+#include "acc_iq_codec.h"
+#include "acc_processing.h"
+
+/** \example example_frame_fanout.c
+ * @brief This is an example that feeds one sensor stream to several processors with the frame fan-out
+ * @n
+ * The example executes as follows:
+ *   - Replay a synthetic recording of a breathing person in place of the sensor, one read per frame
+ *     into a buffer from the fan-out, at the frame rate of the recording
+ *   - Publish every frame once to four processors:
+ *     - breathing: tracks the phase of the person, in its own thread
+ *     - presence zones: finds the zone with motion, in the thread that reads
+ *     - recorder: encodes every frame with the IQ codec, in its own thread
+ *     - slow: takes three frame periods per frame, in its own thread
+ *   - Verify that
+ *     - there was exactly one read per published frame
+ *     - all processors saw the frame in the buffer it was read into, and the frames were not modified
+ *     - the breathing, presence zones and recorder processors got every frame
+ *     - the slow processor had frames dropped instead of holding up the reads
+ *   - Print the statistics of the processors
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host frame_fanout_host
+ */
+
+#define NUM_POINTS       (40U)
+#define SWEEPS_PER_FRAME (16U)
+#define FRAME_LENGTH     (NUM_POINTS * SWEEPS_PER_FRAME)
+#define NUM_FRAMES       (200U)
+#define FRAME_PERIOD_US  (10000U)
+#define QUEUE_DEPTH      (8U)
+
+#define REFLECTOR_POINT     (20U)
+#define REFLECTOR_AMPLITUDE (2000.0f)
+#define NOISE_AMPLITUDE     (8.0f)
+#define BREATHING_RATE_HZ   (0.5f)
+#define BREATHING_PHASE_RAD (2.0f)
+
+#define NUM_ZONES          (3U)
+#define POINTS_PER_ZONE    ((NUM_POINTS + NUM_ZONES - 1U) / NUM_ZONES)
+#define SLOW_FRAME_PERIODS (3U)
+
+#define MAX_PHASE_ERROR_RAD (0.1f)
+
+/**
+ * @brief Replays a recording in place of the sensor, counting the reads
+ */
+typedef struct
+{
+	acc_int16_complex_t       *frames;
+	uint32_t                   frame_count;
+	uint32_t                   reads;
+	/** The buffer each frame was read into */
+	const acc_int16_complex_t *buffers[NUM_FRAMES];
+} replay_t;
+
+/**
+ * @brief The frames a processor saw, by sequence
+ */
+typedef struct
+{
+	const acc_int16_complex_t *seen[NUM_FRAMES];
+	uint32_t                   next_sequence;
+	bool                       in_order;
+} frame_log_t;
+
+typedef struct
+{
+	frame_log_t log;
+	float       phase[NUM_FRAMES];
+} breathing_t;
+
+typedef struct
+{
+	frame_log_t         log;
+	acc_int16_complex_t previous[NUM_POINTS];
+	bool                has_previous;
+	float               energy[NUM_ZONES];
+} presence_zones_t;
+
+typedef struct
+{
+	frame_log_t log;
+	uint8_t    *encoded;
+	uint32_t    sizes[NUM_FRAMES];
+	uint32_t    max_size;
+} recorder_t;
+
+typedef struct
+{
+	frame_log_t log;
+} slow_t;
+
+static acc_int16_complex_t *generate_recording(void);
+
+static float expected_phase(uint32_t frame);
+
+static bool replay_read(replay_t *replay, void *buffer, acc_processing_result_t *result);
+
+static bool log_frame(frame_log_t *log, const acc_frame_fanout_frame_t *frame);
+
+static bool breathing_process(const acc_frame_fanout_frame_t *frame, void *user_data);
+
+static bool presence_zones_process(const acc_frame_fanout_frame_t *frame, void *user_data);
+
+static bool recorder_process(const acc_frame_fanout_frame_t *frame, void *user_data);
+
+static bool slow_process(const acc_frame_fanout_frame_t *frame, void *user_data);
+
+static void mean_sweep(const acc_int16_complex_t *frame, acc_int16_complex_t *sweep);
+
+static bool check_log(const frame_log_t *log, const replay_t *replay, bool all_frames);
+
+static bool check(bool ok, const char *name);
+
+static float noise(uint32_t *seed);
+
+static uint64_t get_time_us(void);
+
+static void sleep_until_us(uint64_t time_us);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	acc_processing_metadata_t metadata = {0};
+
+	metadata.frame_data_length = FRAME_LENGTH;
+	metadata.sweep_data_length = NUM_POINTS;
+
+	static replay_t         replay;
+	static breathing_t      breathing;
+	static presence_zones_t presence_zones;
+	static recorder_t       recorder;
+	static slow_t           slow;
+
+	breathing.log.in_order      = true;
+	presence_zones.log.in_order = true;
+	recorder.log.in_order       = true;
+	slow.log.in_order           = true;
+
+	replay.frames      = generate_recording();
+	replay.frame_count = NUM_FRAMES;
+	recorder.max_size  = ACC_IQ_CODEC_MAX_ENCODED_SIZE(NUM_POINTS, SWEEPS_PER_FRAME);
+	recorder.encoded   = malloc((size_t)NUM_FRAMES * recorder.max_size);
+
+	acc_frame_fanout_t *fanout = acc_frame_fanout_create(&metadata, FRAME_LENGTH * sizeof(acc_int16_complex_t), QUEUE_DEPTH);
+
+	if ((replay.frames == NULL) || (recorder.encoded == NULL) || (fanout == NULL))
+	{
+		printf("Failed to allocate\n");
+		return EXIT_FAILURE;
+	}
+
+	uint16_t breathing_id      = 0U;
+	uint16_t presence_zones_id = 0U;
+	uint16_t recorder_id       = 0U;
+	uint16_t slow_id           = 0U;
+
+	bool all_ok = acc_frame_fanout_add_processor(fanout, "breathing", breathing_process, &breathing, true, &breathing_id) &&
+	              acc_frame_fanout_add_processor(fanout, "presence zones", presence_zones_process, &presence_zones, false, &presence_zones_id) &&
+	              acc_frame_fanout_add_processor(fanout, "recorder", recorder_process, &recorder, true, &recorder_id) &&
+	              acc_frame_fanout_add_processor(fanout, "slow", slow_process, &slow, true, &slow_id) && acc_frame_fanout_start(fanout);
+
+	if (!all_ok)
+	{
+		printf("Failed to start the fan-out\n");
+		acc_frame_fanout_destroy(fanout);
+		return EXIT_FAILURE;
+	}
+
+	uint64_t next_us        = get_time_us();
+	uint64_t max_publish_us = 0U;
+	uint32_t published      = 0U;
+
+	for (uint32_t f = 0U; f < NUM_FRAMES; f++)
+	{
+		next_us += FRAME_PERIOD_US;
+		sleep_until_us(next_us);
+
+		acc_processing_result_t result;
+		void                   *buffer = acc_frame_fanout_get_buffer(fanout);
+
+		if ((buffer == NULL) || !replay_read(&replay, buffer, &result))
+		{
+			printf("Failed to read frame %" PRIu32 "\n", f);
+			all_ok = false;
+			break;
+		}
+
+		uint64_t start_us = get_time_us();
+
+		if (!acc_frame_fanout_publish(fanout, &result))
+		{
+			printf("Failed to publish frame %" PRIu32 "\n", f);
+			all_ok = false;
+			break;
+		}
+
+		uint64_t publish_us = get_time_us() - start_us;
+
+		if (publish_us > max_publish_us)
+		{
+			max_publish_us = publish_us;
+		}
+
+		published++;
+	}
+
+	acc_frame_fanout_stop(fanout);
+	acc_frame_fanout_print_stats(fanout);
+
+	acc_frame_fanout_stats_t breathing_stats;
+	acc_frame_fanout_stats_t presence_zones_stats;
+	acc_frame_fanout_stats_t recorder_stats;
+	acc_frame_fanout_stats_t slow_stats;
+
+	acc_frame_fanout_get_stats(fanout, breathing_id, &breathing_stats);
+	acc_frame_fanout_get_stats(fanout, presence_zones_id, &presence_zones_stats);
+	acc_frame_fanout_get_stats(fanout, recorder_id, &recorder_stats);
+	acc_frame_fanout_get_stats(fanout, slow_id, &slow_stats);
+
+	printf("Reads: %" PRIu32 ", published: %" PRIu32 ", longest publish: %" PRIu64 " us\n", replay.reads, published, max_publish_us);
+
+	all_ok = check(published == NUM_FRAMES, "all frames published") && all_ok;
+	all_ok = check(replay.reads == published, "one read per published frame") && all_ok;
+	all_ok = check(max_publish_us < FRAME_PERIOD_US, "publish shorter than a frame period") && all_ok;
+
+	all_ok = check(check_log(&breathing.log, &replay, true), "breathing saw every frame in place") && all_ok;
+	all_ok = check(check_log(&presence_zones.log, &replay, true), "presence zones saw every frame in place") && all_ok;
+	all_ok = check(check_log(&recorder.log, &replay, true), "recorder saw every frame in place") && all_ok;
+	all_ok = check(check_log(&slow.log, &replay, false), "slow saw its frames in place") && all_ok;
+
+	all_ok = check((breathing_stats.dropped == 0U) && (presence_zones_stats.dropped == 0U) && (recorder_stats.dropped == 0U),
+	               "no drops for the fast processors") &&
+	         all_ok;
+	all_ok = check((slow_stats.dropped > 0U) && ((slow_stats.frames + slow_stats.dropped) == NUM_FRAMES), "slow processor drops frames") && all_ok;
+	all_ok = check(slow_stats.max_lag == QUEUE_DEPTH, "slow processor lag up to the queue depth") && all_ok;
+
+	bool phase_ok = true;
+
+	for (uint32_t f = 0U; f < NUM_FRAMES; f++)
+	{
+		float error = breathing.phase[f] - expected_phase(f);
+
+		error    = atan2f(sinf(error), cosf(error));
+		phase_ok = phase_ok && (fabsf(error) < MAX_PHASE_ERROR_RAD);
+	}
+
+	all_ok = check(phase_ok, "breathing phase follows the recording") && all_ok;
+
+	uint16_t motion_zone = 0U;
+
+	for (uint16_t z = 1U; z < NUM_ZONES; z++)
+	{
+		if (presence_zones.energy[z] > presence_zones.energy[motion_zone])
+		{
+			motion_zone = z;
+		}
+	}
+
+	all_ok = check(motion_zone == (REFLECTOR_POINT / POINTS_PER_ZONE), "presence zone with motion") && all_ok;
+
+	bool                 recording_ok = true;
+	acc_int16_complex_t *decoded      = malloc(FRAME_LENGTH * sizeof(*decoded));
+
+	for (uint32_t f = 0U; recording_ok && (f < NUM_FRAMES); f++)
+	{
+		recording_ok = (decoded != NULL) &&
+		               acc_iq_codec_decode(&recorder.encoded[f * recorder.max_size], recorder.sizes[f], NUM_POINTS, SWEEPS_PER_FRAME, decoded) &&
+		               (memcmp(decoded, &replay.frames[f * FRAME_LENGTH], FRAME_LENGTH * sizeof(*decoded)) == 0);
+	}
+
+	all_ok = check(recording_ok, "recording identical to the replayed frames") && all_ok;
+
+	free(decoded);
+	acc_frame_fanout_destroy(fanout);
+	free(recorder.encoded);
+	free(replay.frames);
+
+	printf("%s\n", all_ok ? "OK" : "FAILED");
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static acc_int16_complex_t *generate_recording(void)
+{
+	acc_int16_complex_t *frames = malloc((size_t)NUM_FRAMES * FRAME_LENGTH * sizeof(*frames));
+	uint32_t             seed   = 12345U;
+
+	if (frames == NULL)
+	{
+		return NULL;
+	}
+
+	// One reflector moving with the breathing, with an amplitude envelope over depth, plus noise
+	for (uint32_t f = 0U; f < NUM_FRAMES; f++)
+	{
+		float phase = expected_phase(f);
+
+		for (uint16_t s = 0U; s < SWEEPS_PER_FRAME; s++)
+		{
+			for (uint16_t p = 0U; p < NUM_POINTS; p++)
+			{
+				float distance  = ((float)p - (float)REFLECTOR_POINT) / 3.0f;
+				float amplitude = REFLECTOR_AMPLITUDE * expf(-distance * distance);
+
+				acc_int16_complex_t *point = &frames[(f * FRAME_LENGTH) + ((uint32_t)s * NUM_POINTS) + p];
+
+				point->real = (int16_t)lrintf((amplitude * cosf(phase)) + (NOISE_AMPLITUDE * noise(&seed)));
+				point->imag = (int16_t)lrintf((amplitude * sinf(phase)) + (NOISE_AMPLITUDE * noise(&seed)));
+			}
+		}
+	}
+
+	return frames;
+}
+
+static float expected_phase(uint32_t frame)
+{
+	float time_s = (float)frame * ((float)FRAME_PERIOD_US / 1000000.0f);
+
+	return BREATHING_PHASE_RAD * sinf(2.0f * (float)M_PI * BREATHING_RATE_HZ * time_s);
+}
+
+static bool replay_read(replay_t *replay, void *buffer, acc_processing_result_t *result)
+{
+	if (replay->reads == replay->frame_count)
+	{
+		return false;
+	}
+
+	// Stands in for acc_sensor_read and acc_processing_execute, which leave the frame in the buffer
+	memcpy(buffer, &replay->frames[replay->reads * FRAME_LENGTH], FRAME_LENGTH * sizeof(acc_int16_complex_t));
+
+	result->data_saturated     = false;
+	result->frame_delayed      = false;
+	result->calibration_needed = false;
+	result->temperature        = 25;
+	result->frame              = buffer;
+
+	replay->buffers[replay->reads] = buffer;
+	replay->reads++;
+
+	return true;
+}
+
+static bool log_frame(frame_log_t *log, const acc_frame_fanout_frame_t *frame)
+{
+	if ((frame->sequence >= NUM_FRAMES) || (frame->sequence < log->next_sequence))
+	{
+		log->in_order = false;
+		return false;
+	}
+
+	log->seen[frame->sequence] = frame->frame;
+	log->next_sequence         = frame->sequence + 1U;
+
+	return true;
+}
+
+static bool breathing_process(const acc_frame_fanout_frame_t *frame, void *user_data)
+{
+	breathing_t        *breathing = user_data;
+	acc_int16_complex_t sweep[NUM_POINTS];
+
+	if (!log_frame(&breathing->log, frame))
+	{
+		return false;
+	}
+
+	mean_sweep(frame->frame, sweep);
+
+	breathing->phase[frame->sequence] = atan2f((float)sweep[REFLECTOR_POINT].imag, (float)sweep[REFLECTOR_POINT].real);
+
+	return true;
+}
+
+static bool presence_zones_process(const acc_frame_fanout_frame_t *frame, void *user_data)
+{
+	presence_zones_t   *presence_zones = user_data;
+	acc_int16_complex_t sweep[NUM_POINTS];
+
+	if (!log_frame(&presence_zones->log, frame))
+	{
+		return false;
+	}
+
+	mean_sweep(frame->frame, sweep);
+
+	if (presence_zones->has_previous)
+	{
+		for (uint16_t p = 0U; p < NUM_POINTS; p++)
+		{
+			float real = (float)sweep[p].real - (float)presence_zones->previous[p].real;
+			float imag = (float)sweep[p].imag - (float)presence_zones->previous[p].imag;
+
+			presence_zones->energy[p / POINTS_PER_ZONE] += (real * real) + (imag * imag);
+		}
+	}
+
+	memcpy(presence_zones->previous, sweep, sizeof(sweep));
+	presence_zones->has_previous = true;
+
+	return true;
+}
+
+static bool recorder_process(const acc_frame_fanout_frame_t *frame, void *user_data)
+{
+	recorder_t *recorder = user_data;
+
+	if (!log_frame(&recorder->log, frame))
+	{
+		return false;
+	}
+
+	uint32_t size = acc_iq_codec_encode(frame->frame,
+	                                    frame->metadata->sweep_data_length,
+	                                    frame->metadata->frame_data_length / frame->metadata->sweep_data_length,
+	                                    &recorder->encoded[frame->sequence * recorder->max_size],
+	                                    recorder->max_size);
+
+	recorder->sizes[frame->sequence] = size;
+
+	return size > 0U;
+}
+
+static bool slow_process(const acc_frame_fanout_frame_t *frame, void *user_data)
+{
+	slow_t *slow = user_data;
+
+	if (!log_frame(&slow->log, frame))
+	{
+		return false;
+	}
+
+	sleep_until_us(get_time_us() + (SLOW_FRAME_PERIODS * FRAME_PERIOD_US));
+
+	return true;
+}
+
+static void mean_sweep(const acc_int16_complex_t *frame, acc_int16_complex_t *sweep)
+{
+	for (uint16_t p = 0U; p < NUM_POINTS; p++)
+	{
+		int32_t real = 0;
+		int32_t imag = 0;
+
+		for (uint16_t s = 0U; s < SWEEPS_PER_FRAME; s++)
+		{
+			real += frame[(s * NUM_POINTS) + p].real;
+			imag += frame[(s * NUM_POINTS) + p].imag;
+		}
+
+		sweep[p].real = (int16_t)(real / (int32_t)SWEEPS_PER_FRAME);
+		sweep[p].imag = (int16_t)(imag / (int32_t)SWEEPS_PER_FRAME);
+	}
+}
+
+static bool check_log(const frame_log_t *log, const replay_t *replay, bool all_frames)
+{
+	bool ok = log->in_order;
+
+	for (uint32_t f = 0U; ok && (f < NUM_FRAMES); f++)
+	{
+		if (log->seen[f] != NULL)
+		{
+			ok = log->seen[f] == replay->buffers[f];
+		}
+		else
+		{
+			ok = !all_frames;
+		}
+	}
+
+	return ok;
+}
+
+static bool check(bool ok, const char *name)
+{
+	printf("%-50s %s\n", name, ok ? "OK" : "FAILED");
+
+	return ok;
+}
+
+static float noise(uint32_t *seed)
+{
+	*seed = (*seed * 1103515245U) + 12345U;
+
+	return ((float)((*seed >> 16) & 0x7FFFU) / 16383.5f) - 1.0f;
+}
+
+static uint64_t get_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000U) + ((uint64_t)ts.tv_nsec / 1000U);
+}
+
+static void sleep_until_us(uint64_t time_us)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = (time_t)(time_us / 1000000U);
+	ts.tv_nsec = (long)((time_us % 1000000U) * 1000U);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+	{
+	}
+}
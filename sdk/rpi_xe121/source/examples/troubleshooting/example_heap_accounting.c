@@ -0,0 +1,179 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_algorithm.h"
+#include "acc_integration.h"
+
+/** \example example_heap_accounting.c
+ * @brief This is an example that checks the heap accounting of the integration allocator
+ * @n
+ * The example executes as follows:
+ *   - Optionally serve all allocations from a pool
+ *   - Allocate and free blocks of random sizes and verify the live byte count and the peak
+ *   - Run acc_algorithm processing on preallocated buffers for many frames in steady state
+ *   - Verify that no allocations were made in steady state
+ *   - Print the heap statistics per call site
+ *
+ * Run with a pool size in bytes as argument to test the pool, e.g.
+ *   example_heap_accounting 65536
+ * Run with ACC_MEM_STEADY_STATE=abort to abort on the first steady state allocation.
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host heap_host
+ */
+
+#define NBR_BLOCKS        (64U)
+#define NBR_ROUNDS        (2000U)
+#define MAX_BLOCK_SIZE    (1000U)
+#define NBR_FRAMES        (1000U)
+#define FRAME_LENGTH      (64U)
+#define FFT_LENGTH_SHIFT  (6U)
+#define FILTER_LENGTH     (FRAME_LENGTH)
+#define FILTER_ORDER      (2U)
+
+static bool check_alloc_free(void);
+
+static bool check_steady_state(void);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	if ((argc > 1) && !acc_integration_mem_pool_init((size_t)strtoul(argv[1], NULL, 0)))
+	{
+		printf("Failed to create pool\n");
+		return EXIT_FAILURE;
+	}
+
+	bool alloc_free_ok   = check_alloc_free();
+	bool steady_state_ok = check_steady_state();
+
+	printf("Alloc/free accounting: %s\n", alloc_free_ok ? "OK" : "FAILED");
+	printf("Steady state processing: %s\n", steady_state_ok ? "OK" : "FAILED");
+
+	acc_integration_mem_print_stats();
+
+	return (alloc_free_ok && steady_state_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool check_alloc_free(void)
+{
+	uint8_t *blocks[NBR_BLOCKS] = {NULL};
+	size_t   sizes[NBR_BLOCKS]  = {0};
+	size_t   expected_live      = 0U;
+	size_t   expected_peak      = 0U;
+	uint32_t seed               = 12345U;
+	bool     ok                 = true;
+
+	acc_integration_mem_stats_t start;
+	acc_integration_mem_stats_t stats;
+
+	acc_integration_mem_get_stats(&start);
+	expected_live = start.live_bytes;
+	expected_peak = start.peak_bytes;
+
+	for (uint32_t round = 0U; ok && (round < NBR_ROUNDS); round++)
+	{
+		seed = (seed * 1103515245U) + 12345U;
+
+		uint16_t i = (uint16_t)((seed >> 16) % NBR_BLOCKS);
+
+		if (blocks[i] != NULL)
+		{
+			// The block must be intact, which also catches overlapping pool blocks
+			for (size_t j = 0U; ok && (j < sizes[i]); j++)
+			{
+				ok = blocks[i][j] == (uint8_t)i;
+			}
+
+			acc_integration_mem_free(blocks[i]);
+			blocks[i] = NULL;
+			expected_live -= sizes[i];
+		}
+		else
+		{
+			sizes[i]  = ((seed >> 8) % MAX_BLOCK_SIZE) + 1U;
+			blocks[i] = (round % 2U) == 0U ? acc_integration_mem_alloc(sizes[i]) : acc_integration_mem_calloc(1U, sizes[i]);
+
+			if (blocks[i] == NULL)
+			{
+				ok = false;
+				break;
+			}
+
+			memset(blocks[i], (int)i, sizes[i]);
+			expected_live += sizes[i];
+			expected_peak = expected_live > expected_peak ? expected_live : expected_peak;
+		}
+
+		acc_integration_mem_get_stats(&stats);
+		ok = ok && (stats.live_bytes == expected_live) && (stats.peak_bytes == expected_peak);
+	}
+
+	for (uint16_t i = 0U; i < NBR_BLOCKS; i++)
+	{
+		acc_integration_mem_free(blocks[i]);
+	}
+
+	acc_integration_mem_get_stats(&stats);
+
+	return ok && (stats.live_bytes == start.live_bytes) && (stats.live_allocations == start.live_allocations);
+}
+
+static bool check_steady_state(void)
+{
+	const float b[FILTER_ORDER + 1U] = {0.2f, 0.4f, 0.2f};
+	const float a[FILTER_ORDER]      = {-0.5f, 0.1f};
+
+	float complex *frame      = acc_integration_mem_alloc(FRAME_LENGTH * sizeof(*frame));
+	float complex *spectrum   = acc_integration_mem_alloc(FRAME_LENGTH * sizeof(*spectrum));
+	float complex *filtered   = acc_integration_mem_alloc(FILTER_LENGTH * sizeof(*filtered));
+	float complex *history_in = acc_integration_mem_calloc(FILTER_LENGTH * (FILTER_ORDER + 1U), sizeof(*history_in));
+	float complex *history    = acc_integration_mem_calloc(FILTER_LENGTH * FILTER_ORDER, sizeof(*history));
+
+	if ((frame == NULL) || (spectrum == NULL) || (filtered == NULL) || (history_in == NULL) || (history == NULL))
+	{
+		return false;
+	}
+
+	acc_integration_mem_stats_t before;
+	acc_integration_mem_stats_t after;
+
+	acc_integration_mem_get_stats(&before);
+	acc_integration_mem_steady_state_begin();
+
+	for (uint32_t f = 0U; f < NBR_FRAMES; f++)
+	{
+		for (uint16_t i = 0U; i < FRAME_LENGTH; i++)
+		{
+			frame[i] = (float)((f + i) % 7U) + ((float)(i % 3U) * I);
+		}
+
+		acc_algorithm_fft(frame, FRAME_LENGTH, FFT_LENGTH_SHIFT, spectrum);
+		acc_algorithm_roll_and_push_matrix_f32_complex(history_in, FILTER_ORDER + 1U, FILTER_LENGTH, spectrum, true);
+		acc_algorithm_apply_filter_f32_complex(a, history, FILTER_ORDER, FILTER_LENGTH, b, history_in, FILTER_ORDER + 1U, FILTER_LENGTH, filtered, FILTER_LENGTH);
+		acc_algorithm_roll_and_push_matrix_f32_complex(history, FILTER_ORDER, FILTER_LENGTH, filtered, true);
+	}
+
+	acc_integration_mem_steady_state_end();
+	acc_integration_mem_get_stats(&after);
+
+	acc_integration_mem_free(frame);
+	acc_integration_mem_free(spectrum);
+	acc_integration_mem_free(filtered);
+	acc_integration_mem_free(history_in);
+	acc_integration_mem_free(history);
+
+	return (after.steady_state_allocations == before.steady_state_allocations) && (after.total_allocations == before.total_allocations);
+}
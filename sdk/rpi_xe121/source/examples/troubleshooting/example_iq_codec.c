@@ -0,0 +1,291 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "acc_definitions_common.h"
+#include "acc_iq_codec.h"
+
+/** \example example_iq_codec.c
+ * @brief This is an example that measures the lossless IQ frame codec
+ * @n
+ * The example executes as follows:
+ *   - Generate synthetic frames, or read frames from a recording
+ *   - Encode and decode every frame and verify that the decoded frame is identical
+ *   - Print the compression ratio and the encode and decode throughput
+ *
+ * A recording is a file with raw frames of acc_int16_complex_t in little endian
+ * byte order and is given together with its frame shape:
+ *   example_iq_codec <recording> <num_points> <sweeps_per_frame>
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host iq_codec_host
+ */
+
+#define SYNTHETIC_FRAMES (200U)
+#define MAX_FRAMES       (2000U)
+#define TIMING_ROUNDS    (20U)
+
+typedef struct
+{
+	const char *name;
+	uint16_t    num_points;
+	uint16_t    sweeps_per_frame;
+	float       noise_amplitude;
+	float       reflector_amplitude;
+} synthetic_session_t;
+
+static const synthetic_session_t synthetic_sessions[] = {
+    {"presence, empty room", 40U, 16U, 8.0f, 200.0f},
+    {"breathing, sitting", 30U, 16U, 8.0f, 2000.0f},
+    {"distance, strong target", 120U, 1U, 16.0f, 8000.0f},
+    {"vibration, high noise", 1U, 1024U, 400.0f, 3000.0f},
+};
+
+#define NBR_SYNTHETIC_SESSIONS (sizeof(synthetic_sessions) / sizeof(synthetic_sessions[0]))
+
+static bool run_session(const char *name, const acc_int16_complex_t *frames, uint32_t frame_count, uint16_t num_points, uint16_t sweeps_per_frame);
+
+static acc_int16_complex_t *generate_session(const synthetic_session_t *session, uint32_t frame_count);
+
+static acc_int16_complex_t *read_recording(const char *path, uint16_t num_points, uint16_t sweeps_per_frame, uint32_t *frame_count);
+
+static float noise(uint32_t *seed);
+
+static double now_us(void);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	bool all_ok = true;
+
+	if (argc == 4)
+	{
+		uint16_t num_points       = (uint16_t)atoi(argv[2]);
+		uint16_t sweeps_per_frame = (uint16_t)atoi(argv[3]);
+		uint32_t frame_count      = 0U;
+
+		if ((num_points == 0U) || (sweeps_per_frame == 0U))
+		{
+			printf("Invalid frame shape\n");
+			return EXIT_FAILURE;
+		}
+
+		acc_int16_complex_t *frames = read_recording(argv[1], num_points, sweeps_per_frame, &frame_count);
+
+		if (frames == NULL)
+		{
+			return EXIT_FAILURE;
+		}
+
+		all_ok = run_session(argv[1], frames, frame_count, num_points, sweeps_per_frame);
+		free(frames);
+	}
+	else if (argc == 1)
+	{
+		for (uint16_t i = 0U; i < NBR_SYNTHETIC_SESSIONS; i++)
+		{
+			const synthetic_session_t *session = &synthetic_sessions[i];
+			acc_int16_complex_t       *frames  = generate_session(session, SYNTHETIC_FRAMES);
+
+			if (frames == NULL)
+			{
+				printf("Failed to allocate frames\n");
+				return EXIT_FAILURE;
+			}
+
+			all_ok = run_session(session->name, frames, SYNTHETIC_FRAMES, session->num_points, session->sweeps_per_frame) && all_ok;
+			free(frames);
+		}
+	}
+	else
+	{
+		printf("Usage: %s [<recording> <num_points> <sweeps_per_frame>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool run_session(const char *name, const acc_int16_complex_t *frames, uint32_t frame_count, uint16_t num_points, uint16_t sweeps_per_frame)
+{
+	uint32_t frame_length = (uint32_t)num_points * sweeps_per_frame;
+	uint32_t max_size     = ACC_IQ_CODEC_MAX_ENCODED_SIZE(num_points, sweeps_per_frame);
+
+	uint8_t             *encoded = malloc((size_t)frame_count * max_size);
+	uint32_t            *sizes   = malloc(frame_count * sizeof(*sizes));
+	acc_int16_complex_t *decoded = malloc(frame_length * sizeof(*decoded));
+	bool                 ok      = (encoded != NULL) && (sizes != NULL) && (decoded != NULL);
+	uint64_t             total   = 0U;
+
+	for (uint32_t f = 0U; ok && (f < frame_count); f++)
+	{
+		const acc_int16_complex_t *frame = &frames[f * frame_length];
+
+		sizes[f] = acc_iq_codec_encode(frame, num_points, sweeps_per_frame, &encoded[f * max_size], max_size);
+		ok       = (sizes[f] > 0U) && acc_iq_codec_decode(&encoded[f * max_size], sizes[f], num_points, sweeps_per_frame, decoded) &&
+		     (memcmp(frame, decoded, frame_length * sizeof(*decoded)) == 0);
+		total += sizes[f];
+	}
+
+	double encode_us = 0.0;
+	double decode_us = 0.0;
+
+	for (uint16_t round = 0U; ok && (round < TIMING_ROUNDS); round++)
+	{
+		double start = now_us();
+
+		for (uint32_t f = 0U; f < frame_count; f++)
+		{
+			(void)acc_iq_codec_encode(&frames[f * frame_length], num_points, sweeps_per_frame, &encoded[f * max_size], max_size);
+		}
+
+		double middle = now_us();
+
+		for (uint32_t f = 0U; f < frame_count; f++)
+		{
+			(void)acc_iq_codec_decode(&encoded[f * max_size], sizes[f], num_points, sweeps_per_frame, decoded);
+		}
+
+		encode_us += middle - start;
+		decode_us += now_us() - middle;
+	}
+
+	if (ok)
+	{
+		double raw_bytes = (double)frame_count * frame_length * sizeof(acc_int16_complex_t);
+
+		printf("%-26s: %4u x %-4u x %4" PRIu32 " frames, ratio %5.2f, encode %7.1f MB/s, decode %7.1f MB/s\n",
+		       name,
+		       (unsigned int)num_points,
+		       (unsigned int)sweeps_per_frame,
+		       frame_count,
+		       raw_bytes / (double)total,
+		       raw_bytes * TIMING_ROUNDS / encode_us,
+		       raw_bytes * TIMING_ROUNDS / decode_us);
+	}
+	else
+	{
+		printf("%-26s: FAILED\n", name);
+	}
+
+	free(encoded);
+	free(sizes);
+	free(decoded);
+
+	return ok;
+}
+
+static acc_int16_complex_t *generate_session(const synthetic_session_t *session, uint32_t frame_count)
+{
+	uint32_t             frame_length = (uint32_t)session->num_points * session->sweeps_per_frame;
+	acc_int16_complex_t *frames       = malloc((size_t)frame_count * frame_length * sizeof(*frames));
+	uint32_t             seed         = 12345U;
+
+	if (frames == NULL)
+	{
+		return NULL;
+	}
+
+	// One slowly moving reflector with an amplitude envelope over depth, plus noise
+	for (uint32_t f = 0U; f < frame_count; f++)
+	{
+		for (uint16_t s = 0U; s < session->sweeps_per_frame; s++)
+		{
+			float phase = 0.05f * (float)((f * session->sweeps_per_frame) + s);
+
+			for (uint16_t p = 0U; p < session->num_points; p++)
+			{
+				float distance  = ((float)p - (0.5f * (float)session->num_points)) / 4.0f;
+				float amplitude = session->reflector_amplitude * expf(-distance * distance);
+				float angle     = phase + (0.8f * (float)p);
+
+				acc_int16_complex_t *point = &frames[(f * frame_length) + ((uint32_t)s * session->num_points) + p];
+
+				point->real = (int16_t)lrintf((amplitude * cosf(angle)) + (session->noise_amplitude * noise(&seed)));
+				point->imag = (int16_t)lrintf((amplitude * sinf(angle)) + (session->noise_amplitude * noise(&seed)));
+			}
+		}
+	}
+
+	return frames;
+}
+
+static acc_int16_complex_t *read_recording(const char *path, uint16_t num_points, uint16_t sweeps_per_frame, uint32_t *frame_count)
+{
+	uint32_t frame_length = (uint32_t)num_points * sweeps_per_frame;
+	uint8_t *bytes        = malloc((size_t)MAX_FRAMES * frame_length * 4U);
+	FILE    *file         = fopen(path, "rb");
+
+	if ((bytes == NULL) || (file == NULL))
+	{
+		printf("Failed to read %s\n", path);
+		free(bytes);
+		if (file != NULL)
+		{
+			fclose(file);
+		}
+
+		return NULL;
+	}
+
+	size_t length = fread(bytes, 4U * frame_length, MAX_FRAMES, file);
+
+	fclose(file);
+
+	*frame_count = (uint32_t)length;
+
+	acc_int16_complex_t *frames = malloc(length * frame_length * sizeof(*frames));
+
+	if ((frames == NULL) || (length == 0U))
+	{
+		printf("No complete frames in %s\n", path);
+		free(bytes);
+		free(frames);
+		return NULL;
+	}
+
+	for (uint32_t i = 0U; i < (*frame_count * frame_length); i++)
+	{
+		frames[i].real = (int16_t)(uint16_t)(bytes[4U * i] | (bytes[(4U * i) + 1U] << 8));
+		frames[i].imag = (int16_t)(uint16_t)(bytes[(4U * i) + 2U] | (bytes[(4U * i) + 3U] << 8));
+	}
+
+	free(bytes);
+
+	return frames;
+}
+
+static float noise(uint32_t *seed)
+{
+	// Sum of uniform values as a cheap approximation of gaussian noise
+	float sum = 0.0f;
+
+	for (uint16_t i = 0U; i < 4U; i++)
+	{
+		*seed = (*seed * 1103515245U) + 12345U;
+		sum += ((float)((*seed >> 16) & 0xffffU) / 32768.0f) - 1.0f;
+	}
+
+	return sum * 0.866f;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
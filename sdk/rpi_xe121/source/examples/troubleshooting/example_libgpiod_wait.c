@@ -0,0 +1,123 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "acc_integration.h"
+#include "acc_libgpiod.h"
+#include "acc_libgpiod_fake.h"
+
+/** \example example_libgpiod_wait.c
+ * @brief This is an example that exercises the interrupt wait of acc_libgpiod with the fake GPIO backend
+ * @n
+ * The example executes as follows:
+ *   - Generate periodic interrupts on a fake interrupt pin
+ *   - Wait for a number of interrupts with the blocking event wait
+ *   - Wait for the same number of interrupts with busy-polling enabled
+ *   - Print the wake-up statistics and latency histograms of both modes
+ *   - Verify that the edge events are read also when busy-polling sees the interrupt first
+ *   - Stop the interrupts and verify that a wait times out
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host libgpiod_host
+ */
+
+#define INTERRUPT_PIN        (26U)
+#define FRAME_PERIOD_US      (1000U)
+#define INTERRUPT_HIGH_US    (200U)
+#define PROCESSING_TIME_US   (300U)
+#define BUSY_POLL_WINDOW_US  (2000U)
+#define NBR_WAITS            (500U)
+#define WAIT_TIMEOUT_MS      (100U)
+#define TIMEOUT_TEST_WAIT_MS (20U)
+
+static const gpio_config_t pin_config[] = {{INTERRUPT_PIN, GPIO_DIR_INPUT_INTERRUPT}, {0, GPIO_DIR_UNKNOWN}};
+
+static bool run_waits(const char *mode, uint32_t busy_poll_window_us);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	bool all_ok = true;
+
+	if (!acc_libgpiod_init(pin_config))
+	{
+		return EXIT_FAILURE;
+	}
+
+	all_ok = run_waits("event wait", 0U) && all_ok;
+	all_ok = run_waits("busy-poll", BUSY_POLL_WINDOW_US) && all_ok;
+
+	acc_libgpiod_fake_set_interrupt(INTERRUPT_PIN, 0U, 0U);
+	acc_libgpiod_set_busy_poll(BUSY_POLL_WINDOW_US, false);
+
+	if (acc_libgpiod_wait_for_interrupt(INTERRUPT_PIN, TIMEOUT_TEST_WAIT_MS))
+	{
+		printf("Wait without interrupt did not time out\n");
+		all_ok = false;
+	}
+
+	acc_libgpiod_deinit();
+
+	printf("%s\n", all_ok ? "All waits OK" : "FAILED");
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool run_waits(const char *mode, uint32_t busy_poll_window_us)
+{
+	uint32_t                  missed = 0U;
+	uint32_t                  queued;
+	uint32_t                  max_queued;
+	uint32_t                  last_wait_us = 0U;
+	uint32_t                  latencies    = 0U;
+	acc_libgpiod_wait_stats_t stats;
+
+	acc_libgpiod_set_busy_poll(busy_poll_window_us, false);
+	acc_libgpiod_reset_wait_stats();
+	acc_libgpiod_fake_set_interrupt(INTERRUPT_PIN, FRAME_PERIOD_US, INTERRUPT_HIGH_US);
+
+	for (uint32_t i = 0U; i < NBR_WAITS; i++)
+	{
+		last_wait_us = acc_integration_get_time_us();
+
+		if (!acc_libgpiod_wait_for_interrupt(INTERRUPT_PIN, WAIT_TIMEOUT_MS))
+		{
+			missed++;
+		}
+
+		// Processing, long enough for the interrupt pin to go low again
+		acc_integration_sleep_us(PROCESSING_TIME_US);
+	}
+
+	// The events from before the last wait have been read, only the edges since then can be queued
+	queued     = acc_libgpiod_fake_get_queued_events(INTERRUPT_PIN);
+	max_queued = ((acc_integration_get_time_us() - last_wait_us) / FRAME_PERIOD_US) + 1U;
+
+	acc_libgpiod_get_wait_stats(&stats);
+
+	for (uint16_t i = 0U; i < ACC_LIBGPIOD_LATENCY_BUCKETS; i++)
+	{
+		latencies += stats.busy_poll_latency[i] + stats.event_latency[i];
+	}
+
+	printf("\n%s, %u waits, %u missed, %u events left queued:\n", mode, (unsigned int)NBR_WAITS, (unsigned int)missed, (unsigned int)queued);
+	acc_libgpiod_print_wait_stats();
+
+	if (latencies == 0U)
+	{
+		printf("No wake-up latency was recorded\n");
+	}
+
+	return (missed == 0U) && (queued <= max_queued) && (latencies > 0U);
+}
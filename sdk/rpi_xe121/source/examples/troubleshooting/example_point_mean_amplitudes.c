@@ -0,0 +1,220 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "acc_algorithm_kernels.h"
+#include "acc_control_helper.h"
+#include "acc_definitions_common.h"
+#include "acc_processing_helpers.h"
+
+/** \example example_point_mean_amplitudes.c
+ * @brief This is an example that verifies and measures acc_processing_helper_point_mean_amplitudes
+ * @n
+ * The example executes as follows:
+ *   - Generate synthetic frames of 20-200 points and 8-64 sweeps
+ *   - Calculate the coherent and non-coherent mean amplitude of every point with
+ *     acc_get_iq_point_vector and the vector mean functions, as the static presence example did
+ *   - Calculate the same values with acc_processing_helper_point_mean_amplitudes for
+ *     every kernel variant available on the CPU and compare them with the first
+ *   - Print the time per frame of both
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host point_means_host
+ */
+
+#define TIMING_ROUNDS   (2000U)
+#define ERROR_TOLERANCE (1e-5f)
+
+typedef struct
+{
+	uint16_t num_points;
+	uint16_t sweeps_per_frame;
+} frame_shape_t;
+
+static const frame_shape_t frame_shapes[] = {
+	{20U, 8U},
+	{20U, 64U},
+	{60U, 16U},
+	{120U, 32U},
+	{200U, 8U},
+	{200U, 64U},
+};
+
+#define NBR_FRAME_SHAPES (sizeof(frame_shapes) / sizeof(frame_shapes[0]))
+
+static bool run_shape(const frame_shape_t *shape);
+
+static void gather_means(const acc_control_helper_t *state, acc_vector_iq_t *point_vector, acc_vector_float_t *coherent, acc_vector_float_t *noncoherent);
+
+static float max_error(const acc_vector_float_t *a, const acc_vector_float_t *b);
+
+static void fill_frame(acc_int16_complex_t *frame, const frame_shape_t *shape);
+
+static double now_us(void);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	bool all_ok = true;
+
+	for (uint16_t i = 0U; i < NBR_FRAME_SHAPES; i++)
+	{
+		all_ok = run_shape(&frame_shapes[i]) && all_ok;
+	}
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool run_shape(const frame_shape_t *shape)
+{
+	uint32_t num_points       = shape->num_points;
+	uint32_t sweeps_per_frame = shape->sweeps_per_frame;
+
+	acc_control_helper_t state = {0};
+
+	state.proc_meta.sweep_data_length = (uint16_t)num_points;
+	state.proc_meta.frame_data_length = (uint16_t)(num_points * sweeps_per_frame);
+	state.proc_result.frame           = malloc(num_points * sweeps_per_frame * sizeof(acc_int16_complex_t));
+
+	acc_vector_iq_t    *point_vector         = acc_vector_iq_alloc(sweeps_per_frame);
+	acc_vector_float_t *expected_coherent    = acc_vector_float_alloc(num_points);
+	acc_vector_float_t *expected_noncoherent = acc_vector_float_alloc(num_points);
+	acc_vector_float_t *coherent             = acc_vector_float_alloc(num_points);
+	acc_vector_float_t *noncoherent          = acc_vector_float_alloc(num_points);
+
+	bool ok = (state.proc_result.frame != NULL) && (point_vector != NULL) && (expected_coherent != NULL) &&
+	          (expected_noncoherent != NULL) && (coherent != NULL) && (noncoherent != NULL);
+
+	if (ok)
+	{
+		fill_frame(state.proc_result.frame, shape);
+		gather_means(&state, point_vector, expected_coherent, expected_noncoherent);
+
+		double start = now_us();
+
+		for (uint16_t round = 0U; round < TIMING_ROUNDS; round++)
+		{
+			gather_means(&state, point_vector, expected_coherent, expected_noncoherent);
+		}
+
+		printf("%3u points x %2u sweeps: gather %7.2f us", (unsigned int)num_points, (unsigned int)sweeps_per_frame, (now_us() - start) / TIMING_ROUNDS);
+	}
+
+	acc_algorithm_kernels_variant_t default_variant = acc_algorithm_kernels_get_selected_variant();
+
+	for (uint16_t v = 0U; ok && (v < ACC_ALGORITHM_KERNELS_NUM_VARIANTS); v++)
+	{
+		acc_algorithm_kernels_variant_t variant = (acc_algorithm_kernels_variant_t)v;
+
+		if (!acc_algorithm_kernels_select(variant))
+		{
+			continue;
+		}
+
+		acc_processing_helper_point_mean_amplitudes(state.proc_result.frame, num_points, sweeps_per_frame, coherent, noncoherent);
+
+		float error = fmaxf(max_error(expected_coherent, coherent), max_error(expected_noncoherent, noncoherent));
+
+		ok = error <= ERROR_TOLERANCE;
+
+		double start = now_us();
+
+		for (uint16_t round = 0U; round < TIMING_ROUNDS; round++)
+		{
+			acc_processing_helper_point_mean_amplitudes(state.proc_result.frame, num_points, sweeps_per_frame, coherent, noncoherent);
+		}
+
+		printf(", %s %6.2f us (error %.1e)",
+		       acc_algorithm_kernels_variant_name(variant),
+		       (now_us() - start) / TIMING_ROUNDS,
+		       (double)error);
+	}
+
+	printf(": %s\n", ok ? "OK" : "FAILED");
+
+	(void)acc_algorithm_kernels_select(default_variant);
+
+	free(state.proc_result.frame);
+	acc_vector_iq_free(point_vector);
+	acc_vector_float_free(expected_coherent);
+	acc_vector_float_free(expected_noncoherent);
+	acc_vector_float_free(coherent);
+	acc_vector_float_free(noncoherent);
+
+	return ok;
+}
+
+static void gather_means(const acc_control_helper_t *state, acc_vector_iq_t *point_vector, acc_vector_float_t *coherent, acc_vector_float_t *noncoherent)
+{
+	for (uint32_t p = 0U; p < coherent->data_length; p++)
+	{
+		acc_get_iq_point_vector(state, p, point_vector);
+
+		coherent->data[p]    = acc_vector_iq_coherent_mean_amplitude(point_vector);
+		noncoherent->data[p] = acc_vector_iq_noncoherent_mean_amplitude(point_vector);
+	}
+}
+
+static float max_error(const acc_vector_float_t *a, const acc_vector_float_t *b)
+{
+	float error = 0.0f;
+
+	for (uint32_t i = 0U; i < a->data_length; i++)
+	{
+		error = fmaxf(error, fabsf(a->data[i] - b->data[i]) / fmaxf(1.0f, fabsf(a->data[i])));
+	}
+
+	return error;
+}
+
+static void fill_frame(acc_int16_complex_t *frame, const frame_shape_t *shape)
+{
+	uint32_t seed = 12345U;
+
+	// Static reflectors with a stable phase on some points and noise with random phase on the others
+	for (uint16_t s = 0U; s < shape->sweeps_per_frame; s++)
+	{
+		for (uint16_t p = 0U; p < shape->num_points; p++)
+		{
+			float amplitude = ((p % 7U) == 0U) ? 2000.0f : 0.0f;
+			float angle     = 0.3f * (float)p;
+
+			seed             = (seed * 1103515245U) + 12345U;
+			float noise_real = (float)((int32_t)((seed >> 16) & 0x1ffU) - 256);
+			seed             = (seed * 1103515245U) + 12345U;
+			float noise_imag = (float)((int32_t)((seed >> 16) & 0x1ffU) - 256);
+
+			acc_int16_complex_t *point = &frame[((uint32_t)s * shape->num_points) + p];
+
+			point->real = (int16_t)lrintf((amplitude * cosf(angle)) + noise_real);
+			point->imag = (int16_t)lrintf((amplitude * sinf(angle)) + noise_imag);
+		}
+	}
+
+	// Full scale values to check the integer accumulation
+	frame[0].real = INT16_MIN;
+	frame[0].imag = INT16_MAX;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
@@ -0,0 +1,785 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "acc_definitions_common.h"
+#include "acc_iq_codec.h"
+#include "acc_processing_server.h"
+#include "acc_socket_server.h"
+
+/** \example example_processing_server_loopback.c
+ * @brief This is an example that runs the protocol of acc_processing_server_a121
+ *        against a fake sensor through a loopback socket
+ * @n
+ * The example executes as follows:
+ *   - Serve the protocol of acc_processing_server.h on a free port from a server thread,
+ *     with a fake processing chain on a fake sensor that generates known frames
+ *   - Connect as a client and check:
+ *     - The chains and the raw encodings reported by get_system_info
+ *     - The replies to unknown chains, encodings and commands, a command split over writes,
+ *       and keys found by their position, not by a value with the same name
+ *     - Streaming with every 3:rd frame iq_delta encoded: the results follow the measurements,
+ *       the raw frames are numbered after the results and decode to the measured frames,
+ *       and a frame that needs calibration recalibrates the sensor in place, without powering it
+ *       down, and prepares the chain again without a result
+ *     - Streaming with every frame uncompressed: the raw frames are the measured frames
+ *     - A failed measurement ends the streaming with an error
+ *     - A client that disconnects while streaming releases the sensor
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host processing_server_host
+ */
+
+#define NUM_POINTS       (40U)
+#define SWEEPS_PER_FRAME (8U)
+#define FRAME_LENGTH     (NUM_POINTS * SWEEPS_PER_FRAME)
+#define FRAME_PERIOD_US  (2000U)
+
+#define REPLY_TIMEOUT_MS (2000U)
+#define MAX_LINE_SIZE    (512U)
+
+#define IQ_DELTA_DECIMATION   (3U)
+#define IQ_DELTA_RESULTS      (30U)
+#define CALIBRATION_AT        (10U)
+#define UNCOMPRESSED_RESULTS  (5U)
+#define FAILED_MEASUREMENT_AT (5U)
+
+#define NO_INJECTION UINT32_MAX
+
+typedef struct
+{
+	uint32_t measurement;
+	uint32_t calibration_at;
+	uint32_t failure_at;
+	uint32_t sensor_prepares;
+	uint32_t recalibrations;
+	uint32_t chain_prepares;
+	uint32_t chains_created;
+	uint32_t chains_destroyed;
+	bool     sensor_powered;
+} fake_t;
+
+static bool fake_create(uint32_t *buffer_size, uint16_t *num_points, uint16_t *sweeps_per_frame);
+
+static bool fake_prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size);
+
+static bool fake_process(void *buffer, char *message, size_t message_size, acc_processing_result_t *processing_result);
+
+static void fake_destroy(void);
+
+static bool fake_sensor_prepare(const acc_processing_server_chain_t *chain, void *buffer, uint32_t buffer_size);
+
+static bool fake_sensor_recalibrate(const acc_processing_server_chain_t *chain, void *buffer, uint32_t buffer_size);
+
+static bool fake_sensor_measure(void *buffer, uint32_t buffer_size);
+
+static void fake_sensor_release(void);
+
+static void fake_inject(uint32_t calibration_at, uint32_t failure_at);
+
+static void fake_get(fake_t *state);
+
+static void *server_thread(void *arg);
+
+static bool check(bool ok, const char *name);
+
+static bool run_client(int port);
+
+static bool check_system_info(int fd);
+
+static bool check_errors(int fd);
+
+static bool check_iq_delta(int fd);
+
+static bool check_uncompressed(int fd);
+
+static bool check_failure(int fd);
+
+static bool check_disconnect(int port);
+
+static int connect_client(int port);
+
+static bool command(int fd, const char *cmd, char *reply, size_t reply_size);
+
+static bool skip_until(int fd, const char *expected);
+
+static bool send_text(int fd, const char *text);
+
+static bool read_line(int fd, char *line, size_t line_size);
+
+static bool read_exact(int fd, void *data, size_t size);
+
+static void generate_frame(uint32_t measurement, acc_int16_complex_t *frame);
+
+static uint32_t frame_checksum(const acc_int16_complex_t *frame);
+
+int main(int argc, char *argv[]);
+
+static const acc_processing_server_chain_t fake_chains[] = {
+    {"fake", fake_create, fake_prepare, fake_process, fake_destroy},
+};
+
+static const acc_processing_server_sensor_t fake_sensor = {fake_sensor_prepare, fake_sensor_recalibrate, fake_sensor_measure, fake_sensor_release};
+
+static fake_t          fake       = {0};
+static pthread_mutex_t fake_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static acc_socket_server_t socket_server   = {0};
+static volatile bool       server_shutdown = false;
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	fake_inject(NO_INJECTION, NO_INJECTION);
+
+	/* A client disconnects while streaming, ignore broken pipe like acc_processing_server_a121 does */
+	signal(SIGPIPE, SIG_IGN);
+
+	if (!acc_socket_server_open(&socket_server, 0, ACC_PROCESSING_SERVER_MAX_COMMAND_SIZE))
+	{
+		printf("Failed to open socket server\n");
+		return EXIT_FAILURE;
+	}
+
+	struct sockaddr_in addr;
+	socklen_t          addr_length = sizeof(addr);
+	pthread_t          server;
+
+	if (getsockname(socket_server.server_socket, (struct sockaddr *)&addr, &addr_length) != 0)
+	{
+		printf("Failed to get server port\n");
+		acc_socket_server_close(&socket_server);
+		return EXIT_FAILURE;
+	}
+
+	if (pthread_create(&server, NULL, server_thread, NULL) != 0)
+	{
+		printf("Failed to start server thread\n");
+		acc_socket_server_close(&socket_server);
+		return EXIT_FAILURE;
+	}
+
+	bool all_ok = run_client(ntohs(addr.sin_port));
+
+	// Shutting the listening socket down wakes the server thread up from accept
+	server_shutdown = true;
+	shutdown(socket_server.server_socket, SHUT_RDWR);
+	pthread_join(server, NULL);
+
+	fake_t state;
+
+	fake_get(&state);
+
+	all_ok = check((state.chains_created == state.chains_destroyed) && !state.sensor_powered, "released at shutdown") && all_ok;
+
+	acc_socket_server_close(&socket_server);
+
+	printf("%s\n", all_ok ? "OK" : "FAILED");
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool fake_create(uint32_t *buffer_size, uint16_t *num_points, uint16_t *sweeps_per_frame)
+{
+	pthread_mutex_lock(&fake_mutex);
+	fake.chains_created++;
+	pthread_mutex_unlock(&fake_mutex);
+
+	*buffer_size      = FRAME_LENGTH * sizeof(acc_int16_complex_t);
+	*num_points       = NUM_POINTS;
+	*sweeps_per_frame = SWEEPS_PER_FRAME;
+
+	return true;
+}
+
+static bool fake_prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size)
+{
+	(void)sensor;
+	(void)cal_result;
+	(void)buffer;
+
+	pthread_mutex_lock(&fake_mutex);
+	fake.chain_prepares++;
+	pthread_mutex_unlock(&fake_mutex);
+
+	return buffer_size >= (FRAME_LENGTH * sizeof(acc_int16_complex_t));
+}
+
+static bool fake_process(void *buffer, char *message, size_t message_size, acc_processing_result_t *processing_result)
+{
+	acc_int16_complex_t *frame = buffer;
+
+	pthread_mutex_lock(&fake_mutex);
+	uint32_t measurement = fake.measurement - 1U;
+	bool     calibration = measurement == fake.calibration_at;
+	pthread_mutex_unlock(&fake_mutex);
+
+	memset(processing_result, 0, sizeof(*processing_result));
+	processing_result->calibration_needed = calibration;
+	processing_result->frame              = frame;
+
+	snprintf(message,
+	         message_size,
+	         "{\"type\":\"fake\",\"measurement\":%" PRIu32 ",\"checksum\":%" PRIu32 "}",
+	         measurement,
+	         frame_checksum(frame));
+
+	return true;
+}
+
+static void fake_destroy(void)
+{
+	pthread_mutex_lock(&fake_mutex);
+	fake.chains_destroyed++;
+	pthread_mutex_unlock(&fake_mutex);
+}
+
+static bool fake_sensor_prepare(const acc_processing_server_chain_t *chain, void *buffer, uint32_t buffer_size)
+{
+	pthread_mutex_lock(&fake_mutex);
+	fake.sensor_prepares++;
+	fake.sensor_powered = true;
+	pthread_mutex_unlock(&fake_mutex);
+
+	return chain->prepare(NULL, NULL, buffer, buffer_size);
+}
+
+static bool fake_sensor_recalibrate(const acc_processing_server_chain_t *chain, void *buffer, uint32_t buffer_size)
+{
+	pthread_mutex_lock(&fake_mutex);
+	bool powered = fake.sensor_powered;
+	fake.recalibrations++;
+	pthread_mutex_unlock(&fake_mutex);
+
+	// Only a sensor that is powered and prepared can be recalibrated in place
+	return powered && chain->prepare(NULL, NULL, buffer, buffer_size);
+}
+
+static bool fake_sensor_measure(void *buffer, uint32_t buffer_size)
+{
+	usleep(FRAME_PERIOD_US);
+
+	pthread_mutex_lock(&fake_mutex);
+	uint32_t measurement = fake.measurement++;
+	bool     failure     = measurement == fake.failure_at;
+	pthread_mutex_unlock(&fake_mutex);
+
+	if (failure || (buffer_size < (FRAME_LENGTH * sizeof(acc_int16_complex_t))))
+	{
+		return false;
+	}
+
+	generate_frame(measurement, buffer);
+
+	return true;
+}
+
+static void fake_sensor_release(void)
+{
+	pthread_mutex_lock(&fake_mutex);
+	fake.measurement    = 0U;
+	fake.sensor_powered = false;
+	pthread_mutex_unlock(&fake_mutex);
+}
+
+static void fake_inject(uint32_t calibration_at, uint32_t failure_at)
+{
+	pthread_mutex_lock(&fake_mutex);
+	fake.calibration_at = calibration_at;
+	fake.failure_at     = failure_at;
+	pthread_mutex_unlock(&fake_mutex);
+}
+
+static void fake_get(fake_t *state)
+{
+	pthread_mutex_lock(&fake_mutex);
+	*state = fake;
+	pthread_mutex_unlock(&fake_mutex);
+}
+
+static void *server_thread(void *arg)
+{
+	(void)arg;
+
+	acc_processing_server_config_t config;
+
+	config.chains       = fake_chains;
+	config.num_chains   = sizeof(fake_chains) / sizeof(fake_chains[0]);
+	config.sensor       = &fake_sensor;
+	config.rss_version  = "loopback";
+	config.sensor_count = 1U;
+
+	acc_processing_server_serve(&socket_server, &config, &server_shutdown);
+
+	return NULL;
+}
+
+static bool check(bool ok, const char *name)
+{
+	printf("  %-22s %s\n", name, ok ? "ok" : "FAILED");
+
+	return ok;
+}
+
+static bool run_client(int port)
+{
+	int fd = connect_client(port);
+
+	if (fd < 0)
+	{
+		return check(false, "connect");
+	}
+
+	bool all_ok = true;
+
+	all_ok = check_system_info(fd) && all_ok;
+	all_ok = check_errors(fd) && all_ok;
+	all_ok = check_iq_delta(fd) && all_ok;
+	all_ok = check_uncompressed(fd) && all_ok;
+	all_ok = check_failure(fd) && all_ok;
+
+	close(fd);
+
+	all_ok = check_disconnect(port) && all_ok;
+
+	return all_ok;
+}
+
+static bool check_system_info(int fd)
+{
+	char reply[MAX_LINE_SIZE];
+
+	bool ok = command(fd, "{\"cmd\":\"get_system_info\"}", reply, sizeof(reply)) &&
+	          (strcmp(reply,
+	                  "{\"status\":\"ok\",\"rss_version\":\"loopback\",\"sensor_count\":1,\"processing\":[\"fake\"],"
+	                  "\"raw_encoding\":[\"none\",\"iq_delta\"]}") == 0);
+
+	return check(ok, "get_system_info");
+}
+
+static bool check_errors(int fd)
+{
+	char reply[MAX_LINE_SIZE];
+	bool all_ok = true;
+
+	bool ok = command(fd, "{\"cmd\":\"start_streaming\",\"processing\":\"radar\"}", reply, sizeof(reply)) &&
+	          (strcmp(reply, "{\"status\":\"error\",\"message\":\"unknown processing\"}") == 0);
+	all_ok = check(ok, "unknown processing") && all_ok;
+
+	ok = command(fd, "{\"cmd\":\"start_streaming\",\"processing\":\"fake\",\"raw_encoding\":\"zip\"}", reply, sizeof(reply)) &&
+	     (strcmp(reply, "{\"status\":\"error\",\"message\":\"unknown raw_encoding\"}") == 0);
+	all_ok = check(ok, "unknown raw_encoding") && all_ok;
+
+	ok = command(fd, "{\"processing\":\"fake\"}", reply, sizeof(reply)) &&
+	     (strcmp(reply, "{\"status\":\"error\",\"message\":\"missing cmd\"}") == 0);
+	all_ok = check(ok, "missing cmd") && all_ok;
+
+	ok = command(fd, "{\"cmd\":\"reboot\"}", reply, sizeof(reply)) && (strcmp(reply, "{\"status\":\"error\",\"message\":\"unknown cmd\"}") == 0);
+	all_ok = check(ok, "unknown cmd") && all_ok;
+
+	// The server must wait for the newline of a command that arrives in several reads
+	ok = send_text(fd, "{\"cmd\":\"stop_str");
+	usleep(100000U);
+	ok     = ok && command(fd, "eaming\"}", reply, sizeof(reply)) && (strcmp(reply, "{\"status\":\"stop\"}") == 0);
+	all_ok = check(ok, "split command") && all_ok;
+
+	// A value that is the name of a key, and whitespace around the key, must not hide the key
+	ok = command(fd, "{\"processing\":\"cmd\", \"cmd\" : \"stop_streaming\"}", reply, sizeof(reply)) &&
+	     (strcmp(reply, "{\"status\":\"stop\"}") == 0);
+	all_ok = check(ok, "key after equal value") && all_ok;
+
+	fake_t state;
+
+	fake_get(&state);
+
+	all_ok = check((state.chains_created == state.chains_destroyed) && !state.sensor_powered, "nothing left prepared") && all_ok;
+
+	return all_ok;
+}
+
+static bool check_iq_delta(int fd)
+{
+	char                reply[MAX_LINE_SIZE];
+	acc_int16_complex_t expected[FRAME_LENGTH];
+	acc_int16_complex_t decoded[FRAME_LENGTH];
+	uint8_t             encoded[ACC_IQ_CODEC_MAX_ENCODED_SIZE(NUM_POINTS, SWEEPS_PER_FRAME)];
+	fake_t              before;
+
+	fake_get(&before);
+	fake_inject(CALIBRATION_AT, NO_INJECTION);
+
+	bool ok = command(fd, "{\"cmd\":\"start_streaming\",\"processing\":\"fake\",\"raw_decimation\":3,\"raw_encoding\":\"iq_delta\"}", reply, sizeof(reply)) &&
+	          (strcmp(reply,
+	                  "{\"status\":\"start\",\"processing\":\"fake\",\"raw_decimation\":3,\"raw_encoding\":\"iq_delta\","
+	                  "\"num_points\":40,\"sweeps_per_frame\":8}") == 0);
+	bool all_ok = check(ok, "start iq_delta");
+
+	bool     sequence_ok      = ok;
+	bool     decode_ok        = ok;
+	bool     have_raw         = false;
+	uint32_t results          = 0U;
+	uint32_t raw_frames       = 0U;
+	uint32_t expected_measure = 0U;
+	uint64_t encoded_bytes    = 0U;
+
+	while (ok && (results < IQ_DELTA_RESULTS))
+	{
+		uint32_t frame;
+		uint32_t encoded_size;
+		uint32_t measurement;
+		uint32_t checksum;
+		unsigned num_points;
+		unsigned sweeps_per_frame;
+
+		ok = read_line(fd, reply, sizeof(reply));
+
+		if (ok &&
+		    (sscanf(reply,
+		            "{\"type\":\"raw\",\"frame\":%" SCNu32 ",\"num_points\":%u,\"sweeps_per_frame\":%u,\"encoded_size\":%" SCNu32 "}",
+		            &frame,
+		            &num_points,
+		            &sweeps_per_frame,
+		            &encoded_size) == 4))
+		{
+			ok = (encoded_size <= sizeof(encoded)) && read_exact(fd, encoded, encoded_size);
+
+			sequence_ok = sequence_ok && ok && !have_raw && (frame == results) && ((frame % IQ_DELTA_DECIMATION) == 0U);
+			decode_ok   = decode_ok && ok && (num_points == NUM_POINTS) && (sweeps_per_frame == SWEEPS_PER_FRAME) &&
+			            acc_iq_codec_decode(encoded, encoded_size, NUM_POINTS, SWEEPS_PER_FRAME, decoded);
+
+			encoded_bytes += encoded_size;
+			have_raw       = true;
+			raw_frames++;
+		}
+		else if (ok && (sscanf(reply, "{\"type\":\"fake\",\"measurement\":%" SCNu32 ",\"checksum\":%" SCNu32 "}", &measurement, &checksum) == 2))
+		{
+			// The frame that needs calibration is measured but not reported
+			if (expected_measure == CALIBRATION_AT)
+			{
+				expected_measure++;
+			}
+
+			generate_frame(measurement, expected);
+
+			sequence_ok = sequence_ok && (measurement == expected_measure) && (have_raw == ((results % IQ_DELTA_DECIMATION) == 0U));
+			decode_ok   = decode_ok && (checksum == frame_checksum(expected)) && (!have_raw || (memcmp(decoded, expected, sizeof(expected)) == 0));
+
+			have_raw = false;
+			expected_measure++;
+			results++;
+		}
+		else
+		{
+			ok = false;
+		}
+	}
+
+	sequence_ok = sequence_ok && ok && (raw_frames == (IQ_DELTA_RESULTS / IQ_DELTA_DECIMATION));
+	all_ok      = check(sequence_ok, "results and raw frames") && all_ok;
+	all_ok      = check(decode_ok, "iq_delta decodes") && all_ok;
+
+	ok     = send_text(fd, "{\"cmd\":\"stop_streaming\"}\n") && skip_until(fd, "{\"status\":\"stop\"}");
+	all_ok = check(ok, "stop iq_delta") && all_ok;
+
+	fake_t after;
+
+	fake_get(&after);
+	fake_inject(NO_INJECTION, NO_INJECTION);
+
+	// The sensor is prepared once at the start and recalibrated in place, the chain is prepared for both
+	all_ok = check(((after.sensor_prepares - before.sensor_prepares) == 1U) && ((after.recalibrations - before.recalibrations) == 1U) &&
+	                   ((after.chain_prepares - before.chain_prepares) == 2U),
+	               "recalibration") &&
+	         all_ok;
+
+	if (raw_frames > 0U)
+	{
+		printf("  iq_delta %.1f%% of raw size\n", 100.0 * (double)encoded_bytes / ((double)raw_frames * (double)sizeof(expected)));
+	}
+
+	return all_ok;
+}
+
+static bool check_uncompressed(int fd)
+{
+	char                reply[MAX_LINE_SIZE];
+	acc_int16_complex_t expected[FRAME_LENGTH];
+	acc_int16_complex_t raw[FRAME_LENGTH];
+
+	bool ok = command(fd, "{\"cmd\":\"start_streaming\",\"processing\":\"fake\",\"raw_decimation\":1}", reply, sizeof(reply)) &&
+	          (strstr(reply, "\"raw_encoding\":\"none\"") != NULL);
+	bool all_ok = check(ok, "start uncompressed");
+
+	bool raw_ok = ok;
+
+	for (uint32_t i = 0U; ok && (i < UNCOMPRESSED_RESULTS); i++)
+	{
+		uint32_t frame;
+		uint32_t encoded_size;
+		uint32_t measurement;
+		uint32_t checksum;
+		unsigned num_points;
+		unsigned sweeps_per_frame;
+
+		ok = read_line(fd, reply, sizeof(reply)) &&
+		     (sscanf(reply,
+		             "{\"type\":\"raw\",\"frame\":%" SCNu32 ",\"num_points\":%u,\"sweeps_per_frame\":%u,\"encoded_size\":%" SCNu32 "}",
+		             &frame,
+		             &num_points,
+		             &sweeps_per_frame,
+		             &encoded_size) == 4) &&
+		     (encoded_size == sizeof(raw)) && read_exact(fd, raw, sizeof(raw)) && read_line(fd, reply, sizeof(reply)) &&
+		     (sscanf(reply, "{\"type\":\"fake\",\"measurement\":%" SCNu32 ",\"checksum\":%" SCNu32 "}", &measurement, &checksum) == 2);
+
+		if (ok)
+		{
+			generate_frame(measurement, expected);
+			ok = (frame == i) && (measurement == i) && (memcmp(raw, expected, sizeof(expected)) == 0);
+		}
+
+		raw_ok = raw_ok && ok;
+	}
+
+	all_ok = check(raw_ok, "uncompressed frames") && all_ok;
+
+	ok     = send_text(fd, "{\"cmd\":\"stop_streaming\"}\n") && skip_until(fd, "{\"status\":\"stop\"}");
+	all_ok = check(ok, "stop uncompressed") && all_ok;
+
+	return all_ok;
+}
+
+static bool check_failure(int fd)
+{
+	char reply[MAX_LINE_SIZE];
+
+	fake_inject(NO_INJECTION, FAILED_MEASUREMENT_AT);
+
+	bool ok = command(fd, "{\"cmd\":\"start_streaming\",\"processing\":\"fake\"}", reply, sizeof(reply)) &&
+	          (strstr(reply, "{\"status\":\"start\"") == reply);
+
+	// Without raw frames, every measurement before the failure gives a result
+	for (uint32_t i = 0U; ok && (i < FAILED_MEASUREMENT_AT); i++)
+	{
+		uint32_t measurement;
+		uint32_t checksum;
+
+		ok = read_line(fd, reply, sizeof(reply)) &&
+		     (sscanf(reply, "{\"type\":\"fake\",\"measurement\":%" SCNu32 ",\"checksum\":%" SCNu32 "}", &measurement, &checksum) == 2) &&
+		     (measurement == i);
+	}
+
+	ok = ok && read_line(fd, reply, sizeof(reply)) && (strcmp(reply, "{\"status\":\"error\",\"message\":\"measurement failed\"}") == 0);
+
+	// Nothing may be streamed after the error
+	ok = ok && command(fd, "{\"cmd\":\"stop_streaming\"}", reply, sizeof(reply)) && (strcmp(reply, "{\"status\":\"stop\"}") == 0);
+
+	fake_inject(NO_INJECTION, NO_INJECTION);
+
+	fake_t state;
+
+	fake_get(&state);
+
+	ok = ok && (state.chains_created == state.chains_destroyed) && !state.sensor_powered;
+
+	return check(ok, "measurement failed");
+}
+
+static bool check_disconnect(int port)
+{
+	char reply[MAX_LINE_SIZE];
+	int  fd = connect_client(port);
+
+	bool ok = (fd >= 0) && command(fd, "{\"cmd\":\"start_streaming\",\"processing\":\"fake\"}", reply, sizeof(reply)) &&
+	          (strstr(reply, "{\"status\":\"start\"") == reply) && read_line(fd, reply, sizeof(reply));
+
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+
+	fake_t state;
+
+	fake_get(&state);
+
+	for (uint32_t waited_ms = 0U; ok && state.sensor_powered && (waited_ms < REPLY_TIMEOUT_MS); waited_ms += 10U)
+	{
+		usleep(10000U);
+		fake_get(&state);
+	}
+
+	ok = ok && (state.chains_created == state.chains_destroyed) && !state.sensor_powered;
+
+	return check(ok, "disconnect releases");
+}
+
+static int connect_client(int port)
+{
+	struct sockaddr_in addr;
+	int                fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port        = htons((uint16_t)port);
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static bool command(int fd, const char *cmd, char *reply, size_t reply_size)
+{
+	return send_text(fd, cmd) && send_text(fd, "\n") && read_line(fd, reply, reply_size);
+}
+
+static bool skip_until(int fd, const char *expected)
+{
+	char    line[MAX_LINE_SIZE];
+	uint8_t data[FRAME_LENGTH * sizeof(acc_int16_complex_t) + 64U];
+
+	while (read_line(fd, line, sizeof(line)))
+	{
+		uint32_t frame;
+		uint32_t encoded_size;
+		unsigned num_points;
+		unsigned sweeps_per_frame;
+
+		if (strcmp(line, expected) == 0)
+		{
+			return true;
+		}
+
+		if ((sscanf(line,
+		            "{\"type\":\"raw\",\"frame\":%" SCNu32 ",\"num_points\":%u,\"sweeps_per_frame\":%u,\"encoded_size\":%" SCNu32 "}",
+		            &frame,
+		            &num_points,
+		            &sweeps_per_frame,
+		            &encoded_size) == 4) &&
+		    ((encoded_size > sizeof(data)) || !read_exact(fd, data, encoded_size)))
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+static bool send_text(int fd, const char *text)
+{
+	size_t length = strlen(text);
+
+	return send(fd, text, length, MSG_NOSIGNAL) == (ssize_t)length;
+}
+
+static bool read_line(int fd, char *line, size_t line_size)
+{
+	size_t length = 0U;
+
+	while (length < (line_size - 1U))
+	{
+		struct pollfd fds = {.fd = fd, .events = POLLIN};
+		char          c;
+
+		if ((poll(&fds, 1, (int)REPLY_TIMEOUT_MS) <= 0) || (read(fd, &c, 1U) != 1))
+		{
+			break;
+		}
+
+		if (c == '\n')
+		{
+			line[length] = '\0';
+			return true;
+		}
+
+		line[length++] = c;
+	}
+
+	line[length] = '\0';
+
+	return false;
+}
+
+static bool read_exact(int fd, void *data, size_t size)
+{
+	uint8_t *bytes  = data;
+	size_t   length = 0U;
+
+	while (length < size)
+	{
+		struct pollfd fds = {.fd = fd, .events = POLLIN};
+
+		if (poll(&fds, 1, (int)REPLY_TIMEOUT_MS) <= 0)
+		{
+			return false;
+		}
+
+		ssize_t count = read(fd, &bytes[length], size - length);
+
+		if (count <= 0)
+		{
+			return false;
+		}
+
+		length += (size_t)count;
+	}
+
+	return true;
+}
+
+static void generate_frame(uint32_t measurement, acc_int16_complex_t *frame)
+{
+	for (uint32_t sweep = 0U; sweep < SWEEPS_PER_FRAME; sweep++)
+	{
+		for (uint32_t point = 0U; point < NUM_POINTS; point++)
+		{
+			acc_int16_complex_t *sample = &frame[(sweep * NUM_POINTS) + point];
+
+			sample->real = (int16_t)((int32_t)(((measurement * 97U) + (sweep * 31U) + (point * 7U)) % 4001U) - 2000);
+			sample->imag = (int16_t)((int32_t)(((measurement * 13U) + (sweep * 5U) + (point * 53U)) % 4001U) - 2000);
+		}
+	}
+
+	// Full scale samples that move between frames, so the largest deltas are encoded too
+	frame[measurement % FRAME_LENGTH].real       = INT16_MIN;
+	frame[(measurement + 1U) % FRAME_LENGTH].imag = INT16_MAX;
+}
+
+static uint32_t frame_checksum(const acc_int16_complex_t *frame)
+{
+	uint32_t checksum = 0U;
+
+	for (uint32_t i = 0U; i < FRAME_LENGTH; i++)
+	{
+		checksum = (checksum * 31U) + (uint16_t)frame[i].real;
+		checksum = (checksum * 31U) + (uint16_t)frame[i].imag;
+	}
+
+	return checksum;
+}
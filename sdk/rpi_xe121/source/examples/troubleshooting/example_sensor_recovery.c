@@ -0,0 +1,463 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_definitions_a121.h"
+#include "acc_definitions_common.h"
+#include "acc_hal_definitions_a121.h"
+#include "acc_hal_fault_injection.h"
+#include "acc_hal_integration_a121.h"
+#include "acc_rss_a121.h"
+#include "acc_sensor.h"
+#include "acc_sensor_recovery.h"
+
+/** \example example_sensor_recovery.c
+ * @brief This is an example that injects sensor faults and checks how acc_sensor_recovery recovers
+ * @n
+ * The example executes as follows:
+ *   - Register a fake board HAL wrapped by acc_hal_fault_injection, the way ref_app_breathing does.
+ *     A fake sensor stands in for the sensor and the RSS library: it answers SPI transfers while it is
+ *     powered and enabled, loses its configuration on a failed transfer or a reset, and only accepts
+ *     a calibration from the current power cycle
+ *   - For each scenario, start the sensor, inject interrupt timeouts or transfer failures and measure
+ *     frames with acc_sensor_recovery_measure:
+ *     - Check that a new frame is read after every recovery, or that the measurement fails when the
+ *       sensor cannot be recovered
+ *     - Check the faults, the step that recovered from them and the recovery durations in the statistics
+ *     - Check that the sensor is powered off and destroyed when stopped
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host sensor_recovery_host
+ */
+
+#define SENSOR_ID         (1U)
+#define SENSOR_TIMEOUT_MS (1000U)
+#define FRAMES            (60U)
+#define CAL_RESULT_MARKER (0xca1U)
+#define SENSOR_RESPONSE   (0xa1U)
+
+typedef struct
+{
+	const char *name;
+	/** Period and burst of each fault kind, a period of 0 injects no faults of that kind */
+	uint32_t period[ACC_HAL_FAULT_NUM_FAULTS];
+	uint32_t burst[ACC_HAL_FAULT_NUM_FAULTS];
+	/** Frame where the measurement fails, 0 if all frames are measured */
+	uint32_t failed_frame;
+	uint32_t faults[ACC_SENSOR_RECOVERY_NUM_FAULTS];
+	uint32_t recoveries[ACC_SENSOR_RECOVERY_NUM_STEPS];
+	uint32_t failed_recoveries;
+} scenario_t;
+
+/**
+ * With one interrupt wait and two transfers, measure and read, for each frame, the faults hit:
+ *   - timeout, reset: the wait of frame 50
+ *   - timeouts, recalibrate: the waits of frame 48, of its measurement after the reset and of the
+ *     first calibration attempt
+ *   - read, reset: the read of frame 50
+ *   - measure, recalibrate: the measure of frame 50 and the prepare after the reset
+ *   - measure, power cycle: the measure of frame 49, the prepare after the reset and both
+ *     calibration attempts
+ *   - returns, power cycle: as measure, recalibrate, and then the wait of frame 50 after the
+ *     recalibration, so the recalibration did not clear the fault
+ *   - unrecoverable: the read of frame 48 and every step after it
+ */
+static const scenario_t scenarios[] = {
+    {"timeout, reset", {50U, 0U}, {1U, 0U}, 0U, {0U, 1U, 0U, 0U}, {1U, 0U, 0U}, 0U},
+    {"timeouts, recalibrate", {50U, 0U}, {3U, 0U}, 0U, {0U, 2U, 0U, 0U}, {1U, 1U, 0U}, 0U},
+    {"read, reset", {0U, 100U}, {0U, 1U}, 0U, {0U, 0U, 1U, 0U}, {1U, 0U, 0U}, 0U},
+    {"measure, recalibrate", {0U, 100U}, {0U, 2U}, 0U, {1U, 0U, 0U, 0U}, {0U, 1U, 0U}, 0U},
+    {"measure, power cycle", {0U, 100U}, {0U, 4U}, 0U, {1U, 0U, 0U, 0U}, {0U, 0U, 1U}, 0U},
+    {"returns, power cycle", {51U, 100U}, {1U, 2U}, 0U, {1U, 1U, 0U, 0U}, {0U, 1U, 1U}, 0U},
+    {"unrecoverable", {0U, 100U}, {0U, 5U}, 48U, {0U, 0U, 1U, 0U}, {0U, 0U, 0U}, 1U},
+};
+
+#define NBR_SCENARIOS (sizeof(scenarios) / sizeof(scenarios[0]))
+
+/**
+ * @brief The state of the fake sensor hardware
+ */
+typedef struct
+{
+	bool     powered;
+	bool     enabled;
+	bool     configured;
+	bool     calibrating;
+	bool     interrupt_pending;
+	bool     data_ready;
+	uint32_t power_cycles;
+	uint32_t frames;
+	uint32_t sensors_created;
+	uint32_t sensors_destroyed;
+} fake_hw_t;
+
+struct acc_sensor
+{
+	acc_sensor_id_t sensor_id;
+};
+
+static bool run_scenario(const scenario_t *scenario);
+
+static bool check(bool ok, const char *name);
+
+static bool fake_prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size, void *user_data);
+
+static void fake_board_transfer(acc_sensor_id_t sensor_id, uint8_t *buffer, size_t buffer_size);
+
+static bool fake_transfer(void);
+
+static void fake_reset(void);
+
+int main(int argc, char *argv[]);
+
+static const acc_hal_a121_t *registered_hal = NULL;
+
+static fake_hw_t hw = {0};
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	acc_hal_a121_t board_hal;
+
+	memset(&board_hal, 0, sizeof(board_hal));
+	board_hal.max_spi_transfer_size = 0xffffU;
+	board_hal.mem_alloc             = malloc;
+	board_hal.mem_free              = free;
+	board_hal.transfer              = fake_board_transfer;
+
+	if (!acc_rss_hal_register(acc_hal_fault_injection_get_implementation(&board_hal)))
+	{
+		printf("Failed to register HAL\n");
+		return EXIT_FAILURE;
+	}
+
+	bool all_ok = true;
+
+	for (uint16_t i = 0U; i < NBR_SCENARIOS; i++)
+	{
+		all_ok = check(run_scenario(&scenarios[i]), scenarios[i].name) && all_ok;
+	}
+
+	printf("%s\n", all_ok ? "OK" : "FAILED");
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool run_scenario(const scenario_t *scenario)
+{
+	uint32_t              buffer[16];
+	acc_sensor_recovery_t recovery;
+
+	memset(&recovery, 0, sizeof(recovery));
+	recovery.sensor_id          = SENSOR_ID;
+	recovery.buffer             = buffer;
+	recovery.buffer_size        = sizeof(buffer);
+	recovery.timeout_ms         = SENSOR_TIMEOUT_MS;
+	recovery.prepare            = fake_prepare;
+	recovery.wait_for_interrupt = acc_hal_fault_injection_wait_for_sensor_interrupt;
+
+	acc_hal_fault_injection_set_fault(ACC_HAL_FAULT_INTERRUPT_TIMEOUT, 0U, 0U);
+	acc_hal_fault_injection_set_fault(ACC_HAL_FAULT_TRANSFER, 0U, 0U);
+
+	if (!acc_sensor_recovery_start(&recovery))
+	{
+		acc_sensor_recovery_stop(&recovery);
+		return false;
+	}
+
+	uint32_t injected_before[ACC_HAL_FAULT_NUM_FAULTS];
+	uint32_t last_frame   = hw.frames;
+	uint32_t failed_frame = 0U;
+	bool     frames_ok    = true;
+
+	// The injection counts the events from here, so the faults hit the frames given by the period
+	for (uint16_t i = 0U; i < ACC_HAL_FAULT_NUM_FAULTS; i++)
+	{
+		injected_before[i] = acc_hal_fault_injection_get_count((acc_hal_fault_t)i);
+		acc_hal_fault_injection_set_fault((acc_hal_fault_t)i, scenario->period[i], scenario->burst[i]);
+	}
+
+	for (uint32_t frame = 1U; frame <= FRAMES; frame++)
+	{
+		if (!acc_sensor_recovery_measure(&recovery))
+		{
+			failed_frame = frame;
+			break;
+		}
+
+		// Every frame, also the one after a recovery, must have been measured after the last one
+		frames_ok = frames_ok && (buffer[0] > last_frame);
+		last_frame = buffer[0];
+	}
+
+	bool injected_ok = true;
+
+	for (uint16_t i = 0U; i < ACC_HAL_FAULT_NUM_FAULTS; i++)
+	{
+		acc_hal_fault_injection_set_fault((acc_hal_fault_t)i, 0U, 0U);
+		injected_ok = injected_ok && ((acc_hal_fault_injection_get_count((acc_hal_fault_t)i) - injected_before[i]) == scenario->burst[i]);
+	}
+
+	const acc_sensor_recovery_stats_t *stats      = &recovery.stats;
+	uint32_t                           recoveries = 0U;
+	bool                               stats_ok   = stats->failed_recoveries == scenario->failed_recoveries;
+
+	for (uint16_t i = 0U; i < ACC_SENSOR_RECOVERY_NUM_FAULTS; i++)
+	{
+		stats_ok = stats_ok && (stats->faults[i] == scenario->faults[i]);
+	}
+
+	for (uint16_t i = 0U; i < ACC_SENSOR_RECOVERY_NUM_STEPS; i++)
+	{
+		stats_ok = stats_ok && (stats->recoveries[i] == scenario->recoveries[i]);
+		recoveries += stats->recoveries[i];
+	}
+
+	bool durations_ok = (stats->last_duration_us <= stats->max_duration_us) && (stats->max_duration_us <= stats->total_duration_us) &&
+	                    ((recoveries > 0U) || (stats->total_duration_us == 0U));
+
+	acc_sensor_recovery_print_stats(&recovery);
+	acc_sensor_recovery_stop(&recovery);
+
+	bool stopped_ok = !hw.powered && (hw.sensors_created == hw.sensors_destroyed);
+
+	bool ok = true;
+
+	ok = check(failed_frame == scenario->failed_frame, "failed frame") && ok;
+	ok = check(frames_ok, "new frames") && ok;
+	ok = check(injected_ok, "faults injected") && ok;
+	ok = check(stats_ok, "recovery stats") && ok;
+	ok = check(durations_ok, "recovery durations") && ok;
+	ok = check(stopped_ok, "stopped") && ok;
+
+	return ok;
+}
+
+static bool check(bool ok, const char *name)
+{
+	printf("  %-22s %s\n", name, ok ? "ok" : "FAILED");
+
+	return ok;
+}
+
+static bool fake_prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size, void *user_data)
+{
+	(void)buffer;
+	(void)buffer_size;
+	(void)user_data;
+
+	// A calibration from before the last power cycle is not valid
+	if ((sensor == NULL) || (cal_result->data[0] != (CAL_RESULT_MARKER + hw.power_cycles)) || !fake_transfer())
+	{
+		return false;
+	}
+
+	hw.configured = true;
+
+	return true;
+}
+
+static void fake_board_transfer(acc_sensor_id_t sensor_id, uint8_t *buffer, size_t buffer_size)
+{
+	(void)sensor_id;
+
+	memset(buffer, (hw.powered && hw.enabled) ? SENSOR_RESPONSE : 0U, buffer_size);
+}
+
+/**
+ * @brief Do a transfer through the registered HAL, like the RSS library does
+ *
+ * A transfer that is not answered leaves the sensor in an unknown state, so it has to be prepared again.
+ */
+static bool fake_transfer(void)
+{
+	uint8_t buffer[4] = {0U};
+
+	registered_hal->transfer(SENSOR_ID, buffer, sizeof(buffer));
+
+	if (buffer[0] != SENSOR_RESPONSE)
+	{
+		fake_reset();
+		return false;
+	}
+
+	return true;
+}
+
+static void fake_reset(void)
+{
+	hw.configured        = false;
+	hw.calibrating       = false;
+	hw.interrupt_pending = false;
+	hw.data_ready        = false;
+}
+
+bool acc_rss_hal_register(const acc_hal_a121_t *hal)
+{
+	registered_hal = hal;
+
+	return hal != NULL;
+}
+
+acc_sensor_t *acc_sensor_create(acc_sensor_id_t sensor_id)
+{
+	if (!fake_transfer())
+	{
+		return NULL;
+	}
+
+	acc_sensor_t *sensor = registered_hal->mem_alloc(sizeof(*sensor));
+
+	if (sensor != NULL)
+	{
+		sensor->sensor_id = sensor_id;
+		hw.sensors_created++;
+	}
+
+	return sensor;
+}
+
+void acc_sensor_destroy(acc_sensor_t *sensor)
+{
+	if (sensor != NULL)
+	{
+		registered_hal->mem_free(sensor);
+		hw.sensors_destroyed++;
+	}
+}
+
+bool acc_sensor_calibrate(acc_sensor_t *sensor, bool *cal_complete, acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size)
+{
+	(void)buffer;
+	(void)buffer_size;
+
+	*cal_complete = false;
+
+	if ((sensor == NULL) || !fake_transfer())
+	{
+		return false;
+	}
+
+	// The calibration is done in two steps with an interrupt in between
+	if (!hw.calibrating)
+	{
+		hw.calibrating       = true;
+		hw.interrupt_pending = true;
+		return true;
+	}
+
+	if (hw.interrupt_pending)
+	{
+		return false;
+	}
+
+	memset(cal_result, 0, sizeof(*cal_result));
+	cal_result->data[0] = CAL_RESULT_MARKER + hw.power_cycles;
+
+	hw.calibrating = false;
+	*cal_complete  = true;
+
+	return true;
+}
+
+bool acc_sensor_measure(acc_sensor_t *sensor)
+{
+	if ((sensor == NULL) || !hw.configured || !fake_transfer())
+	{
+		return false;
+	}
+
+	hw.interrupt_pending = true;
+	hw.data_ready        = false;
+
+	return true;
+}
+
+bool acc_sensor_read(const acc_sensor_t *sensor, void *buffer, uint32_t buffer_size)
+{
+	if ((sensor == NULL) || !hw.data_ready || (buffer_size < sizeof(uint32_t)) || !fake_transfer())
+	{
+		return false;
+	}
+
+	uint32_t *frame = buffer;
+
+	hw.data_ready = false;
+	frame[0]      = ++hw.frames;
+
+	return true;
+}
+
+void acc_sensor_status(const acc_sensor_t *sensor)
+{
+	printf("Fake sensor %" PRIu32 ": powered %u, enabled %u, configured %u\n",
+	       sensor != NULL ? (uint32_t)sensor->sensor_id : 0U,
+	       (unsigned int)hw.powered,
+	       (unsigned int)hw.enabled,
+	       (unsigned int)hw.configured);
+}
+
+void acc_hal_integration_sensor_supply_on(acc_sensor_id_t sensor_id)
+{
+	(void)sensor_id;
+
+	hw.powered = true;
+}
+
+void acc_hal_integration_sensor_supply_off(acc_sensor_id_t sensor_id)
+{
+	(void)sensor_id;
+
+	if (hw.powered)
+	{
+		hw.power_cycles++;
+	}
+
+	hw.powered = false;
+	hw.enabled = false;
+	fake_reset();
+}
+
+void acc_hal_integration_sensor_enable(acc_sensor_id_t sensor_id)
+{
+	(void)sensor_id;
+
+	hw.enabled = hw.powered;
+}
+
+void acc_hal_integration_sensor_disable(acc_sensor_id_t sensor_id)
+{
+	(void)sensor_id;
+
+	hw.enabled = false;
+	fake_reset();
+}
+
+bool acc_hal_integration_wait_for_sensor_interrupt(acc_sensor_id_t sensor_id, uint32_t timeout_ms)
+{
+	(void)sensor_id;
+	(void)timeout_ms;
+
+	// The fake sensor is done at once, so there is nothing to wait for
+	if (!hw.enabled || !hw.interrupt_pending)
+	{
+		return false;
+	}
+
+	hw.interrupt_pending = false;
+	hw.data_ready        = !hw.calibrating;
+
+	return true;
+}
@@ -0,0 +1,190 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "acc_sensor_sim.h"
+
+/** \example example_sensor_timing_sim.c
+ * @brief This is an example on how the sensor timing simulator can be used to evaluate a processing time budget
+ * @n
+ * The example executes as follows:
+ *   - Optionally start a number of threads that load the CPU (first argument)
+ *   - Create a simulated sensor with a fixed frame rate
+ *   - For a number of processing times, given as a fraction of the budget between frames:
+ *     - Loop a number of frames:
+ *       - Start a measurement, wait for the interrupt and read the frame
+ *       - Busy-wait for the processing time
+ *     - Print the measured processing time and the number of delayed frames
+ *   - Destroy the simulated sensor
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host sensor_sim_host
+ */
+
+#define SENSOR_TIMEOUT_MS (1000U)
+#define NBR_FRAMES        (100U)
+#define MAX_LOAD_THREADS  (16U)
+
+static const float budget_fractions[] = {0.25f, 0.5f, 0.9f, 1.2f};
+
+static volatile bool load_running = true;
+
+static void *load_thread(void *arg);
+
+static uint64_t get_time_us(void);
+
+static void busy_wait_us(uint32_t time_us);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	uint32_t  nbr_load_threads = 0U;
+	pthread_t load_threads[MAX_LOAD_THREADS];
+
+	if (argc > 1)
+	{
+		nbr_load_threads = (uint32_t)strtoul(argv[1], NULL, 10);
+		if (nbr_load_threads > MAX_LOAD_THREADS)
+		{
+			nbr_load_threads = MAX_LOAD_THREADS;
+		}
+	}
+
+	for (uint32_t i = 0U; i < nbr_load_threads; i++)
+	{
+		if (pthread_create(&load_threads[i], NULL, load_thread, NULL) != 0)
+		{
+			printf("Failed to start load thread\n");
+			nbr_load_threads = i;
+			break;
+		}
+	}
+
+	acc_sensor_sim_config_t config = {
+	    .profile           = ACC_CONFIG_PROFILE_3,
+	    .num_points        = 40U,
+	    .hwaas             = 32U,
+	    .sweeps_per_frame  = 16U,
+	    .sweep_rate        = 0.0f,
+	    .frame_rate        = 20.0f,
+	    .sweep_duration_us = 0U,
+	};
+
+	acc_sensor_sim_t *sim = acc_sensor_sim_create(&config);
+
+	if (sim == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+
+	uint32_t frame_period_us = (uint32_t)(1e6f / config.frame_rate);
+	uint32_t duration_us     = acc_sensor_sim_get_measurement_duration_us(sim);
+	uint32_t budget_us       = frame_period_us > duration_us ? frame_period_us - duration_us : 0U;
+
+	printf("Load threads: %u, frame period: %u us, measurement duration: %u us, processing budget: %u us\n",
+	       (unsigned int)nbr_load_threads,
+	       (unsigned int)frame_period_us,
+	       (unsigned int)duration_us,
+	       (unsigned int)budget_us);
+	printf("%10s %12s %8s %8s %8s\n", "target us", "measured us", "frames", "delayed", "missed");
+
+	bool status = true;
+
+	for (uint32_t step = 0U; status && (step < (sizeof(budget_fractions) / sizeof(budget_fractions[0]))); step++)
+	{
+		uint32_t               processing_us = (uint32_t)(budget_fractions[step] * (float)budget_us);
+		uint64_t               total_us      = 0U;
+		acc_sensor_sim_stats_t before;
+		acc_sensor_sim_stats_t after;
+
+		acc_sensor_sim_get_stats(sim, &before);
+
+		for (uint32_t frame = 0U; frame < NBR_FRAMES; frame++)
+		{
+			bool frame_delayed = false;
+
+			if (!acc_sensor_sim_measure(sim) || !acc_sensor_sim_wait_for_interrupt(sim, SENSOR_TIMEOUT_MS) ||
+			    !acc_sensor_sim_read(sim, &frame_delayed))
+			{
+				printf("Simulated measurement failed\n");
+				status = false;
+				break;
+			}
+
+			uint64_t start_us = get_time_us();
+
+			busy_wait_us(processing_us);
+
+			total_us += get_time_us() - start_us;
+		}
+
+		acc_sensor_sim_get_stats(sim, &after);
+
+		printf("%10u %12u %8u %8u %8u\n",
+		       (unsigned int)processing_us,
+		       (unsigned int)(total_us / NBR_FRAMES),
+		       (unsigned int)(after.frames - before.frames),
+		       (unsigned int)(after.frames_delayed - before.frames_delayed),
+		       (unsigned int)(after.missed_ticks - before.missed_ticks));
+	}
+
+	acc_sensor_sim_destroy(sim);
+
+	load_running = false;
+
+	for (uint32_t i = 0U; i < nbr_load_threads; i++)
+	{
+		pthread_join(load_threads[i], NULL);
+	}
+
+	if (status)
+	{
+		printf("Application finished OK\n");
+	}
+
+	return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void *load_thread(void *arg)
+{
+	volatile uint32_t counter = 0U;
+
+	(void)arg;
+
+	while (load_running)
+	{
+		counter++;
+	}
+
+	return NULL;
+}
+
+static uint64_t get_time_us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000000U) + ((uint64_t)now.tv_nsec / 1000U);
+}
+
+/**
+ * @brief Keep the CPU busy like processing would, a sleep would not be affected by the load
+ */
+static void busy_wait_us(uint32_t time_us)
+{
+	uint64_t end_us = get_time_us() + time_us;
+
+	while (get_time_us() < end_us)
+	{
+	}
+}
@@ -0,0 +1,412 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "acc_algorithm.h"
+#include "acc_algorithm_kernels.h"
+#include "acc_algorithm_shaped.h"
+
+/** \example example_shaped_kernels.c
+ * @brief This is an example that verifies the kernels specialised for the preset shapes
+ * @n
+ * The example executes as follows:
+ *   - For every shape in acc_algorithm_shaped.h, check that a specialised variant is selected
+ *   - Run the specialised variant and the generic function on the same input and compare the output
+ *   - Print the time per call of both and the speedup
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host shaped_kernels_host
+ */
+
+#define TIMING_CALLS    (200000U)
+#define ERROR_TOLERANCE (1e-6f)
+// Points per sweep in the frame of the mean sweep shapes, a stride that is not part of the shape
+#define FRAME_NUM_POINTS (40U)
+#define MEAN_START_POINT (17U)
+
+typedef struct
+{
+	const char *kernel;
+	const char *shape;
+	bool        specialised;
+	float       max_error;
+	double      generic_us;
+	double      shaped_us;
+} shape_result_t;
+
+static uint32_t seed = 12345U;
+
+static int16_t random_i16(void);
+
+static float random_f32(void);
+
+static void check_filter_f32(const char *shape, uint16_t filt_rows, uint16_t data_rows, uint16_t cols, shape_result_t *result);
+
+static void check_filter_f32_complex(const char *shape, uint16_t filt_rows, uint16_t data_rows, uint16_t cols, shape_result_t *result);
+
+static void check_mean_sweep(const char *shape, uint16_t sweeps_per_frame, uint16_t length, shape_result_t *result);
+
+static void check_roll_and_push(const char *shape, uint16_t data_rows, uint16_t cols, uint16_t matrix_rows, shape_result_t *result);
+
+static bool print_result(const shape_result_t *result);
+
+static double now_us(void);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	bool           all_ok = true;
+	shape_result_t result;
+
+	acc_algorithm_kernels_init();
+	printf("Generic functions use the %s kernels\n", acc_algorithm_kernels_variant_name(acc_algorithm_kernels_get_selected_variant()));
+
+#define CHECK_FILTER_F32(name, FILT_ROWS, DATA_ROWS, COLS)            \
+	check_filter_f32(#name, FILT_ROWS, DATA_ROWS, COLS, &result); \
+	all_ok = print_result(&result) && all_ok;
+	ACC_ALGORITHM_SHAPED_FILTER_F32_SHAPES(CHECK_FILTER_F32)
+#undef CHECK_FILTER_F32
+
+#define CHECK_FILTER_F32_COMPLEX(name, FILT_ROWS, DATA_ROWS, COLS)            \
+	check_filter_f32_complex(#name, FILT_ROWS, DATA_ROWS, COLS, &result); \
+	all_ok = print_result(&result) && all_ok;
+	ACC_ALGORITHM_SHAPED_FILTER_F32_COMPLEX_SHAPES(CHECK_FILTER_F32_COMPLEX)
+#undef CHECK_FILTER_F32_COMPLEX
+
+#define CHECK_MEAN_SWEEP(name, SWEEPS_PER_FRAME, LENGTH)            \
+	check_mean_sweep(#name, SWEEPS_PER_FRAME, LENGTH, &result); \
+	all_ok = print_result(&result) && all_ok;
+	ACC_ALGORITHM_SHAPED_MEAN_SWEEP_SHAPES(CHECK_MEAN_SWEEP)
+#undef CHECK_MEAN_SWEEP
+
+#define CHECK_ROLL_AND_PUSH(name, DATA_ROWS, COLS, MATRIX_ROWS)            \
+	check_roll_and_push(#name, DATA_ROWS, COLS, MATRIX_ROWS, &result); \
+	all_ok = print_result(&result) && all_ok;
+	ACC_ALGORITHM_SHAPED_ROLL_AND_PUSH_I16_COMPLEX_SHAPES(CHECK_ROLL_AND_PUSH)
+#undef CHECK_ROLL_AND_PUSH
+
+	// A shape without a variant must fall back to the generic function
+	bool fallback_ok = acc_algorithm_shaped_filter_f32(4U, 5U, 7U) == acc_algorithm_apply_filter_f32;
+	fallback_ok      = fallback_ok && (acc_algorithm_shaped_mean_sweep(16U, 5U) == acc_algorithm_mean_sweep);
+	printf("%-6s other shapes use the generic functions\n", fallback_ok ? "OK" : "FAILED");
+
+	all_ok = all_ok && fallback_ok;
+
+	printf("%s\n", all_ok ? "OK" : "FAILED");
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int16_t random_i16(void)
+{
+	seed = (seed * 1103515245U) + 12345U;
+
+	return (int16_t)((int32_t)((seed >> 16) & 0xffffU) - 32768);
+}
+
+static float random_f32(void)
+{
+	return (float)random_i16() / 32768.0f;
+}
+
+static void check_filter_f32(const char *shape, uint16_t filt_rows, uint16_t data_rows, uint16_t cols, shape_result_t *result)
+{
+	float *a         = malloc(filt_rows * sizeof(*a));
+	float *b         = malloc(data_rows * sizeof(*b));
+	float *filt_data = malloc((size_t)filt_rows * cols * sizeof(*filt_data));
+	float *data      = malloc((size_t)data_rows * cols * sizeof(*data));
+	float *generic   = malloc(cols * sizeof(*generic));
+	float *shaped    = malloc(cols * sizeof(*shaped));
+
+	for (uint16_t i = 0U; i < filt_rows; i++)
+	{
+		a[i] = random_f32();
+	}
+
+	for (uint16_t i = 0U; i < data_rows; i++)
+	{
+		b[i] = random_f32();
+	}
+
+	for (uint32_t i = 0U; i < ((uint32_t)filt_rows * cols); i++)
+	{
+		filt_data[i] = random_f32();
+	}
+
+	for (uint32_t i = 0U; i < ((uint32_t)data_rows * cols); i++)
+	{
+		data[i] = random_f32();
+	}
+
+	acc_algorithm_filter_f32_func_t func = acc_algorithm_shaped_filter_f32(filt_rows, data_rows, cols);
+
+	acc_algorithm_apply_filter_f32(a, filt_data, filt_rows, cols, b, data, data_rows, cols, generic, cols);
+	func(a, filt_data, filt_rows, cols, b, data, data_rows, cols, shaped, cols);
+
+	result->kernel      = "filter_f32";
+	result->shape       = shape;
+	result->specialised = func != acc_algorithm_apply_filter_f32;
+	result->max_error   = 0.0f;
+
+	for (uint16_t i = 0U; i < cols; i++)
+	{
+		result->max_error = fmaxf(result->max_error, fabsf(generic[i] - shaped[i]) / fmaxf(1.0f, fabsf(generic[i])));
+	}
+
+	double start = now_us();
+
+	for (uint32_t i = 0U; i < TIMING_CALLS; i++)
+	{
+		acc_algorithm_apply_filter_f32(a, filt_data, filt_rows, cols, b, data, data_rows, cols, generic, cols);
+	}
+
+	result->generic_us = (now_us() - start) / (double)TIMING_CALLS;
+
+	start = now_us();
+
+	for (uint32_t i = 0U; i < TIMING_CALLS; i++)
+	{
+		func(a, filt_data, filt_rows, cols, b, data, data_rows, cols, shaped, cols);
+	}
+
+	result->shaped_us = (now_us() - start) / (double)TIMING_CALLS;
+
+	free(a);
+	free(b);
+	free(filt_data);
+	free(data);
+	free(generic);
+	free(shaped);
+}
+
+static void check_filter_f32_complex(const char *shape, uint16_t filt_rows, uint16_t data_rows, uint16_t cols, shape_result_t *result)
+{
+	float         *a         = malloc(filt_rows * sizeof(*a));
+	float         *b         = malloc(data_rows * sizeof(*b));
+	float complex *filt_data = malloc((size_t)filt_rows * cols * sizeof(*filt_data));
+	float complex *data      = malloc((size_t)data_rows * cols * sizeof(*data));
+	float complex *generic   = malloc(cols * sizeof(*generic));
+	float complex *shaped    = malloc(cols * sizeof(*shaped));
+
+	for (uint16_t i = 0U; i < filt_rows; i++)
+	{
+		a[i] = random_f32();
+	}
+
+	for (uint16_t i = 0U; i < data_rows; i++)
+	{
+		b[i] = random_f32();
+	}
+
+	for (uint32_t i = 0U; i < ((uint32_t)filt_rows * cols); i++)
+	{
+		filt_data[i] = random_f32() + (random_f32() * I);
+	}
+
+	for (uint32_t i = 0U; i < ((uint32_t)data_rows * cols); i++)
+	{
+		data[i] = random_f32() + (random_f32() * I);
+	}
+
+	acc_algorithm_filter_f32_complex_func_t func = acc_algorithm_shaped_filter_f32_complex(filt_rows, data_rows, cols);
+
+	acc_algorithm_apply_filter_f32_complex(a, filt_data, filt_rows, cols, b, data, data_rows, cols, generic, cols);
+	func(a, filt_data, filt_rows, cols, b, data, data_rows, cols, shaped, cols);
+
+	result->kernel      = "filter_f32_complex";
+	result->shape       = shape;
+	result->specialised = func != acc_algorithm_apply_filter_f32_complex;
+	result->max_error   = 0.0f;
+
+	for (uint16_t i = 0U; i < cols; i++)
+	{
+		result->max_error = fmaxf(result->max_error, cabsf(generic[i] - shaped[i]) / fmaxf(1.0f, cabsf(generic[i])));
+	}
+
+	double start = now_us();
+
+	for (uint32_t i = 0U; i < TIMING_CALLS; i++)
+	{
+		acc_algorithm_apply_filter_f32_complex(a, filt_data, filt_rows, cols, b, data, data_rows, cols, generic, cols);
+	}
+
+	result->generic_us = (now_us() - start) / (double)TIMING_CALLS;
+
+	start = now_us();
+
+	for (uint32_t i = 0U; i < TIMING_CALLS; i++)
+	{
+		func(a, filt_data, filt_rows, cols, b, data, data_rows, cols, shaped, cols);
+	}
+
+	result->shaped_us = (now_us() - start) / (double)TIMING_CALLS;
+
+	free(a);
+	free(b);
+	free(filt_data);
+	free(data);
+	free(generic);
+	free(shaped);
+}
+
+static void check_mean_sweep(const char *shape, uint16_t sweeps_per_frame, uint16_t length, shape_result_t *result)
+{
+	uint32_t             frame_length = (uint32_t)sweeps_per_frame * FRAME_NUM_POINTS;
+	acc_int16_complex_t *frame        = malloc(frame_length * sizeof(*frame));
+	float complex       *generic      = malloc(length * sizeof(*generic));
+	float complex       *shaped       = malloc(length * sizeof(*shaped));
+	uint16_t             end_point    = MEAN_START_POINT + length;
+
+	for (uint32_t i = 0U; i < frame_length; i++)
+	{
+		frame[i].real = random_i16();
+		frame[i].imag = random_i16();
+	}
+
+	acc_algorithm_mean_sweep_func_t func = acc_algorithm_shaped_mean_sweep(sweeps_per_frame, length);
+
+	acc_algorithm_mean_sweep(frame, FRAME_NUM_POINTS, sweeps_per_frame, MEAN_START_POINT, end_point, generic);
+	func(frame, FRAME_NUM_POINTS, sweeps_per_frame, MEAN_START_POINT, end_point, shaped);
+
+	result->kernel      = "mean_sweep";
+	result->shape       = shape;
+	result->specialised = func != acc_algorithm_mean_sweep;
+	result->max_error   = 0.0f;
+
+	for (uint16_t i = 0U; i < length; i++)
+	{
+		result->max_error = fmaxf(result->max_error, cabsf(generic[i] - shaped[i]) / fmaxf(1.0f, cabsf(generic[i])));
+	}
+
+	double start = now_us();
+
+	for (uint32_t i = 0U; i < TIMING_CALLS; i++)
+	{
+		acc_algorithm_mean_sweep(frame, FRAME_NUM_POINTS, sweeps_per_frame, MEAN_START_POINT, end_point, generic);
+	}
+
+	result->generic_us = (now_us() - start) / (double)TIMING_CALLS;
+
+	start = now_us();
+
+	for (uint32_t i = 0U; i < TIMING_CALLS; i++)
+	{
+		func(frame, FRAME_NUM_POINTS, sweeps_per_frame, MEAN_START_POINT, end_point, shaped);
+	}
+
+	result->shaped_us = (now_us() - start) / (double)TIMING_CALLS;
+
+	free(frame);
+	free(generic);
+	free(shaped);
+}
+
+static void check_roll_and_push(const char *shape, uint16_t data_rows, uint16_t cols, uint16_t matrix_rows, shape_result_t *result)
+{
+	uint32_t             data_length   = (uint32_t)data_rows * cols;
+	uint32_t             matrix_length = (uint32_t)matrix_rows * cols;
+	acc_int16_complex_t *generic       = malloc(data_length * sizeof(*generic));
+	acc_int16_complex_t *shaped        = malloc(data_length * sizeof(*shaped));
+	acc_int16_complex_t *matrix        = malloc(matrix_length * sizeof(*matrix));
+
+	acc_algorithm_roll_and_push_mult_matrix_i16_complex_func_t func =
+	    acc_algorithm_shaped_roll_and_push_mult_matrix_i16_complex(data_rows, cols, matrix_rows);
+
+	result->kernel      = "roll_and_push_i16_complex";
+	result->shape       = shape;
+	result->specialised = func != acc_algorithm_roll_and_push_mult_matrix_i16_complex;
+	result->max_error   = 0.0f;
+
+	// Both directions, pushed a few times so that rows from different pushes are compared
+	for (uint16_t direction = 0U; direction < 2U; direction++)
+	{
+		bool pos_shift = direction == 1U;
+
+		for (uint32_t i = 0U; i < data_length; i++)
+		{
+			generic[i].real = random_i16();
+			generic[i].imag = random_i16();
+		}
+
+		memcpy(shaped, generic, data_length * sizeof(*shaped));
+
+		for (uint16_t push = 0U; push < 3U; push++)
+		{
+			for (uint32_t i = 0U; i < matrix_length; i++)
+			{
+				matrix[i].real = random_i16();
+				matrix[i].imag = random_i16();
+			}
+
+			acc_algorithm_roll_and_push_mult_matrix_i16_complex(generic, data_rows, cols, matrix, matrix_rows, pos_shift);
+			func(shaped, data_rows, cols, matrix, matrix_rows, pos_shift);
+		}
+
+		if (memcmp(generic, shaped, data_length * sizeof(*shaped)) != 0)
+		{
+			result->max_error = INFINITY;
+		}
+	}
+
+	double start = now_us();
+
+	for (uint32_t i = 0U; i < (TIMING_CALLS / 100U); i++)
+	{
+		acc_algorithm_roll_and_push_mult_matrix_i16_complex(generic, data_rows, cols, matrix, matrix_rows, false);
+	}
+
+	result->generic_us = (now_us() - start) / (double)(TIMING_CALLS / 100U);
+
+	start = now_us();
+
+	for (uint32_t i = 0U; i < (TIMING_CALLS / 100U); i++)
+	{
+		func(shaped, data_rows, cols, matrix, matrix_rows, false);
+	}
+
+	result->shaped_us = (now_us() - start) / (double)(TIMING_CALLS / 100U);
+
+	free(generic);
+	free(shaped);
+	free(matrix);
+}
+
+static bool print_result(const shape_result_t *result)
+{
+	bool ok = result->specialised && (result->max_error <= ERROR_TOLERANCE);
+
+	printf("%-6s %-26s %-31s max error %g, generic %8.3f us, specialised %8.3f us, %.1fx\n",
+	       ok ? "OK" : "FAILED",
+	       result->kernel,
+	       result->shape,
+	       (double)result->max_error,
+	       result->generic_us,
+	       result->shaped_us,
+	       result->generic_us / result->shaped_us);
+
+	return ok;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
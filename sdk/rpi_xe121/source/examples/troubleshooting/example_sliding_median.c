@@ -0,0 +1,327 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "acc_algorithm.h"
+#include "acc_sliding_median.h"
+
+/** \example example_sliding_median.c
+ * @brief This is an example that verifies and measures the sliding median used by the waste level distance history
+ * @n
+ * The example executes as follows:
+ *   - Generate a synthetic waste level distance session, or read a recorded one
+ *   - Replay the session through the sliding median and through the previous ring buffer,
+ *     copy of non-NaN values and acc_algorithm_median_f32, for several window lengths
+ *   - Verify that the medians and the resulting fill levels are identical for every frame
+ *   - Print the processing time per frame of both for long windows
+ *
+ * A recording is a text file with one distance in meters per frame, nan for frames where no level was found:
+ *   example_sliding_median <recording>
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host sliding_median_host
+ */
+
+#define SYNTHETIC_FRAMES (20000U)
+#define MAX_FRAMES       (100000U)
+#define BIN_START_M      (0.15f)
+#define BIN_END_M        (1.00f)
+
+/**
+ * The app allows up to 10, the longer windows are for the benchmark
+ */
+static const uint16_t window_lengths[] = {1U, 2U, 5U, 10U, 64U, 256U, 1024U};
+
+#define NBR_WINDOW_LENGTHS (sizeof(window_lengths) / sizeof(window_lengths[0]))
+
+typedef struct
+{
+	float   *history;
+	float   *scratch;
+	uint16_t capacity;
+	uint16_t length;
+	uint16_t write_idx;
+} reference_median_t;
+
+static bool run_window(const float *distances, uint32_t frame_count, uint16_t window_length);
+
+static bool reference_median(reference_median_t *reference, float distance, float *median);
+
+static uint8_t fill_level_percent(float distance);
+
+static float *generate_session(uint32_t frame_count);
+
+static float *read_recording(const char *path, uint32_t *frame_count);
+
+static double now_us(void);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	uint32_t frame_count = SYNTHETIC_FRAMES;
+	float   *distances   = NULL;
+	bool     all_ok      = true;
+
+	if (argc == 2)
+	{
+		distances = read_recording(argv[1], &frame_count);
+	}
+	else if (argc == 1)
+	{
+		distances = generate_session(frame_count);
+	}
+	else
+	{
+		printf("Usage: %s [<recording>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (distances == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+
+	for (uint16_t i = 0U; i < NBR_WINDOW_LENGTHS; i++)
+	{
+		all_ok = run_window(distances, frame_count, window_lengths[i]) && all_ok;
+	}
+
+	free(distances);
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool run_window(const float *distances, uint32_t frame_count, uint16_t window_length)
+{
+	reference_median_t reference = {
+		.history  = malloc(window_length * sizeof(float)),
+		.scratch  = malloc(window_length * sizeof(float)),
+		.capacity = window_length,
+	};
+
+	acc_sliding_median_t *sliding = acc_sliding_median_create(window_length);
+	bool                  ok      = (reference.history != NULL) && (reference.scratch != NULL) && (sliding != NULL);
+	uint32_t              levels  = 0U;
+	double                reference_us;
+	double                sliding_us;
+
+	// Replay and compare frame by frame
+	for (uint32_t f = 0U; ok && (f < frame_count); f++)
+	{
+		float expected = 0.0f;
+		float actual   = 0.0f;
+
+		bool expected_found = reference_median(&reference, distances[f], &expected);
+
+		acc_sliding_median_push(sliding, distances[f]);
+		bool actual_found = acc_sliding_median_get(sliding, &actual);
+
+		ok = (expected_found == actual_found);
+
+		if (ok && expected_found)
+		{
+			ok = (memcmp(&expected, &actual, sizeof(expected)) == 0) && (fill_level_percent(expected) == fill_level_percent(actual));
+			levels++;
+		}
+
+		if (!ok)
+		{
+			printf("Window %4u: mismatch at frame %" PRIu32 "\n", (unsigned int)window_length, f);
+		}
+	}
+
+	if (ok)
+	{
+		float median = 0.0f;
+		float sum    = 0.0f;
+
+		reference.length    = 0U;
+		reference.write_idx = 0U;
+		acc_sliding_median_reset(sliding);
+
+		double start = now_us();
+
+		for (uint32_t f = 0U; f < frame_count; f++)
+		{
+			if (reference_median(&reference, distances[f], &median))
+			{
+				sum += median;
+			}
+		}
+
+		double middle = now_us();
+
+		for (uint32_t f = 0U; f < frame_count; f++)
+		{
+			acc_sliding_median_push(sliding, distances[f]);
+
+			if (acc_sliding_median_get(sliding, &median))
+			{
+				sum += median;
+			}
+		}
+
+		reference_us = (middle - start) / frame_count;
+		sliding_us   = (now_us() - middle) / frame_count;
+
+		printf("Window %4u: %" PRIu32 " frames, %" PRIu32 " levels identical, sort %9.3f us/frame, sliding %6.3f us/frame (checksum %.1f)\n",
+		       (unsigned int)window_length,
+		       frame_count,
+		       levels,
+		       reference_us,
+		       sliding_us,
+		       (double)sum);
+	}
+
+	free(reference.history);
+	free(reference.scratch);
+	acc_sliding_median_destroy(sliding);
+
+	return ok;
+}
+
+static bool reference_median(reference_median_t *reference, float distance, float *median)
+{
+	uint16_t num_normal = 0U;
+
+	reference->history[reference->write_idx] = distance;
+	reference->write_idx                     = (reference->write_idx + 1U) % reference->capacity;
+
+	if (reference->length < reference->capacity)
+	{
+		reference->length++;
+	}
+
+	for (uint16_t i = 0U; i < reference->length; i++)
+	{
+		if (fpclassify(reference->history[i]) != FP_NAN)
+		{
+			reference->scratch[num_normal] = reference->history[i];
+			num_normal++;
+		}
+	}
+
+	if (num_normal == 0U)
+	{
+		return false;
+	}
+
+	*median = acc_algorithm_median_f32(reference->scratch, num_normal);
+
+	return true;
+}
+
+static uint8_t fill_level_percent(float distance)
+{
+	// Same as set_level_numbers in example_waste_level.c
+	float fill_level_m         = BIN_END_M - distance;
+	float fill_level_percent_f = acc_algorithm_clip_f32(100.0f * fill_level_m / (BIN_END_M - BIN_START_M), 0.0f, 100.0f);
+
+	return (uint8_t)(fill_level_percent_f + 0.5f);
+}
+
+static float *generate_session(uint32_t frame_count)
+{
+	float   *distances = malloc(frame_count * sizeof(*distances));
+	uint32_t seed      = 12345U;
+
+	if (distances == NULL)
+	{
+		printf("Failed to allocate distances\n");
+		return NULL;
+	}
+
+	// The bin fills up and is emptied a few times, with quantized distances, dropouts and reflections from the lid
+	for (uint32_t f = 0U; f < frame_count; f++)
+	{
+		float fill     = (float)(f % 5000U) / 5000.0f;
+		float distance = BIN_END_M - (fill * (BIN_END_M - BIN_START_M));
+
+		seed = (seed * 1103515245U) + 12345U;
+
+		uint32_t event = (seed >> 16) % 100U;
+
+		if (event < 10U)
+		{
+			distance = NAN;
+		}
+		else if (event < 15U)
+		{
+			distance = BIN_START_M + ((float)((seed >> 8) % 64U) * 0.0025f);
+		}
+		else
+		{
+			// Distances come from a point grid, so repeated values are common
+			distance = roundf(distance / 0.0025f) * 0.0025f;
+		}
+
+		distances[f] = distance;
+	}
+
+	return distances;
+}
+
+static float *read_recording(const char *path, uint32_t *frame_count)
+{
+	float *distances = malloc(MAX_FRAMES * sizeof(*distances));
+	FILE  *file      = fopen(path, "r");
+	char   line[64];
+
+	if ((distances == NULL) || (file == NULL))
+	{
+		printf("Failed to read %s\n", path);
+		free(distances);
+		if (file != NULL)
+		{
+			fclose(file);
+		}
+
+		return NULL;
+	}
+
+	*frame_count = 0U;
+
+	while ((*frame_count < MAX_FRAMES) && (fgets(line, sizeof(line), file) != NULL))
+	{
+		char *end      = NULL;
+		float distance = strtof(line, &end);
+
+		if (end != line)
+		{
+			distances[*frame_count] = distance;
+			(*frame_count)++;
+		}
+	}
+
+	fclose(file);
+
+	if (*frame_count == 0U)
+	{
+		printf("No distances in %s\n", path);
+		free(distances);
+		return NULL;
+	}
+
+	return distances;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
@@ -0,0 +1,229 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "acc_snapshot.h"
+
+/** \example example_snapshot.c
+ * @brief This is an example that checks the state snapshots used by ref_app_breathing
+ * @n
+ * The example executes as follows:
+ *   - Write a snapshot of some state and read it back
+ *   - Check that snapshots of another version or configuration, stale snapshots, snapshots from the
+ *     future, corrupted and truncated snapshots are rejected
+ *   - Check that a snapshot that does not fit its buffer is not written
+ *   - Write a snapshot file, replace it and read it back, and check that no temporary file is left
+ *   - Read a snapshot file into a buffer of exactly its size, and check that a larger file is rejected
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host snapshot_host
+ */
+
+#define MAGIC       (0x54534554U)
+#define VERSION     (3U)
+#define CONFIG_HASH (0x12345678U)
+#define NOW_MS      (1700000000000U)
+#define MAX_AGE_MS  (60000U)
+
+#define STATE_LENGTH  (100U)
+#define BUFFER_LENGTH (1024U)
+#define PAYLOAD_SIZE  (sizeof(uint16_t) + sizeof(float) + (STATE_LENGTH * sizeof(float)))
+
+typedef struct
+{
+	uint16_t counter;
+	float    distance;
+	float    series[STATE_LENGTH];
+} state_t;
+
+static bool check(bool ok, const char *name);
+
+static void fill_state(state_t *state, uint16_t counter);
+
+static uint32_t write_state(const state_t *state, uint64_t timestamp_ms, uint8_t *buffer, uint32_t buffer_size);
+
+static acc_snapshot_status_t read_state(state_t *state, const uint8_t *buffer, uint32_t size, uint16_t version, uint32_t config_hash, uint64_t now_ms);
+
+static bool states_equal(const state_t *a, const state_t *b);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	static uint8_t buffer[BUFFER_LENGTH];
+	static uint8_t modified[BUFFER_LENGTH];
+	state_t        saved;
+	state_t        restored;
+	bool           all_ok = true;
+
+	fill_state(&saved, 7U);
+
+	uint64_t saved_ms = NOW_MS - 1000U;
+	uint32_t size     = write_state(&saved, saved_ms, buffer, sizeof(buffer));
+
+	all_ok = check(size == (ACC_SNAPSHOT_HEADER_SIZE + PAYLOAD_SIZE), "size") && all_ok;
+
+	// A size query writes nothing but gives the same size
+	acc_snapshot_t writer;
+	uint32_t       query_size;
+
+	acc_snapshot_begin_write(&writer, NULL, 0U);
+	acc_snapshot_write(&writer, NULL, PAYLOAD_SIZE);
+	all_ok = check(acc_snapshot_end_write(&writer, MAGIC, VERSION, CONFIG_HASH, NOW_MS, &query_size) && (query_size == size), "size query") &&
+	         all_ok;
+
+	memset(&restored, 0, sizeof(restored));
+	all_ok = check((read_state(&restored, buffer, size, VERSION, CONFIG_HASH, NOW_MS) == ACC_SNAPSHOT_STATUS_OK) && states_equal(&saved, &restored),
+	               "round trip") &&
+	         all_ok;
+
+	all_ok = check(read_state(&restored, buffer, size, VERSION + 1U, CONFIG_HASH, NOW_MS) == ACC_SNAPSHOT_STATUS_VERSION, "other version") && all_ok;
+	all_ok = check(read_state(&restored, buffer, size, VERSION, CONFIG_HASH + 1U, NOW_MS) == ACC_SNAPSHOT_STATUS_CONFIG, "other config") && all_ok;
+	all_ok = check(read_state(&restored, buffer, size, VERSION, CONFIG_HASH, saved_ms + MAX_AGE_MS) == ACC_SNAPSHOT_STATUS_OK, "oldest allowed") &&
+	         all_ok;
+	all_ok = check(read_state(&restored, buffer, size, VERSION, CONFIG_HASH, saved_ms + MAX_AGE_MS + 1U) == ACC_SNAPSHOT_STATUS_STALE, "stale") &&
+	         all_ok;
+	all_ok = check(read_state(&restored, buffer, size, VERSION, CONFIG_HASH, saved_ms - 1U) == ACC_SNAPSHOT_STATUS_STALE, "from the future") && all_ok;
+
+	// Every single flipped bit must be caught, in the header as well as in the payload
+	bool all_caught = true;
+
+	for (uint32_t i = 0U; i < size; i++)
+	{
+		for (uint16_t bit = 0U; bit < 8U; bit++)
+		{
+			memcpy(modified, buffer, size);
+			modified[i] ^= (uint8_t)(1U << bit);
+
+			all_caught = all_caught && (read_state(&restored, modified, size, VERSION, CONFIG_HASH, NOW_MS) != ACC_SNAPSHOT_STATUS_OK);
+		}
+	}
+
+	all_ok = check(all_caught, "corrupted") && all_ok;
+	all_ok = check(read_state(&restored, buffer, size - 1U, VERSION, CONFIG_HASH, NOW_MS) == ACC_SNAPSHOT_STATUS_INVALID, "truncated") && all_ok;
+	all_ok = check(read_state(&restored, buffer, 10U, VERSION, CONFIG_HASH, NOW_MS) == ACC_SNAPSHOT_STATUS_INVALID, "shorter than header") && all_ok;
+	all_ok = check(write_state(&saved, NOW_MS, modified, size - 1U) == 0U, "too small buffer") && all_ok;
+
+	// Reading more than the payload holds, or less, is an error
+	acc_snapshot_t reader;
+	uint8_t        larger[BUFFER_LENGTH];
+
+	(void)acc_snapshot_begin_read(&reader, buffer, size, MAGIC, VERSION, CONFIG_HASH, NOW_MS, MAX_AGE_MS);
+	all_ok = check(!acc_snapshot_read(&reader, larger, sizeof(larger)) && !acc_snapshot_end_read(&reader), "read past end") && all_ok;
+	(void)acc_snapshot_begin_read(&reader, buffer, size, MAGIC, VERSION, CONFIG_HASH, NOW_MS, MAX_AGE_MS);
+	all_ok = check(acc_snapshot_read(&reader, larger, PAYLOAD_SIZE - 1U) && !acc_snapshot_end_read(&reader), "read short") && all_ok;
+
+	// Files are replaced as a whole
+	char path[64];
+	char tmp_path[80];
+
+	snprintf(path, sizeof(path), "/tmp/example_snapshot_%ld", (long)getpid());
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+	state_t newer;
+
+	fill_state(&newer, 8U);
+
+	uint32_t newer_size = write_state(&newer, NOW_MS, modified, sizeof(modified));
+	uint32_t file_size  = 0U;
+	bool     file_ok    = acc_snapshot_file_write(path, buffer, size) && acc_snapshot_file_write(path, modified, newer_size) &&
+	               acc_snapshot_file_read(path, buffer, sizeof(buffer), &file_size) &&
+	               (read_state(&restored, buffer, file_size, VERSION, CONFIG_HASH, NOW_MS) == ACC_SNAPSHOT_STATUS_OK) &&
+	               states_equal(&newer, &restored) && (access(tmp_path, F_OK) != 0);
+
+	all_ok = check(file_ok, "file replace") && all_ok;
+
+	// The application allocates a buffer of exactly the snapshot size
+	memset(buffer, 0, sizeof(buffer));
+	file_ok = acc_snapshot_file_read(path, buffer, newer_size, &file_size) && (file_size == newer_size) &&
+	          (read_state(&restored, buffer, file_size, VERSION, CONFIG_HASH, NOW_MS) == ACC_SNAPSHOT_STATUS_OK) && states_equal(&newer, &restored);
+
+	all_ok = check(file_ok, "file exact size") && all_ok;
+	all_ok = check(!acc_snapshot_file_read(path, buffer, newer_size - 1U, &file_size), "file too large") && all_ok;
+
+	unlink(path);
+
+	all_ok = check(!acc_snapshot_file_read(path, buffer, sizeof(buffer), &file_size), "missing file") && all_ok;
+
+	printf("%s\n", all_ok ? "OK" : "FAILED");
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool check(bool ok, const char *name)
+{
+	printf("%-22s %s\n", name, ok ? "ok" : "FAILED");
+
+	return ok;
+}
+
+static void fill_state(state_t *state, uint16_t counter)
+{
+	memset(state, 0, sizeof(*state));
+
+	state->counter  = counter;
+	state->distance = 0.6f + (float)counter;
+
+	for (uint16_t i = 0U; i < STATE_LENGTH; i++)
+	{
+		state->series[i] = (float)(i * counter) * 0.01f;
+	}
+}
+
+static uint32_t write_state(const state_t *state, uint64_t timestamp_ms, uint8_t *buffer, uint32_t buffer_size)
+{
+	acc_snapshot_t writer;
+	uint32_t       size;
+
+	acc_snapshot_begin_write(&writer, buffer, buffer_size);
+	acc_snapshot_write(&writer, &state->counter, sizeof(state->counter));
+	acc_snapshot_write(&writer, &state->distance, sizeof(state->distance));
+	acc_snapshot_write(&writer, state->series, sizeof(state->series));
+
+	return acc_snapshot_end_write(&writer, MAGIC, VERSION, CONFIG_HASH, timestamp_ms, &size) ? size : 0U;
+}
+
+static acc_snapshot_status_t read_state(state_t *state, const uint8_t *buffer, uint32_t size, uint16_t version, uint32_t config_hash, uint64_t now_ms)
+{
+	acc_snapshot_t        reader;
+	acc_snapshot_status_t status = acc_snapshot_begin_read(&reader, buffer, size, MAGIC, version, config_hash, now_ms, MAX_AGE_MS);
+
+	if (status != ACC_SNAPSHOT_STATUS_OK)
+	{
+		return status;
+	}
+
+	state_t read;
+
+	memset(&read, 0, sizeof(read));
+
+	acc_snapshot_read(&reader, &read.counter, sizeof(read.counter));
+	acc_snapshot_read(&reader, &read.distance, sizeof(read.distance));
+	acc_snapshot_read(&reader, read.series, sizeof(read.series));
+
+	if (!acc_snapshot_end_read(&reader))
+	{
+		return ACC_SNAPSHOT_STATUS_INVALID;
+	}
+
+	*state = read;
+
+	return ACC_SNAPSHOT_STATUS_OK;
+}
+
+static bool states_equal(const state_t *a, const state_t *b)
+{
+	return (a->counter == b->counter) && (a->distance == b->distance) && (memcmp(a->series, b->series, sizeof(a->series)) == 0);
+}
@@ -0,0 +1,505 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "acc_algorithm.h"
+
+/** \example example_sos_filter.c
+ * @brief This is an example that compares the direct form filters of acc_algorithm with the
+ *        second-order section filters and their steady state initialisation
+ * @n
+ * The example executes as follows:
+ *   - Check that the multi-channel and complex section filters give the same result as filtering
+ *     every channel on its own
+ *   - Filter a breathing signal with the breathing band-pass filter at a range of frame rates, both in
+ *     direct form and as sections, and print the error against a filter designed and run in double
+ *   - Filter a breathing signal with a large offset from zero history in direct form and from the steady
+ *     state of the first sample as sections, and print how long it takes until the output is within 5 %
+ *     of the breathing amplitude of a filter that has run for a long time
+ *   - Do the same for the static filter and the band-pass filter of ref_app_breathing together, on the
+ *     IQ of a breathing target next to a strong static reflection
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host sos_filter_host
+ */
+
+#define LOWEST_FREQ     (0.1f)
+#define HIGHEST_FREQ    (1.0f)
+#define BREATHING_FREQ  (0.25f)
+#define SIGNAL_LENGTH_S (60.0f)
+#define WARM_UP_S       (300.0f)
+#define SETTLE_LIMIT    (0.05f)
+#define NUM_CHANNELS    (5U)
+#define CHANNEL_LENGTH  (200U)
+#define MAX_ERROR       (1e-3f)
+
+#define BANDPASS_SECTIONS (2U)
+#define LOWPASS_SECTIONS  (1U)
+
+static const float frame_rates[] = {10.0f, 20.0f, 50.0f, 100.0f};
+
+#define NBR_FRAME_RATES (sizeof(frame_rates) / sizeof(frame_rates[0]))
+
+typedef enum
+{
+	SIGNAL_PHASE,
+	SIGNAL_IQ,
+} signal_type_t;
+
+static uint32_t seed = 12345U;
+
+static bool check_channels(void);
+
+static bool check_precision(float frame_rate);
+
+static bool check_settling(signal_type_t type, float frame_rate);
+
+static float signal_phase(uint32_t n, float frame_rate);
+
+static float complex signal_iq(uint32_t n, float frame_rate);
+
+static float run_pipeline(signal_type_t type, float frame_rate, uint32_t start, uint32_t length, bool sections, float *output);
+
+static float settling_time_s(const float *output, const float *reference, uint32_t length, float frame_rate, float amplitude);
+
+static void design_bandpass_double(double min_freq, double max_freq, double fs, double *b, double *a);
+
+static double complex cdiv_double(double complex num, double complex denom);
+
+static float noise(void);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	bool all_ok = check_channels();
+
+	printf("Band-pass %.1f-%.1f Hz, error against a double precision filter\n", (double)LOWEST_FREQ, (double)HIGHEST_FREQ);
+
+	for (uint16_t f = 0U; f < NBR_FRAME_RATES; f++)
+	{
+		all_ok = check_precision(frame_rates[f]) && all_ok;
+	}
+
+	printf("Settling time to %.0f %% of the breathing amplitude\n", (double)(SETTLE_LIMIT * 100.0f));
+
+	for (uint16_t f = 0U; f < NBR_FRAME_RATES; f++)
+	{
+		all_ok = check_settling(SIGNAL_PHASE, frame_rates[f]) && all_ok;
+	}
+
+	for (uint16_t f = 0U; f < NBR_FRAME_RATES; f++)
+	{
+		all_ok = check_settling(SIGNAL_IQ, frame_rates[f]) && all_ok;
+	}
+
+	printf("%s\n", all_ok ? "OK" : "FAILED");
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool check_channels(void)
+{
+	float sos[BANDPASS_SECTIONS * ACC_ALGORITHM_SOS_SECTION_LENGTH];
+	float zi[BANDPASS_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH];
+
+	acc_algorithm_butter_bandpass_sos(LOWEST_FREQ, HIGHEST_FREQ, 10.0f, sos);
+	acc_algorithm_sosfilt_zi(sos, BANDPASS_SECTIONS, zi);
+
+	float         input[NUM_CHANNELS][CHANNEL_LENGTH];
+	float         single[NUM_CHANNELS][CHANNEL_LENGTH];
+	float complex x[NUM_CHANNELS];
+	float complex y[NUM_CHANNELS];
+	float         re[NUM_CHANNELS];
+	float         state_re[BANDPASS_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH * NUM_CHANNELS];
+	float complex state[BANDPASS_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH * NUM_CHANNELS];
+
+	for (uint16_t c = 0U; c < NUM_CHANNELS; c++)
+	{
+		for (uint16_t n = 0U; n < CHANNEL_LENGTH; n++)
+		{
+			input[c][n]  = noise() + (float)c;
+			single[c][n] = input[c][n];
+		}
+
+		acc_algorithm_sosfilt(sos, BANDPASS_SECTIONS, zi, single[c], CHANNEL_LENGTH);
+	}
+
+	// The imaginary part is the real part negated, so both parts can be checked against the same single channel result
+	for (uint16_t c = 0U; c < NUM_CHANNELS; c++)
+	{
+		x[c]  = input[c][0] - (input[c][0] * I);
+		re[c] = input[c][0];
+	}
+
+	acc_algorithm_sosfilt_init_f32(zi, BANDPASS_SECTIONS, re, NUM_CHANNELS, state_re);
+	acc_algorithm_sosfilt_init_f32_complex(zi, BANDPASS_SECTIONS, x, NUM_CHANNELS, state);
+
+	float max_diff = 0.0f;
+
+	for (uint16_t n = 0U; n < CHANNEL_LENGTH; n++)
+	{
+		for (uint16_t c = 0U; c < NUM_CHANNELS; c++)
+		{
+			x[c]  = input[c][n] - (input[c][n] * I);
+			re[c] = input[c][n];
+		}
+
+		acc_algorithm_sosfilt_f32(sos, BANDPASS_SECTIONS, state_re, re, re, NUM_CHANNELS);
+		acc_algorithm_sosfilt_f32_complex(sos, BANDPASS_SECTIONS, state, x, y, NUM_CHANNELS);
+
+		for (uint16_t c = 0U; c < NUM_CHANNELS; c++)
+		{
+			max_diff = fmaxf(max_diff, fabsf(re[c] - single[c][n]));
+			max_diff = fmaxf(max_diff, fabsf(crealf(y[c]) - single[c][n]));
+			max_diff = fmaxf(max_diff, fabsf(cimagf(y[c]) + single[c][n]));
+		}
+	}
+
+	bool ok = max_diff == 0.0f;
+
+	printf("Multi-channel and complex sections against single channel: max difference %g %s\n", (double)max_diff, ok ? "" : "FAILED");
+
+	return ok;
+}
+
+static bool check_precision(float frame_rate)
+{
+	uint32_t length = (uint32_t)(SIGNAL_LENGTH_S * frame_rate);
+
+	float  *direct    = malloc(length * sizeof(*direct));
+	float  *sections  = malloc(length * sizeof(*sections));
+	double *reference = malloc(length * sizeof(*reference));
+
+	if ((direct == NULL) || (sections == NULL) || (reference == NULL))
+	{
+		printf("Memory allocation failed\n");
+		free(direct);
+		free(sections);
+		free(reference);
+		return false;
+	}
+
+	for (uint32_t n = 0U; n < length; n++)
+	{
+		direct[n]    = signal_phase(n, frame_rate);
+		sections[n]  = direct[n];
+		reference[n] = (double)direct[n];
+	}
+
+	float b[5];
+	float a[4];
+	float sos[BANDPASS_SECTIONS * ACC_ALGORITHM_SOS_SECTION_LENGTH];
+
+	acc_algorithm_butter_bandpass(LOWEST_FREQ, HIGHEST_FREQ, frame_rate, b, a);
+	acc_algorithm_butter_bandpass_sos(LOWEST_FREQ, HIGHEST_FREQ, frame_rate, sos);
+
+	acc_algorithm_lfilter(b, a, direct, (uint16_t)length);
+	acc_algorithm_sosfilt(sos, BANDPASS_SECTIONS, NULL, sections, (uint16_t)length);
+
+	double b_ref[5];
+	double a_ref[4];
+	double state[4] = {0.0, 0.0, 0.0, 0.0};
+
+	design_bandpass_double(LOWEST_FREQ, HIGHEST_FREQ, frame_rate, b_ref, a_ref);
+
+	for (uint32_t n = 0U; n < length; n++)
+	{
+		double x = reference[n];
+		double y = state[0] + (b_ref[0] * x);
+
+		state[0] = state[1] + (b_ref[1] * x) - (a_ref[0] * y);
+		state[1] = state[2] + (b_ref[2] * x) - (a_ref[1] * y);
+		state[2] = state[3] + (b_ref[3] * x) - (a_ref[2] * y);
+		state[3] = (b_ref[4] * x) - (a_ref[3] * y);
+
+		reference[n] = y;
+	}
+
+	double direct_error   = 0.0;
+	double sections_error = 0.0;
+	double energy         = 0.0;
+
+	for (uint32_t n = 0U; n < length; n++)
+	{
+		direct_error   += ((double)direct[n] - reference[n]) * ((double)direct[n] - reference[n]);
+		sections_error += ((double)sections[n] - reference[n]) * ((double)sections[n] - reference[n]);
+		energy         += reference[n] * reference[n];
+	}
+
+	float direct_rel   = (float)sqrt(direct_error / energy);
+	float sections_rel = (float)sqrt(sections_error / energy);
+
+	// A direct form filter that has gone unstable has an error far above one, or not a number at all
+	bool ok = (sections_rel < MAX_ERROR) && (sections_rel <= direct_rel);
+
+	printf("  %5.1f Hz (%.4f of Nyquist): direct form %9.2e, sections %9.2e %s\n",
+	       (double)frame_rate,
+	       (double)(2.0f * LOWEST_FREQ / frame_rate),
+	       (double)direct_rel,
+	       (double)sections_rel,
+	       ok ? "" : "FAILED");
+
+	free(direct);
+	free(sections);
+	free(reference);
+
+	return ok;
+}
+
+static bool check_settling(signal_type_t type, float frame_rate)
+{
+	uint32_t warm_up = (uint32_t)(WARM_UP_S * frame_rate);
+	uint32_t length  = (uint32_t)(SIGNAL_LENGTH_S * frame_rate);
+
+	float *direct    = malloc(length * sizeof(*direct));
+	float *sections  = malloc(length * sizeof(*sections));
+	float *reference = malloc((warm_up + length) * sizeof(*reference));
+
+	if ((direct == NULL) || (sections == NULL) || (reference == NULL))
+	{
+		printf("Memory allocation failed\n");
+		free(direct);
+		free(sections);
+		free(reference);
+		return false;
+	}
+
+	// The reference has filtered the same signal from long before, so all start-up transients are gone
+	run_pipeline(type, frame_rate, 0U, warm_up + length, true, reference);
+
+	float amplitude = run_pipeline(type, frame_rate, warm_up, length, false, direct);
+
+	run_pipeline(type, frame_rate, warm_up, length, true, sections);
+
+	float direct_s   = settling_time_s(direct, &reference[warm_up], length, frame_rate, amplitude);
+	float sections_s = settling_time_s(sections, &reference[warm_up], length, frame_rate, amplitude);
+
+	bool ok = sections_s < direct_s;
+
+	printf("  %-5s %5.1f Hz: direct form from zero %5.1f s, sections from first sample %5.1f s %s\n",
+	       (type == SIGNAL_PHASE) ? "phase" : "iq",
+	       (double)frame_rate,
+	       (double)direct_s,
+	       (double)sections_s,
+	       ok ? "" : "FAILED");
+
+	free(direct);
+	free(sections);
+	free(reference);
+
+	return ok;
+}
+
+static float signal_phase(uint32_t n, float frame_rate)
+{
+	// The unwrapped phase of a breathing target, with an offset from where the unwrapping started
+	float t = (float)n / frame_rate;
+
+	return 3.0f + (0.5f * sinf(2.0f * (float)M_PI * BREATHING_FREQ * t)) + (0.02f * sinf(2.0f * (float)M_PI * 2.3f * t));
+}
+
+static float complex signal_iq(uint32_t n, float frame_rate)
+{
+	// A breathing target next to a static reflection four times stronger
+	float t     = (float)n / frame_rate;
+	float phase = 1.0f + (0.5f * sinf(2.0f * (float)M_PI * BREATHING_FREQ * t));
+
+	return 4.0f + (2.0f * I) + cexpf(phase * I);
+}
+
+static float run_pipeline(signal_type_t type, float frame_rate, uint32_t start, uint32_t length, bool sections, float *output)
+{
+	float b_static[3];
+	float a_static[2];
+	float b_angle[5];
+	float a_angle[4];
+	float sos_static[LOWPASS_SECTIONS * ACC_ALGORITHM_SOS_SECTION_LENGTH];
+	float sos_angle[BANDPASS_SECTIONS * ACC_ALGORITHM_SOS_SECTION_LENGTH];
+	float zi_static[LOWPASS_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH];
+	float zi_angle[BANDPASS_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH];
+
+	acc_algorithm_butter_lowpass(LOWEST_FREQ, frame_rate, b_static, a_static);
+	acc_algorithm_butter_bandpass(LOWEST_FREQ, HIGHEST_FREQ, frame_rate, b_angle, a_angle);
+	acc_algorithm_butter_lowpass_sos(LOWEST_FREQ, frame_rate, sos_static);
+	acc_algorithm_butter_bandpass_sos(LOWEST_FREQ, HIGHEST_FREQ, frame_rate, sos_angle);
+	acc_algorithm_sosfilt_zi(sos_static, LOWPASS_SECTIONS, zi_static);
+	acc_algorithm_sosfilt_zi(sos_angle, BANDPASS_SECTIONS, zi_angle);
+
+	// Direct form histories as kept by ref_app_breathing, newest row last
+	float complex x_static[3] = {0.0f};
+	float complex y_static[2] = {0.0f};
+	float         x_angle[5]  = {0.0f};
+	float         y_angle[4]  = {0.0f};
+	float complex state_static[LOWPASS_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH];
+	float         state_angle[BANDPASS_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH];
+	float         prev_angle      = 0.0f;
+	float         unwrapped_angle = 0.0f;
+	float         max_output      = 0.0f;
+
+	for (uint32_t n = 0U; n < length; n++)
+	{
+		float phase;
+
+		if (type == SIGNAL_PHASE)
+		{
+			phase = signal_phase(start + n, frame_rate);
+		}
+		else
+		{
+			float complex iq = signal_iq(start + n, frame_rate);
+			float complex static_iq;
+
+			if (sections)
+			{
+				if (n == 0U)
+				{
+					acc_algorithm_sosfilt_init_f32_complex(zi_static, LOWPASS_SECTIONS, &iq, 1U, state_static);
+				}
+
+				acc_algorithm_sosfilt_f32_complex(sos_static, LOWPASS_SECTIONS, state_static, &iq, &static_iq, 1U);
+			}
+			else
+			{
+				acc_algorithm_roll_and_push_matrix_f32_complex(x_static, 3U, 1U, &iq, true);
+				acc_algorithm_apply_filter_f32_complex(a_static, y_static, 2U, 1U, b_static, x_static, 3U, 1U, &static_iq, 1U);
+				acc_algorithm_roll_and_push_matrix_f32_complex(y_static, 2U, 1U, &static_iq, true);
+			}
+
+			float angle = cargf(iq - static_iq);
+
+			if (n == 0U)
+			{
+				prev_angle = angle;
+			}
+
+			float angle_diff = angle - prev_angle;
+
+			prev_angle = angle;
+
+			if ((float)M_PI < angle_diff)
+			{
+				angle_diff -= 2.0f * (float)M_PI;
+			}
+			else if (angle_diff < -(float)M_PI)
+			{
+				angle_diff += 2.0f * (float)M_PI;
+			}
+
+			unwrapped_angle += angle_diff;
+			phase            = unwrapped_angle;
+		}
+
+		float filtered;
+
+		if (sections)
+		{
+			if (n == 0U)
+			{
+				acc_algorithm_sosfilt_init_f32(zi_angle, BANDPASS_SECTIONS, &phase, 1U, state_angle);
+			}
+
+			acc_algorithm_sosfilt_f32(sos_angle, BANDPASS_SECTIONS, state_angle, &phase, &filtered, 1U);
+		}
+		else
+		{
+			acc_algorithm_roll_and_push_matrix_f32(x_angle, 5U, 1U, &phase, true);
+			acc_algorithm_apply_filter_f32(a_angle, y_angle, 4U, 1U, b_angle, x_angle, 5U, 1U, &filtered, 1U);
+			acc_algorithm_roll_and_push_matrix_f32(y_angle, 4U, 1U, &filtered, true);
+		}
+
+		output[n] = filtered;
+
+		if (n >= (length / 2U))
+		{
+			max_output = fmaxf(max_output, fabsf(filtered));
+		}
+	}
+
+	// The amplitude of the breathing motion after the filters, from the second half where it has settled
+	return max_output;
+}
+
+static float settling_time_s(const float *output, const float *reference, uint32_t length, float frame_rate, float amplitude)
+{
+	uint32_t last_outside = 0U;
+
+	for (uint32_t n = 0U; n < length; n++)
+	{
+		if (fabsf(output[n] - reference[n]) > (SETTLE_LIMIT * amplitude))
+		{
+			last_outside = n + 1U;
+		}
+	}
+
+	return (float)last_outside / frame_rate;
+}
+
+static void design_bandpass_double(double min_freq, double max_freq, double fs, double *b, double *a)
+{
+	// The design of acc_algorithm_butter_bandpass, in double
+	double         min_f = 4.0 * tan(M_PI * min_freq / fs);
+	double         max_f = 4.0 * tan(M_PI * max_freq / fs);
+	double         bw    = max_f - min_f;
+	double         w0    = min_f * max_f;
+	double complex p[2];
+	double complex p_z[4];
+
+	p[0] = -cexp((-M_PI / 4.0) * (double complex)I) * (bw / 2.0);
+	p[1] = -cexp((M_PI / 4.0) * (double complex)I) * (bw / 2.0);
+
+	double complex p_bp[4] = {
+		p[0] + csqrt((p[0] * p[0]) - w0),
+		p[1] + csqrt((p[1] * p[1]) - w0),
+		p[0] - csqrt((p[0] * p[0]) - w0),
+		p[1] - csqrt((p[1] * p[1]) - w0),
+	};
+
+	double complex p_prod = 1.0;
+
+	for (uint16_t i = 0U; i < 4U; i++)
+	{
+		p_z[i]  = cdiv_double(4.0 + p_bp[i], 4.0 - p_bp[i]);
+		p_prod *= 4.0 - p_bp[i];
+	}
+
+	double k = bw * bw * creal(cdiv_double(16.0, p_prod));
+
+	a[0] = creal(-(p_z[0] + p_z[1] + p_z[2] + p_z[3]));
+	a[1] = creal((p_z[0] * p_z[1]) + (p_z[0] * p_z[2]) + (p_z[0] * p_z[3]) + (p_z[1] * p_z[2]) + (p_z[1] * p_z[3]) + (p_z[2] * p_z[3]));
+	a[2] = creal(-((p_z[0] * p_z[1] * p_z[2]) + (p_z[0] * p_z[1] * p_z[3]) + (p_z[0] * p_z[2] * p_z[3]) + (p_z[1] * p_z[2] * p_z[3])));
+	a[3] = creal(p_z[0] * p_z[1] * p_z[2] * p_z[3]);
+	b[0] = k;
+	b[1] = 0.0;
+	b[2] = -2.0 * k;
+	b[3] = 0.0;
+	b[4] = k;
+}
+
+static double complex cdiv_double(double complex num, double complex denom)
+{
+	double denom_abs = (creal(denom) * creal(denom)) + (cimag(denom) * cimag(denom));
+
+	return (((creal(num) * creal(denom)) + (cimag(num) * cimag(denom))) +
+	        (((cimag(num) * creal(denom)) - (creal(num) * cimag(denom))) * (double complex)I)) /
+	       denom_abs;
+}
+
+static float noise(void)
+{
+	seed = (1103515245U * seed) + 12345U;
+
+	return ((float)((seed >> 8) & 0xFFFFU) / 32768.0f) - 1.0f;
+}
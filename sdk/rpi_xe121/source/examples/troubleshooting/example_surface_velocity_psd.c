@@ -0,0 +1,443 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "acc_definitions_common.h"
+#include "acc_surface_velocity_psd.h"
+
+/** \example example_surface_velocity_psd.c
+ * @brief This is an example that replays frames through the distance-locked PSD of example_surface_velocity
+ * @n
+ * The example executes as follows:
+ *   - Generate synthetic frames of a flowing surface for a number of scenes: a still surface,
+ *     a surface between two distances, a surface that drifts to the next distance, one that
+ *     jumps three distances, and a still surface with splashes further away
+ *   - Replay every scene through a PSD that locks the distance and one that always calculates
+ *     the PSD of all distances
+ *   - Check that the selected distance and its PSD are identical while the distance is locked,
+ *     that jitter between two distances does not drop the lock, and that the selected distance
+ *     agrees again once the lock has been dropped and the PSDs have settled
+ *   - Print the time per frame of both for 8 to 32 distances
+ *
+ * The example can be built for the host with
+ *   make ACC_CFG_HOST_BUILD=1 OUT_DIR=out_host surface_velocity_psd_host
+ */
+
+// The default config of example_surface_velocity
+#define SWEEPS_PER_FRAME   (128U)
+#define TIME_SERIES_LENGTH (512U)
+#define SWEEP_RATE         (3000.0f)
+#define NUM_DISTANCES      (16U)
+#define MAX_DISTANCES      (32U)
+#define TARGET_DISTANCE    (6U)
+#define NUM_FRAMES         (700U)
+#define CHANGE_FRAME       (200U)
+#define AGREE_FRAMES       (60U)
+#define TIMING_FRAMES      (300U)
+#define NUM_TONES          (5U)
+#define AMPLITUDE          (1000.0f)
+#define NOISE              (20.0f)
+#define SPLASH_OFFSET      (4U)
+
+typedef struct
+{
+	const char *name;
+	/** Position of the surface in distances from TARGET_DISTANCE, before and from CHANGE_FRAME */
+	float position;
+	float changed_position;
+	/** Alternate the changed position with this one every JITTER_PERIOD frames, 0 for no jitter */
+	float jitter_position;
+	/** Distance expected at the end, relative to TARGET_DISTANCE */
+	uint16_t final_offset;
+	/**
+	 * Amplitude of a splash at SPLASH_OFFSET from TARGET_DISTANCE relative to the surface, 0 for none.
+	 * The splash comes in the first frame after the lock is dropped. Its PSD is stronger than the PSD
+	 * of the surface while it is in the time series, but weaker after low-pass filtering.
+	 */
+	float splash_amplitude;
+} scene_t;
+
+#define JITTER_PERIOD (6U)
+
+static const scene_t scenes[] = {
+	{"still", 0.3f, 0.3f, 0.0f, 0U, 0.0f},
+	{"jitter", 0.3f, 0.45f, 0.55f, 0U, 0.0f},
+	{"drift", 0.3f, 0.7f, 0.0f, 1U, 0.0f},
+	{"jump", 0.3f, 3.3f, 0.0f, 3U, 0.0f},
+	{"splash", 0.3f, 0.3f, 0.0f, 0U, 2.2f},
+};
+
+#define NBR_SCENES (sizeof(scenes) / sizeof(scenes[0]))
+
+typedef struct
+{
+	uint32_t      seed;
+	uint32_t      sweep_count;
+	float         tone_hz[NUM_TONES];
+	float         tone_phase[NUM_TONES];
+	float complex doppler[SWEEPS_PER_FRAME];
+} generator_t;
+
+static acc_int16_complex_t frame[SWEEPS_PER_FRAME * MAX_DISTANCES];
+
+static bool check(bool ok, const char *name);
+
+static void default_config(acc_surface_velocity_psd_config_t *config, uint16_t num_distances);
+
+static bool run_scene(const scene_t *scene);
+
+static void benchmark(uint16_t num_distances);
+
+static void generator_init(generator_t *generator);
+
+static void generate_frame(generator_t *generator, float position, float splash_amplitude, uint16_t num_distances);
+
+static float random_uniform(generator_t *generator);
+
+static float max_relative_error(const float *a, const float *b, uint16_t length);
+
+static double now_us(void);
+
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	bool ok = true;
+
+	for (uint16_t i = 0U; i < NBR_SCENES; i++)
+	{
+		ok = run_scene(&scenes[i]) && ok;
+	}
+
+	for (uint16_t num_distances = 8U; num_distances <= MAX_DISTANCES; num_distances += 8U)
+	{
+		benchmark(num_distances);
+	}
+
+	printf("%s\n", ok ? "All checks passed" : "Some checks FAILED");
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool check(bool ok, const char *name)
+{
+	printf("  %-22s %s\n", name, ok ? "ok" : "FAILED");
+
+	return ok;
+}
+
+static void default_config(acc_surface_velocity_psd_config_t *config, uint16_t num_distances)
+{
+	config->num_distances         = num_distances;
+	config->sweeps_per_frame      = SWEEPS_PER_FRAME;
+	config->time_series_length    = TIME_SERIES_LENGTH;
+	config->sweep_rate            = SWEEP_RATE;
+	config->psd_lp_coeff          = 0.75f;
+	config->slow_zone_half_length = 3U;
+	config->lock_frames           = 50U;
+	config->lock_half_width       = 1U;
+	config->unlock_frames         = 10U;
+	config->rescan_interval       = 500U;
+	config->rescan_energy_ratio   = 0.5f;
+	config->settle_frames         = 12U;
+}
+
+static bool run_scene(const scene_t *scene)
+{
+	acc_surface_velocity_psd_config_t config;
+
+	default_config(&config, NUM_DISTANCES);
+
+	acc_surface_velocity_psd_t *locked = acc_surface_velocity_psd_create(&config);
+
+	config.lock_frames = 0U;
+
+	acc_surface_velocity_psd_t *full = acc_surface_velocity_psd_create(&config);
+
+	if ((locked == NULL) || (full == NULL))
+	{
+		printf("Failed to create the PSDs\n");
+		acc_surface_velocity_psd_destroy(locked);
+		acc_surface_velocity_psd_destroy(full);
+		return false;
+	}
+
+	uint16_t segment_length = acc_surface_velocity_psd_get_segment_length(locked);
+	generator_t generator;
+
+	generator_init(&generator);
+
+	uint32_t locked_compared = 0U;
+	uint32_t locked_differs  = 0U;
+	uint32_t settled_differs = 0U;
+	uint32_t full_changes    = 0U;
+	uint32_t locked_changes  = 0U;
+	uint16_t locked_index    = 0U;
+	uint16_t full_index      = 0U;
+	uint16_t max_offset      = 0U;
+	bool     was_locked      = false;
+
+	acc_surface_velocity_psd_stats_t stats;
+
+	for (uint32_t f = 0U; f < NUM_FRAMES; f++)
+	{
+		float position = scene->position;
+
+		if (f >= CHANGE_FRAME)
+		{
+			bool jitter = (scene->jitter_position != 0.0f) && (((f / JITTER_PERIOD) % 2U) != 0U);
+
+			position = jitter ? scene->jitter_position : scene->changed_position;
+		}
+
+		bool  lock_dropped = was_locked && !acc_surface_velocity_psd_is_locked(locked);
+		float splash       = lock_dropped ? scene->splash_amplitude : 0.0f;
+
+		was_locked = acc_surface_velocity_psd_is_locked(locked);
+
+		generate_frame(&generator, TARGET_DISTANCE + position, splash, NUM_DISTANCES);
+
+		acc_surface_velocity_psd_get_stats(locked, &stats);
+
+		// Only a rescan that finds the same distance keeps the tracked PSDs exact
+		bool     exact            = acc_surface_velocity_psd_is_locked(locked) && (stats.unlocks_moved == 0U) && (stats.unlocks_lost == 0U);
+		uint16_t new_locked_index = acc_surface_velocity_psd_update(locked, frame);
+		uint16_t new_full_index   = acc_surface_velocity_psd_update(full, frame);
+
+		if (f >= CHANGE_FRAME)
+		{
+			full_changes   += (new_full_index != full_index) ? 1U : 0U;
+			locked_changes += (new_locked_index != locked_index) ? 1U : 0U;
+		}
+
+		locked_index = new_locked_index;
+		full_index   = new_full_index;
+
+		uint16_t offset = (locked_index > full_index) ? (locked_index - full_index) : (full_index - locked_index);
+
+		max_offset = (f >= CHANGE_FRAME) && (offset > max_offset) ? offset : max_offset;
+
+		// While locked, the tracked distances are filtered exactly as with a PSD of all distances
+		if (exact && (locked_index == full_index))
+		{
+			bool same = memcmp(acc_surface_velocity_psd_get_psd(locked), acc_surface_velocity_psd_get_psd(full), segment_length * sizeof(float)) == 0;
+
+			locked_compared += 1U;
+			locked_differs  += same ? 0U : 1U;
+		}
+
+		if ((f >= (CHANGE_FRAME + AGREE_FRAMES)) && (locked_index != full_index))
+		{
+			settled_differs += 1U;
+		}
+	}
+
+	acc_surface_velocity_psd_get_stats(locked, &stats);
+
+	float error = max_relative_error(acc_surface_velocity_psd_get_psd(locked), acc_surface_velocity_psd_get_psd(full), segment_length);
+
+	printf("%s: locked %u of %u frames, %u locks, %u unlocks for a neighbour, %u for lost energy, %u rescans, "
+	       "max PSD error at the end %g\n",
+	       scene->name,
+	       (unsigned int)stats.locked_frames,
+	       (unsigned int)stats.frames,
+	       (unsigned int)stats.locks,
+	       (unsigned int)stats.unlocks_moved,
+	       (unsigned int)stats.unlocks_lost,
+	       (unsigned int)stats.rescans,
+	       (double)error);
+
+	bool ok = true;
+
+	ok = check((locked_compared >= CHANGE_FRAME / 2U) && (locked_differs == 0U), "identical while locked") && ok;
+	ok = check((locked_index == (TARGET_DISTANCE + scene->final_offset)) && acc_surface_velocity_psd_is_locked(locked), "locked at the end") && ok;
+	ok = check(error < 1e-3f, "same PSD at the end") && ok;
+
+	if (scene->jitter_position != 0.0f)
+	{
+		ok = check(full_changes > 4U, "full scan jitters") && ok;
+		ok = check((locked_changes == 0U) && (stats.unlocks_moved == 0U) && (stats.unlocks_lost == 0U), "lock kept on jitter") && ok;
+		ok = check(max_offset <= 1U, "within one distance") && ok;
+	}
+	else
+	{
+		ok = check(settled_differs == 0U, "same distance settled") && ok;
+	}
+
+	if (scene->final_offset == 0U)
+	{
+		ok = check(stats.rescans > 0U, "rescanned") && ok;
+	}
+	else if (scene->final_offset == 1U)
+	{
+		ok = check(stats.unlocks_moved > 0U, "unlocked for neighbour") && ok;
+	}
+	else
+	{
+		ok = check(stats.unlocks_lost > 0U, "unlocked on lost energy") && ok;
+	}
+
+	acc_surface_velocity_psd_destroy(locked);
+	acc_surface_velocity_psd_destroy(full);
+
+	return ok;
+}
+
+static void benchmark(uint16_t num_distances)
+{
+	acc_surface_velocity_psd_config_t config;
+
+	default_config(&config, num_distances);
+
+	// Never rescan, so that every locked frame is timed with the lock
+	config.rescan_interval = UINT16_MAX;
+
+	acc_surface_velocity_psd_t *locked = acc_surface_velocity_psd_create(&config);
+
+	config.lock_frames = 0U;
+
+	acc_surface_velocity_psd_t *full = acc_surface_velocity_psd_create(&config);
+
+	if ((locked != NULL) && (full != NULL))
+	{
+		generator_t generator;
+		double      locked_us = 0.0;
+		double      full_us   = 0.0;
+		uint32_t    timed     = 0U;
+
+		generator_init(&generator);
+
+		for (uint32_t f = 0U; f < TIMING_FRAMES; f++)
+		{
+			generate_frame(&generator, (float)(num_distances / 2U) + 0.3f, 0.0f, num_distances);
+
+			bool   was_locked = acc_surface_velocity_psd_is_locked(locked);
+			double start      = now_us();
+
+			acc_surface_velocity_psd_update(locked, frame);
+
+			double middle = now_us();
+
+			acc_surface_velocity_psd_update(full, frame);
+
+			double end = now_us();
+
+			if (was_locked)
+			{
+				locked_us += middle - start;
+				full_us   += end - middle;
+				timed     += 1U;
+			}
+		}
+
+		if (timed > 0U)
+		{
+			printf("%2u distances: %8.1f us per frame for all distances, %8.1f us locked\n",
+			       (unsigned int)num_distances,
+			       full_us / (double)timed,
+			       locked_us / (double)timed);
+		}
+		else
+		{
+			printf("%2u distances: never locked\n", (unsigned int)num_distances);
+		}
+	}
+
+	acc_surface_velocity_psd_destroy(locked);
+	acc_surface_velocity_psd_destroy(full);
+}
+
+static void generator_init(generator_t *generator)
+{
+	generator->seed        = 12345U;
+	generator->sweep_count = 0U;
+
+	// A spread of surface velocities, 140 Hz to 234 Hz of Doppler shift, at the centres of the PSD bins
+	for (uint16_t i = 0U; i < NUM_TONES; i++)
+	{
+		generator->tone_hz[i]    = (6.0f + (float)i) * SWEEP_RATE / (float)(TIME_SERIES_LENGTH / 4U);
+		generator->tone_phase[i] = 2.0f * (float)M_PI * (random_uniform(generator) + 1.0f) / 2.0f;
+	}
+}
+
+/**
+ * @brief Generate a frame with the surface at a position between two distances
+ *
+ * The power of the surface reflection falls off as exp(-x^2) with the distance x from the position.
+ * A splash is a reflection with the same spectrum at SPLASH_OFFSET from TARGET_DISTANCE.
+ */
+static void generate_frame(generator_t *generator, float position, float splash_amplitude, uint16_t num_distances)
+{
+	for (uint16_t s = 0U; s < SWEEPS_PER_FRAME; s++)
+	{
+		float t = (float)generator->sweep_count / SWEEP_RATE;
+
+		generator->doppler[s] = 0.0f;
+
+		for (uint16_t i = 0U; i < NUM_TONES; i++)
+		{
+			generator->doppler[s] += cexpf(I * ((2.0f * (float)M_PI * generator->tone_hz[i] * t) + generator->tone_phase[i])) / (float)NUM_TONES;
+		}
+
+		generator->sweep_count += 1U;
+	}
+
+	for (uint16_t d = 0U; d < num_distances; d++)
+	{
+		float x         = (float)d - position;
+		float splash_x  = (float)d - (float)(TARGET_DISTANCE + SPLASH_OFFSET);
+		float amplitude = AMPLITUDE * (expf(-(x * x) / 2.0f) + (splash_amplitude * expf(-(splash_x * splash_x) / 2.0f)));
+
+		for (uint16_t s = 0U; s < SWEEPS_PER_FRAME; s++)
+		{
+			float complex value = (amplitude * generator->doppler[s]) + (NOISE * (random_uniform(generator) + (I * random_uniform(generator))));
+
+			frame[(s * num_distances) + d].real = (int16_t)lrintf(crealf(value));
+			frame[(s * num_distances) + d].imag = (int16_t)lrintf(cimagf(value));
+		}
+	}
+}
+
+static float random_uniform(generator_t *generator)
+{
+	generator->seed = (generator->seed * 1103515245U) + 12345U;
+
+	return ((float)((generator->seed >> 8) & 0xFFFFU) / 32768.0f) - 1.0f;
+}
+
+static float max_relative_error(const float *a, const float *b, uint16_t length)
+{
+	float max_b = 0.0f;
+	float error = 0.0f;
+
+	for (uint16_t i = 0U; i < length; i++)
+	{
+		max_b = fmaxf(max_b, fabsf(b[i]));
+		error = fmaxf(error, fabsf(a[i] - b[i]));
+	}
+
+	return (max_b > 0.0f) ? (error / max_b) : error;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
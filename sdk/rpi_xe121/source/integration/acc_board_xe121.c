@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "acc_definitions_common.h"
 #include "acc_hal_definitions_a121.h"
@@ -41,6 +42,9 @@
 #define ACC_BOARD_BUS       (0)        /**< @brief The SPI bus of this board */
 #define ACC_BOARD_CS        (0)        /**< @brief The SPI device of the board */
 
+#define SENSOR_CRYSTAL_STARTUP_US (2000U) /**< @brief Time from enable until the sensor crystal is stable */
+#define SENSOR_DISABLE_SETTLE_US  (2000U) /**< @brief Time from disable until the sensor is in a known state */
+
 typedef struct
 {
 	const int enable_pin;
@@ -70,6 +74,21 @@ static const gpio_config_t pin_config[] = {{PIN_SPI_SEL0, GPIO_DIR_OUTPUT_LOW},
                                            {PIN_SEN_INT5_3V3, GPIO_DIR_INPUT_INTERRUPT},
                                            {0, GPIO_DIR_UNKNOWN}};
 
+/**
+ * @brief Time (get_time_us) when each sensor may be accessed again, 0 when it may be accessed now
+ *
+ * Enable and disable do not sleep. They set a deadline that is waited for on the
+ * next access to the same sensor: the first SPI transfer after enable, or the next
+ * enable/disable. Sensors that are enabled back to back therefore share the crystal
+ * startup time, and work done by the application in between is not added to it.
+ *
+ * The sensors may be accessed from different threads, so it is only accessed with
+ * ready_time_mutex held.
+ */
+static uint64_t sensor_ready_time_us[SENSOR_COUNT];
+
+static pthread_mutex_t ready_time_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static uint32_t spi_speed = ACC_BOARD_SPI_SPEED;
 
 static pthread_mutex_t spi_mutex;
@@ -126,6 +145,53 @@ static bool acc_board_init(void)
 	return result;
 }
 
+/**
+ * @brief Monotonic time in us that does not wrap, unlike acc_integration_get_time_us
+ */
+static uint64_t get_time_us(void)
+{
+	struct timespec time_ts = {0};
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+	return ((uint64_t)time_ts.tv_sec * 1000000U) + ((uint64_t)time_ts.tv_nsec / 1000U);
+}
+
+static void sensor_set_ready_time(acc_sensor_id_t sensor_id, uint32_t delay_us)
+{
+	pthread_mutex_lock(&ready_time_mutex);
+	sensor_ready_time_us[sensor_id - 1] = get_time_us() + delay_us;
+	pthread_mutex_unlock(&ready_time_mutex);
+}
+
+static void sensor_wait_until_ready(acc_sensor_id_t sensor_id)
+{
+	pthread_mutex_lock(&ready_time_mutex);
+	uint64_t ready_time_us = sensor_ready_time_us[sensor_id - 1];
+	pthread_mutex_unlock(&ready_time_mutex);
+
+	if (ready_time_us == 0U)
+	{
+		return;
+	}
+
+	// Sleep without the lock so that the other sensors are not held up
+	uint64_t now_us = get_time_us();
+
+	if (now_us < ready_time_us)
+	{
+		acc_integration_sleep_us((uint32_t)(ready_time_us - now_us));
+	}
+
+	// A deadline that was set while sleeping is kept for the next access
+	pthread_mutex_lock(&ready_time_mutex);
+	if (sensor_ready_time_us[sensor_id - 1] == ready_time_us)
+	{
+		sensor_ready_time_us[sensor_id - 1] = 0U;
+	}
+
+	pthread_mutex_unlock(&ready_time_mutex);
+}
+
 static bool acc_board_spi_select(acc_sensor_id_t sensor_id)
 {
 	assert(sensor_id <= SENSOR_COUNT);
@@ -177,6 +243,10 @@ static bool acc_board_spi_select(acc_sensor_id_t sensor_id)
 static void acc_board_sensor_transfer(acc_sensor_id_t sensor_id, uint8_t *buffer, size_t buffer_length)
 {
 	assert(sensor_id <= SENSOR_COUNT);
+
+	// Wait outside the lock so that transfers to other sensors are not held up
+	sensor_wait_until_ready(sensor_id);
+
 	bool result = pthread_mutex_lock(&spi_mutex) == 0;
 	assert(result);
 
@@ -219,14 +289,17 @@ void acc_hal_integration_sensor_enable(acc_sensor_id_t sensor_id)
 	assert(sensor_id <= SENSOR_COUNT);
 	acc_sensor_info_t *sensor_info = &sensor_infos[sensor_id - 1];
 
+	// A previous disable must have settled
+	sensor_wait_until_ready(sensor_id);
+
 	if (!acc_libgpiod_set(sensor_info->enable_pin, PIN_HIGH))
 	{
 		fprintf(stderr, "%s: Unable to activate enable_pin for sensor %" PRIsensor_id ".\n", __func__, sensor_id);
 		assert(false);
 	}
 
-	// Wait 2 ms to make sure that the sensor crystal has time to stabilize
-	acc_integration_sleep_ms(2);
+	// The sensor crystal needs 2 ms to stabilize, this is waited for on the first transfer
+	sensor_set_ready_time(sensor_id, SENSOR_CRYSTAL_STARTUP_US);
 }
 
 void acc_hal_integration_sensor_disable(acc_sensor_id_t sensor_id)
@@ -234,6 +307,9 @@ void acc_hal_integration_sensor_disable(acc_sensor_id_t sensor_id)
 	assert(sensor_id <= SENSOR_COUNT);
 	acc_sensor_info_t *sensor_info = &sensor_infos[sensor_id - 1];
 
+	// Keep the enable pulse at least as long as the crystal startup time
+	sensor_wait_until_ready(sensor_id);
+
 	// Disable sensor
 	if (!acc_libgpiod_set(sensor_info->enable_pin, PIN_LOW))
 	{
@@ -242,8 +318,9 @@ void acc_hal_integration_sensor_disable(acc_sensor_id_t sensor_id)
 	}
 
 	// Wait after disable to leave the sensor in a known state
-	// in case the application intends to enable the sensor directly
-	acc_integration_sleep_ms(2);
+	// in case the application intends to enable the sensor directly.
+	// This is waited for on the next enable.
+	sensor_set_ready_time(sensor_id, SENSOR_DISABLE_SETTLE_US);
 }
 
 bool acc_hal_integration_wait_for_sensor_interrupt(acc_sensor_id_t sensor_id, uint32_t timeout_ms)
@@ -267,8 +344,8 @@ const acc_hal_a121_t *acc_hal_rss_integration_get_implementation(void)
 	static const acc_hal_a121_t val = {
 	    .max_spi_transfer_size = MAX_SPI_TRANSFER_SIZE,
 
-	    .mem_alloc = malloc,
-	    .mem_free  = free,
+	    .mem_alloc = acc_integration_mem_alloc,
+	    .mem_free  = acc_integration_mem_free,
 
 	    .transfer = acc_board_sensor_transfer,
 	    .log      = acc_integration_log,
@@ -0,0 +1,156 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_definitions_common.h"
+#include "acc_hal_definitions_a121.h"
+#include "acc_hal_fault_injection.h"
+#include "acc_hal_integration_a121.h"
+
+typedef struct
+{
+	uint32_t period;
+	uint32_t burst;
+	uint32_t events;
+	uint32_t injected;
+} fault_state_t;
+
+static void fault_injection_transfer(acc_sensor_id_t sensor_id, uint8_t *buffer, size_t buffer_size);
+
+static bool inject(acc_hal_fault_t fault);
+
+static void read_env_fault(acc_hal_fault_t fault, const char *name);
+
+static const char *fault_env_names[ACC_HAL_FAULT_NUM_FAULTS] = {
+	"ACC_HAL_FAULT_INTERRUPT_TIMEOUT",
+	"ACC_HAL_FAULT_TRANSFER",
+};
+
+static fault_state_t faults[ACC_HAL_FAULT_NUM_FAULTS];
+
+static acc_hal_a121_t                      fault_injection_hal;
+static acc_hal_sensor_transfer8_function_t board_transfer = NULL;
+
+
+const acc_hal_a121_t *acc_hal_fault_injection_get_implementation(const acc_hal_a121_t *hal)
+{
+	if (hal == NULL)
+	{
+		return NULL;
+	}
+
+	for (uint16_t i = 0U; i < ACC_HAL_FAULT_NUM_FAULTS; i++)
+	{
+		read_env_fault((acc_hal_fault_t)i, fault_env_names[i]);
+	}
+
+	fault_injection_hal = *hal;
+	board_transfer      = hal->transfer;
+
+	fault_injection_hal.transfer = fault_injection_transfer;
+
+	// The 16-bit transfer would bypass the wrapper
+	fault_injection_hal.optimization.transfer16 = NULL;
+
+	return &fault_injection_hal;
+}
+
+
+void acc_hal_fault_injection_set_fault(acc_hal_fault_t fault, uint32_t period, uint32_t burst)
+{
+	faults[fault].period = period;
+	faults[fault].burst  = (burst > 0U) ? burst : 1U;
+	faults[fault].events = 0U;
+}
+
+
+bool acc_hal_fault_injection_wait_for_sensor_interrupt(acc_sensor_id_t sensor_id, uint32_t timeout_ms)
+{
+	if (inject(ACC_HAL_FAULT_INTERRUPT_TIMEOUT))
+	{
+		return false;
+	}
+
+	return acc_hal_integration_wait_for_sensor_interrupt(sensor_id, timeout_ms);
+}
+
+
+uint32_t acc_hal_fault_injection_get_count(acc_hal_fault_t fault)
+{
+	return faults[fault].injected;
+}
+
+
+static void fault_injection_transfer(acc_sensor_id_t sensor_id, uint8_t *buffer, size_t buffer_size)
+{
+	if (inject(ACC_HAL_FAULT_TRANSFER))
+	{
+		memset(buffer, 0, buffer_size);
+		return;
+	}
+
+	board_transfer(sensor_id, buffer, buffer_size);
+}
+
+
+static bool inject(acc_hal_fault_t fault)
+{
+	fault_state_t *state = &faults[fault];
+
+	if (state->period == 0U)
+	{
+		return false;
+	}
+
+	state->events++;
+
+	// The burst ends each period, so the first fault comes after period - burst good events
+	uint32_t position = state->events % state->period;
+	bool     failed   = (position == 0U) || (position > (state->period - state->burst));
+
+	if (failed)
+	{
+		state->injected++;
+	}
+
+	return failed;
+}
+
+
+static void read_env_fault(acc_hal_fault_t fault, const char *name)
+{
+	const char *value = getenv(name);
+
+	if (value == NULL)
+	{
+		return;
+	}
+
+	char         *end    = NULL;
+	unsigned long period = strtoul(value, &end, 10);
+	unsigned long burst  = 1UL;
+
+	if (*end == ':')
+	{
+		burst = strtoul(end + 1, NULL, 10);
+	}
+
+	if ((period == 0UL) || (burst == 0UL) || (burst >= period))
+	{
+		printf("Ignoring invalid %s=%s, expected period[:burst] with burst < period\n", name, value);
+		return;
+	}
+
+	acc_hal_fault_injection_set_fault(fault, (uint32_t)period, (uint32_t)burst);
+
+	printf("Injecting %s: %lu of every %lu\n", name, burst, period);
+}
@@ -7,10 +7,81 @@
 #include "acc_integration.h"
 
 #include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#define MEM_STEADY_STATE_ENV_VARIABLE "ACC_MEM_STEADY_STATE"
+#define MEM_POOL_SIZE_ENV_VARIABLE    "ACC_MEM_POOL_SIZE"
+
+#define MEM_MAGIC          (0xacc0a110U)
+#define MEM_HEADER_SIZE    (16U)
+#define MEM_MIN_SPLIT_SIZE (64U)
+#define MEM_MAX_SIZE       (UINT32_MAX / 2U)
+#define MEM_MAX_SITES      (64U)
+
+/**
+ * Header in front of every allocation, MEM_HEADER_SIZE bytes to keep the alignment of malloc
+ */
+typedef struct
+{
+	uint32_t magic;
+	uint32_t size;
+	uint32_t block_size; /**< Size of the pool block including the header, only used in the pool */
+	uint32_t site;
+} mem_header_t;
+
+typedef struct mem_free_block
+{
+	size_t                 size;
+	struct mem_free_block *next;
+} mem_free_block_t;
+
+typedef struct
+{
+	void    *address;
+	uint32_t allocations;
+	size_t   live_bytes;
+} mem_site_t;
+
+static void *mem_alloc(size_t size, void *caller);
+
+static void mem_init(void);
+
+static uint16_t mem_find_site(void *caller);
+
+static size_t mem_round_up(size_t size);
+
+static bool pool_create(size_t size);
+
+static mem_header_t *pool_alloc(size_t block_size);
+
+static void pool_free(mem_header_t *header);
+
+static pthread_mutex_t mem_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool     mem_initialized              = false;
+static bool     mem_steady_state_abort       = false;
+static uint32_t mem_steady_state_depth       = 0U;
+static uint32_t mem_steady_state_allocations = 0U;
+static size_t   mem_live_bytes               = 0U;
+static size_t   mem_peak_bytes               = 0U;
+static uint32_t mem_live_allocations         = 0U;
+static uint32_t mem_total_allocations        = 0U;
+
+static mem_site_t mem_sites[MEM_MAX_SITES];
+static uint16_t   mem_site_count = 1U;
+
+static uint8_t          *mem_pool           = NULL;
+static size_t            mem_pool_size      = 0U;
+static mem_free_block_t *mem_pool_free_list = NULL;
+static uint32_t          mem_pool_fallbacks = 0U;
+
 void acc_integration_sleep_us(uint32_t time_usec)
 {
 	int             ret = 0;
@@ -42,20 +113,368 @@ uint32_t acc_integration_get_time(void)
 	struct timespec time_ts = {0};
 
 	clock_gettime(CLOCK_MONOTONIC, &time_ts);
-	return time_ts.tv_sec * 1000 + time_ts.tv_nsec / 1000000;
+	return (uint32_t)(((uint64_t)time_ts.tv_sec * 1000U) + ((uint64_t)time_ts.tv_nsec / 1000000U));
+}
+
+uint32_t acc_integration_get_time_us(void)
+{
+	struct timespec time_ts = {0};
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+	return (uint32_t)(((uint64_t)time_ts.tv_sec * 1000000U) + ((uint64_t)time_ts.tv_nsec / 1000U));
 }
 
 void *acc_integration_mem_alloc(size_t size)
 {
-	return malloc(size);
+	return mem_alloc(size, __builtin_return_address(0));
 }
 
 void *acc_integration_mem_calloc(size_t nmemb, size_t size)
 {
-	return calloc(nmemb, size);
+	if ((size != 0U) && (nmemb > (SIZE_MAX / size)))
+	{
+		return NULL;
+	}
+
+	void *ptr = mem_alloc(nmemb * size, __builtin_return_address(0));
+
+	if (ptr != NULL)
+	{
+		memset(ptr, 0, nmemb * size);
+	}
+
+	return ptr;
 }
 
 void acc_integration_mem_free(void *ptr)
 {
-	free(ptr);
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	mem_header_t *header = (mem_header_t *)((uint8_t *)ptr - MEM_HEADER_SIZE);
+
+	pthread_mutex_lock(&mem_mutex);
+
+	if (header->magic != MEM_MAGIC)
+	{
+		pthread_mutex_unlock(&mem_mutex);
+		printf("acc_integration_mem_free: %p was not allocated or is already freed\n", ptr);
+		abort();
+	}
+
+	header->magic = 0U;
+
+	mem_live_bytes -= header->size;
+	mem_live_allocations--;
+	mem_sites[header->site].live_bytes -= header->size;
+
+	if (((uint8_t *)header >= mem_pool) && ((uint8_t *)header < (mem_pool + mem_pool_size)))
+	{
+		pool_free(header);
+		pthread_mutex_unlock(&mem_mutex);
+	}
+	else
+	{
+		pthread_mutex_unlock(&mem_mutex);
+		free(header);
+	}
+}
+
+bool acc_integration_mem_pool_init(size_t size)
+{
+	bool status = false;
+
+	pthread_mutex_lock(&mem_mutex);
+
+	if ((mem_total_allocations == 0U) && (mem_pool == NULL))
+	{
+		status = pool_create(size);
+	}
+
+	pthread_mutex_unlock(&mem_mutex);
+
+	return status;
+}
+
+void acc_integration_mem_steady_state_begin(void)
+{
+	pthread_mutex_lock(&mem_mutex);
+	mem_steady_state_depth++;
+	pthread_mutex_unlock(&mem_mutex);
+}
+
+void acc_integration_mem_steady_state_end(void)
+{
+	pthread_mutex_lock(&mem_mutex);
+
+	if (mem_steady_state_depth > 0U)
+	{
+		mem_steady_state_depth--;
+	}
+
+	pthread_mutex_unlock(&mem_mutex);
+}
+
+void acc_integration_mem_get_stats(acc_integration_mem_stats_t *stats)
+{
+	pthread_mutex_lock(&mem_mutex);
+
+	stats->live_bytes               = mem_live_bytes;
+	stats->peak_bytes               = mem_peak_bytes;
+	stats->live_allocations         = mem_live_allocations;
+	stats->total_allocations        = mem_total_allocations;
+	stats->steady_state_allocations = mem_steady_state_allocations;
+	stats->pool_size                = mem_pool_size;
+	stats->pool_free_bytes          = 0U;
+	stats->pool_fallbacks           = mem_pool_fallbacks;
+
+	for (const mem_free_block_t *block = mem_pool_free_list; block != NULL; block = block->next)
+	{
+		stats->pool_free_bytes += block->size;
+	}
+
+	pthread_mutex_unlock(&mem_mutex);
+}
+
+void acc_integration_mem_print_stats(void)
+{
+	acc_integration_mem_stats_t stats;
+
+	acc_integration_mem_get_stats(&stats);
+
+	printf("Heap: live %zu bytes in %" PRIu32 " blocks, peak %zu bytes, %" PRIu32 " allocations, %" PRIu32 " in steady state\n",
+	       stats.live_bytes,
+	       stats.live_allocations,
+	       stats.peak_bytes,
+	       stats.total_allocations,
+	       stats.steady_state_allocations);
+
+	if (stats.pool_size > 0U)
+	{
+		printf("Pool: %zu bytes, %zu free, %" PRIu32 " fallbacks to malloc\n", stats.pool_size, stats.pool_free_bytes, stats.pool_fallbacks);
+	}
+
+	pthread_mutex_lock(&mem_mutex);
+
+	for (uint16_t i = 0U; i < mem_site_count; i++)
+	{
+		if (mem_sites[i].allocations == 0U)
+		{
+			continue;
+		}
+
+		printf("  %18p: %8" PRIu32 " allocations, %10zu bytes live\n", mem_sites[i].address, mem_sites[i].allocations, mem_sites[i].live_bytes);
+	}
+
+	pthread_mutex_unlock(&mem_mutex);
+}
+
+static void *mem_alloc(size_t size, void *caller)
+{
+	mem_header_t *header = NULL;
+	bool          report = false;
+
+	if (size > MEM_MAX_SIZE)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&mem_mutex);
+
+	if (!mem_initialized)
+	{
+		mem_init();
+	}
+
+	if (mem_pool != NULL)
+	{
+		header = pool_alloc(MEM_HEADER_SIZE + mem_round_up(size));
+
+		if (header == NULL)
+		{
+			mem_pool_fallbacks++;
+		}
+	}
+
+	if (header == NULL)
+	{
+		header = malloc(MEM_HEADER_SIZE + size);
+	}
+
+	if (header != NULL)
+	{
+		header->magic = MEM_MAGIC;
+		header->size  = (uint32_t)size;
+		header->site  = mem_find_site(caller);
+
+		mem_live_bytes += size;
+		mem_live_allocations++;
+		mem_total_allocations++;
+		mem_sites[header->site].allocations++;
+		mem_sites[header->site].live_bytes += size;
+
+		if (mem_live_bytes > mem_peak_bytes)
+		{
+			mem_peak_bytes = mem_live_bytes;
+		}
+	}
+
+	if (mem_steady_state_depth > 0U)
+	{
+		mem_steady_state_allocations++;
+		report = true;
+	}
+
+	pthread_mutex_unlock(&mem_mutex);
+
+	if (report)
+	{
+		printf("Allocation of %zu bytes in steady state from %p\n", size, caller);
+
+		if (mem_steady_state_abort)
+		{
+			abort();
+		}
+	}
+
+	return (header != NULL) ? (uint8_t *)header + MEM_HEADER_SIZE : NULL;
+}
+
+static void mem_init(void)
+{
+	const char *steady_state = getenv(MEM_STEADY_STATE_ENV_VARIABLE);
+	const char *pool_size    = getenv(MEM_POOL_SIZE_ENV_VARIABLE);
+
+	mem_initialized        = true;
+	mem_steady_state_abort = (steady_state != NULL) && (strcmp(steady_state, "abort") == 0);
+
+	if ((pool_size != NULL) && (mem_pool == NULL))
+	{
+		size_t size = (size_t)strtoul(pool_size, NULL, 0);
+
+		if (!pool_create(size))
+		{
+			printf("Could not create a %zu byte allocation pool\n", size);
+		}
+	}
+}
+
+static uint16_t mem_find_site(void *caller)
+{
+	for (uint16_t i = 1U; i < mem_site_count; i++)
+	{
+		if (mem_sites[i].address == caller)
+		{
+			return i;
+		}
+	}
+
+	if (mem_site_count < MEM_MAX_SITES)
+	{
+		mem_sites[mem_site_count].address = caller;
+		return mem_site_count++;
+	}
+
+	// Site 0 collects the call sites that do not fit in the table
+	return 0U;
+}
+
+static size_t mem_round_up(size_t size)
+{
+	return (size + (MEM_HEADER_SIZE - 1U)) & ~(size_t)(MEM_HEADER_SIZE - 1U);
+}
+
+static bool pool_create(size_t size)
+{
+	size = mem_round_up(size);
+
+	if ((size < sizeof(mem_free_block_t)) || (size > MEM_MAX_SIZE))
+	{
+		return false;
+	}
+
+	mem_pool = malloc(size);
+	if (mem_pool == NULL)
+	{
+		return false;
+	}
+
+	mem_pool_size      = size;
+	mem_pool_free_list = (mem_free_block_t *)mem_pool;
+
+	mem_pool_free_list->size = size;
+	mem_pool_free_list->next = NULL;
+
+	return true;
+}
+
+static mem_header_t *pool_alloc(size_t block_size)
+{
+	mem_free_block_t **link = &mem_pool_free_list;
+
+	// First fit in a free list ordered by address
+	while ((*link != NULL) && ((*link)->size < block_size))
+	{
+		link = &(*link)->next;
+	}
+
+	mem_free_block_t *block = *link;
+
+	if (block == NULL)
+	{
+		return NULL;
+	}
+
+	if ((block->size - block_size) >= MEM_MIN_SPLIT_SIZE)
+	{
+		mem_free_block_t *rest = (mem_free_block_t *)((uint8_t *)block + block_size);
+
+		rest->size = block->size - block_size;
+		rest->next = block->next;
+		*link      = rest;
+	}
+	else
+	{
+		block_size = block->size;
+		*link      = block->next;
+	}
+
+	mem_header_t *header = (mem_header_t *)block;
+
+	header->block_size = (uint32_t)block_size;
+
+	return header;
+}
+
+static void pool_free(mem_header_t *header)
+{
+	mem_free_block_t  *block = (mem_free_block_t *)header;
+	mem_free_block_t **link  = &mem_pool_free_list;
+	mem_free_block_t  *prev  = NULL;
+
+	block->size = header->block_size;
+
+	while ((*link != NULL) && (*link < block))
+	{
+		prev = *link;
+		link = &(*link)->next;
+	}
+
+	block->next = *link;
+	*link       = block;
+
+	// Merge with the following and the preceding free block
+	if ((block->next != NULL) && (((uint8_t *)block + block->size) == (uint8_t *)block->next))
+	{
+		block->size += block->next->size;
+		block->next = block->next->next;
+	}
+
+	if ((prev != NULL) && (((uint8_t *)prev + prev->size) == (uint8_t *)block))
+	{
+		prev->size += block->size;
+		prev->next = block->next;
+	}
 }
@@ -4,8 +4,14 @@
 // 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
 // of this source code package.
 #include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "gpiod.h"
 
@@ -18,9 +24,153 @@
 #define RPI_GPIO_CHIPNAME "gpiochip0"
 #define GPIOD_CONSUMER    "Acconeer"
 
+#define BUSY_POLL_ENV_VARIABLE "ACC_GPIO_BUSY_POLL_US"
+#define MMAP_ENV_VARIABLE      "ACC_GPIO_MMAP"
+
+/**
+ * @brief GPIO registers of the BCM2835-BCM2711, GPLEV0 holds the level of pin 0-31 and GPLEV1 of pin 32-53
+ */
+#define GPIOMEM_PATH    "/dev/gpiomem"
+#define GPIOMEM_SIZE    4096
+#define GPIOMEM_GPLEV0  (0x34 / sizeof(uint32_t))
+#define GPIOMEM_GPLEV1  (0x38 / sizeof(uint32_t))
+
 static gpio_pin_t         gpios[GPIO_PIN_COUNT];
 static struct gpiod_chip *chip;
 
+static uint32_t                  busy_poll_window_us = 0;
+static void                     *gpiomem_map         = NULL;
+static volatile uint32_t        *gpio_registers      = NULL;
+static acc_libgpiod_wait_stats_t wait_stats;
+
+// The statistics are read and reset by other threads than the one waiting, e.g. a reporting thread
+static pthread_mutex_t wait_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool gpiomem_open(void)
+{
+	if (gpio_registers != NULL)
+	{
+		return true;
+	}
+
+	int fd = open(GPIOMEM_PATH, O_RDONLY | O_SYNC);
+	if (fd < 0)
+	{
+		perror("Failed opening " GPIOMEM_PATH);
+		return false;
+	}
+
+	void *map = mmap(NULL, GPIOMEM_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+	{
+		perror("mmap of " GPIOMEM_PATH " failed");
+		return false;
+	}
+
+	gpiomem_map    = map;
+	gpio_registers = map;
+
+	return true;
+}
+
+static void gpiomem_close(void)
+{
+	if (gpiomem_map != NULL)
+	{
+		munmap(gpiomem_map, GPIOMEM_SIZE);
+		gpiomem_map    = NULL;
+		gpio_registers = NULL;
+	}
+}
+
+static int gpio_read_value(int pin)
+{
+	if (gpio_registers != NULL)
+	{
+		if (pin >= 32)
+		{
+			return (gpio_registers[GPIOMEM_GPLEV1] >> (pin - 32)) & 1;
+		}
+
+		return (gpio_registers[GPIOMEM_GPLEV0] >> pin) & 1;
+	}
+
+	return gpiod_line_get_value(gpios[pin].line);
+}
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+}
+
+static uint64_t timespec_to_ns(const struct timespec *ts)
+{
+	return ((uint64_t)ts->tv_sec * 1000000000) + (uint64_t)ts->tv_nsec;
+}
+
+/**
+ * @brief Read the queued edge events of a pin without blocking
+ *
+ * @return The timestamp of the last rising edge read, 0 if there was none
+ */
+static uint64_t drain_events(int pin)
+{
+	uint64_t                edge_ns = 0;
+	struct timespec         no_wait = {0, 0};
+	struct gpiod_line_event event;
+
+	while (gpiod_line_event_wait(gpios[pin].line, &no_wait) > 0)
+	{
+		if (gpiod_line_event_read(gpios[pin].line, &event) != 0)
+		{
+			break;
+		}
+
+		if (event.event_type == GPIOD_LINE_EVENT_RISING_EDGE)
+		{
+			edge_ns = timespec_to_ns(&event.ts);
+		}
+	}
+
+	return edge_ns;
+}
+
+static void record_latency(uint32_t *histogram, uint64_t latency_ns)
+{
+	uint64_t latency_us = latency_ns / 1000;
+	int      bucket     = 0;
+
+	while ((latency_us > 0) && (bucket < (ACC_LIBGPIOD_LATENCY_BUCKETS - 1)))
+	{
+		latency_us >>= 1;
+		bucket++;
+	}
+
+	histogram[bucket]++;
+}
+
+/**
+ * @brief Count a completed wait and, if histogram is not NULL, its latency
+ */
+static void count_wait(uint32_t *counter, uint32_t *histogram, uint64_t latency_ns)
+{
+	pthread_mutex_lock(&wait_stats_mutex);
+
+	(*counter)++;
+
+	if (histogram != NULL)
+	{
+		record_latency(histogram, latency_ns);
+	}
+
+	pthread_mutex_unlock(&wait_stats_mutex);
+}
+
 static bool gpio_open(int pin, gpio_direction_t direction)
 {
 	gpios[pin].line = gpiod_chip_get_line(chip, pin);
@@ -66,6 +216,11 @@ bool acc_libgpiod_init(const gpio_config_t *pin_config)
 		gpios[pin].direction = GPIO_DIR_UNKNOWN;
 	}
 
+	const char *busy_poll = getenv(BUSY_POLL_ENV_VARIABLE);
+	const char *use_mmap  = getenv(MMAP_ENV_VARIABLE);
+
+	acc_libgpiod_set_busy_poll(busy_poll != NULL ? (uint32_t)strtoul(busy_poll, NULL, 10) : 0, use_mmap != NULL && atoi(use_mmap) != 0);
+
 	chip = gpiod_chip_open_by_name(RPI_GPIO_CHIPNAME);
 	if (chip == NULL)
 	{
@@ -102,6 +257,8 @@ void acc_libgpiod_deinit(void)
 		gpiod_chip_close(chip);
 		chip = NULL;
 	}
+
+	gpiomem_close();
 }
 
 bool acc_libgpiod_set(int pin, gpio_pin_value_t value)
@@ -138,15 +295,69 @@ bool acc_libgpiod_wait_for_interrupt(int pin, uint32_t timeout_ms)
 	int pin_value = gpiod_line_get_value(gpios[pin].line);
 	assert(pin_value >= 0);
 
+	if (pin_value == PIN_HIGH)
+	{
+		count_wait(&wait_stats.already_high, NULL, 0);
+		return true;
+	}
+
+	if (busy_poll_window_us > 0)
+	{
+		// The pin was low, so a queued edge is from an interrupt that was already handled,
+		// one that busy-polling saw before the kernel queued its event. An interrupt that
+		// came after the read above may also be drained, so the pin is read again after.
+		(void)drain_events(pin);
+
+		pin_value = gpiod_line_get_value(gpios[pin].line);
+		assert(pin_value >= 0);
+
+		if (pin_value == PIN_HIGH)
+		{
+			count_wait(&wait_stats.already_high, NULL, 0);
+			return true;
+		}
+
+		uint64_t window_ns     = (uint64_t)busy_poll_window_us * 1000;
+		uint64_t poll_start_ns = get_time_ns();
+
+		if (window_ns > (uint64_t)timeout_ms * 1000000)
+		{
+			window_ns = (uint64_t)timeout_ms * 1000000;
+		}
+
+		while (true)
+		{
+			pin_value       = gpio_read_value(pin);
+			uint64_t now_ns = get_time_ns();
+
+			if (pin_value == PIN_HIGH)
+			{
+				// The edge event is read so that it does not wake a later wait, and its
+				// timestamp gives the latency from the edge
+				uint64_t edge_ns   = drain_events(pin);
+				bool     has_edge = (edge_ns != 0) && (now_ns >= edge_ns);
+
+				count_wait(&wait_stats.busy_poll_wakeups, has_edge ? wait_stats.busy_poll_latency : NULL, now_ns - edge_ns);
+				return true;
+			}
+
+			if ((now_ns - poll_start_ns) >= window_ns)
+			{
+				break;
+			}
+		}
+	}
+
 	unsigned int elapsed_ms = get_elapsed_ms(&start);
 
 	while ((pin_value != PIN_HIGH) && (elapsed_ms < timeout_ms))
 	{
-		timeout_ms           -= elapsed_ms;
-		time_t          secs  = timeout_ms / 1000;
-		long            ns    = (timeout_ms % 1000) * 1000000;
-		struct timespec ts    = {secs, ns};
-		int             res   = gpiod_line_event_wait(gpios[pin].line, &ts);
+		// elapsed_ms is counted from the start of the wait, not from the last event
+		unsigned int    remaining_ms = timeout_ms - elapsed_ms;
+		time_t          secs         = remaining_ms / 1000;
+		long            ns           = (remaining_ms % 1000) * 1000000;
+		struct timespec ts           = {secs, ns};
+		int             res          = gpiod_line_event_wait(gpios[pin].line, &ts);
 		if (res < 0)
 		{
 			perror("gpiod_line_event_wait failed");
@@ -183,9 +394,93 @@ bool acc_libgpiod_wait_for_interrupt(int pin, uint32_t timeout_ms)
 				perror("gpiod_line_get_value failed");
 				assert(true);
 			}
+			else if (pin_value == PIN_HIGH)
+			{
+				// The event timestamp is CLOCK_MONOTONIC since Linux 5.7
+				uint64_t event_ns = timespec_to_ns(&event.ts);
+				uint64_t now_ns   = get_time_ns();
+
+				count_wait(&wait_stats.event_wakeups, now_ns >= event_ns ? wait_stats.event_latency : NULL, now_ns - event_ns);
+			}
 		}
 
 		elapsed_ms = get_elapsed_ms(&start);
 	}
+
+	if (pin_value != PIN_HIGH)
+	{
+		count_wait(&wait_stats.timeouts, NULL, 0);
+	}
+
 	return pin_value == PIN_HIGH;
 }
+
+void acc_libgpiod_set_busy_poll(uint32_t window_us, bool use_mmap)
+{
+	busy_poll_window_us = window_us;
+
+	if (use_mmap)
+	{
+		if (!gpiomem_open())
+		{
+			fprintf(stderr, "Memory-mapped GPIO not available, using gpiod to read pin values\n");
+		}
+	}
+	else
+	{
+		gpiomem_close();
+	}
+}
+
+void acc_libgpiod_get_wait_stats(acc_libgpiod_wait_stats_t *stats)
+{
+	pthread_mutex_lock(&wait_stats_mutex);
+	*stats = wait_stats;
+	pthread_mutex_unlock(&wait_stats_mutex);
+}
+
+void acc_libgpiod_reset_wait_stats(void)
+{
+	pthread_mutex_lock(&wait_stats_mutex);
+	memset(&wait_stats, 0, sizeof(wait_stats));
+	pthread_mutex_unlock(&wait_stats_mutex);
+}
+
+void acc_libgpiod_print_wait_stats(void)
+{
+	acc_libgpiod_wait_stats_t stats;
+
+	acc_libgpiod_get_wait_stats(&stats);
+
+	printf("Interrupt waits: %u already high, %u busy-poll, %u event, %u timeouts\n",
+	       (unsigned int)stats.already_high,
+	       (unsigned int)stats.busy_poll_wakeups,
+	       (unsigned int)stats.event_wakeups,
+	       (unsigned int)stats.timeouts);
+	printf("%12s %10s %10s\n", "latency [us]", "busy-poll", "event");
+
+	for (int bucket = 0; bucket < ACC_LIBGPIOD_LATENCY_BUCKETS; bucket++)
+	{
+		if ((stats.busy_poll_latency[bucket] == 0) && (stats.event_latency[bucket] == 0))
+		{
+			continue;
+		}
+
+		char range[16];
+
+		if (bucket == 0)
+		{
+			snprintf(range, sizeof(range), "< 1");
+		}
+		else if (bucket == (ACC_LIBGPIOD_LATENCY_BUCKETS - 1))
+		{
+			snprintf(range, sizeof(range), ">= %u", 1U << (bucket - 1));
+		}
+		else
+		{
+			snprintf(range, sizeof(range), "< %u", 1U << bucket);
+		}
+
+		printf("%12s %10u %10u\n", range, (unsigned int)stats.busy_poll_latency[bucket], (unsigned int)stats.event_latency[bucket]);
+	}
+}
@@ -0,0 +1,222 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "gpiod.h"
+
+#include "acc_libgpiod_fake.h"
+
+/**
+ * @brief Number of fake GPIO lines
+ */
+#define FAKE_LINE_COUNT 64
+
+/**
+ * @brief Number of edge events the kernel buffers for a line before dropping the oldest
+ */
+#define FAKE_EVENT_QUEUE_LENGTH 16
+
+struct gpiod_chip
+{
+	const char *name;
+};
+
+struct gpiod_line
+{
+	bool     requested;
+	int      value;
+	uint64_t first_edge_ns;
+	uint64_t period_ns;
+	uint64_t high_ns;
+	uint64_t next_edge;
+};
+
+static struct gpiod_chip fake_chip;
+static struct gpiod_line fake_lines[FAKE_LINE_COUNT];
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+}
+
+static struct timespec ns_to_timespec(uint64_t ns)
+{
+	struct timespec ts = {(time_t)(ns / 1000000000), (long)(ns % 1000000000)};
+
+	return ts;
+}
+
+static void sleep_until_ns(uint64_t ns)
+{
+	struct timespec ts = ns_to_timespec(ns);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+	{
+	}
+}
+
+/**
+ * @brief Number of rising edges that have occurred on a line up to a point in time
+ */
+static uint64_t edges_until(const struct gpiod_line *line, uint64_t ns)
+{
+	if ((line->period_ns == 0) || (ns < line->first_edge_ns))
+	{
+		return 0;
+	}
+
+	return ((ns - line->first_edge_ns) / line->period_ns) + 1;
+}
+
+void acc_libgpiod_fake_set_interrupt(unsigned int pin, uint32_t period_us, uint32_t high_us)
+{
+	struct gpiod_line *line = &fake_lines[pin];
+
+	line->period_ns     = (uint64_t)period_us * 1000;
+	line->high_ns       = (uint64_t)high_us * 1000;
+	line->first_edge_ns = get_time_ns() + line->period_ns;
+	line->next_edge     = 0;
+}
+
+uint32_t acc_libgpiod_fake_get_queued_events(unsigned int pin)
+{
+	const struct gpiod_line *line  = &fake_lines[pin];
+	uint64_t                 edges = edges_until(line, get_time_ns()) - line->next_edge;
+
+	return edges > FAKE_EVENT_QUEUE_LENGTH ? FAKE_EVENT_QUEUE_LENGTH : (uint32_t)edges;
+}
+
+
+int acc_libgpiod_fake_get_output(unsigned int pin)
+{
+	return fake_lines[pin].value;
+}
+
+struct gpiod_chip *gpiod_chip_open_by_name(const char *name)
+{
+	memset(fake_lines, 0, sizeof(fake_lines));
+	fake_chip.name = name;
+
+	return &fake_chip;
+}
+
+void gpiod_chip_close(struct gpiod_chip *chip)
+{
+	chip->name = NULL;
+}
+
+struct gpiod_line *gpiod_chip_get_line(struct gpiod_chip *chip, unsigned int offset)
+{
+	(void)chip;
+
+	return offset < FAKE_LINE_COUNT ? &fake_lines[offset] : NULL;
+}
+
+int gpiod_line_request_output(struct gpiod_line *line, const char *consumer, int default_val)
+{
+	(void)consumer;
+
+	line->requested = true;
+	line->value     = default_val;
+
+	return 0;
+}
+
+int gpiod_line_request_rising_edge_events(struct gpiod_line *line, const char *consumer)
+{
+	(void)consumer;
+
+	line->requested = true;
+
+	return 0;
+}
+
+void gpiod_line_release(struct gpiod_line *line)
+{
+	line->requested = false;
+	line->period_ns = 0;
+}
+
+int gpiod_line_set_value(struct gpiod_line *line, int value)
+{
+	line->value = value;
+
+	return 0;
+}
+
+int gpiod_line_get_value(struct gpiod_line *line)
+{
+	if (line->period_ns == 0)
+	{
+		return line->value;
+	}
+
+	uint64_t now_ns = get_time_ns();
+
+	if (now_ns < line->first_edge_ns)
+	{
+		return 0;
+	}
+
+	return ((now_ns - line->first_edge_ns) % line->period_ns) < line->high_ns ? 1 : 0;
+}
+
+int gpiod_line_event_wait(struct gpiod_line *line, const struct timespec *timeout)
+{
+	uint64_t now_ns      = get_time_ns();
+	uint64_t deadline_ns = now_ns + ((uint64_t)timeout->tv_sec * 1000000000) + (uint64_t)timeout->tv_nsec;
+
+	if (edges_until(line, now_ns) > line->next_edge)
+	{
+		return 1;
+	}
+
+	if (line->period_ns != 0)
+	{
+		uint64_t edge_ns = line->first_edge_ns + (line->next_edge * line->period_ns);
+
+		if (edge_ns <= deadline_ns)
+		{
+			sleep_until_ns(edge_ns);
+			return 1;
+		}
+	}
+
+	sleep_until_ns(deadline_ns);
+
+	return 0;
+}
+
+int gpiod_line_event_read(struct gpiod_line *line, struct gpiod_line_event *event)
+{
+	uint64_t edges = edges_until(line, get_time_ns());
+
+	if (edges <= line->next_edge)
+	{
+		errno = EAGAIN;
+		return -1;
+	}
+
+	if ((edges - line->next_edge) > FAKE_EVENT_QUEUE_LENGTH)
+	{
+		line->next_edge = edges - FAKE_EVENT_QUEUE_LENGTH;
+	}
+
+	event->ts         = ns_to_timespec(line->first_edge_ns + (line->next_edge * line->period_ns));
+	event->event_type = GPIOD_LINE_EVENT_RISING_EDGE;
+
+	line->next_edge++;
+
+	return 0;
+}
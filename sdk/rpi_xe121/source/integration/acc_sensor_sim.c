@@ -0,0 +1,202 @@
+// Copyright (c) Acconeer AB, 2024
+// All rights reserved
+// This file is subject to the terms and conditions defined in the file
+// 'LICENSES/license_acconeer.txt', (BSD 3-Clause License) which is part
+// of this source code package.
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "acc_integration.h"
+#include "acc_sensor_sim.h"
+
+/**
+ * @brief Estimated time per hwaas and point for each profile
+ *
+ * These are rough estimates, use acc_sensor_sim_config_t.sweep_duration_us
+ * with a value measured on hardware for accurate timing.
+ */
+static const uint32_t sample_time_ns[ACC_CONFIG_PROFILE_5 + 1] = {0, 400, 480, 560, 640, 720};
+
+#define POINT_OVERHEAD_NS (1000U)   /**< @brief Estimated overhead per point */
+#define SWEEP_OVERHEAD_NS (10000U)  /**< @brief Estimated overhead per sweep */
+#define FRAME_OVERHEAD_NS (200000U) /**< @brief Estimated overhead per frame, including wake-up from idle */
+
+struct acc_sensor_sim
+{
+	uint64_t               duration_ns;
+	uint64_t               frame_period_ns;
+	uint64_t               next_tick_ns;
+	uint64_t               ready_ns;
+	bool                   measuring;
+	bool                   delayed;
+	acc_sensor_sim_stats_t stats;
+};
+
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec;
+}
+
+
+static void sleep_until_ns(uint64_t time_ns)
+{
+	struct timespec ts = {(time_t)(time_ns / 1000000000U), (long)(time_ns % 1000000000U)};
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+	{
+	}
+}
+
+
+acc_sensor_sim_t *acc_sensor_sim_create(const acc_sensor_sim_config_t *config)
+{
+	if ((config->profile < ACC_CONFIG_PROFILE_1) || (config->profile > ACC_CONFIG_PROFILE_5) || (config->num_points == 0U) ||
+	    (config->hwaas == 0U) || (config->sweeps_per_frame == 0U))
+	{
+		printf("Invalid sensor simulator config\n");
+		return NULL;
+	}
+
+	acc_sensor_sim_t *sim = acc_integration_mem_alloc(sizeof(*sim));
+
+	if (sim == NULL)
+	{
+		printf("Sensor simulator allocation failed\n");
+		return NULL;
+	}
+
+	memset(sim, 0, sizeof(*sim));
+
+	uint64_t sweep_ns = (uint64_t)config->sweep_duration_us * 1000U;
+
+	if (sweep_ns == 0U)
+	{
+		sweep_ns = SWEEP_OVERHEAD_NS + ((uint64_t)config->num_points * (POINT_OVERHEAD_NS + ((uint64_t)config->hwaas * sample_time_ns[config->profile])));
+	}
+
+	uint64_t sweep_period_ns = sweep_ns;
+
+	if (config->sweep_rate > 0.0f)
+	{
+		uint64_t rate_period_ns = (uint64_t)(1e9f / config->sweep_rate);
+
+		if (rate_period_ns > sweep_period_ns)
+		{
+			sweep_period_ns = rate_period_ns;
+		}
+	}
+
+	sim->duration_ns = FRAME_OVERHEAD_NS + ((uint64_t)(config->sweeps_per_frame - 1U) * sweep_period_ns) + sweep_ns;
+
+	if (config->frame_rate > 0.0f)
+	{
+		sim->frame_period_ns = (uint64_t)(1e9f / config->frame_rate);
+	}
+
+	return sim;
+}
+
+
+void acc_sensor_sim_destroy(acc_sensor_sim_t *sim)
+{
+	acc_integration_mem_free(sim);
+}
+
+
+uint32_t acc_sensor_sim_get_measurement_duration_us(const acc_sensor_sim_t *sim)
+{
+	return (uint32_t)(sim->duration_ns / 1000U);
+}
+
+
+bool acc_sensor_sim_measure(acc_sensor_sim_t *sim)
+{
+	if (sim->measuring)
+	{
+		return false;
+	}
+
+	uint64_t now_ns   = get_time_ns();
+	uint64_t start_ns = now_ns;
+
+	sim->delayed = false;
+
+	if (sim->frame_period_ns > 0U)
+	{
+		if (sim->next_tick_ns == 0U)
+		{
+			// The first measure starts the frame timer
+			sim->next_tick_ns = now_ns + sim->frame_period_ns;
+		}
+		else if (now_ns <= sim->next_tick_ns)
+		{
+			start_ns          = sim->next_tick_ns;
+			sim->next_tick_ns += sim->frame_period_ns;
+		}
+		else
+		{
+			// The tick passed before the sensor was ready for a new frame
+			uint64_t missed = ((now_ns - sim->next_tick_ns) / sim->frame_period_ns) + 1U;
+
+			sim->delayed            = true;
+			sim->stats.missed_ticks += (uint32_t)missed;
+			sim->next_tick_ns       += missed * sim->frame_period_ns;
+		}
+	}
+
+	sim->ready_ns  = start_ns + sim->duration_ns;
+	sim->measuring = true;
+
+	return true;
+}
+
+
+bool acc_sensor_sim_wait_for_interrupt(acc_sensor_sim_t *sim, uint32_t timeout_ms)
+{
+	uint64_t deadline_ns = get_time_ns() + ((uint64_t)timeout_ms * 1000000U);
+
+	if (!sim->measuring || (sim->ready_ns > deadline_ns))
+	{
+		sleep_until_ns(deadline_ns);
+		return false;
+	}
+
+	sleep_until_ns(sim->ready_ns);
+
+	return true;
+}
+
+
+bool acc_sensor_sim_read(acc_sensor_sim_t *sim, bool *frame_delayed)
+{
+	if (!sim->measuring || (get_time_ns() < sim->ready_ns))
+	{
+		return false;
+	}
+
+	sim->measuring = false;
+	*frame_delayed = sim->delayed;
+
+	sim->stats.frames++;
+	if (sim->delayed)
+	{
+		sim->stats.frames_delayed++;
+	}
+
+	return true;
+}
+
+
+void acc_sensor_sim_get_stats(const acc_sensor_sim_t *sim, acc_sensor_sim_stats_t *stats)
+{
+	*stats = sim->stats;
+}
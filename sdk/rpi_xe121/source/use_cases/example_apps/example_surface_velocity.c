@@ -23,6 +23,7 @@
 #include "acc_processing.h"
 #include "acc_rss_a121.h"
 #include "acc_sensor.h"
+#include "acc_surface_velocity_psd.h"
 #include "acc_version.h"
 
 /**
@@ -78,6 +79,60 @@
  */
 #define CONFIG_HWAAS (16U)
 
+/**
+ * [Default app config - can be adapted to reflect the setup]
+ *
+ * Number of consecutive frames the selected distance must stay the same before
+ * the PSD is only calculated for the selected distance and its neighbours.
+ *
+ * Set to 0 to always calculate the PSD for all distances.
+ */
+#define CONFIG_DISTANCE_LOCK_FRAMES (50U)
+
+/**
+ * [Default app config - can be adapted to reflect the setup]
+ *
+ * Number of neighbouring distances on each side of the selected distance that
+ * are tracked while the distance is locked.
+ */
+#define CONFIG_DISTANCE_LOCK_HALF_WIDTH (1U)
+
+/**
+ * [Default app config - can be adapted to reflect the setup]
+ *
+ * Number of consecutive frames a neighbouring distance must have more energy
+ * than the locked distance before the PSD is calculated for all distances again.
+ *
+ * Keeps the lock when the peak jitters between two neighbouring distances.
+ */
+#define CONFIG_DISTANCE_UNLOCK_FRAMES (10U)
+
+/**
+ * [Default app config - can be adapted to reflect the setup]
+ *
+ * Number of locked frames after which a PSD calculation for all distances is
+ * made to verify the selected distance.
+ */
+#define CONFIG_DISTANCE_RESCAN_INTERVAL (500U)
+
+/**
+ * [Default app config - can be adapted to reflect the setup]
+ *
+ * A PSD calculation for all distances is made if the peak energy at the locked
+ * distance drops below this fraction of the peak energy when it was locked.
+ */
+#define CONFIG_DISTANCE_RESCAN_ENERGY_RATIO (0.5f)
+
+/**
+ * [Default app config - can be adapted to reflect the setup]
+ *
+ * Number of frames the selected distance is held after a PSD calculation for all
+ * distances is resumed, while the low-pass filtered PSDs of the distances that
+ * were not tracked settle. With the default PSD coefficient, 0.75^12 of the
+ * outdated PSD remains after 12 frames.
+ */
+#define CONFIG_DISTANCE_RESCAN_SETTLE_FRAMES (12U)
+
 #define SENSOR_ID         (1U)
 #define SENSOR_TIMEOUT_MS (1000U)
 
@@ -98,6 +153,12 @@ typedef struct
 	float         velocity_lp_coeff;
 	float         max_peak_interval_s;
 	float         sensor_angle;
+	uint16_t      distance_lock_frames;
+	uint16_t      distance_lock_half_width;
+	uint16_t      distance_unlock_frames;
+	uint16_t      distance_rescan_interval;
+	float         distance_rescan_energy_ratio;
+	uint16_t      distance_rescan_settle_frames;
 	acc_config_t *sensor_config;
 } acc_surface_velocity_config_t;
 
@@ -123,22 +184,15 @@ typedef struct
 	uint16_t num_distances;
 	uint16_t sweeps_per_frame;
 	uint16_t segment_length;
-	uint16_t padded_segment_length;
-	uint16_t padded_segment_length_shift;
 	uint16_t middle_index;
 
-	int32_t       *double_buffer_filter_buffer;
-	float complex *frame;
-	float complex *time_series;
-	float complex *time_series_buffer;
-	float complex *fft_out;
-	float         *psds;
-	float         *lp_psds;
-	float         *psd;
-	float         *window;
-	uint32_t      *threshold_check;
-	float         *bin_rad_vs;
-	float         *bin_vertical_vs;
+	acc_surface_velocity_psd_t *distance_psd;
+
+	int32_t     *double_buffer_filter_buffer;
+	const float *psd;
+	uint32_t    *threshold_check;
+	float       *bin_rad_vs;
+	float       *bin_vertical_vs;
 
 	uint16_t update_index;
 	uint16_t wait_n;
@@ -191,8 +245,6 @@ static bool get_velocity_estimate(acc_surface_velocity_handle_t *handle);
 
 static float get_angle_correction(float surface_distance, float distance);
 
-static uint16_t calc_power_spectral_density(acc_surface_velocity_handle_t *handle);
-
 static float get_perceived_wavelength(void);
 
 static float calc_dynamic_smoothing_factor(float static_sf, uint32_t update_count);
@@ -377,26 +429,13 @@ static void cleanup(acc_surface_velocity_handle_t *handle, acc_surface_velocity_
 		acc_sensor_destroy(handle->sensor);
 	}
 
+	acc_surface_velocity_psd_destroy(handle->distance_psd);
+
 	if (handle->double_buffer_filter_buffer != NULL)
 	{
 		acc_integration_mem_free(handle->double_buffer_filter_buffer);
 	}
 
-	if (handle->frame != NULL)
-	{
-		acc_integration_mem_free(handle->frame);
-	}
-
-	if (handle->time_series != NULL)
-	{
-		acc_integration_mem_free(handle->time_series);
-	}
-
-	if (handle->time_series_buffer != NULL)
-	{
-		acc_integration_mem_free(handle->time_series_buffer);
-	}
-
 	if (handle->bin_rad_vs != NULL)
 	{
 		acc_integration_mem_free(handle->bin_rad_vs);
@@ -407,31 +446,6 @@ static void cleanup(acc_surface_velocity_handle_t *handle, acc_surface_velocity_
 		acc_integration_mem_free(handle->bin_vertical_vs);
 	}
 
-	if (handle->lp_psds != NULL)
-	{
-		acc_integration_mem_free(handle->lp_psds);
-	}
-
-	if (handle->fft_out != NULL)
-	{
-		acc_integration_mem_free(handle->fft_out);
-	}
-
-	if (handle->psds != NULL)
-	{
-		acc_integration_mem_free(handle->psds);
-	}
-
-	if (handle->psd != NULL)
-	{
-		acc_integration_mem_free(handle->psd);
-	}
-
-	if (handle->window != NULL)
-	{
-		acc_integration_mem_free(handle->window);
-	}
-
 	if (handle->threshold_check != NULL)
 	{
 		acc_integration_mem_free(handle->threshold_check);
@@ -484,6 +498,13 @@ static void set_config(acc_surface_velocity_config_t *config)
 	config->threshold_sensitivity = CONFIG_THRESHOLD_SENSITIVITY;
 	config->velocity_lp_coeff     = CONFIG_VELOCITY_LP_COEFF;
 
+	config->distance_lock_frames          = CONFIG_DISTANCE_LOCK_FRAMES;
+	config->distance_lock_half_width      = CONFIG_DISTANCE_LOCK_HALF_WIDTH;
+	config->distance_unlock_frames        = CONFIG_DISTANCE_UNLOCK_FRAMES;
+	config->distance_rescan_interval      = CONFIG_DISTANCE_RESCAN_INTERVAL;
+	config->distance_rescan_energy_ratio  = CONFIG_DISTANCE_RESCAN_ENERGY_RATIO;
+	config->distance_rescan_settle_frames = CONFIG_DISTANCE_RESCAN_SETTLE_FRAMES;
+
 	acc_config_hwaas_set(config->sensor_config, CONFIG_HWAAS);
 	acc_config_sweep_rate_set(config->sensor_config, CONFIG_SWEEP_RATE);
 
@@ -677,36 +698,35 @@ static bool init_handle(acc_surface_velocity_handle_t *handle, acc_surface_veloc
 		}
 	}
 
-	handle->segment_length = handle->surface_velocity_config.time_series_length / 4U;
+	acc_surface_velocity_psd_config_t psd_config;
 
-	if (handle->segment_length % 2U != 0U)
-	{
-		handle->segment_length += 1U;
-	}
+	psd_config.num_distances         = handle->num_distances;
+	psd_config.sweeps_per_frame      = handle->sweeps_per_frame;
+	psd_config.time_series_length    = handle->surface_velocity_config.time_series_length;
+	psd_config.sweep_rate            = handle->sweep_rate;
+	psd_config.psd_lp_coeff          = config->psd_lp_coeff;
+	psd_config.slow_zone_half_length = config->slow_zone_half_length;
+	psd_config.lock_frames           = config->distance_lock_frames;
+	psd_config.lock_half_width       = config->distance_lock_half_width;
+	psd_config.unlock_frames         = config->distance_unlock_frames;
+	psd_config.rescan_interval       = config->distance_rescan_interval;
+	psd_config.rescan_energy_ratio   = config->distance_rescan_energy_ratio;
+	psd_config.settle_frames         = config->distance_rescan_settle_frames;
 
-	handle->padded_segment_length_shift = 0U;
-	handle->padded_segment_length       = 1U << handle->padded_segment_length_shift;
-
-	while (handle->padded_segment_length < handle->segment_length)
+	handle->distance_psd = acc_surface_velocity_psd_create(&psd_config);
+	if (handle->distance_psd == NULL)
 	{
-		handle->padded_segment_length_shift++;
-		handle->padded_segment_length = 1U << handle->padded_segment_length_shift;
+		printf("Failed to create the distance PSD\n");
+		return false;
 	}
 
-	handle->middle_index = rintf((float)handle->segment_length / 2.0f);
+	handle->segment_length = acc_surface_velocity_psd_get_segment_length(handle->distance_psd);
+	handle->middle_index   = acc_surface_velocity_psd_get_middle_index(handle->distance_psd);
+	handle->psd            = acc_surface_velocity_psd_get_psd(handle->distance_psd);
 
 	handle->double_buffer_filter_buffer = acc_integration_mem_alloc((handle->sweeps_per_frame - 2U) * sizeof(*handle->double_buffer_filter_buffer));
-	handle->time_series =
-	    acc_integration_mem_alloc(handle->surface_velocity_config.time_series_length * handle->num_distances * sizeof(*handle->time_series));
-	handle->time_series_buffer = acc_integration_mem_alloc(handle->segment_length * sizeof(*handle->time_series_buffer));
-	handle->frame              = acc_integration_mem_alloc(handle->num_distances * handle->sweeps_per_frame * sizeof(*handle->frame));
-	handle->bin_rad_vs         = acc_integration_mem_alloc(handle->segment_length * sizeof(*handle->bin_rad_vs));
-	handle->bin_vertical_vs    = acc_integration_mem_alloc(handle->segment_length * sizeof(*handle->bin_vertical_vs));
-	handle->lp_psds            = acc_integration_mem_alloc(handle->segment_length * handle->num_distances * sizeof(*handle->lp_psds));
-	handle->fft_out            = acc_integration_mem_alloc(handle->padded_segment_length * sizeof(*handle->fft_out));
-	handle->psds               = acc_integration_mem_alloc(handle->segment_length * handle->num_distances * sizeof(*handle->psds));
-	handle->psd                = acc_integration_mem_alloc(handle->segment_length * sizeof(*handle->psd));
-	handle->window             = acc_integration_mem_alloc(handle->segment_length * sizeof(*handle->window));
+	handle->bin_rad_vs                  = acc_integration_mem_alloc(handle->segment_length * sizeof(*handle->bin_rad_vs));
+	handle->bin_vertical_vs             = acc_integration_mem_alloc(handle->segment_length * sizeof(*handle->bin_vertical_vs));
 
 	size_t threshold_check_length = acc_alg_basic_utils_calculate_length_of_bitarray_uint32(handle->segment_length);
 
@@ -721,10 +741,9 @@ static bool init_handle(acc_surface_velocity_handle_t *handle, acc_surface_veloc
 	handle->peak_indexes        = acc_integration_mem_alloc(handle->peak_indexes_length * sizeof(*handle->peak_indexes));
 	handle->num_peaks           = 0U;
 
-	bool alloc_success = handle->double_buffer_filter_buffer && handle->time_series != NULL && handle->time_series_buffer != NULL &&
-	                     handle->frame != NULL && handle->bin_rad_vs != NULL && handle->bin_vertical_vs != NULL && handle->lp_psds != NULL &&
-	                     handle->fft_out != NULL && handle->psds != NULL && handle->window != NULL && handle->threshold_check != NULL &&
-	                     handle->merged_velocities != NULL && handle->merged_energies != NULL && handle->peak_indexes != NULL;
+	bool alloc_success = handle->double_buffer_filter_buffer && handle->bin_rad_vs != NULL && handle->bin_vertical_vs != NULL &&
+	                     handle->threshold_check != NULL && handle->merged_velocities != NULL && handle->merged_energies != NULL &&
+	                     handle->peak_indexes != NULL;
 
 	if (!alloc_success)
 	{
@@ -732,14 +751,9 @@ static bool init_handle(acc_surface_velocity_handle_t *handle, acc_surface_veloc
 		return false;
 	}
 
-	memset(handle->time_series, 0, handle->surface_velocity_config.time_series_length * handle->num_distances * sizeof(*handle->time_series));
-	memset(handle->lp_psds, 0, handle->segment_length * handle->num_distances * sizeof(*handle->lp_psds));
-	memset(handle->psds, 0, handle->segment_length * handle->num_distances * sizeof(*handle->psds));
 	memset(handle->merged_velocities, 0, handle->merged_peaks_length * sizeof(*handle->merged_velocities));
 	memset(handle->merged_energies, 0, handle->merged_peaks_length * sizeof(*handle->merged_energies));
 
-	acc_algorithm_hann(handle->segment_length, handle->window);
-
 	acc_algorithm_fftfreq(handle->segment_length, 1.0f / handle->sweep_rate, handle->bin_rad_vs);
 	acc_algorithm_fftshift(handle->bin_rad_vs, handle->segment_length);
 
@@ -781,72 +795,6 @@ static bool measure(acc_surface_velocity_handle_t *handle)
 	return true;
 }
 
-/**
- * @brief Calculate PSD (power spectral density)
- *
- * @param handle Surface velocity handle
- * @return Distance index
- */
-static uint16_t calc_power_spectral_density(acc_surface_velocity_handle_t *handle)
-{
-	for (uint16_t i = 0U; i < handle->sweeps_per_frame; i++)
-	{
-		for (uint16_t j = 0U; j < handle->num_distances; j++)
-		{
-			uint16_t index = i * handle->num_distances + j;
-
-			handle->frame[j] = ((float)handle->proc_result.frame[index].real) + ((float)handle->proc_result.frame[index].imag) * I;
-		}
-
-		acc_algorithm_roll_and_push_matrix_f32_complex(
-		    handle->time_series, handle->surface_velocity_config.time_series_length, handle->num_distances, handle->frame, false);
-	}
-
-	acc_algorithm_welch_matrix(handle->time_series,
-	                           handle->surface_velocity_config.time_series_length,
-	                           handle->num_distances,
-	                           handle->segment_length,
-	                           handle->time_series_buffer,
-	                           handle->fft_out,
-	                           handle->psds,
-	                           handle->window,
-	                           handle->padded_segment_length_shift,
-	                           handle->sweep_rate);
-
-	acc_algorithm_fftshift_matrix(handle->psds, handle->segment_length, handle->num_distances);
-
-	if (handle->update_index * handle->sweeps_per_frame < handle->surface_velocity_config.time_series_length)
-	{
-		for (uint16_t i = 0U; i < handle->segment_length; i++)
-		{
-			for (uint16_t j = 0U; j < handle->num_distances; j++)
-			{
-				handle->lp_psds[i * handle->num_distances + j] = handle->psds[i * handle->num_distances + j];
-			}
-		}
-	}
-
-	for (uint16_t i = 0U; i < handle->segment_length; i++)
-	{
-		for (uint16_t j = 0U; j < handle->num_distances; j++)
-		{
-			handle->lp_psds[i * handle->num_distances + j] =
-			    handle->lp_psds[i * handle->num_distances + j] * handle->surface_velocity_config.psd_lp_coeff +
-			    handle->psds[i * handle->num_distances + j] * (1 - handle->surface_velocity_config.psd_lp_coeff);
-		}
-	}
-
-	uint16_t index = acc_algorithm_get_distance_idx(
-	    handle->lp_psds, handle->num_distances, handle->segment_length, handle->middle_index, handle->surface_velocity_config.slow_zone_half_length);
-
-	for (uint16_t i = 0U; i < handle->segment_length; i++)
-	{
-		handle->psd[i] = handle->lp_psds[i * handle->num_distances + index];
-	}
-
-	return index;
-}
-
 static bool process(acc_surface_velocity_handle_t *handle, acc_surface_velocity_result_t *result)
 {
 	bool status = false;
@@ -854,7 +802,7 @@ static bool process(acc_surface_velocity_handle_t *handle, acc_surface_velocity_
 	acc_algorithm_double_buffering_frame_filter(
 	    handle->proc_result.frame, handle->sweeps_per_frame, handle->num_distances, handle->double_buffer_filter_buffer);
 
-	uint16_t distance_index   = calc_power_spectral_density(handle);
+	uint16_t distance_index   = acc_surface_velocity_psd_update(handle->distance_psd, handle->proc_result.frame);
 	float    distance         = acc_algorithm_get_distance_m(handle->step_length, handle->start_point, handle->base_step_length_m, distance_index);
 	float    angle_correction = get_angle_correction(handle->surface_velocity_config.surface_distance, distance);
 
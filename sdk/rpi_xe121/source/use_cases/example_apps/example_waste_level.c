@@ -20,6 +20,7 @@
 #include "acc_integration.h"
 #include "acc_integration_log.h"
 #include "acc_processing.h"
+#include "acc_sliding_median.h"
 #include "example_waste_level.h"
 
 #define MODULE "example_waste_level"
@@ -29,17 +30,14 @@ struct waste_level_handle
 	/** State. Affects output between frames */
 	struct
 	{
-		/** Ring buffer for distance estimations. Has capacity processing_config.median_filter_len */
-		float *distance_history_points;
-
-		/** How many valid elements there are in distance_history_points (starting at 0) */
-		uint16_t distance_history_len;
-
-		/** Write index for the distance_history_points */
-		uint16_t distance_history_write_idx;
+		/** Sliding median of the distance estimations, NaN when no level was found. Has capacity processing_config.median_filter_len */
+		acc_sliding_median_t *distance_history;
 	} state;
 
-	/** Float scratch. Has length == max(sweeps_per_frame, median_filter_len) */
+	/** Distance in meters of each point in a sweep. Has length == sweep data length */
+	float *point_distances_m;
+
+	/** Float scratch. Has length == sweeps_per_frame */
 	float *scratch;
 };
 
@@ -105,35 +103,22 @@ static float subsweep_approx_start_m(const acc_config_t *sensor_config, uint8_t
 static float subsweep_approx_end_m(const acc_config_t *sensor_config, uint8_t subsweep_idx);
 
 /**
- * @brief Calculate a point's corresponding distance in meters
+ * @brief Get the number of points in a sweep
  *
  * @param[in] sensor_config The sensor config
- * @param[in] metadata The processing metadata
- * @param[in] point_idx The index in a sweep of the point to get distance for
- * @return The distance of point at point_idx
+ * @return The total number of points of all subsweeps
  */
-static float point_in_sweep_to_distance_m(const acc_config_t *sensor_config, const acc_processing_metadata_t *metadata, uint16_t point_idx);
+static uint16_t get_sweep_data_length(const acc_config_t *sensor_config);
 
 /**
- * @brief Write next value into a ring buffer
+ * @brief Calculate the corresponding distance in meters of every point in a sweep
  *
- * @param[in, out] buffer The circular buffer
- * @param[in] capacity The allocated number of elements of buffer
- * @param[in, out] length The buffer length (number of valid elements)
- * @param[in, out] write_idx The next index in buffer to write to
- * @param[in] elem The new element to write
- */
-static void write_to_ring_buffer(float *buffer, uint16_t capacity, uint16_t *length, uint16_t *write_idx, float elem);
-
-/**
- * @brief Copy non-NaN floats between buffers
+ * The subsweeps are laid out after each other in the sweep, in subsweep order.
  *
- * @param[in] in Source buffer of floats which can contain NaNs
- * @param[out] out The destination buffer. Will not contain NaNs
- * @param[in] length The allocated size of in & out
- * @return The number of elements written to out
+ * @param[in] sensor_config The sensor config
+ * @param[out] point_distances_m The distance of each point, sweep data length long
  */
-static uint16_t copy_non_nan_floats(const float *in, float *out, uint16_t length);
+static void fill_point_distances_m(const acc_config_t *sensor_config, float *point_distances_m);
 
 /**
  * @brief Populate a waste level result with its human-readable entries
@@ -218,13 +203,14 @@ waste_level_handle_t *waste_level_handle_create(const waste_level_app_config_t *
 {
 	uint16_t              sweeps_per_frame  = 0U;
 	uint16_t              median_filter_len = 0U;
+	uint16_t              sweep_data_length = 0U;
 	waste_level_handle_t *handle            = NULL;
 
 	bool status = validate_app_config(app_config);
 
 	if (status)
 	{
-		handle = acc_integration_mem_alloc(sizeof(*handle));
+		handle = acc_integration_mem_calloc(1U, sizeof(*handle));
 		status = handle != NULL;
 	}
 
@@ -232,23 +218,33 @@ waste_level_handle_t *waste_level_handle_create(const waste_level_app_config_t *
 	{
 		sweeps_per_frame  = acc_config_sweeps_per_frame_get(app_config->sensor_config);
 		median_filter_len = app_config->processing_config.median_filter_len;
+		sweep_data_length = get_sweep_data_length(app_config->sensor_config);
+	}
 
-		handle->state.distance_history_len       = 0U;
-		handle->state.distance_history_write_idx = 0U;
+	if (status)
+	{
+		handle->scratch = (float *)acc_integration_mem_alloc(sweeps_per_frame * sizeof(*handle->scratch));
+		status          = handle->scratch != NULL;
 	}
 
 	if (status)
 	{
-		uint16_t num_elem = sweeps_per_frame > median_filter_len ? sweeps_per_frame : median_filter_len;
-		handle->scratch   = (float *)acc_integration_mem_alloc(num_elem * sizeof(*handle->scratch));
-		status            = handle->scratch != NULL;
+		handle->point_distances_m = (float *)acc_integration_mem_alloc(sweep_data_length * sizeof(*handle->point_distances_m));
+		status                    = handle->point_distances_m != NULL;
 	}
 
 	if (status)
 	{
-		handle->state.distance_history_points =
-		    (float *)acc_integration_mem_alloc(median_filter_len * sizeof(*handle->state.distance_history_points));
-		status = handle->state.distance_history_points != NULL;
+		fill_point_distances_m(app_config->sensor_config, handle->point_distances_m);
+
+		handle->state.distance_history = acc_sliding_median_create(median_filter_len);
+		status                         = handle->state.distance_history != NULL;
+	}
+
+	if (!status)
+	{
+		waste_level_handle_destroy(handle);
+		handle = NULL;
 	}
 
 	return handle;
@@ -258,9 +254,11 @@ void waste_level_handle_destroy(waste_level_handle_t *handle)
 {
 	if (handle != NULL)
 	{
-		if (handle->state.distance_history_points != NULL)
+		acc_sliding_median_destroy(handle->state.distance_history);
+
+		if (handle->point_distances_m != NULL)
 		{
-			acc_integration_mem_free(handle->state.distance_history_points);
+			acc_integration_mem_free(handle->point_distances_m);
 		}
 
 		if (handle->scratch != NULL)
@@ -283,7 +281,6 @@ void waste_level_process(waste_level_handle_t            *handle,
 		uint16_t sweep_length      = metadata->sweep_data_length;
 		uint16_t sweeps_per_frame  = acc_config_sweeps_per_frame_get(app_config->sensor_config);
 		uint16_t distance_seq_len  = app_config->processing_config.distance_sequence_len;
-		uint16_t median_filter_len = app_config->processing_config.median_filter_len;
 		float    threshold_squared = app_config->processing_config.threshold * app_config->processing_config.threshold;
 
 		uint16_t phase_vars_under_threshold = 0U;
@@ -327,21 +324,16 @@ void waste_level_process(waste_level_handle_t            *handle,
 			}
 		}
 
-		float new_distance = !point_of_waste_found ? NAN : point_in_sweep_to_distance_m(app_config->sensor_config, metadata, point_of_waste);
+		float new_distance = !point_of_waste_found ? NAN : handle->point_distances_m[point_of_waste];
 
-		write_to_ring_buffer(handle->state.distance_history_points,
-		                     median_filter_len,
-		                     &handle->state.distance_history_len,
-		                     &handle->state.distance_history_write_idx,
-		                     new_distance);
+		acc_sliding_median_push(handle->state.distance_history, new_distance);
 
-		// copy non-NaN distance history points as median sorts inplace
-		uint16_t num_normal = copy_non_nan_floats(handle->state.distance_history_points, handle->scratch, handle->state.distance_history_len);
-		if (num_normal > 0U)
+		float median_distance;
+
+		if (acc_sliding_median_get(handle->state.distance_history, &median_distance))
 		{
 			waste_level_result->level_found = true;
 
-			float median_distance = acc_algorithm_median_f32(handle->scratch, num_normal);
 			set_level_numbers(median_distance, &app_config->processing_config, waste_level_result);
 		}
 		else
@@ -542,55 +534,39 @@ static float subsweep_approx_end_m(const acc_config_t *sensor_config, uint8_t su
 	                                    acc_config_subsweep_num_points_get(sensor_config, subsweep_idx) - 1U);
 }
 
-static float point_in_sweep_to_distance_m(const acc_config_t *sensor_config, const acc_processing_metadata_t *metadata, uint16_t point_idx)
+static uint16_t get_sweep_data_length(const acc_config_t *sensor_config)
 {
-	uint8_t num_subsweeps = acc_config_num_subsweeps_get(sensor_config);
-	float   distance_m    = 0.0f;
+	uint8_t  num_subsweeps     = acc_config_num_subsweeps_get(sensor_config);
+	uint16_t sweep_data_length = 0U;
 
 	for (uint8_t subsweep_idx = 0U; subsweep_idx < num_subsweeps; subsweep_idx++)
 	{
-		uint16_t start = metadata->subsweep_data_offset[subsweep_idx];
-		uint16_t end   = start + metadata->subsweep_data_length[subsweep_idx];
-
-		if (point_idx >= start && point_idx < end)
-		{
-			distance_m = acc_algorithm_get_distance_m(acc_config_subsweep_step_length_get(sensor_config, subsweep_idx),
-			                                          acc_config_subsweep_start_point_get(sensor_config, subsweep_idx),
-			                                          acc_processing_points_to_meter(1),
-			                                          point_idx - start);
-			break;
-		}
+		sweep_data_length += acc_config_subsweep_num_points_get(sensor_config, subsweep_idx);
 	}
 
-	return distance_m;
+	return sweep_data_length;
 }
 
-static void write_to_ring_buffer(float *buffer, uint16_t capacity, uint16_t *length, uint16_t *write_idx, float elem)
+static void fill_point_distances_m(const acc_config_t *sensor_config, float *point_distances_m)
 {
-	buffer[*write_idx] = elem;
+	uint8_t  num_subsweeps = acc_config_num_subsweeps_get(sensor_config);
+	float    base_step_m   = acc_processing_points_to_meter(1);
+	uint16_t offset        = 0U;
 
-	*write_idx = (*write_idx + 1U) % capacity;
-
-	if (*length < capacity)
+	for (uint8_t subsweep_idx = 0U; subsweep_idx < num_subsweeps; subsweep_idx++)
 	{
-		*length = *length + 1U;
-	}
-}
-
-static uint16_t copy_non_nan_floats(const float *in, float *out, uint16_t length)
-{
-	uint16_t num_normal = 0U;
+		uint16_t num_points = acc_config_subsweep_num_points_get(sensor_config, subsweep_idx);
 
-	for (uint16_t i = 0U; i < length; i++)
-	{
-		if (fpclassify(in[i]) != FP_NAN)
+		for (uint16_t point_idx = 0U; point_idx < num_points; point_idx++)
 		{
-			out[num_normal] = in[i];
-			num_normal++;
+			point_distances_m[offset + point_idx] = acc_algorithm_get_distance_m(acc_config_subsweep_step_length_get(sensor_config, subsweep_idx),
+			                                                                     acc_config_subsweep_start_point_get(sensor_config, subsweep_idx),
+			                                                                     base_step_m,
+			                                                                     point_idx);
 		}
-	}
 
-	return num_normal;
+		offset += num_points;
+	}
 }
 
 static void set_level_numbers(float filtered_distance, const waste_level_processing_config_t *processing_config, waste_level_result_t *result)
@@ -11,8 +11,11 @@
 
 #include "acc_alg_basic_utils.h"
 #include "acc_algorithm.h"
+#include "acc_algorithm_shaped.h"
 #include "acc_detector_presence.h"
+#include "acc_distance_lock.h"
 #include "acc_integration.h"
+#include "acc_snapshot.h"
 #include "ref_app_breathing.h"
 
 #define B_STATIC_LENGTH (3U)
@@ -20,6 +23,22 @@
 #define B_ANGLE_LENGTH  (5U)
 #define A_ANGLE_LENGTH  (4U)
 
+#define STATIC_SECTIONS (1U)
+#define ANGLE_SECTIONS  (2U)
+
+// "BRTH", identifies a breathing state snapshot
+#define SNAPSHOT_MAGIC   (0x48545242U)
+#define SNAPSHOT_VERSION (1U)
+
+// Number of arrays in a snapshot, with the filter states of second-order sections
+#define SNAPSHOT_MAX_ARRAYS (10U)
+
+// Longest time series, its padded length must fit the FFT length
+#define MAX_TIME_SERIES_LENGTH (32768U)
+
+// Lowest correlation with the reference distance for a distance to contribute to the breathing spectrum
+#define MIN_COHERENCE (0.3f)
+
 struct ref_app_breathing_handle
 {
 	acc_detector_presence_handle_t *presence_handle;
@@ -29,6 +48,7 @@ struct ref_app_breathing_handle
 	int32_t  start_point;
 	uint16_t num_points_to_analyze_half_width;
 	uint16_t num_points_to_analyze;
+	uint16_t max_points_to_analyze;
 	uint16_t end_point;
 	float    frame_rate;
 	float    lowest_freq;
@@ -54,6 +74,18 @@ struct ref_app_breathing_handle
 	float b_angle[B_ANGLE_LENGTH];
 	float a_angle[A_ANGLE_LENGTH];
 
+	acc_algorithm_mean_sweep_func_t         mean_sweep_func;
+	acc_algorithm_filter_f32_complex_func_t static_filter_func;
+	acc_algorithm_filter_f32_func_t         angle_filter_func;
+
+	bool           use_sos_filters;
+	float          sos_static[STATIC_SECTIONS * ACC_ALGORITHM_SOS_SECTION_LENGTH];
+	float          sos_angle[ANGLE_SECTIONS * ACC_ALGORITHM_SOS_SECTION_LENGTH];
+	float          zi_static[STATIC_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH];
+	float          zi_angle[ANGLE_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH];
+	float complex *static_sos_state;
+	float         *angle_sos_state;
+
 	float complex *mean_sweep;
 	float complex *sparse_iq_buffer;
 	float complex *filt_sparse_iq_buffer;
@@ -66,10 +98,11 @@ struct ref_app_breathing_handle
 	float         *filt_angle_buffer;
 	float         *breathing_motion_buffer;
 	float         *hamming_window;
-	float         *windowed_breathing_motion_buffer;
+	float         *coherence;
+	float         *combined_breathing_motion;
 	float complex *rfft_output;
 	uint16_t       rfft_output_length;
-	float         *weighted_psd;
+	float         *psd;
 	float          freq_delta;
 
 	uint16_t distance_determination_counter;
@@ -78,13 +111,42 @@ struct ref_app_breathing_handle
 	bool     base_presence_dist;
 	float    base_presence_distance;
 	float    presence_distance_threshold;
+
+	acc_distance_lock_t *distance_lock;
+	float complex       *lock_sweep;
+
 	bool     first;
 	uint16_t init_count;
 	uint16_t count;
 	bool     initialized;
 	uint16_t count_limit;
+
+	uint32_t config_hash;
+	uint16_t restore_grace_counter;
 };
 
+typedef struct
+{
+	uint8_t  app_state;
+	uint8_t  prev_app_state;
+	bool     presence_init;
+	bool     base_presence_dist;
+	bool     initialized;
+	uint16_t start_point;
+	uint16_t end_point;
+	uint16_t distance_determination_counter;
+	uint16_t init_count;
+	uint16_t count;
+	float    presence_distance;
+	float    base_presence_distance;
+} snapshot_scalars_t;
+
+typedef struct
+{
+	void    *data;
+	uint32_t size;
+} snapshot_array_t;
+
 static bool validate_config(ref_app_breathing_config_t *config);
 
 static void determine_state(ref_app_breathing_handle_t *handle, acc_detector_presence_result_t *presence_result);
@@ -93,10 +155,22 @@ static void update_presence_distance(ref_app_breathing_handle_t *handle, float p
 
 static bool reinit_breathing(ref_app_breathing_handle_t *handle, uint16_t start_point, uint16_t end_point);
 
+static void select_kernels(ref_app_breathing_handle_t *handle);
+
+static void update_distance_lock(ref_app_breathing_handle_t *handle, acc_int16_complex_t *frame);
+
 static bool perform_action_based_on_state(ref_app_breathing_handle_t *handle, acc_int16_complex_t *frame, ref_app_breathing_result_t *result);
 
 static bool process_breathing(ref_app_breathing_handle_t *handle, acc_int16_complex_t *frame, ref_app_breathing_result_t *result);
 
+static uint32_t calculate_config_hash(const ref_app_breathing_handle_t *handle);
+
+static bool write_snapshot(ref_app_breathing_handle_t *handle, uint64_t timestamp_ms, void *buffer, uint32_t buffer_size, uint32_t *snapshot_size);
+
+static uint16_t get_snapshot_arrays(ref_app_breathing_handle_t *handle, uint16_t num_points, snapshot_array_t *arrays);
+
+static void transfer_state(ref_app_breathing_handle_t *from, ref_app_breathing_handle_t *to);
+
 ref_app_breathing_config_t *ref_app_breathing_config_create(void)
 {
 	ref_app_breathing_config_t *config = acc_integration_mem_alloc(sizeof(*config));
@@ -117,6 +191,8 @@ ref_app_breathing_config_t *ref_app_breathing_config_create(void)
 		config->num_dists_to_analyze              = 3U;
 		config->use_presence_processor            = true;
 		config->distance_determination_duration_s = 5U;
+		config->use_early_distance_lock           = true;
+		config->use_sos_filters                   = false;
 
 		acc_detector_presence_config_t *presence_config = config->presence_config;
 
@@ -153,6 +229,11 @@ void ref_app_breathing_config_destroy(ref_app_breathing_config_t *config)
 	}
 }
 
+bool ref_app_breathing_config_validate(ref_app_breathing_config_t *config)
+{
+	return validate_config(config);
+}
+
 ref_app_breathing_handle_t *ref_app_breathing_create(ref_app_breathing_config_t *config)
 {
 	if (!validate_config(config))
@@ -189,6 +270,7 @@ ref_app_breathing_handle_t *ref_app_breathing_create(ref_app_breathing_config_t
 		handle->distance_determination_count     = config->distance_determination_duration_s * handle->frame_rate;
 		handle->num_points_to_analyze_half_width = config->num_dists_to_analyze / 2U;
 		handle->num_points_to_analyze = config->use_presence_processor ? handle->num_points_to_analyze_half_width * 2U + 1U : handle->num_points;
+		handle->max_points_to_analyze = handle->num_points_to_analyze;
 
 		handle->time_series_length              = handle->time_series_length_s * handle->frame_rate;
 		handle->padded_time_series_length_shift = 0U;
@@ -219,6 +301,8 @@ ref_app_breathing_handle_t *ref_app_breathing_create(ref_app_breathing_config_t
 
 		handle->count_limit = handle->time_series_length / 2U;
 
+		select_kernels(handle);
+
 		acc_algorithm_butter_lowpass(handle->lowest_freq, handle->frame_rate, handle->b_static, handle->a_static);
 		acc_algorithm_butter_bandpass(handle->lowest_freq, handle->highest_freq, handle->frame_rate, handle->b_angle, handle->a_angle);
 
@@ -235,22 +319,65 @@ ref_app_breathing_handle_t *ref_app_breathing_create(ref_app_breathing_config_t
 		handle->filt_angle_buffer = acc_integration_mem_alloc(A_ANGLE_LENGTH * handle->num_points_to_analyze * sizeof(*handle->filt_angle_buffer));
 		handle->breathing_motion_buffer =
 		    acc_integration_mem_alloc(handle->time_series_length * handle->num_points_to_analyze * sizeof(*handle->breathing_motion_buffer));
-		handle->hamming_window = acc_integration_mem_alloc(handle->time_series_length * sizeof(*handle->hamming_window));
-		handle->windowed_breathing_motion_buffer =
-		    acc_integration_mem_alloc(handle->time_series_length * handle->num_points_to_analyze * sizeof(*handle->windowed_breathing_motion_buffer));
-		handle->rfft_output  = acc_integration_mem_alloc(handle->rfft_output_length * handle->num_points_to_analyze * sizeof(*handle->rfft_output));
-		handle->weighted_psd = acc_integration_mem_alloc(handle->rfft_output_length * sizeof(*handle->weighted_psd));
+		handle->hamming_window            = acc_integration_mem_alloc(handle->time_series_length * sizeof(*handle->hamming_window));
+		handle->coherence                 = acc_integration_mem_alloc(handle->num_points_to_analyze * sizeof(*handle->coherence));
+		handle->combined_breathing_motion = acc_integration_mem_alloc(handle->time_series_length * sizeof(*handle->combined_breathing_motion));
+		handle->rfft_output               = acc_integration_mem_alloc(handle->rfft_output_length * sizeof(*handle->rfft_output));
+		handle->psd                       = acc_integration_mem_alloc(handle->rfft_output_length * sizeof(*handle->psd));
+
+		handle->use_sos_filters = config->use_sos_filters;
+
+		if (handle->use_sos_filters)
+		{
+			acc_algorithm_butter_lowpass_sos(handle->lowest_freq, handle->frame_rate, handle->sos_static);
+			acc_algorithm_butter_bandpass_sos(handle->lowest_freq, handle->highest_freq, handle->frame_rate, handle->sos_angle);
+			acc_algorithm_sosfilt_zi(handle->sos_static, STATIC_SECTIONS, handle->zi_static);
+			acc_algorithm_sosfilt_zi(handle->sos_angle, ANGLE_SECTIONS, handle->zi_angle);
+
+			handle->static_sos_state = acc_integration_mem_alloc(STATIC_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH * handle->num_points_to_analyze *
+			                                                     sizeof(*handle->static_sos_state));
+			handle->angle_sos_state =
+			    acc_integration_mem_alloc(ANGLE_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH * handle->num_points_to_analyze * sizeof(*handle->angle_sos_state));
+
+			if (handle->static_sos_state == NULL || handle->angle_sos_state == NULL)
+			{
+				ref_app_breathing_destroy(handle);
+				return NULL;
+			}
+		}
+
+		if (config->use_presence_processor && config->use_early_distance_lock)
+		{
+			acc_distance_lock_config_t lock_config;
+
+			acc_distance_lock_config_default(&lock_config);
+			lock_config.num_points   = handle->num_points;
+			lock_config.frame_rate   = handle->frame_rate;
+			lock_config.highest_freq = handle->highest_freq;
+
+			handle->distance_lock = acc_distance_lock_create(&lock_config);
+			handle->lock_sweep    = acc_integration_mem_alloc(handle->num_points * sizeof(*handle->lock_sweep));
+
+			if (handle->distance_lock == NULL || handle->lock_sweep == NULL)
+			{
+				ref_app_breathing_destroy(handle);
+				return NULL;
+			}
+		}
 
 		bool status = handle->mean_sweep != NULL && handle->filt_sparse_iq != NULL && handle->sparse_iq_buffer != NULL &&
 		              handle->filt_sparse_iq_buffer != NULL && handle->angle != NULL && handle->prev_angle != NULL && handle->lp_filt_ampl != NULL &&
 		              handle->unwrapped_angle != NULL && handle->angle_buffer != NULL && handle->filt_angle_buffer != NULL &&
-		              handle->breathing_motion_buffer != NULL && handle->hamming_window != NULL && handle->windowed_breathing_motion_buffer != NULL &&
-		              handle->rfft_output != NULL && handle->weighted_psd != NULL;
+		              handle->breathing_motion_buffer != NULL && handle->hamming_window != NULL && handle->coherence != NULL &&
+		              handle->combined_breathing_motion != NULL && handle->rfft_output != NULL && handle->psd != NULL;
 
 		if (status)
 		{
 			handle->freq_delta = acc_algorithm_fftfreq_delta(handle->padded_time_series_length, 1.0f / handle->frame_rate);
 			acc_algorithm_hamming(handle->time_series_length, handle->hamming_window);
+
+			handle->config_hash           = calculate_config_hash(handle);
+			handle->restore_grace_counter = 0U;
 		}
 		else
 		{
@@ -331,9 +458,14 @@ void ref_app_breathing_destroy(ref_app_breathing_handle_t *handle)
 			acc_integration_mem_free(handle->hamming_window);
 		}
 
-		if (handle->windowed_breathing_motion_buffer != NULL)
+		if (handle->coherence != NULL)
+		{
+			acc_integration_mem_free(handle->coherence);
+		}
+
+		if (handle->combined_breathing_motion != NULL)
 		{
-			acc_integration_mem_free(handle->windowed_breathing_motion_buffer);
+			acc_integration_mem_free(handle->combined_breathing_motion);
 		}
 
 		if (handle->rfft_output != NULL)
@@ -341,9 +473,26 @@ void ref_app_breathing_destroy(ref_app_breathing_handle_t *handle)
 			acc_integration_mem_free(handle->rfft_output);
 		}
 
-		if (handle->weighted_psd != NULL)
+		if (handle->psd != NULL)
 		{
-			acc_integration_mem_free(handle->weighted_psd);
+			acc_integration_mem_free(handle->psd);
+		}
+
+		if (handle->static_sos_state != NULL)
+		{
+			acc_integration_mem_free(handle->static_sos_state);
+		}
+
+		if (handle->angle_sos_state != NULL)
+		{
+			acc_integration_mem_free(handle->angle_sos_state);
+		}
+
+		acc_distance_lock_destroy(handle->distance_lock);
+
+		if (handle->lock_sweep != NULL)
+		{
+			acc_integration_mem_free(handle->lock_sweep);
 		}
 
 		acc_integration_mem_free(handle);
@@ -355,6 +504,138 @@ bool ref_app_breathing_get_buffer_size(ref_app_breathing_handle_t *handle, uint3
 	return acc_detector_presence_get_buffer_size(handle->presence_handle, buffer_size);
 }
 
+bool ref_app_breathing_get_frame_data_length(ref_app_breathing_handle_t *handle, uint16_t *frame_data_length)
+{
+	*frame_data_length = handle->num_points * handle->sweeps_per_frame;
+
+	return true;
+}
+
+bool ref_app_breathing_get_snapshot_size(ref_app_breathing_handle_t *handle, uint32_t *snapshot_size)
+{
+	// The largest snapshot, with all points that can be analyzed
+	return write_snapshot(handle, 0U, NULL, 0U, snapshot_size);
+}
+
+bool ref_app_breathing_snapshot_save(ref_app_breathing_handle_t *handle,
+                                     uint64_t                    timestamp_ms,
+                                     void                       *buffer,
+                                     uint32_t                    buffer_size,
+                                     uint32_t                   *snapshot_size)
+{
+	return write_snapshot(handle, timestamp_ms, buffer, buffer_size, snapshot_size);
+}
+
+acc_snapshot_status_t ref_app_breathing_snapshot_restore(ref_app_breathing_handle_t *handle,
+                                                         const void                 *snapshot,
+                                                         uint32_t                    snapshot_size,
+                                                         uint64_t                    now_ms,
+                                                         uint32_t                    max_age_ms)
+{
+	acc_snapshot_t        reader;
+	acc_snapshot_status_t status =
+	    acc_snapshot_begin_read(&reader, snapshot, snapshot_size, SNAPSHOT_MAGIC, SNAPSHOT_VERSION, handle->config_hash, now_ms, max_age_ms);
+
+	if (status != ACC_SNAPSHOT_STATUS_OK)
+	{
+		return status;
+	}
+
+	snapshot_scalars_t scalars;
+
+	// Everything is validated before the handle is touched
+	bool valid = acc_snapshot_read(&reader, &scalars, sizeof(scalars)) &&
+	             (scalars.app_state <= (uint8_t)REF_APP_BREATHING_APP_STATE_ESTIMATE_BREATHING_RATE) &&
+	             (scalars.prev_app_state <= (uint8_t)REF_APP_BREATHING_APP_STATE_ESTIMATE_BREATHING_RATE) &&
+	             (scalars.start_point < scalars.end_point) && (scalars.end_point <= handle->num_points) &&
+	             ((scalars.end_point - scalars.start_point) <= handle->max_points_to_analyze) &&
+	             (scalars.init_count <= (handle->time_series_length + 1U)) && (scalars.count < handle->time_series_length);
+
+	snapshot_array_t arrays[SNAPSHOT_MAX_ARRAYS];
+	uint16_t         num_arrays = valid ? get_snapshot_arrays(handle, scalars.end_point - scalars.start_point, arrays) : 0U;
+	uint32_t         arrays_size = 0U;
+
+	for (uint16_t i = 0U; i < num_arrays; i++)
+	{
+		arrays_size += arrays[i].size;
+	}
+
+	if (!valid || ((reader.buffer_size - reader.offset) != arrays_size))
+	{
+		return ACC_SNAPSHOT_STATUS_INVALID;
+	}
+
+	for (uint16_t i = 0U; i < num_arrays; i++)
+	{
+		acc_snapshot_read(&reader, arrays[i].data, arrays[i].size);
+	}
+
+	handle->app_state                      = (ref_app_breathing_app_state_t)scalars.app_state;
+	handle->prev_app_state                 = (ref_app_breathing_app_state_t)scalars.prev_app_state;
+	handle->presence_init                  = scalars.presence_init;
+	handle->base_presence_dist             = scalars.base_presence_dist;
+	handle->initialized                    = scalars.initialized;
+	handle->start_point                    = scalars.start_point;
+	handle->end_point                      = scalars.end_point;
+	handle->num_points_to_analyze          = scalars.end_point - scalars.start_point;
+	handle->distance_determination_counter = scalars.distance_determination_counter;
+	handle->init_count                     = scalars.init_count;
+	handle->count                          = scalars.count;
+	handle->presence_distance              = scalars.presence_distance;
+	handle->base_presence_distance         = scalars.base_presence_distance;
+
+	// The first frame after the restart is not continuous with the stored ones, it starts the phase
+	// unwrapping and the amplitude over again
+	handle->first = true;
+
+	// With a full time series, the next frame gives a breathing rate
+	if (handle->initialized)
+	{
+		handle->count = handle->time_series_length - handle->count_limit;
+	}
+
+	// The presence detector starts over, so its first frames must not throw away the restored state
+	handle->restore_grace_counter = handle->distance_determination_count;
+
+	select_kernels(handle);
+
+	return ACC_SNAPSHOT_STATUS_OK;
+}
+
+bool ref_app_breathing_reconfigure(ref_app_breathing_handle_t *handle, ref_app_breathing_config_t *config)
+{
+	ref_app_breathing_handle_t *new_handle = ref_app_breathing_create(config);
+
+	if (new_handle == NULL)
+	{
+		return false;
+	}
+
+	// The sensor must measure the same frames as before, anything else needs a prepare
+	bool same_frames = (new_handle->num_points == handle->num_points) && (new_handle->start_m == handle->start_m) &&
+	                   (new_handle->step_length_m == handle->step_length_m) && (new_handle->frame_rate == handle->frame_rate) &&
+	                   (new_handle->sweeps_per_frame == handle->sweeps_per_frame) &&
+	                   (new_handle->intra_detection_threshold == handle->intra_detection_threshold);
+
+	if (!same_frames)
+	{
+		ref_app_breathing_destroy(new_handle);
+		return false;
+	}
+
+	transfer_state(handle, new_handle);
+
+	// The caller keeps its handle, the old state goes with the temporary one
+	ref_app_breathing_handle_t old_handle = *handle;
+
+	*handle     = *new_handle;
+	*new_handle = old_handle;
+
+	ref_app_breathing_destroy(new_handle);
+
+	return true;
+}
+
 bool ref_app_breathing_prepare(ref_app_breathing_handle_t *handle,
                                ref_app_breathing_config_t *config,
                                acc_sensor_t               *sensor,
@@ -378,9 +659,20 @@ bool ref_app_breathing_process(ref_app_breathing_handle_t *handle, void *buffer,
 		}
 		else
 		{
-			determine_state(handle, &result->presence_result);
+			// Until the presence detector has settled after a restore, no detection keeps the restored state
+			bool hold_state = (handle->restore_grace_counter > 0U) && !result->presence_result.presence_detected;
 
-			update_presence_distance(handle, result->presence_result.presence_distance);
+			if (handle->restore_grace_counter > 0U)
+			{
+				handle->restore_grace_counter--;
+			}
+
+			if (!hold_state)
+			{
+				determine_state(handle, &result->presence_result);
+
+				update_presence_distance(handle, result->presence_result.presence_distance);
+			}
 
 			status = perform_action_based_on_state(handle, result->presence_result.processing_result.frame, result);
 		}
@@ -420,6 +712,26 @@ static bool validate_config(ref_app_breathing_config_t *config)
 		status = false;
 	}
 
+	float time_series_length = (float)config->time_series_length_s * frame_rate;
+
+	if ((time_series_length < 2.0f) || ((float)MAX_TIME_SERIES_LENGTH < time_series_length))
+	{
+		printf("Time series must hold between 2 and %u frames\n", MAX_TIME_SERIES_LENGTH);
+		status = false;
+	}
+
+	if ((frame_rate / 2.0f) <= ((float)config->highest_breathing_rate / 60.0f))
+	{
+		printf("Highest breathing rate must be lower than half the frame rate\n");
+		status = false;
+	}
+
+	if ((float)UINT16_MAX < ((float)config->distance_determination_duration_s * frame_rate))
+	{
+		printf("Distance determination duration is too long for the frame rate\n");
+		status = false;
+	}
+
 	return status;
 }
 
@@ -484,9 +796,39 @@ static bool reinit_breathing(ref_app_breathing_handle_t *handle, uint16_t start_
 	memset(handle->filt_angle_buffer, 0, A_ANGLE_LENGTH * handle->num_points_to_analyze * sizeof(*handle->filt_angle_buffer));
 	memset(handle->breathing_motion_buffer, 0, handle->time_series_length * handle->num_points_to_analyze * sizeof(*handle->breathing_motion_buffer));
 
+	select_kernels(handle);
+
 	return true;
 }
 
+static void select_kernels(ref_app_breathing_handle_t *handle)
+{
+	// Variants specialised for the shapes of the presets, or the generic functions for other configurations
+	handle->mean_sweep_func    = acc_algorithm_shaped_mean_sweep(handle->sweeps_per_frame, handle->num_points_to_analyze);
+	handle->static_filter_func = acc_algorithm_shaped_filter_f32_complex(A_STATIC_LENGTH, B_STATIC_LENGTH, handle->num_points_to_analyze);
+	handle->angle_filter_func  = acc_algorithm_shaped_filter_f32(A_ANGLE_LENGTH, B_ANGLE_LENGTH, handle->num_points_to_analyze);
+}
+
+static void update_distance_lock(ref_app_breathing_handle_t *handle, acc_int16_complex_t *frame)
+{
+	uint16_t locked_point;
+
+	acc_algorithm_mean_sweep(frame, handle->num_points, handle->sweeps_per_frame, 0U, handle->num_points, handle->lock_sweep);
+
+	if (acc_distance_lock_update(handle->distance_lock, handle->lock_sweep, &locked_point))
+	{
+		float lock_distance = handle->start_m + ((float)locked_point * handle->step_length_m);
+
+		// Only trusted when the presence detector agrees, otherwise the whole determination time is used
+		if (fabsf(lock_distance - handle->presence_distance) <= handle->presence_distance_threshold)
+		{
+			handle->base_presence_dist             = true;
+			handle->base_presence_distance         = lock_distance;
+			handle->distance_determination_counter = handle->distance_determination_count;
+		}
+	}
+}
+
 static bool perform_action_based_on_state(ref_app_breathing_handle_t *handle, acc_int16_complex_t *frame, ref_app_breathing_result_t *result)
 {
 	bool status = true;
@@ -508,6 +850,11 @@ static bool perform_action_based_on_state(ref_app_breathing_handle_t *handle, ac
 			if (handle->app_state != handle->prev_app_state)
 			{
 				handle->distance_determination_counter = 0U;
+
+				if (handle->distance_lock != NULL)
+				{
+					acc_distance_lock_reset(handle->distance_lock);
+				}
 			}
 			else
 			{
@@ -516,6 +863,11 @@ static bool perform_action_based_on_state(ref_app_breathing_handle_t *handle, ac
 				handle->base_presence_distance = handle->presence_distance;
 			}
 
+			if (handle->distance_lock != NULL)
+			{
+				update_distance_lock(handle, frame);
+			}
+
 			break;
 		case REF_APP_BREATHING_APP_STATE_ESTIMATE_BREATHING_RATE:
 			if (handle->app_state != handle->prev_app_state)
@@ -554,24 +906,45 @@ static bool perform_action_based_on_state(ref_app_breathing_handle_t *handle, ac
 
 static bool process_breathing(ref_app_breathing_handle_t *handle, acc_int16_complex_t *frame, ref_app_breathing_result_t *result)
 {
-	acc_algorithm_mean_sweep(frame, handle->num_points, handle->sweeps_per_frame, handle->start_point, handle->end_point, handle->mean_sweep);
+	bool first_frame = handle->first;
 
-	acc_algorithm_roll_and_push_matrix_f32_complex(
-	    handle->sparse_iq_buffer, B_STATIC_LENGTH, handle->num_points_to_analyze, handle->mean_sweep, true);
+	handle->mean_sweep_func(frame, handle->num_points, handle->sweeps_per_frame, handle->start_point, handle->end_point, handle->mean_sweep);
 
-	acc_algorithm_apply_filter_f32_complex(handle->a_static,
-	                                       handle->filt_sparse_iq_buffer,
-	                                       A_STATIC_LENGTH,
-	                                       handle->num_points_to_analyze,
-	                                       handle->b_static,
-	                                       handle->sparse_iq_buffer,
-	                                       B_STATIC_LENGTH,
-	                                       handle->num_points_to_analyze,
-	                                       handle->filt_sparse_iq,
-	                                       handle->num_points_to_analyze);
+	if (handle->use_sos_filters)
+	{
+		// Starting from the steady state of the first sweep removes most of the start-up transient of the static filter
+		if (first_frame)
+		{
+			acc_algorithm_sosfilt_init_f32_complex(
+			    handle->zi_static, STATIC_SECTIONS, handle->mean_sweep, handle->num_points_to_analyze, handle->static_sos_state);
+		}
 
-	acc_algorithm_roll_and_push_matrix_f32_complex(
-	    handle->filt_sparse_iq_buffer, A_STATIC_LENGTH, handle->num_points_to_analyze, handle->filt_sparse_iq, true);
+		acc_algorithm_sosfilt_f32_complex(handle->sos_static,
+		                                  STATIC_SECTIONS,
+		                                  handle->static_sos_state,
+		                                  handle->mean_sweep,
+		                                  handle->filt_sparse_iq,
+		                                  handle->num_points_to_analyze);
+	}
+	else
+	{
+		acc_algorithm_roll_and_push_matrix_f32_complex(
+		    handle->sparse_iq_buffer, B_STATIC_LENGTH, handle->num_points_to_analyze, handle->mean_sweep, true);
+
+		handle->static_filter_func(handle->a_static,
+		                           handle->filt_sparse_iq_buffer,
+		                           A_STATIC_LENGTH,
+		                           handle->num_points_to_analyze,
+		                           handle->b_static,
+		                           handle->sparse_iq_buffer,
+		                           B_STATIC_LENGTH,
+		                           handle->num_points_to_analyze,
+		                           handle->filt_sparse_iq,
+		                           handle->num_points_to_analyze);
+
+		acc_algorithm_roll_and_push_matrix_f32_complex(
+		    handle->filt_sparse_iq_buffer, A_STATIC_LENGTH, handle->num_points_to_analyze, handle->filt_sparse_iq, true);
+	}
 
 	for (uint16_t i = 0U; i < handle->num_points_to_analyze; i++)
 	{
@@ -612,20 +985,39 @@ static bool process_breathing(ref_app_breathing_handle_t *handle, acc_int16_comp
 		handle->unwrapped_angle[i] += angle_diff;
 	}
 
-	acc_algorithm_roll_and_push_matrix_f32(handle->angle_buffer, B_ANGLE_LENGTH, handle->num_points_to_analyze, handle->unwrapped_angle, true);
-
-	acc_algorithm_apply_filter_f32(handle->a_angle,
-	                               handle->filt_angle_buffer,
-	                               A_ANGLE_LENGTH,
-	                               handle->num_points_to_analyze,
-	                               handle->b_angle,
-	                               handle->angle_buffer,
-	                               B_ANGLE_LENGTH,
-	                               handle->num_points_to_analyze,
-	                               handle->angle,
-	                               handle->num_points_to_analyze);
+	if (handle->use_sos_filters)
+	{
+		if (first_frame)
+		{
+			acc_algorithm_sosfilt_init_f32(
+			    handle->zi_angle, ANGLE_SECTIONS, handle->unwrapped_angle, handle->num_points_to_analyze, handle->angle_sos_state);
+		}
 
-	acc_algorithm_roll_and_push_matrix_f32(handle->filt_angle_buffer, A_ANGLE_LENGTH, handle->num_points_to_analyze, handle->angle, true);
+		acc_algorithm_sosfilt_f32(handle->sos_angle,
+		                          ANGLE_SECTIONS,
+		                          handle->angle_sos_state,
+		                          handle->unwrapped_angle,
+		                          handle->angle,
+		                          handle->num_points_to_analyze);
+	}
+	else
+	{
+		acc_algorithm_roll_and_push_matrix_f32(
+		    handle->angle_buffer, B_ANGLE_LENGTH, handle->num_points_to_analyze, handle->unwrapped_angle, true);
+
+		handle->angle_filter_func(handle->a_angle,
+		                          handle->filt_angle_buffer,
+		                          A_ANGLE_LENGTH,
+		                          handle->num_points_to_analyze,
+		                          handle->b_angle,
+		                          handle->angle_buffer,
+		                          B_ANGLE_LENGTH,
+		                          handle->num_points_to_analyze,
+		                          handle->angle,
+		                          handle->num_points_to_analyze);
+
+		acc_algorithm_roll_and_push_matrix_f32(handle->filt_angle_buffer, A_ANGLE_LENGTH, handle->num_points_to_analyze, handle->angle, true);
+	}
 
 	acc_algorithm_roll_and_push_matrix_f32(
 	    handle->breathing_motion_buffer, handle->time_series_length, handle->num_points_to_analyze, handle->angle, false);
@@ -645,42 +1037,35 @@ static bool process_breathing(ref_app_breathing_handle_t *handle, acc_int16_comp
 
 		if (handle->initialized)
 		{
-			float lp_filt_ampl_sum = 0U;
+			// Distances that see the same breathing motion are combined into one series before the spectrum,
+			// weighted by their amplitude and their correlation, so that uncorrelated clutter averages out
+			// instead of adding its own peaks to the spectrum.
+			acc_algorithm_coherent_combine(handle->breathing_motion_buffer,
+			                               handle->time_series_length,
+			                               handle->num_points_to_analyze,
+			                               handle->lp_filt_ampl,
+			                               MIN_COHERENCE,
+			                               handle->coherence,
+			                               handle->combined_breathing_motion);
 
 			for (uint16_t r = 0U; r < handle->time_series_length; r++)
 			{
-				for (uint16_t c = 0U; c < handle->num_points_to_analyze; c++)
-				{
-					handle->windowed_breathing_motion_buffer[r * handle->num_points_to_analyze + c] =
-					    handle->breathing_motion_buffer[r * handle->num_points_to_analyze + c] * handle->hamming_window[r];
-					lp_filt_ampl_sum += handle->lp_filt_ampl[c];
-				}
+				handle->combined_breathing_motion[r] *= handle->hamming_window[r];
 			}
 
-			acc_algorithm_rfft_matrix(handle->windowed_breathing_motion_buffer,
-			                          handle->time_series_length,
-			                          handle->num_points_to_analyze,
-			                          handle->padded_time_series_length_shift,
-			                          handle->rfft_output,
-			                          0U);
+			acc_algorithm_rfft(
+			    handle->combined_breathing_motion, handle->time_series_length, handle->padded_time_series_length_shift, handle->rfft_output);
 
 			for (uint16_t r = 0U; r < handle->rfft_output_length; r++)
 			{
-				float sum_psd = 0U;
-
-				for (uint16_t c = 0U; c < handle->num_points_to_analyze; c++)
-				{
-					sum_psd += cabsf(handle->rfft_output[r * handle->num_points_to_analyze + c]) * handle->lp_filt_ampl[c];
-				}
-
-				handle->weighted_psd[r] = sum_psd / lp_filt_ampl_sum;
+				handle->psd[r] = cabsf(handle->rfft_output[r]);
 			}
 
-			uint16_t peak_loc = acc_algorithm_argmax(handle->weighted_psd, handle->rfft_output_length);
+			uint16_t peak_loc = acc_algorithm_argmax(handle->psd, handle->rfft_output_length);
 
 			if (peak_loc > 0U)
 			{
-				float freq             = acc_algorithm_interpolate_peaks_equidistant(handle->weighted_psd, 0.0f, handle->freq_delta, peak_loc);
+				float freq             = acc_algorithm_interpolate_peaks_equidistant(handle->psd, 0.0f, handle->freq_delta, peak_loc);
 				result->result_ready   = true;
 				result->breathing_rate = freq * 60.0f;
 			}
@@ -693,3 +1078,160 @@ static bool process_breathing(ref_app_breathing_handle_t *handle, acc_int16_comp
 
 	return true;
 }
+
+static uint32_t calculate_config_hash(const ref_app_breathing_handle_t *handle)
+{
+	// Everything that decides the layout or the meaning of the processing state
+	uint32_t hash = ACC_SNAPSHOT_HASH_INIT;
+
+	hash = acc_snapshot_hash(hash, &handle->frame_rate, sizeof(handle->frame_rate));
+	hash = acc_snapshot_hash(hash, &handle->sweeps_per_frame, sizeof(handle->sweeps_per_frame));
+	hash = acc_snapshot_hash(hash, &handle->start_m, sizeof(handle->start_m));
+	hash = acc_snapshot_hash(hash, &handle->step_length_m, sizeof(handle->step_length_m));
+	hash = acc_snapshot_hash(hash, &handle->num_points, sizeof(handle->num_points));
+	hash = acc_snapshot_hash(hash, &handle->lowest_freq, sizeof(handle->lowest_freq));
+	hash = acc_snapshot_hash(hash, &handle->highest_freq, sizeof(handle->highest_freq));
+	hash = acc_snapshot_hash(hash, &handle->time_series_length, sizeof(handle->time_series_length));
+	hash = acc_snapshot_hash(hash, &handle->max_points_to_analyze, sizeof(handle->max_points_to_analyze));
+	hash = acc_snapshot_hash(hash, &handle->use_presence_processor, sizeof(handle->use_presence_processor));
+	hash = acc_snapshot_hash(hash, &handle->distance_determination_count, sizeof(handle->distance_determination_count));
+	hash = acc_snapshot_hash(hash, &handle->presence_distance_threshold, sizeof(handle->presence_distance_threshold));
+	hash = acc_snapshot_hash(hash, &handle->use_sos_filters, sizeof(handle->use_sos_filters));
+
+	return hash;
+}
+
+static bool write_snapshot(ref_app_breathing_handle_t *handle, uint64_t timestamp_ms, void *buffer, uint32_t buffer_size, uint32_t *snapshot_size)
+{
+	acc_snapshot_t     writer;
+	snapshot_scalars_t scalars;
+
+	// Cleared so that the padding bytes are the same in every snapshot
+	memset(&scalars, 0, sizeof(scalars));
+
+	scalars.app_state                      = (uint8_t)handle->app_state;
+	scalars.prev_app_state                 = (uint8_t)handle->prev_app_state;
+	scalars.presence_init                  = handle->presence_init;
+	scalars.base_presence_dist             = handle->base_presence_dist;
+	scalars.initialized                    = handle->initialized;
+	scalars.start_point                    = (uint16_t)handle->start_point;
+	scalars.end_point                      = handle->end_point;
+	scalars.distance_determination_counter = handle->distance_determination_counter;
+	scalars.init_count                     = handle->init_count;
+	scalars.count                          = handle->count;
+	scalars.presence_distance              = handle->presence_distance;
+	scalars.base_presence_distance         = handle->base_presence_distance;
+
+	// Only the points in use are stored, a size query asks for the largest possible snapshot
+	uint16_t         num_points = (buffer == NULL) ? handle->max_points_to_analyze : handle->num_points_to_analyze;
+	snapshot_array_t arrays[SNAPSHOT_MAX_ARRAYS];
+	uint16_t         num_arrays = get_snapshot_arrays(handle, num_points, arrays);
+
+	acc_snapshot_begin_write(&writer, buffer, buffer_size);
+	acc_snapshot_write(&writer, &scalars, sizeof(scalars));
+
+	for (uint16_t i = 0U; i < num_arrays; i++)
+	{
+		acc_snapshot_write(&writer, arrays[i].data, arrays[i].size);
+	}
+
+	return acc_snapshot_end_write(&writer, SNAPSHOT_MAGIC, SNAPSHOT_VERSION, handle->config_hash, timestamp_ms, snapshot_size);
+}
+
+static uint16_t get_snapshot_arrays(ref_app_breathing_handle_t *handle, uint16_t num_points, snapshot_array_t *arrays)
+{
+	uint16_t num_arrays = 0U;
+
+	arrays[num_arrays].data   = handle->sparse_iq_buffer;
+	arrays[num_arrays++].size = B_STATIC_LENGTH * num_points * sizeof(*handle->sparse_iq_buffer);
+	arrays[num_arrays].data   = handle->filt_sparse_iq_buffer;
+	arrays[num_arrays++].size = A_STATIC_LENGTH * num_points * sizeof(*handle->filt_sparse_iq_buffer);
+	arrays[num_arrays].data   = handle->prev_angle;
+	arrays[num_arrays++].size = num_points * sizeof(*handle->prev_angle);
+	arrays[num_arrays].data   = handle->lp_filt_ampl;
+	arrays[num_arrays++].size = num_points * sizeof(*handle->lp_filt_ampl);
+	arrays[num_arrays].data   = handle->unwrapped_angle;
+	arrays[num_arrays++].size = num_points * sizeof(*handle->unwrapped_angle);
+	arrays[num_arrays].data   = handle->angle_buffer;
+	arrays[num_arrays++].size = B_ANGLE_LENGTH * num_points * sizeof(*handle->angle_buffer);
+	arrays[num_arrays].data   = handle->filt_angle_buffer;
+	arrays[num_arrays++].size = A_ANGLE_LENGTH * num_points * sizeof(*handle->filt_angle_buffer);
+	arrays[num_arrays].data   = handle->breathing_motion_buffer;
+	arrays[num_arrays++].size = handle->time_series_length * num_points * sizeof(*handle->breathing_motion_buffer);
+
+	if (handle->use_sos_filters)
+	{
+		arrays[num_arrays].data   = handle->static_sos_state;
+		arrays[num_arrays++].size = STATIC_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH * num_points * sizeof(*handle->static_sos_state);
+		arrays[num_arrays].data   = handle->angle_sos_state;
+		arrays[num_arrays++].size = ANGLE_SECTIONS * ACC_ALGORITHM_SOS_STATE_LENGTH * num_points * sizeof(*handle->angle_sos_state);
+	}
+
+	return num_arrays;
+}
+
+static void transfer_state(ref_app_breathing_handle_t *from, ref_app_breathing_handle_t *to)
+{
+	// The prepared presence detector goes to the new state, the one created with it is destroyed with the old state
+	acc_detector_presence_handle_t *presence_handle = to->presence_handle;
+
+	to->presence_handle   = from->presence_handle;
+	from->presence_handle = presence_handle;
+
+	// Where the person is does not depend on the processing configuration
+	to->app_state                      = from->app_state;
+	to->prev_app_state                 = from->prev_app_state;
+	to->presence_init                  = from->presence_init;
+	to->presence_distance              = from->presence_distance;
+	to->base_presence_dist             = from->base_presence_dist;
+	to->base_presence_distance         = from->base_presence_distance;
+	to->distance_determination_counter = from->distance_determination_counter;
+	to->restore_grace_counter          = from->restore_grace_counter;
+
+	if ((from->distance_lock != NULL) && (to->distance_lock != NULL) && (from->highest_freq == to->highest_freq))
+	{
+		acc_distance_lock_t *distance_lock = to->distance_lock;
+
+		to->distance_lock   = from->distance_lock;
+		from->distance_lock = distance_lock;
+	}
+
+	// The breathing time series is only kept if it is filtered and stored the same way
+	bool same_series = (from->time_series_length == to->time_series_length) && (from->lowest_freq == to->lowest_freq) &&
+	                   (from->highest_freq == to->highest_freq) && (from->use_sos_filters == to->use_sos_filters) &&
+	                   (from->use_presence_processor == to->use_presence_processor) &&
+	                   (from->max_points_to_analyze == to->max_points_to_analyze);
+
+	if (from->app_state != REF_APP_BREATHING_APP_STATE_ESTIMATE_BREATHING_RATE)
+	{
+		// Nothing to keep, the analysis starts when the state is entered
+	}
+	else if (same_series)
+	{
+		snapshot_array_t from_arrays[SNAPSHOT_MAX_ARRAYS];
+		snapshot_array_t to_arrays[SNAPSHOT_MAX_ARRAYS];
+		uint16_t         num_arrays = get_snapshot_arrays(from, from->num_points_to_analyze, from_arrays);
+
+		(void)get_snapshot_arrays(to, from->num_points_to_analyze, to_arrays);
+
+		for (uint16_t i = 0U; i < num_arrays; i++)
+		{
+			memcpy(to_arrays[i].data, from_arrays[i].data, from_arrays[i].size);
+		}
+
+		to->start_point           = from->start_point;
+		to->end_point             = from->end_point;
+		to->num_points_to_analyze = from->num_points_to_analyze;
+		to->first                 = from->first;
+		to->init_count            = from->init_count;
+		to->count                 = from->count;
+		to->initialized           = from->initialized;
+
+		select_kernels(to);
+	}
+	else
+	{
+		// Entering the state again on the next frame starts a new time series at the kept distance
+		to->prev_app_state = REF_APP_BREATHING_APP_STATE_INIT;
+	}
+}
@@ -6,15 +6,22 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
+#include "acc_control_socket.h"
 #include "acc_definitions_a121.h"
 #include "acc_definitions_common.h"
 #include "acc_hal_definitions_a121.h"
+#include "acc_hal_fault_injection.h"
 #include "acc_hal_integration_a121.h"
 #include "acc_integration.h"
 #include "acc_processing.h"
 #include "acc_rss_a121.h"
 #include "acc_sensor.h"
+#include "acc_sensor_recovery.h"
+#include "acc_snapshot.h"
 #include "acc_version.h"
 
 #include "ref_app_breathing.h"
@@ -31,25 +38,106 @@ typedef enum
 
 #define DEFAULT_PRESET_CONFIG BREATHING_PRESET_SITTING
 
-static void cleanup(ref_app_breathing_handle_t *handle, ref_app_breathing_config_t *config, acc_sensor_t *sensor, void *buffer);
+// The processing state is saved periodically and restored on start if it is recent enough.
+// The path can be changed with the environment variable, an empty path turns it off.
+#define SNAPSHOT_PATH_ENV     "REF_APP_BREATHING_SNAPSHOT"
+#define DEFAULT_SNAPSHOT_PATH "/var/tmp/ref_app_breathing.snapshot"
+#define SNAPSHOT_INTERVAL_MS  (5000U)
+#define SNAPSHOT_MAX_AGE_MS   (60000U)
 
-static void set_config(ref_app_breathing_config_t *config, breathing_preset_t preset);
+// Parameters can be changed while running through a control socket, e.g.
+//   echo "set time_series_length_s=30" | socat - UNIX-CONNECT:/tmp/ref_app_breathing.control
+// The path can be changed with the environment variable, an empty path turns it off.
+#define CONTROL_PATH_ENV     "REF_APP_BREATHING_CONTROL"
+#define DEFAULT_CONTROL_PATH "/tmp/ref_app_breathing.control"
+
+typedef enum
+{
+	PARAM_TIME_SERIES_LENGTH_S,
+	PARAM_LOWEST_BREATHING_RATE,
+	PARAM_HIGHEST_BREATHING_RATE,
+	PARAM_NUM_DISTS_TO_ANALYZE,
+	PARAM_USE_PRESENCE_PROCESSOR,
+	PARAM_DISTANCE_DETERMINATION_DURATION_S,
+	PARAM_USE_EARLY_DISTANCE_LOCK,
+	PARAM_USE_SOS_FILTERS,
+	PARAM_START_M,
+	PARAM_END_M,
+	PARAM_FRAME_RATE,
+	PARAM_INTRA_DETECTION_THRESHOLD,
+	NUM_PARAMS,
+} control_param_t;
+
+// The breathing parameters only change the processing, the presence parameters change
+// what the sensor measures or need a new presence detector
+static const acc_control_param_t control_params[NUM_PARAMS] = {
+	[PARAM_TIME_SERIES_LENGTH_S]              = {"time_series_length_s", ACC_CONTROL_VALUE_U16, false},
+	[PARAM_LOWEST_BREATHING_RATE]             = {"lowest_breathing_rate", ACC_CONTROL_VALUE_U16, false},
+	[PARAM_HIGHEST_BREATHING_RATE]            = {"highest_breathing_rate", ACC_CONTROL_VALUE_U16, false},
+	[PARAM_NUM_DISTS_TO_ANALYZE]              = {"num_dists_to_analyze", ACC_CONTROL_VALUE_U16, false},
+	[PARAM_USE_PRESENCE_PROCESSOR]            = {"use_presence_processor", ACC_CONTROL_VALUE_BOOL, false},
+	[PARAM_DISTANCE_DETERMINATION_DURATION_S] = {"distance_determination_duration_s", ACC_CONTROL_VALUE_U16, false},
+	[PARAM_USE_EARLY_DISTANCE_LOCK]           = {"use_early_distance_lock", ACC_CONTROL_VALUE_BOOL, false},
+	[PARAM_USE_SOS_FILTERS]                   = {"use_sos_filters", ACC_CONTROL_VALUE_BOOL, false},
+	[PARAM_START_M]                           = {"start_m", ACC_CONTROL_VALUE_FLOAT, true},
+	[PARAM_END_M]                             = {"end_m", ACC_CONTROL_VALUE_FLOAT, true},
+	[PARAM_FRAME_RATE]                        = {"frame_rate", ACC_CONTROL_VALUE_FLOAT, true},
+	[PARAM_INTRA_DETECTION_THRESHOLD]         = {"intra_detection_threshold", ACC_CONTROL_VALUE_FLOAT, true},
+};
 
-static bool sensor_calibration(acc_sensor_t *sensor, acc_cal_result_t *sensor_cal_result, void *buffer, uint32_t buffer_size);
+typedef enum
+{
+	RECONFIGURE_REJECTED,
+	RECONFIGURE_IN_PLACE,
+	RECONFIGURE_PREPARED,
+	RECONFIGURE_FAILED,
+} reconfigure_status_t;
+
+typedef struct
+{
+	ref_app_breathing_handle_t *handle;
+	ref_app_breathing_config_t *config;
+} breathing_context_t;
 
-static bool measure(acc_sensor_t *sensor, void *buffer, uint32_t buffer_size);
+static void cleanup(ref_app_breathing_handle_t *handle,
+                    ref_app_breathing_config_t *config,
+                    acc_sensor_recovery_t      *recovery,
+                    void                       *buffer,
+                    void                       *snapshot,
+                    acc_control_socket_t       *control);
+
+static void set_config(ref_app_breathing_config_t *config, breathing_preset_t preset);
+
+static bool prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size, void *user_data);
 
 static void print_app_state(ref_app_breathing_result_t *result);
 
 static void print_result(ref_app_breathing_result_t *result, ref_app_breathing_app_state_t prev_app_state);
 
-static bool handle_indications(ref_app_breathing_handle_t     *handle,
-                               ref_app_breathing_config_t     *config,
-                               acc_sensor_t                   *sensor,
-                               acc_cal_result_t               *sensor_cal_result,
-                               void                           *buffer,
-                               uint32_t                        buffer_size,
-                               acc_detector_presence_result_t *presence_result);
+static bool handle_indications(acc_sensor_recovery_t *recovery, acc_detector_presence_result_t *presence_result);
+
+static const char *get_path(const char *env, const char *default_path);
+
+static void restore_snapshot(ref_app_breathing_handle_t *handle, const char *path, void *snapshot, uint32_t snapshot_size);
+
+static void save_snapshot(ref_app_breathing_handle_t *handle, const char *path, void *snapshot, uint32_t snapshot_size);
+
+static uint64_t get_wall_clock_ms(void);
+
+static reconfigure_status_t reconfigure(breathing_context_t   *context,
+                                        acc_sensor_recovery_t *recovery,
+                                        acc_control_value_t   *values,
+                                        char                  *command,
+                                        char                  *reply,
+                                        size_t                 reply_size);
+
+static ref_app_breathing_config_t *create_config(const acc_control_value_t *values);
+
+static bool values_equal(acc_control_value_type_t type, acc_control_value_t a, acc_control_value_t b);
+
+static acc_control_value_t get_param(const ref_app_breathing_config_t *config, control_param_t param);
+
+static void set_param(ref_app_breathing_config_t *config, control_param_t param, acc_control_value_t value);
 
 int main(int argc, char *argv[]);
 
@@ -59,15 +147,22 @@ int main(int argc, char *argv[])
 	(void)argv;
 	ref_app_breathing_config_t   *config = NULL;
 	ref_app_breathing_handle_t   *handle = NULL;
-	acc_sensor_t                 *sensor = NULL;
-	acc_cal_result_t              sensor_cal_result;
+	acc_sensor_recovery_t         recovery       = {.sensor_id = SENSOR_ID};
+	breathing_context_t           context        = {0};
 	void                         *buffer         = NULL;
 	uint32_t                      buffer_size    = 0U;
 	ref_app_breathing_app_state_t prev_app_state = (ref_app_breathing_app_state_t)0U;
+	const char                   *snapshot_path  = get_path(SNAPSHOT_PATH_ENV, DEFAULT_SNAPSHOT_PATH);
+	void                         *snapshot       = NULL;
+	uint32_t                      snapshot_size  = 0U;
+	const char                   *control_path   = get_path(CONTROL_PATH_ENV, DEFAULT_CONTROL_PATH);
+	acc_control_socket_t          control        = {.server_socket = -1, .client_socket = -1};
+	acc_control_value_t           control_values[NUM_PARAMS];
 
 	printf("Acconeer software version %s\n", acc_version_get());
 
-	const acc_hal_a121_t *hal = acc_hal_rss_integration_get_implementation();
+	// Passes everything through unless faults are configured with ACC_HAL_FAULT_* environment variables
+	const acc_hal_a121_t *hal = acc_hal_fault_injection_get_implementation(acc_hal_rss_integration_get_implementation());
 
 	if (!acc_rss_hal_register(hal))
 	{
@@ -79,25 +174,30 @@ int main(int argc, char *argv[])
 	if (config == NULL)
 	{
 		printf("Failed to create config\n");
-		cleanup(handle, config, sensor, buffer);
+		cleanup(handle, config, &recovery, buffer, snapshot, &control);
 		return EXIT_FAILURE;
 	}
 
 	set_config(config, DEFAULT_PRESET_CONFIG);
 
+	for (uint16_t i = 0U; i < NUM_PARAMS; i++)
+	{
+		control_values[i] = get_param(config, (control_param_t)i);
+	}
+
 	handle = ref_app_breathing_create(config);
 
 	if (handle == NULL)
 	{
 		printf("Failed to create handle\n");
-		cleanup(handle, config, sensor, buffer);
+		cleanup(handle, config, &recovery, buffer, snapshot, &control);
 		return EXIT_FAILURE;
 	}
 
 	if (!ref_app_breathing_get_buffer_size(handle, &buffer_size))
 	{
 		printf("ref_app_breathing_get_buffer_size() failed\n");
-		cleanup(handle, config, sensor, buffer);
+		cleanup(handle, config, &recovery, buffer, snapshot, &control);
 		return EXIT_FAILURE;
 	}
 
@@ -105,55 +205,90 @@ int main(int argc, char *argv[])
 	if (buffer == NULL)
 	{
 		printf("Failed to allocate buffer\n");
-		cleanup(handle, config, sensor, buffer);
+		cleanup(handle, config, &recovery, buffer, snapshot, &control);
 		return EXIT_FAILURE;
 	}
 
-	acc_hal_integration_sensor_supply_on(SENSOR_ID);
-	acc_hal_integration_sensor_enable(SENSOR_ID);
-
-	sensor = acc_sensor_create(SENSOR_ID);
-	if (sensor == NULL)
+	if (snapshot_path != NULL)
 	{
-		printf("acc_sensor_create() failed\n");
-		cleanup(handle, config, sensor, buffer);
-		return EXIT_FAILURE;
+		if (!ref_app_breathing_get_snapshot_size(handle, &snapshot_size))
+		{
+			printf("ref_app_breathing_get_snapshot_size() failed\n");
+			cleanup(handle, config, &recovery, buffer, snapshot, &control);
+			return EXIT_FAILURE;
+		}
+
+		snapshot = acc_integration_mem_alloc(snapshot_size);
+		if (snapshot == NULL)
+		{
+			printf("Failed to allocate snapshot buffer\n");
+			cleanup(handle, config, &recovery, buffer, snapshot, &control);
+			return EXIT_FAILURE;
+		}
+
+		restore_snapshot(handle, snapshot_path, snapshot, snapshot_size);
 	}
 
-	if (!sensor_calibration(sensor, &sensor_cal_result, buffer, buffer_size))
+	// Without a control socket the application runs as configured
+	if ((control_path != NULL) && acc_control_socket_open(&control, control_path))
 	{
-		printf("Sensor calibration failed\n");
-		cleanup(handle, config, sensor, buffer);
-		return EXIT_FAILURE;
+		printf("Listening for configuration changes on %s\n", control_path);
 	}
 
-	if (!ref_app_breathing_prepare(handle, config, sensor, &sensor_cal_result, buffer, buffer_size))
+	context.handle = handle;
+	context.config = config;
+
+	recovery.buffer             = buffer;
+	recovery.buffer_size        = buffer_size;
+	recovery.timeout_ms         = SENSOR_TIMEOUT_MS;
+	recovery.prepare            = prepare;
+	recovery.prepare_user_data  = &context;
+	recovery.wait_for_interrupt = acc_hal_fault_injection_wait_for_sensor_interrupt;
+
+	if (!acc_sensor_recovery_start(&recovery))
 	{
-		printf("ref_app_breathing_prepare() failed\n");
-		cleanup(handle, config, sensor, buffer);
+		cleanup(handle, config, &recovery, buffer, snapshot, &control);
 		return EXIT_FAILURE;
 	}
 
 	ref_app_breathing_result_t result = {0};
 
+	uint32_t             start_ms           = acc_integration_get_time();
+	uint32_t             last_snapshot_ms   = start_ms;
+	bool                 first_rate_ready   = false;
+	uint32_t             frame_ms           = start_ms;
+	reconfigure_status_t reconfigure_status = RECONFIGURE_REJECTED;
+	uint32_t             apply_ms           = 0U;
+	char                 command[ACC_CONTROL_SOCKET_MAX_LINE_LENGTH];
+	char                 reply[ACC_CONTROL_SOCKET_MAX_LINE_LENGTH];
+
 	while (true)
 	{
-		if (!measure(sensor, buffer, buffer_size))
+		// Sensor faults are recovered in-process, only give up if the recovery fails
+		if (!acc_sensor_recovery_measure(&recovery))
 		{
-			cleanup(handle, config, sensor, buffer);
+			cleanup(handle, config, &recovery, buffer, snapshot, &control);
 			return EXIT_FAILURE;
 		}
 
-		if (!ref_app_breathing_process(handle, buffer, &result))
+		uint32_t prev_frame_ms = frame_ms;
+
+		frame_ms = acc_integration_get_time();
+
+		acc_integration_mem_steady_state_begin();
+		bool process_ok = ref_app_breathing_process(handle, buffer, &result);
+		acc_integration_mem_steady_state_end();
+
+		if (!process_ok)
 		{
 			printf("ref_app_breathing_process() failed\n");
-			cleanup(handle, config, sensor, buffer);
+			cleanup(handle, config, &recovery, buffer, snapshot, &control);
 			return EXIT_FAILURE;
 		}
 
-		if (!handle_indications(handle, config, sensor, &sensor_cal_result, buffer, buffer_size, &result.presence_result))
+		if (!handle_indications(&recovery, &result.presence_result))
 		{
-			cleanup(handle, config, sensor, buffer);
+			cleanup(handle, config, &recovery, buffer, snapshot, &control);
 			return EXIT_FAILURE;
 		}
 
@@ -162,33 +297,124 @@ int main(int argc, char *argv[])
 			print_result(&result, prev_app_state);
 			prev_app_state = result.app_state;
 		}
+
+		uint32_t now_ms = acc_integration_get_time();
+
+		if (result.result_ready && !first_rate_ready)
+		{
+			first_rate_ready = true;
+			printf("First breathing rate %" PRIu32 " ms after the start of measurements\n", now_ms - start_ms);
+		}
+
+		if ((snapshot != NULL) && ((now_ms - last_snapshot_ms) >= SNAPSHOT_INTERVAL_MS))
+		{
+			last_snapshot_ms = now_ms;
+			save_snapshot(handle, snapshot_path, snapshot, snapshot_size);
+		}
+
+		// The first frame with a new configuration tells how long the frames were interrupted
+		if (reconfigure_status != RECONFIGURE_REJECTED)
+		{
+			bool     in_place  = reconfigure_status == RECONFIGURE_IN_PLACE;
+			uint32_t gap_ms    = frame_ms - prev_frame_ms;
+			uint32_t period_ms = (uint32_t)(1000.0f / acc_detector_presence_config_frame_rate_get(config->presence_config));
+
+			snprintf(reply,
+			         sizeof(reply),
+			         "ok %s apply_ms=%" PRIu32 " gap_ms=%" PRIu32 " period_ms=%" PRIu32,
+			         in_place ? "in_place" : "prepared",
+			         apply_ms,
+			         gap_ms,
+			         period_ms);
+			printf("Reconfigured %s: %" PRIu32 " ms to apply, %" PRIu32 " ms between frames\n",
+			       in_place ? "in place" : "with prepare",
+			       apply_ms,
+			       gap_ms);
+			acc_control_socket_reply(&control, reply);
+
+			reconfigure_status = RECONFIGURE_REJECTED;
+		}
+
+		// Changes are applied between frames, while the sensor is idle until the next measure
+		if (acc_control_socket_poll(&control, command, sizeof(command)))
+		{
+			uint32_t reconfigure_start_ms = acc_integration_get_time();
+
+			reconfigure_status = reconfigure(&context, &recovery, control_values, command, reply, sizeof(reply));
+			apply_ms           = acc_integration_get_time() - reconfigure_start_ms;
+
+			switch (reconfigure_status)
+			{
+				case RECONFIGURE_REJECTED:
+					printf("Configuration change rejected: %s\n", reply);
+					acc_control_socket_reply(&control, reply);
+					break;
+				case RECONFIGURE_IN_PLACE:
+				case RECONFIGURE_PREPARED:
+					handle      = context.handle;
+					config      = context.config;
+					buffer      = recovery.buffer;
+					buffer_size = recovery.buffer_size;
+
+					// The snapshot size depends on the configuration
+					if (snapshot != NULL)
+					{
+						acc_integration_mem_free(snapshot);
+						snapshot = NULL;
+
+						if (ref_app_breathing_get_snapshot_size(handle, &snapshot_size))
+						{
+							snapshot = acc_integration_mem_alloc(snapshot_size);
+						}
+
+						if (snapshot == NULL)
+						{
+							printf("Failed to allocate snapshot buffer, snapshots are turned off\n");
+						}
+					}
+
+					break;
+				case RECONFIGURE_FAILED:
+				default:
+					printf("The sensor could not be prepared with the new or the old configuration\n");
+					acc_control_socket_reply(&control, reply);
+					cleanup(handle, config, &recovery, buffer, snapshot, &control);
+					return EXIT_FAILURE;
+			}
+		}
 	}
 
-	cleanup(handle, config, sensor, buffer);
+	cleanup(handle, config, &recovery, buffer, snapshot, &control);
 
 	printf("Application finished OK\n");
 
 	return EXIT_SUCCESS;
 }
 
-static void cleanup(ref_app_breathing_handle_t *handle, ref_app_breathing_config_t *config, acc_sensor_t *sensor, void *buffer)
+static void cleanup(ref_app_breathing_handle_t *handle,
+                    ref_app_breathing_config_t *config,
+                    acc_sensor_recovery_t      *recovery,
+                    void                       *buffer,
+                    void                       *snapshot,
+                    acc_control_socket_t       *control)
 {
-	acc_hal_integration_sensor_disable(SENSOR_ID);
-	acc_hal_integration_sensor_supply_off(SENSOR_ID);
+	acc_sensor_recovery_print_stats(recovery);
+	acc_sensor_recovery_stop(recovery);
+	acc_control_socket_close(control);
 
 	if (config != NULL)
 	{
 		ref_app_breathing_config_destroy(config);
 	}
 
-	if (sensor != NULL)
+	if (buffer != NULL)
 	{
-		acc_sensor_destroy(sensor);
+		acc_integration_mem_free(buffer);
 	}
 
-	if (buffer != NULL)
+	if (snapshot != NULL)
 	{
-		acc_integration_mem_free(buffer);
+		acc_integration_mem_free(snapshot);
 	}
 
 	ref_app_breathing_destroy(handle);
@@ -214,66 +440,13 @@ static void set_config(ref_app_breathing_config_t *config, breathing_preset_t pr
 	}
 }
 
-static bool sensor_calibration(acc_sensor_t *sensor, acc_cal_result_t *sensor_cal_result, void *buffer, uint32_t buffer_size)
+static bool prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size, void *user_data)
 {
-	bool           status              = false;
-	bool           cal_complete        = false;
-	const uint16_t calibration_retries = 1U;
-
-	// Random disturbances may cause the calibration to fail. At failure, retry at least once.
-	for (uint16_t i = 0; !status && (i <= calibration_retries); i++)
-	{
-		// Reset sensor before calibration by disabling/enabling it
-		acc_hal_integration_sensor_disable(SENSOR_ID);
-		acc_hal_integration_sensor_enable(SENSOR_ID);
-
-		do
-		{
-			status = acc_sensor_calibrate(sensor, &cal_complete, sensor_cal_result, buffer, buffer_size);
-
-			if (status && !cal_complete)
-			{
-				status = acc_hal_integration_wait_for_sensor_interrupt(SENSOR_ID, SENSOR_TIMEOUT_MS);
-			}
-		} while (status && !cal_complete);
-	}
-
-	if (status)
-	{
-		/* Reset sensor after calibration by disabling/enabling it */
-		acc_hal_integration_sensor_disable(SENSOR_ID);
-		acc_hal_integration_sensor_enable(SENSOR_ID);
-	}
-	else
-	{
-		printf("acc_sensor_calibrate() failed\n");
-		acc_sensor_status(sensor);
-	}
-
-	return status;
-}
-
-static bool measure(acc_sensor_t *sensor, void *buffer, uint32_t buffer_size)
-{
-
-	if (!acc_sensor_measure(sensor))
-	{
-		printf("acc_sensor_measure failed\n");
-		acc_sensor_status(sensor);
-		return false;
-	}
-
-	if (!acc_hal_integration_wait_for_sensor_interrupt(SENSOR_ID, SENSOR_TIMEOUT_MS))
-	{
-		printf("Sensor interrupt timeout\n");
-		acc_sensor_status(sensor);
-		return false;
-	}
+	breathing_context_t *context = user_data;
 
-	if (!acc_sensor_read(sensor, buffer, buffer_size))
+	if (!ref_app_breathing_prepare(context->handle, context->config, sensor, cal_result, buffer, buffer_size))
 	{
-		printf("acc_sensor_read() failed\n");
-		acc_sensor_status(sensor);
+		printf("ref_app_breathing_prepare() failed\n");
 		return false;
 	}
 
@@ -316,13 +489,7 @@ static void print_result(ref_app_breathing_result_t *result, ref_app_breathing_a
 	}
 }
 
-static bool handle_indications(ref_app_breathing_handle_t     *handle,
-                               ref_app_breathing_config_t     *config,
-                               acc_sensor_t                   *sensor,
-                               acc_cal_result_t               *sensor_cal_result,
-                               void                           *buffer,
-                               uint32_t                        buffer_size,
-                               acc_detector_presence_result_t *presence_result)
+static bool handle_indications(acc_sensor_recovery_t *recovery, acc_detector_presence_result_t *presence_result)
 {
 	if (presence_result->processing_result.data_saturated)
 	{
@@ -339,21 +506,325 @@ static bool handle_indications(ref_app_breathing_handle_t     *handle,
 	{
 		printf("Sensor recalibration needed ... \n");
 
-		if (!sensor_calibration(sensor, sensor_cal_result, buffer, buffer_size))
+		// Before measuring again, the sensor is prepared through the detector
+		if (!acc_sensor_recovery_recalibrate(recovery))
 		{
 			printf("Sensor calibration failed\n");
 			return false;
 		}
 
 		printf("Sensor recalibration done!\n");
+	}
+
+	return true;
+}
+
+static const char *get_path(const char *env, const char *default_path)
+{
+	const char *path = getenv(env);
+
+	if (path == NULL)
+	{
+		path = default_path;
+	}
+
+	return (path[0] != '\0') ? path : NULL;
+}
+
+static void restore_snapshot(ref_app_breathing_handle_t *handle, const char *path, void *snapshot, uint32_t snapshot_size)
+{
+	uint32_t size;
+
+	if (!acc_snapshot_file_read(path, snapshot, snapshot_size, &size))
+	{
+		printf("No breathing state snapshot in %s\n", path);
+		return;
+	}
+
+	acc_snapshot_status_t status = ref_app_breathing_snapshot_restore(handle, snapshot, size, get_wall_clock_ms(), SNAPSHOT_MAX_AGE_MS);
+
+	if (status == ACC_SNAPSHOT_STATUS_OK)
+	{
+		printf("Restored breathing state from %s\n", path);
+	}
+	else
+	{
+		printf("Breathing state snapshot in %s not restored: %s\n", path, acc_snapshot_status_str(status));
+	}
+}
+
+static void save_snapshot(ref_app_breathing_handle_t *handle, const char *path, void *snapshot, uint32_t snapshot_size)
+{
+	uint32_t size;
+
+	// A failed save is not fatal, the next restart just starts from the beginning
+	if (!ref_app_breathing_snapshot_save(handle, get_wall_clock_ms(), snapshot, snapshot_size, &size) ||
+	    !acc_snapshot_file_write(path, snapshot, size))
+	{
+		printf("Failed to save breathing state snapshot to %s\n", path);
+	}
+}
+
+static uint64_t get_wall_clock_ms(void)
+{
+	// The wall clock, unlike the integration time, carries over restarts and reboots
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000U) + ((uint64_t)ts.tv_nsec / 1000000U);
+}
+
+static reconfigure_status_t reconfigure(breathing_context_t   *context,
+                                        acc_sensor_recovery_t *recovery,
+                                        acc_control_value_t   *values,
+                                        char                  *command,
+                                        char                  *reply,
+                                        size_t                 reply_size)
+{
+	acc_control_change_t changes[ACC_CONTROL_SOCKET_MAX_CHANGES];
+	uint16_t             num_changes;
+	char                 error[ACC_CONTROL_SOCKET_MAX_LINE_LENGTH / 2U];
+
+	if (!acc_control_parse(control_params, NUM_PARAMS, command, changes, &num_changes, error, sizeof(error)))
+	{
+		snprintf(reply, reply_size, "error %s", error);
+		return RECONFIGURE_REJECTED;
+	}
+
+	acc_control_value_t new_values[NUM_PARAMS];
+	bool                needs_prepare = false;
+
+	memcpy(new_values, values, sizeof(new_values));
 
-		// Before measuring again, the sensor needs to be prepared through the detector
-		if (!ref_app_breathing_prepare(handle, config, sensor, sensor_cal_result, buffer, buffer_size))
+	for (uint16_t i = 0U; i < num_changes; i++)
+	{
+		const acc_control_param_t *param = &control_params[changes[i].param];
+
+		// Setting a value that is already used does not interrupt the frames
+		if (param->needs_prepare && !values_equal(param->type, values[changes[i].param], changes[i].value))
 		{
-			printf("acc_detector_presence_prepare() failed\n");
-			return false;
+			needs_prepare = true;
 		}
+
+		new_values[changes[i].param] = changes[i].value;
 	}
 
-	return true;
+	ref_app_breathing_config_t *new_config = create_config(new_values);
+
+	if (new_config == NULL)
+	{
+		snprintf(reply, reply_size, "error failed to create config");
+		return RECONFIGURE_REJECTED;
+	}
+
+	if (!ref_app_breathing_config_validate(new_config))
+	{
+		ref_app_breathing_config_destroy(new_config);
+		snprintf(reply, reply_size, "error invalid configuration");
+		return RECONFIGURE_REJECTED;
+	}
+
+	if (!needs_prepare && ref_app_breathing_reconfigure(context->handle, new_config))
+	{
+		ref_app_breathing_config_destroy(context->config);
+		context->config = new_config;
+		memcpy(values, new_values, sizeof(new_values));
+
+		return RECONFIGURE_IN_PLACE;
+	}
+
+	ref_app_breathing_handle_t *new_handle  = ref_app_breathing_create(new_config);
+	uint32_t                    buffer_size = 0U;
+
+	if ((new_handle == NULL) || !ref_app_breathing_get_buffer_size(new_handle, &buffer_size))
+	{
+		ref_app_breathing_destroy(new_handle);
+		ref_app_breathing_config_destroy(new_config);
+		snprintf(reply, reply_size, "error failed to create handle");
+		return RECONFIGURE_REJECTED;
+	}
+
+	void *old_buffer = recovery->buffer;
+	void *new_buffer = (buffer_size > recovery->buffer_size) ? acc_integration_mem_alloc(buffer_size) : old_buffer;
+
+	if (new_buffer == NULL)
+	{
+		ref_app_breathing_destroy(new_handle);
+		ref_app_breathing_config_destroy(new_config);
+		snprintf(reply, reply_size, "error failed to allocate buffer");
+		return RECONFIGURE_REJECTED;
+	}
+
+	breathing_context_t old_context     = *context;
+	uint32_t            old_buffer_size = recovery->buffer_size;
+
+	context->handle = new_handle;
+	context->config = new_config;
+
+	if (new_buffer != old_buffer)
+	{
+		recovery->buffer      = new_buffer;
+		recovery->buffer_size = buffer_size;
+	}
+
+	if (acc_sensor_recovery_prepare(recovery))
+	{
+		ref_app_breathing_destroy(old_context.handle);
+		ref_app_breathing_config_destroy(old_context.config);
+
+		if (new_buffer != old_buffer)
+		{
+			acc_integration_mem_free(old_buffer);
+		}
+
+		memcpy(values, new_values, sizeof(new_values));
+
+		return RECONFIGURE_PREPARED;
+	}
+
+	// The sensor did not accept the new configuration, go back to the old one
+	*context              = old_context;
+	recovery->buffer      = old_buffer;
+	recovery->buffer_size = old_buffer_size;
+
+	ref_app_breathing_destroy(new_handle);
+	ref_app_breathing_config_destroy(new_config);
+
+	if (new_buffer != old_buffer)
+	{
+		acc_integration_mem_free(new_buffer);
+	}
+
+	snprintf(reply, reply_size, "error sensor prepare failed");
+
+	return acc_sensor_recovery_prepare(recovery) ? RECONFIGURE_REJECTED : RECONFIGURE_FAILED;
+}
+
+static ref_app_breathing_config_t *create_config(const acc_control_value_t *values)
+{
+	ref_app_breathing_config_t *config = ref_app_breathing_config_create();
+
+	if (config != NULL)
+	{
+		set_config(config, DEFAULT_PRESET_CONFIG);
+
+		for (uint16_t i = 0U; i < NUM_PARAMS; i++)
+		{
+			set_param(config, (control_param_t)i, values[i]);
+		}
+	}
+
+	return config;
+}
+
+static bool values_equal(acc_control_value_type_t type, acc_control_value_t a, acc_control_value_t b)
+{
+	switch (type)
+	{
+		case ACC_CONTROL_VALUE_U16:
+			return a.u16 == b.u16;
+		case ACC_CONTROL_VALUE_FLOAT:
+			return a.f32 == b.f32;
+		case ACC_CONTROL_VALUE_BOOL:
+			return a.b == b.b;
+		default:
+			return false;
+	}
+}
+
+static acc_control_value_t get_param(const ref_app_breathing_config_t *config, control_param_t param)
+{
+	acc_control_value_t value = {0};
+
+	switch (param)
+	{
+		case PARAM_TIME_SERIES_LENGTH_S:
+			value.u16 = config->time_series_length_s;
+			break;
+		case PARAM_LOWEST_BREATHING_RATE:
+			value.u16 = config->lowest_breathing_rate;
+			break;
+		case PARAM_HIGHEST_BREATHING_RATE:
+			value.u16 = config->highest_breathing_rate;
+			break;
+		case PARAM_NUM_DISTS_TO_ANALYZE:
+			value.u16 = config->num_dists_to_analyze;
+			break;
+		case PARAM_USE_PRESENCE_PROCESSOR:
+			value.b = config->use_presence_processor;
+			break;
+		case PARAM_DISTANCE_DETERMINATION_DURATION_S:
+			value.u16 = config->distance_determination_duration_s;
+			break;
+		case PARAM_USE_EARLY_DISTANCE_LOCK:
+			value.b = config->use_early_distance_lock;
+			break;
+		case PARAM_USE_SOS_FILTERS:
+			value.b = config->use_sos_filters;
+			break;
+		case PARAM_START_M:
+			value.f32 = acc_detector_presence_config_start_get(config->presence_config);
+			break;
+		case PARAM_END_M:
+			value.f32 = acc_detector_presence_config_end_get(config->presence_config);
+			break;
+		case PARAM_FRAME_RATE:
+			value.f32 = acc_detector_presence_config_frame_rate_get(config->presence_config);
+			break;
+		case PARAM_INTRA_DETECTION_THRESHOLD:
+			value.f32 = acc_detector_presence_config_intra_detection_threshold_get(config->presence_config);
+			break;
+		case NUM_PARAMS:
+		default:
+			break;
+	}
+
+	return value;
+}
+
+static void set_param(ref_app_breathing_config_t *config, control_param_t param, acc_control_value_t value)
+{
+	switch (param)
+	{
+		case PARAM_TIME_SERIES_LENGTH_S:
+			config->time_series_length_s = value.u16;
+			break;
+		case PARAM_LOWEST_BREATHING_RATE:
+			config->lowest_breathing_rate = value.u16;
+			break;
+		case PARAM_HIGHEST_BREATHING_RATE:
+			config->highest_breathing_rate = value.u16;
+			break;
+		case PARAM_NUM_DISTS_TO_ANALYZE:
+			config->num_dists_to_analyze = value.u16;
+			break;
+		case PARAM_USE_PRESENCE_PROCESSOR:
+			config->use_presence_processor = value.b;
+			break;
+		case PARAM_DISTANCE_DETERMINATION_DURATION_S:
+			config->distance_determination_duration_s = value.u16;
+			break;
+		case PARAM_USE_EARLY_DISTANCE_LOCK:
+			config->use_early_distance_lock = value.b;
+			break;
+		case PARAM_USE_SOS_FILTERS:
+			config->use_sos_filters = value.b;
+			break;
+		case PARAM_START_M:
+			acc_detector_presence_config_start_set(config->presence_config, value.f32);
+			break;
+		case PARAM_END_M:
+			acc_detector_presence_config_end_set(config->presence_config, value.f32);
+			break;
+		case PARAM_FRAME_RATE:
+			acc_detector_presence_config_frame_rate_set(config->presence_config, value.f32);
+			break;
+		case PARAM_INTRA_DETECTION_THRESHOLD:
+			acc_detector_presence_config_intra_detection_threshold_set(config->presence_config, value.f32);
+			break;
+		case NUM_PARAMS:
+		default:
+			break;
+	}
 }
@@ -100,6 +100,8 @@ int main(int argc, char *argv[])
 
 		if (data_reliable)
 		{
+			acc_integration_mem_steady_state_begin();
+
 			if (parking_config.obstruction_detection_enabled)
 			{
 				ref_app_parking_obstruction_process(handle, &obstruction_detected);
@@ -109,6 +111,8 @@ int main(int argc, char *argv[])
 
 			ref_app_parking_process(handle, &car_detected);
 
+			acc_integration_mem_steady_state_end();
+
 			printf("car_detected: %s\n", car_detected ? "true" : "false");
 		}
 	}
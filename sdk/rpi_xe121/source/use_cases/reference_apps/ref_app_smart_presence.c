@@ -727,7 +727,11 @@ static bool detector_get_next(app_context_t *context, acc_detector_presence_resu
 		return EXIT_FAILURE;
 	}
 
-	if (!acc_detector_presence_process(context->current_context->detector_handle, context->buffer, detector_result))
+	acc_integration_mem_steady_state_begin();
+	bool process_ok = acc_detector_presence_process(context->current_context->detector_handle, context->buffer, detector_result);
+	acc_integration_mem_steady_state_end();
+
+	if (!process_ok)
 	{
 		printf("acc_detector_presence_process failed\n");
 		return EXIT_FAILURE;
@@ -586,12 +586,16 @@ static bool detector_get_next(app_context_t *context, const acc_cal_result_t *se
 			return false;
 		}
 
-		if (!acc_detector_distance_process(context->detector_handle,
-		                                   context->buffer,
-		                                   context->detector_cal_result_static,
-		                                   &context->detector_cal_result_dynamic,
-		                                   &result_available,
-		                                   detector_result))
+		acc_integration_mem_steady_state_begin();
+		bool process_ok = acc_detector_distance_process(context->detector_handle,
+		                                                context->buffer,
+		                                                context->detector_cal_result_static,
+		                                                &context->detector_cal_result_dynamic,
+		                                                &result_available,
+		                                                detector_result);
+		acc_integration_mem_steady_state_end();
+
+		if (!process_ok)
 		{
 			printf("acc_detector_distance_process() failed\n");
 			return false;
@@ -12,15 +12,18 @@
 #include <string.h>
 
 #include "acc_algorithm.h"
+#include "acc_algorithm_shaped.h"
 #include "acc_config.h"
 #include "acc_definitions_common.h"
 #include "acc_hal_definitions_a121.h"
+#include "acc_hal_fault_injection.h"
 #include "acc_hal_integration_a121.h"
 #include "acc_integration.h"
 #include "acc_integration_log.h"
 #include "acc_processing.h"
 #include "acc_rss_a121.h"
 #include "acc_sensor.h"
+#include "acc_sensor_recovery.h"
 #include "acc_version.h"
 
 #define SENSOR_ID (1U)
@@ -108,7 +111,7 @@ typedef enum
 typedef struct
 {
 	acc_touchless_button_config_t config;
-	acc_sensor_t                 *sensor;
+	acc_sensor_recovery_t         recovery;
 	acc_processing_t             *processing;
 	acc_processing_metadata_t     proc_metadata;
 	acc_processing_result_t       proc_result;
@@ -141,6 +144,9 @@ typedef struct
 	uint16_t                      far_non_signal;
 	bool                          close_detection;
 	bool                          far_detection;
+
+	// Specialised for the shape of the presets, or the generic function for other configurations
+	acc_algorithm_roll_and_push_mult_matrix_i16_complex_func_t roll_and_push_background;
 } acc_touchless_button_handle_t;
 
 /**
@@ -178,7 +184,7 @@ static void reset_background(acc_touchless_button_handle_t *handle);
 
 static bool init_sensor(acc_touchless_button_handle_t *handle);
 
-static bool do_sensor_calibration_and_prepare(acc_touchless_button_handle_t *handle);
+static bool prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size, void *user_data);
 
 static bool measure(acc_touchless_button_handle_t *handle);
 
@@ -200,7 +206,7 @@ int main(int argc, char *argv[])
 	(void)argv;
 
 	acc_touchless_button_handle_t handle;
-	handle.sensor                      = NULL;
+	handle.recovery                    = (acc_sensor_recovery_t){.sensor_id = SENSOR_ID};
 	handle.processing                  = NULL;
 	handle.buffer                      = NULL;
 	handle.double_buffer_filter_buffer = NULL;
@@ -216,7 +222,7 @@ int main(int argc, char *argv[])
 
 	printf("Acconeer software version %s\n", acc_version_get());
 
-	const acc_hal_a121_t *hal = acc_hal_rss_integration_get_implementation();
+	const acc_hal_a121_t *hal = acc_hal_fault_injection_get_implementation(acc_hal_rss_integration_get_implementation());
 
 	if (!acc_rss_hal_register(hal))
 	{
@@ -257,6 +263,7 @@ int main(int argc, char *argv[])
 
 	while (true)
 	{
+		// Sensor faults are recovered in-process, only give up if the recovery fails
 		if (!measure(&handle))
 		{
 			printf("Failed to measure\n");
@@ -280,10 +287,9 @@ int main(int argc, char *argv[])
 			printf("The current calibration is not valid for the current temperature.\n");
 			printf("The sensor needs to be re-calibrated.\n");
 
-			if (!do_sensor_calibration_and_prepare(&handle))
+			if (!acc_sensor_recovery_recalibrate(&handle.recovery))
 			{
-				printf("do_sensor_calibration_and_prepare() failed\n");
-				acc_sensor_status(handle.sensor);
+				printf("acc_sensor_recovery_recalibrate() failed\n");
 				cleanup(&handle);
 				return EXIT_FAILURE;
 			}
@@ -296,7 +302,11 @@ int main(int argc, char *argv[])
 		{
 			acc_touchless_button_result_t result = {0};
 
-			if (!process(&handle, &result))
+			acc_integration_mem_steady_state_begin();
+			bool process_ok = process(&handle, &result);
+			acc_integration_mem_steady_state_end();
+
+			if (!process_ok)
 			{
 				printf("Failed to process sensor result\n");
 				cleanup(&handle);
@@ -316,19 +326,14 @@ int main(int argc, char *argv[])
 
 static void cleanup(acc_touchless_button_handle_t *handle)
 {
-	acc_hal_integration_sensor_disable(SENSOR_ID);
-	acc_hal_integration_sensor_supply_off(SENSOR_ID);
+	acc_sensor_recovery_print_stats(&handle->recovery);
+	acc_sensor_recovery_stop(&handle->recovery);
 
 	if (handle->config.sensor_config != NULL)
 	{
 		acc_config_destroy(handle->config.sensor_config);
 	}
 
-	if (handle->sensor != NULL)
-	{
-		acc_sensor_destroy(handle->sensor);
-	}
-
 	if (handle->processing != NULL)
 	{
 		acc_processing_destroy(handle->processing);
@@ -580,6 +585,8 @@ static bool init_handle(acc_touchless_button_handle_t *handle)
 		handle->cal_sweeps          = (uint16_t)((sweep_rate * handle->config.calibration_duration_s) + 0.5f);
 		uint16_t num_points         = handle->proc_metadata.sweep_data_length;
 
+		handle->roll_and_push_background = acc_algorithm_shaped_roll_and_push_mult_matrix_i16_complex(handle->cal_sweeps, num_points, spf);
+
 		handle->double_buffer_filter_buffer = acc_integration_mem_alloc((spf - 2U) * sizeof(*handle->double_buffer_filter_buffer));
 		handle->frame_variance              = acc_integration_mem_alloc(handle->proc_metadata.frame_data_length * sizeof(*handle->frame_variance));
 		handle->arg_norm                    = acc_integration_mem_alloc(handle->proc_metadata.sweep_data_length * sizeof(*handle->arg_norm));
@@ -645,81 +652,33 @@ static void reset_background(acc_touchless_button_handle_t *handle)
 
 static bool init_sensor(acc_touchless_button_handle_t *handle)
 {
-	acc_hal_integration_sensor_supply_on(SENSOR_ID);
-	acc_hal_integration_sensor_enable(SENSOR_ID);
-
-	handle->sensor = acc_sensor_create(SENSOR_ID);
-
-	if (handle->sensor == NULL)
-	{
-		return false;
-	}
-
-	if (!do_sensor_calibration_and_prepare(handle))
-	{
-		return false;
-	}
-
-	return true;
+	handle->recovery.buffer             = handle->buffer;
+	handle->recovery.buffer_size        = handle->buffer_size;
+	handle->recovery.timeout_ms         = SENSOR_TIMEOUT_MS;
+	handle->recovery.prepare            = prepare;
+	handle->recovery.prepare_user_data  = handle;
+	handle->recovery.wait_for_interrupt = acc_hal_fault_injection_wait_for_sensor_interrupt;
+
+	return acc_sensor_recovery_start(&handle->recovery);
 }
 
-static bool do_sensor_calibration_and_prepare(acc_touchless_button_handle_t *handle)
+static bool prepare(acc_sensor_t *sensor, const acc_cal_result_t *cal_result, void *buffer, uint32_t buffer_size, void *user_data)
 {
-	bool             status       = false;
-	bool             cal_complete = false;
-	acc_cal_result_t cal_result;
-	const uint16_t   calibration_retries = 1U;
-
-	// Random disturbances may cause the calibration to fail. At failure, retry at least once.
-	for (uint16_t i = 0; !status && (i <= calibration_retries); i++)
-	{
-		// Reset sensor before calibration by disabling/enabling it
-		acc_hal_integration_sensor_disable(SENSOR_ID);
-		acc_hal_integration_sensor_enable(SENSOR_ID);
+	acc_touchless_button_handle_t *handle = user_data;
 
-		do
-		{
-			status = acc_sensor_calibrate(handle->sensor, &cal_complete, &cal_result, handle->buffer, handle->buffer_size);
-
-			if (status && !cal_complete)
-			{
-				status = acc_hal_integration_wait_for_sensor_interrupt(SENSOR_ID, SENSOR_TIMEOUT_MS);
-			}
-		} while (status && !cal_complete);
-	}
-
-	if (status)
+	if (!acc_sensor_prepare(sensor, handle->config.sensor_config, cal_result, buffer, buffer_size))
 	{
-		// Reset sensor after calibration by disabling/enabling it
-		acc_hal_integration_sensor_disable(SENSOR_ID);
-		acc_hal_integration_sensor_enable(SENSOR_ID);
-
-		status = acc_sensor_prepare(handle->sensor, handle->config.sensor_config, &cal_result, handle->buffer, handle->buffer_size);
+		printf("acc_sensor_prepare() failed\n");
+		return false;
 	}
 
-	return status;
+	return true;
 }
 
 static bool measure(acc_touchless_button_handle_t *handle)
 {
-	if (!acc_sensor_measure(handle->sensor))
-	{
-		printf("acc_sensor_measure failed\n");
-		acc_sensor_status(handle->sensor);
-		return false;
-	}
-
-	if (!acc_hal_integration_wait_for_sensor_interrupt(SENSOR_ID, SENSOR_TIMEOUT_MS))
-	{
-		printf("Sensor interrupt timeout\n");
-		acc_sensor_status(handle->sensor);
-		return false;
-	}
-
-	if (!acc_sensor_read(handle->sensor, handle->buffer, handle->buffer_size))
+	if (!acc_sensor_recovery_measure(&handle->recovery))
 	{
-		printf("acc_sensor_read failed\n");
-		acc_sensor_status(handle->sensor);
 		return false;
 	}
 
@@ -806,12 +765,12 @@ static void update_background(acc_touchless_button_handle_t *handle)
 {
 	uint16_t spf = acc_config_sweeps_per_frame_get(handle->config.sensor_config);
 
-	acc_algorithm_roll_and_push_mult_matrix_i16_complex(handle->dynamic_background,
-	                                                    handle->cal_sweeps,
-	                                                    handle->proc_metadata.sweep_data_length,
-	                                                    handle->dynamic_background_guard,
-	                                                    acc_config_sweeps_per_frame_get(handle->config.sensor_config),
-	                                                    false);
+	handle->roll_and_push_background(handle->dynamic_background,
+	                                 handle->cal_sweeps,
+	                                 handle->proc_metadata.sweep_data_length,
+	                                 handle->dynamic_background_guard,
+	                                 acc_config_sweeps_per_frame_get(handle->config.sensor_config),
+	                                 false);
 
 	handle->rows_in_dynamic_background += spf;
 	handle->rows_in_dynamic_background =
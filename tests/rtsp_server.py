@@ -5,88 +5,167 @@ gi.require_version('Gst', '1.0')
 gi.require_version('GstRtspServer', '1.0')
 from gi.repository import Gst, GstRtspServer, GLib
 
-from picamera2 import Picamera2
-# from libcamera import controls # Not strictly needed if using integer/string values directly
-
+import argparse
+import os
+import resource
 import signal
 import sys
 import socket
+import time
 
 Gst.init(None)
 
-# --- Picamera2 Configuration ---
-picam2 = Picamera2()
-# Default resolution and framerate, adjust as needed
-# video_config = picam2.create_video_configuration(main={"size": (1280, 720), "format": "RGB888"},
-                                                #  lores={"size": (640, 360), "format": "YUV420"},
-                                                #  controls={"FrameRate": 30})
+# --- Capture Configuration ---
+# 2K resolution and 30fps framerate
+CAPTURE_WIDTH = 2048
+CAPTURE_HEIGHT = 1080
+CAPTURE_FPS = 30
+gst_format = "I420"
 
-# # 2K resolution
-# video_config = picam2.create_video_configuration(main={"size": (1920, 1080), "format": "RGB888"},
-#                                                  lores={"size": (1920, 1080), "format": "YUV420"},
-#                                                  controls={"FrameRate": 60})
+# --- Encoder Configuration ---
+# Every setting can be overridden from the environment (e.g. in the systemd unit) or the command line.
+# "auto" uses the hardware encoder when the v4l2h264enc element exists and falls back to x264enc otherwise.
+ENCODER = os.environ.get("RTSP_ENCODER", "auto")  # auto, hardware or software
+BITRATE_KBPS = int(os.environ.get("RTSP_BITRATE_KBPS", "25000"))
+I_FRAME_PERIOD = int(os.environ.get("RTSP_I_FRAME_PERIOD", "60"))
+H264_LEVEL = os.environ.get("RTSP_H264_LEVEL", "auto")  # auto or a level such as 4.2
+# dmabuf-import lets v4l2h264enc encode the libcamerasrc buffers in place, without a copy through system memory
+HW_OUTPUT_IO_MODE = os.environ.get("RTSP_HW_OUTPUT_IO_MODE", "dmabuf-import")
+X264_SPEED_PRESET = os.environ.get("RTSP_X264_SPEED_PRESET", "ultrafast")
 
-# 2K resolution and 30fps framerate
-video_config = picam2.create_video_configuration(main={"size": (2048, 1080), "format": "RGB888"},
-                                                 lores={"size": (2048, 1080), "format": "YUV420"},
-                                                 controls={"FrameRate": 30})
+HW_ENCODER = "v4l2h264enc"
+SW_ENCODER = "x264enc"
 
+# H.264 levels the Pi encoder supports: (level, V4L2 h264_level control value, max macroblocks/s, max frame size in macroblocks)
+H264_LEVELS = [
+    ("3.1", 9, 108000, 3600),
+    ("3.2", 10, 216000, 5120),
+    ("4", 11, 245760, 8192),
+    ("4.1", 12, 245760, 8192),
+    ("4.2", 13, 522240, 8704),
+]
 
-picam2.configure(video_config)
-picam2.start()
-picam2.stop()
 
-gst_format = "I420"
-width = video_config['lores']['size'][0]
-height = video_config['lores']['size'][1]
-framerate = int(video_config['controls']['FrameRate'])
-stride = video_config['lores']['stride']
+def probe_camera():
+    """Configure the camera once with Picamera2 to get the lores stream parameters for libcamerasrc"""
+    from picamera2 import Picamera2
+
+    picam2 = Picamera2()
+    video_config = picam2.create_video_configuration(main={"size": (CAPTURE_WIDTH, CAPTURE_HEIGHT), "format": "RGB888"},
+                                                     lores={"size": (CAPTURE_WIDTH, CAPTURE_HEIGHT), "format": "YUV420"},
+                                                     controls={"FrameRate": CAPTURE_FPS})
+
+    picam2.configure(video_config)
+    picam2.start()
+    picam2.stop()
+
+    width = video_config['lores']['size'][0]
+    height = video_config['lores']['size'][1]
+    framerate = int(video_config['controls']['FrameRate'])
+    stride = video_config['lores']['stride']
+
+    # Close the Picamera2 instance to release libcamera resources before libcamerasrc uses them
+    picam2.close()
+    print("Picamera2 instance closed.")
+    print(f"Camera parameters for GStreamer: {width}x{height} @{framerate}fps, Format: {gst_format}, Stride: {stride}")
+
+    return width, height, framerate
+
+
+def select_encoder(requested):
+    """Resolve auto to the hardware encoder when it is available"""
+    hw_available = Gst.ElementFactory.find(HW_ENCODER) is not None
+
+    if requested == "hardware" and not hw_available:
+        raise RuntimeError(f"{HW_ENCODER} is not available")
+    if requested == "auto":
+        if not hw_available:
+            print(f"{HW_ENCODER} not found, falling back to software encoding with {SW_ENCODER}")
+        return "hardware" if hw_available else "software"
+    return requested
+
+
+def select_h264_level(width, height, framerate, requested):
+    """Pick the lowest level that fits the macroblock rate, the encoder rejects streams above the negotiated level"""
+    macroblocks = ((width + 15) // 16) * ((height + 15) // 16)
+
+    for level, control, max_mbps, max_fs in H264_LEVELS:
+        if requested == "auto":
+            if macroblocks <= max_fs and macroblocks * framerate <= max_mbps:
+                return level, control
+        elif requested == level:
+            return level, control
+
+    if requested != "auto":
+        raise ValueError(f"Unsupported H.264 level {requested}")
+
+    print(f"{width}x{height}@{framerate} exceeds H.264 level {H264_LEVELS[-1][0]}, the hardware encoder may refuse it")
+    return H264_LEVELS[-1][0], H264_LEVELS[-1][1]
+
+
+def build_encoder(encoder, width, height, framerate, settings, io_mode):
+    """Encoder part of the pipeline, from raw I420 to H.264 with the parameters RTSP clients need in-band"""
+    bitrate_bps = settings.bitrate_kbps * 1000
+
+    if encoder == "hardware":
+        level, level_control = select_h264_level(width, height, framerate, settings.h264_level)
+        extra_controls = (
+            f'extra-controls="controls,'
+            f'video_bitrate_mode=1,video_bitrate={bitrate_bps},'
+            f'h264_profile=4,h264_level={level_control},h264_i_frame_period={settings.i_frame_period},'
+            f'repeat_sequence_header=1"'
+        )
+        return (
+            f"{HW_ENCODER} output-io-mode={io_mode} {extra_controls} ! "
+            f"video/x-h264,profile=high,level=(string){level} ! "
+            f"h264parse config-interval=-1"
+        )
+
+    # x264enc takes I420 directly, so no videoconvert is needed here either
+    return (
+        f"{SW_ENCODER} speed-preset={settings.x264_speed_preset} tune=zerolatency "
+        f"bitrate={settings.bitrate_kbps} key-int-max={settings.i_frame_period} ! "
+        f"h264parse config-interval=-1"
+    )
+
+
+def build_launch_string(source, encoder, width, height, framerate, settings, io_mode, sink="rtph264pay name=pay0 pt=96"):
+    """The raw caps are fixed to what the camera produces so the buffers go to the encoder as they are"""
+    return (
+        f"{source} ! "
+        f"video/x-raw,format={gst_format},width={width},height={height},framerate={framerate}/1 ! "
+        f"{build_encoder(encoder, width, height, framerate, settings, io_mode)} ! "
+        f"{sink}"
+    )
+
+
+def camera_source():
+    # AfMode: 0=manual, 1=auto, 2=continuous
+    # AfSpeed: 0=normal, 1=fast
+    # AfRange: 0=normal, 1=macro, 2=full
+    af_mode_val = 2      # continuous
+    af_speed_val = 0     # normal
+    af_range_val = 2     # full
 
-picam2.close()
-print("Picamera2 instance closed.")
-print(f"Camera parameters for GStreamer: {width}x{height} @{framerate}fps, Format: {gst_format}, Stride: {stride}")
+    return f"libcamerasrc af-mode={af_mode_val} af-speed={af_speed_val} af-range={af_range_val}"
 
 
 # --- GStreamer RTSP Server Configuration ---
 class SensorFactory(GstRtspServer.RTSPMediaFactory):
-    def __init__(self, **properties):
+    def __init__(self, launch_string, **properties):
         super(SensorFactory, self).__init__(**properties)
 
-        # Define autofocus settings based on your gst-inspect output
-        # AfMode: 0=manual, 1=auto, 2=continuous
-        # AfSpeed: 0=normal, 1=fast
-        # AfRange: 0=normal, 1=macro, 2=full
-        
-        # Property names from your gst-inspect output appear to be lowercase with hyphens:
-        # e.g., af-mode, af-speed, af-range
-        
-        # Note: GStreamer property values can sometimes be integers or string representations of the enum
-        # Check gst-inspect output for default values and accepted types if unsure.
-        # For enums, integer values are usually reliable.
-        af_mode_val = 2      # continuous
-        af_speed_val = 0     # normal
-        af_range_val = 2     # full
-
-        # Construct the libcamerasrc element with direct properties
-        # Ensure property names match exactly what gst-inspect-1.0 libcamerasrc shows
-        self.launch_string = (
-            f"libcamerasrc af-mode={af_mode_val} af-speed={af_speed_val} af-range={af_range_val} ! "
-            f"video/x-raw,format={gst_format},width={width},height={height},framerate={framerate}/1 ! "
-            f"videoconvert ! "
-            #f"x264enc speed-preset=ultrafast tune=zerolatency bitrate=1500 ! "
-            f"x264enc speed-preset=ultrafast tune=zerolatency bitrate=25000 ! "
-            f"rtph264pay name=pay0 pt=96"
-        )
+        self.launch_string = launch_string
         print(f"Using GStreamer launch string: {self.launch_string}")
 
     def do_create_element(self, url):
         return Gst.parse_launch(self.launch_string)
 
-# ... (rest of your GstServer, signal_handler, and main block remains the same) ...
+
 class GstServer():
-    def __init__(self):
+    def __init__(self, launch_string):
         self.server = GstRtspServer.RTSPServer()
-        self.factory = SensorFactory()
+        self.factory = SensorFactory(launch_string)
         self.factory.set_shared(True)
 
         mounts = self.server.get_mount_points()
@@ -105,6 +184,86 @@ class GstServer():
         print(f"RTSP server started on rtsp://{self.ip_address}:8554/stream")
         print("Press Ctrl+C to stop the server.")
 
+
+# --- Self-test ---
+def run_pipeline(name, launch_string, timeout_s):
+    """Run a pipeline to EOS and return the CPU load of this process while it ran, None if it failed"""
+    try:
+        pipeline = Gst.parse_launch(launch_string)
+    except GLib.Error as e:
+        print(f"{name}: pipeline does not build: {e}")
+        return None
+
+    usage_start = resource.getrusage(resource.RUSAGE_SELF)
+    wall_start = time.monotonic()
+
+    pipeline.set_state(Gst.State.PLAYING)
+    message = pipeline.get_bus().timed_pop_filtered(int(timeout_s * Gst.SECOND), Gst.MessageType.EOS | Gst.MessageType.ERROR)
+
+    wall_s = time.monotonic() - wall_start
+    usage_end = resource.getrusage(resource.RUSAGE_SELF)
+    pipeline.set_state(Gst.State.NULL)
+
+    if message is None or message.type == Gst.MessageType.ERROR:
+        error = message.parse_error()[0].message if message is not None else "timeout"
+        print(f"{name}: pipeline failed: {error}")
+        return None
+
+    cpu_s = (usage_end.ru_utime - usage_start.ru_utime) + (usage_end.ru_stime - usage_start.ru_stime)
+    return 100.0 * cpu_s / wall_s
+
+
+def self_test(settings, width, height, framerate, seconds):
+    """Build and run each available pipeline from videotestsrc and compare the CPU load"""
+    num_buffers = int(seconds * framerate)
+    # videotestsrc has no dmabufs to import, so the hardware encoder copies its input here
+    source = f"videotestsrc is-live=true pattern=ball num-buffers={num_buffers}"
+    sink = "rtph264pay pt=96 ! fakesink sync=false"
+
+    candidates = [
+        # The pipeline this server used before, with a videoconvert copy of the I420 frames
+        ("x264enc + videoconvert", (
+            f"{source} ! video/x-raw,format={gst_format},width={width},height={height},framerate={framerate}/1 ! "
+            f"videoconvert ! x264enc speed-preset=ultrafast tune=zerolatency bitrate={settings.bitrate_kbps} ! {sink}")),
+        ("x264enc", build_launch_string(source, "software", width, height, framerate, settings, "auto", sink)),
+    ]
+
+    if Gst.ElementFactory.find(HW_ENCODER) is not None:
+        candidates.append((HW_ENCODER, build_launch_string(source, "hardware", width, height, framerate, settings, "auto", sink)))
+    else:
+        print(f"{HW_ENCODER} not available, only the software pipelines are tested")
+
+    all_ok = True
+    print(f"Running each pipeline for {num_buffers} frames of {width}x{height}@{framerate}")
+
+    for name, launch_string in candidates:
+        if Gst.ElementFactory.find(SW_ENCODER) is None and name.startswith(SW_ENCODER):
+            print(f"{name}: skipped, {SW_ENCODER} not available")
+            continue
+
+        cpu_percent = run_pipeline(name, launch_string, seconds * 4 + 10)
+
+        if cpu_percent is None:
+            all_ok = False
+        else:
+            print(f"{name}: OK, CPU {cpu_percent:.0f}% of one core")
+
+    return all_ok
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="RTSP server for the Pi camera")
+    parser.add_argument("--encoder", choices=["auto", "hardware", "software"], default=ENCODER)
+    parser.add_argument("--bitrate-kbps", type=int, default=BITRATE_KBPS)
+    parser.add_argument("--i-frame-period", type=int, default=I_FRAME_PERIOD)
+    parser.add_argument("--h264-level", default=H264_LEVEL)
+    parser.add_argument("--hw-output-io-mode", default=HW_OUTPUT_IO_MODE, help="v4l2h264enc output-io-mode, e.g. dmabuf-import or auto")
+    parser.add_argument("--x264-speed-preset", default=X264_SPEED_PRESET)
+    parser.add_argument("--self-test", action="store_true", help="run the pipelines from videotestsrc and compare the CPU load, no camera needed")
+    parser.add_argument("--self-test-seconds", type=float, default=10.0)
+    return parser.parse_args()
+
+
 loop = GLib.MainLoop()
 
 def signal_handler(sig, frame):
@@ -116,7 +275,16 @@ signal.signal(signal.SIGINT, signal_handler)
 signal.signal(signal.SIGTERM, signal_handler)
 
 if __name__ == '__main__':
-    server = GstServer()
+    settings = parse_args()
+
+    if settings.self_test:
+        sys.exit(0 if self_test(settings, CAPTURE_WIDTH, CAPTURE_HEIGHT, CAPTURE_FPS, settings.self_test_seconds) else 1)
+
+    width, height, framerate = probe_camera()
+    encoder = select_encoder(settings.encoder)
+    launch_string = build_launch_string(camera_source(), encoder, width, height, framerate, settings, settings.hw_output_io_mode)
+
+    server = GstServer(launch_string)
     try:
         loop.run()
     except Exception as e: